@@ -58,14 +58,11 @@ vector<string> get_label_list(const string &label_file) {
   return lines;
 }
 
-void test(const string &model_file,
-          const string &trained_file,
+void test(network<sequential> *net,
           const string &mean_file,
           const string &label_file,
           const string &img_file) {
   auto labels = get_label_list(label_file);
-  auto net    = create_net_from_caffe_prototxt(model_file);
-  reload_weight_from_caffe_protobinary(trained_file, net.get());
 
   // int channels = (*net)[0]->in_data_shape()[0].depth_;
   int width  = (*net)[0]->in_data_shape()[0].width_;
@@ -100,16 +97,39 @@ void test(const string &model_file,
   }
 }
 
-int main(int argc, char **argv) {
-  int arg_channel     = 1;
-  string model_file   = argv[arg_channel++];
-  string trained_file = argv[arg_channel++];
-  string mean_file    = argv[arg_channel++];
-  string label_file   = argv[arg_channel++];
-  string img_file     = argv[arg_channel++];
+shared_ptr<network<sequential>> load_caffe(const string &model_file,
+                                           const string &trained_file) {
+  auto net = create_net_from_caffe_prototxt(model_file);
+  reload_weight_from_caffe_protobinary(trained_file, net.get());
+  return net;
+}
 
+void usage() {
+  cout << "usage:\n"
+       << "  caffe_converter pack [model-file] [trained-file] [packed-file]\n"
+       << "  caffe_converter [packed-file] [mean-file] [label-file] "
+          "[img-file]\n"
+       << "  caffe_converter [model-file] [trained-file] [mean-file] "
+          "[label-file] [img-file]"
+       << endl;
+}
+
+int main(int argc, char **argv) {
   try {
-    test(model_file, trained_file, mean_file, label_file, img_file);
+    if (argc == 5 && string(argv[1]) == "pack") {
+      // parse the caffemodel once and write it pre-packed for serving
+      save_packed(*load_caffe(argv[2], argv[3]), string(argv[4]));
+    } else if (argc == 5) {
+      network<sequential> net;
+      load_packed(net, string(argv[1]));
+      test(&net, argv[2], argv[3], argv[4]);
+    } else if (argc == 6) {
+      auto net = load_caffe(argv[1], argv[2]);
+      test(net.get(), argv[3], argv[4], argv[5]);
+    } else {
+      usage();
+      return 1;
+    }
   } catch (const nn_error &e) {
     cout << e.what() << endl;
   }
@@ -0,0 +1,33 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+
+/* runs the C emitted by c_code_generator_emit and compares every output
+   with the one predict() produced on backend_t::internal */
+
+#include <stdio.h>
+
+#include "ref_data.h"
+#include "ref_net.h"
+
+int main(void) {
+  int s, i, mismatches = 0;
+
+  for (s = 0; s < REF_SAMPLES; s++) {
+    ref_real out[REF_OUT_SIZE];
+    ref_predict(ref_inputs[s], out);
+    for (i = 0; i < REF_OUT_SIZE; i++) {
+      if (out[i] != ref_outputs[s][i]) {
+        printf("sample %d, output %d: %a, expected %a\n", s, i,
+               (double)out[i], (double)ref_outputs[s][i]);
+        mismatches++;
+      }
+    }
+  }
+  printf("%d of %d outputs differ\n", mismatches, REF_SAMPLES * REF_OUT_SIZE);
+  return mismatches != 0;
+}
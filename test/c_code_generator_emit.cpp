@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+
+// writes ref_net.h/ref_net.c, generated by c_code_generator from a small
+// network on backend_t::internal, and ref_data.h with inputs and the
+// outputs of predict() for them. c_code_generator_check.c compiles against
+// all three and requires the outputs to be bit-identical.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "tiny_dnn/tiny_dnn.h"
+
+using namespace tiny_dnn;
+
+static const int num_samples = 8;
+
+static std::string hex(float_t v) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%a", static_cast<double>(v));
+  return buf;
+}
+
+static void write_array(std::ostream &os,
+                        const std::string &name,
+                        const std::vector<vec_t> &rows) {
+  os << "static const ref_real " << name << "[" << rows.size() << "]["
+     << rows[0].size() << "] = {\n";
+  for (const auto &row : rows) {
+    os << "  {";
+    for (size_t i = 0; i < row.size(); i++) {
+      os << (i ? ", " : "") << hex(row[i]);
+    }
+    os << "},\n";
+  }
+  os << "};\n\n";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    nn_warn("usage: c_code_generator_emit [output directory]");
+    return 1;
+  }
+  const std::string dir        = argv[1];
+  const core::backend_t engine = core::backend_t::internal;
+
+  network<sequential> net;
+  net << convolutional_layer(12, 12, 3, 2, 4, core::connection_table(2, 2, 4),
+                             padding::same, true, 1, 1, engine)
+      << elu_layer() << average_pooling_layer(12, 12, 4, 2)
+      << max_pooling_layer(6, 6, 4, 2, engine)
+      << fully_connected_layer(36, 10, true, engine) << tanh_layer()
+      << fully_connected_layer(10, 3, true, engine) << softmax_layer();
+  set_random_seed(5);
+  net.init_weight();
+
+  std::vector<vec_t> in, out;
+  for (int s = 0; s < num_samples; s++) {
+    vec_t x(net.in_data_size());
+    uniform_rand(x.begin(), x.end(), float_t(-1), float_t(1));
+    in.push_back(x);
+    out.push_back(net.predict(x));
+  }
+
+  c_code_generator gen(net, "ref");
+  std::ofstream h((dir + "/ref_net.h").c_str());
+  std::ofstream c((dir + "/ref_net.c").c_str());
+  std::ofstream d((dir + "/ref_data.h").c_str());
+  gen.generate_header(h);
+  gen.generate_source(c);
+
+  d << "/* generated by c_code_generator_emit, do not edit */\n"
+    << "typedef " << (sizeof(float_t) == sizeof(float) ? "float" : "double")
+    << " ref_real;\n\n#define REF_SAMPLES " << num_samples << "\n\n";
+  write_array(d, "ref_inputs", in);
+  write_array(d, "ref_outputs", out);
+
+  if (!h || !c || !d) {
+    nn_warn("failed to write to " + dir);
+    return 1;
+  }
+  return 0;
+}
@@ -15,29 +15,51 @@ using namespace tiny_dnn::activation;
 
 #include "test_average_pooling_layer.h"
 #include "test_network.h"
-// TODO(yida): fix broken test
-//#include "test_average_unpooling_layer.h"
+#include "test_average_unpooling_layer.h"
+#include "test_background_evaluator.h"
 #include "test_batch_norm_layer.h"
+#include "test_binary_convolutional_layer.h"
+#include "test_binary_fully_connected_layer.h"
+#include "test_c_code_generator.h"
+#include "test_channel_pruning.h"
 #include "test_concat_layer.h"
 #include "test_convolutional_layer.h"
 #include "test_core.h"
+#include "test_cost_model.h"
 #include "test_deconvolutional_layer.h"
 #include "test_dropout_layer.h"
+#include "test_early_exit_cascade.h"
+#include "test_ensemble.h"
+#include "test_execution_context.h"
+#include "test_fake_quantization.h"
 #include "test_fully_connected_layer.h"
 #include "test_global_average_pooling_layer.h"
+#include "test_hierarchical_softmax_layer.h"
 #include "test_large_thread_count.h"
+#include "test_layer_profiler.h"
+#include "test_low_rank_factorization.h"
 #include "test_lrn_layer.h"
 #include "test_max_pooling_layer.h"
+#include "test_max_unpooling_layer.h"
+#include "test_model_compression.h"
 #include "test_models.h"
 #include "test_node.h"
 #include "test_nodes.h"
+#include "test_optimizer_state.h"
+#include "test_packed_model.h"
 #include "test_power_layer.h"
 #include "test_quantization.h"
 #include "test_quantized_convolutional_layer.h"
 #include "test_quantized_deconvolutional_layer.h"
+#include "test_recurrent_layer.h"
+#include "test_sampled_softmax_layer.h"
 #include "test_slice_layer.h"
+#include "test_sparse_weights.h"
+#include "test_static_network.h"
 #include "test_target_cost.h"
+#include "test_telemetry.h"
 #include "test_tensor.h"
+#include "test_training_runner.h"
 
 #ifndef CNN_NO_SERIALIZATION
 #include "test_serialization.h"
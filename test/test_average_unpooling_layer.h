@@ -52,7 +52,9 @@ TEST(ave_unpool, forward) {
   l.bias_init(weight_init::constant(0.0));
   l.init_weight();
 
-  vec_t res = l.forward({{in}})[0][0];
+  std::vector<const tensor_t *> out;
+  l.forward({{in}}, out);
+  vec_t res = (*out[0])[0];
 
   for (size_t i = 0; i < expected.size(); i++) {
     EXPECT_FLOAT_EQ(expected[i], res[i]);
@@ -81,13 +83,49 @@ TEST(ave_unpool, forward_stride) {
   l.bias_init(weight_init::constant(0.0));
   l.init_weight();
 
-  vec_t res = l.forward({{in}})[0][0];
+  std::vector<const tensor_t *> out;
+  l.forward({{in}}, out);
+  vec_t res = (*out[0])[0];
 
   for (size_t i = 0; i < expected.size(); i++) {
     EXPECT_FLOAT_EQ(expected[i], res[i]);
   }
 }
 
+TEST(ave_unpool, backward_stride) {
+  average_unpooling_layer l(3, 3, 2, 2, 1);
+  l.weight_init(weight_init::constant(2.0));
+  l.init_weight();
+
+  vec_t in(18), delta(32);
+  uniform_rand(in.begin(), in.end(), -1.0, 1.0);
+  uniform_rand(delta.begin(), delta.end(), -1.0, 1.0);
+
+  std::vector<const tensor_t *> out;
+  l.forward({{in}}, out);
+  auto grads = l.backward(std::vector<tensor_t>{{delta}});
+
+  for (serial_size_t c = 0; c < 2; c++) {
+    float_t dw = 0, db = 0;
+    for (serial_size_t y = 0; y < 3; y++) {
+      for (serial_size_t x = 0; x < 3; x++) {
+        // each input covers the 2x2 window at its position
+        float_t g = 0;
+        for (serial_size_t dy = 0; dy < 2; dy++) {
+          for (serial_size_t dx = 0; dx < 2; dx++) {
+            g += delta[c * 16 + (y + dy) * 4 + x + dx];
+          }
+        }
+        EXPECT_NEAR(2 * g, grads[0][0][c * 9 + y * 3 + x], 1e-5);
+        dw += in[c * 9 + y * 3 + x] * g;
+      }
+    }
+    for (serial_size_t i = 0; i < 16; i++) db += delta[c * 16 + i];
+    EXPECT_NEAR(dw, grads[1][0][c], 1e-5);
+    EXPECT_NEAR(db, grads[2][0][c], 1e-5);
+  }
+}
+
 TEST(ave_unpool, read_write) {
   average_unpooling_layer l1(100, 100, 5, 2);
   average_unpooling_layer l2(100, 100, 5, 2);
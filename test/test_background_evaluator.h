@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <mutex>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+inline void make_classification_data(size_t n,
+                                     std::vector<vec_t> *x,
+                                     std::vector<label_t> *y) {
+  for (size_t i = 0; i < n; i++) {
+    vec_t v(4);
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+    // the label is the largest of the first three features
+    const vec_t head(v.begin(), v.begin() + 3);
+    x->push_back(v);
+    y->push_back(static_cast<label_t>(max_index(head)));
+  }
+}
+
+TEST(background_evaluator, matches_network_test) {
+  network<sequential> net;
+  net << fully_connected_layer(4, 8) << batch_normalization_layer(1, 8)
+      << tanh_layer() << fully_connected_layer(8, 3) << sigmoid_layer();
+
+  std::vector<vec_t> x, vx;
+  std::vector<label_t> y, vy;
+  make_classification_data(64, &x, &y);
+  make_classification_data(50, &vx, &vy);
+
+  std::mutex m;
+  std::vector<snapshot_evaluation> reports;
+  background_evaluator<sequential> eval(
+    vx, vy,
+    [&](const snapshot_evaluation &e) {
+      std::lock_guard<std::mutex> lock(m);
+      reports.push_back(e);
+    },
+    16);
+
+  adagrad opt;
+  size_t epoch = 0;
+  net.train<mse>(opt, x, y, 8, 3, [] {}, [&] { eval.submit(net, epoch++); });
+  eval.wait();
+
+  result expected = net.test(vx, vy);
+  ASSERT_FALSE(reports.empty());
+  EXPECT_EQ(reports.size() + eval.dropped(), 3u);
+  const snapshot_evaluation &last = reports.back();
+  EXPECT_EQ(last.tag, 2u);
+  EXPECT_EQ(last.test_result.num_total, 50);
+  EXPECT_EQ(last.test_result.num_success, expected.num_success);
+  EXPECT_EQ(last.test_result.confusion_matrix, expected.confusion_matrix);
+}
+
+TEST(background_evaluator, snapshot_is_isolated) {
+  network<sequential> net;
+  net << fully_connected_layer(4, 6) << relu_layer()
+      << fully_connected_layer(6, 3);
+  net.init_weight();
+
+  std::vector<vec_t> vx;
+  std::vector<label_t> vy;
+  make_classification_data(40, &vx, &vy);
+  const result expected = net.test(vx, vy);
+
+  result actual;
+  background_evaluator<sequential> eval(
+    vx, vy, [&](const snapshot_evaluation &e) { actual = e.test_result; });
+
+  // submit twice, so the second snapshot reuses the first one's buffers
+  eval.submit(net, 0);
+  eval.wait();
+  eval.submit(net, 1);
+
+  // changes after submit must not reach the snapshot
+  for (size_t i = 0; i < net.layer_size(); i++) {
+    for (auto w : net[i]->weights()) std::fill(w->begin(), w->end(), 0);
+  }
+  eval.wait();
+
+  EXPECT_EQ(actual.num_success, expected.num_success);
+  EXPECT_EQ(actual.confusion_matrix, expected.confusion_matrix);
+}
+
+}  // namespace tiny_dnn
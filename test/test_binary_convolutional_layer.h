@@ -0,0 +1,109 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(binary_convolutional, forward) {
+  auto sign = [](float_t x) { return x >= 0 ? float_t(1) : float_t(-1); };
+
+  for (auto pad : {padding::valid, padding::same}) {
+    binary_convolutional_layer l(7, 6, 3, 2, 4, 9, pad, true, 2, 1);
+    l.setup(false);
+    const shape3d in_shape = l.in_shape()[0], out_shape = l.out_shape()[0];
+    const serial_size_t ox = pad == padding::same ? 1 : 0;
+    const serial_size_t oy = pad == padding::same ? 1 : 0;
+
+    vec_t in(in_shape.size());
+    uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+    const vec_t &W = *l.weights()[0];
+    const vec_t &b = *l.weights()[1];
+    std::vector<const tensor_t *> o;
+    l.forward({{in}}, o);
+    const vec_t &out = (*o[0])[0];
+
+    // padded positions are zero, which binarizes to +1
+    auto pixel = [&](int x, int y, serial_size_t c) {
+      x -= ox, y -= oy;
+      if (x < 0 || y < 0 || x >= static_cast<int>(in_shape.width_) ||
+          y >= static_cast<int>(in_shape.height_))
+        return float_t(1);
+      return sign(in[in_shape.get_index(x, y, c)]);
+    };
+
+    // 3x2 filters over 4 input channels
+    const serial_size_t n = 3 * 2 * 4;
+    for (serial_size_t o = 0; o < out_shape.depth_; o++) {
+      const float_t *w = &W[o * n];
+      float_t alpha{0};
+      for (size_t k = 0; k < n; k++) alpha += std::abs(w[k]);
+      alpha /= n;
+
+      for (serial_size_t y = 0; y < out_shape.height_; y++) {
+        for (serial_size_t x = 0; x < out_shape.width_; x++) {
+          float_t dot{0};
+          for (serial_size_t c = 0; c < 4; c++) {
+            for (serial_size_t wy = 0; wy < 2; wy++) {
+              for (serial_size_t wx = 0; wx < 3; wx++) {
+                dot += sign(w[(c * 2 + wy) * 3 + wx]) *
+                       pixel(x * 2 + wx, y + wy, c);
+              }
+            }
+          }
+          EXPECT_NEAR(out[out_shape.get_index(x, y, o)], alpha * dot + b[o],
+                      1e-4);
+        }
+      }
+    }
+  }
+}
+
+TEST(binary_convolutional, train) {
+  network<sequential> nn;
+  adagrad optimizer;
+  nn << binary_convolutional_layer(5, 5, 3, 1, 4, padding::same)
+     << fully_connected_layer(100, 2) << tanh_layer();
+
+  std::vector<vec_t> data, target;
+  for (int i = 0; i < 32; i++) {
+    vec_t x(25);
+    uniform_rand(x.begin(), x.end(), float_t(-1), float_t(1));
+    data.push_back(x);
+    target.push_back(x[12] > 0 ? vec_t{0.8, -0.8} : vec_t{-0.8, 0.8});
+  }
+
+  const float_t before = nn.get_loss<mse>(data, target);
+  nn.fit<mse>(optimizer, data, target, 8, 10);
+  EXPECT_LT(nn.get_loss<mse>(data, target), before * 0.5);
+}
+
+TEST(binary_convolutional, packed_only) {
+  network<sequential> net1, net2;
+  net1 << binary_convolutional_layer(6, 5, 3, 2, 3, padding::same);
+  net1.init_weight();
+
+  vec_t in(6 * 5 * 2);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net1.predict(in);
+
+  auto &l = net1.at<binary_convolutional_layer>(0);
+  l.release_real_weights();
+  EXPECT_TRUE(l.weights()[0]->empty());
+  EXPECT_EQ(net1.predict(in), expected);
+
+  net2.from_json(net1.to_json(content_type::weights_and_model),
+                 content_type::weights_and_model);
+  EXPECT_TRUE(net2.at<binary_convolutional_layer>(0).packed_only());
+  EXPECT_EQ(net2.predict(in), expected);
+}
+
+}  // namespace tiny_dnn
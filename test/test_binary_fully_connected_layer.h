@@ -0,0 +1,151 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <fstream>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(binary_fully_connected, forward) {
+  const serial_size_t in_size = 300, out_size = 5;
+  binary_fully_connected_layer l(in_size, out_size);
+  l.setup(false);
+
+  vec_t in(in_size);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t &W = *l.weights()[0];
+  const vec_t &b = *l.weights()[1];
+
+  auto sign = [](float_t x) { return x >= 0 ? float_t(1) : float_t(-1); };
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  const vec_t &out = (*o[0])[0];
+  for (serial_size_t o = 0; o < out_size; o++) {
+    float_t alpha{0}, dot{0};
+    for (serial_size_t c = 0; c < in_size; c++) {
+      alpha += std::abs(W[c * out_size + o]);
+      dot += sign(in[c]) * sign(W[c * out_size + o]);
+    }
+    EXPECT_NEAR(out[o], alpha / in_size * dot + b[o], 1e-4);
+  }
+
+  // 64 signs per word
+  EXPECT_EQ(l.packed_weights().size(), out_size * 5u);
+}
+
+TEST(binary_fully_connected, backward) {
+  const serial_size_t in_size = 6, out_size = 3;
+  binary_fully_connected_layer l(in_size, out_size);
+  l.setup(false);
+
+  vec_t in = {0.5, -2.0, 0.0, -0.25, 1.5, 0.75};
+  vec_t delta = {1.0, -0.5, 0.25};
+  const vec_t &W = *l.weights()[0];
+
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  auto grads = l.backward(std::vector<tensor_t>{{delta}});
+
+  auto sign = [](float_t x) { return x >= 0 ? float_t(1) : float_t(-1); };
+  vec_t alpha(out_size, float_t(0));
+  for (serial_size_t c = 0; c < in_size; c++) {
+    for (serial_size_t o = 0; o < out_size; o++) {
+      alpha[o] += std::abs(W[c * out_size + o]) / in_size;
+    }
+  }
+
+  for (serial_size_t c = 0; c < in_size; c++) {
+    // straight-through: no gradient where |x| > 1
+    float_t dx{0};
+    for (serial_size_t o = 0; o < out_size; o++) {
+      const float_t w = W[c * out_size + o];
+      dx += delta[o] * alpha[o] * sign(w);
+      const float_t dw =
+        delta[o] * sign(in[c]) *
+        (float_t(1) / in_size + (std::abs(w) <= 1 ? alpha[o] : 0));
+      EXPECT_NEAR(grads[1][0][c * out_size + o], dw, 1e-5);
+    }
+    EXPECT_NEAR(grads[0][0][c], std::abs(in[c]) <= 1 ? dx : 0, 1e-5);
+  }
+  for (serial_size_t o = 0; o < out_size; o++) {
+    EXPECT_FLOAT_EQ(grads[2][0][o], delta[o]);
+  }
+}
+
+TEST(binary_fully_connected, serialization) {
+  network<sequential> net1, net2;
+  net1 << binary_fully_connected_layer(70, 3, false);
+  net1.init_weight();
+
+  net2.from_json(net1.to_json());
+  auto w1 = net1[0]->weights(), w2 = net2[0]->weights();
+  *w2[0] = *w1[0];
+
+  vec_t in(70, float_t(-0.5));
+  in[3] = 1;
+  EXPECT_EQ(net1.predict(in), net2.predict(in));
+}
+
+TEST(binary_fully_connected, packed_weights_cached) {
+  binary_fully_connected_layer l(10, 2, false);
+  l.setup(false);
+  vec_t in(10, float_t(1));
+
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  const vec_t before = (*o[0])[0];
+
+  // edited weights are used after the next update only
+  for (auto &w : *l.weights()[0]) w = -std::abs(w) - float_t(0.5);
+  l.forward({{in}}, o);
+  EXPECT_EQ((*o[0])[0], before);
+
+  l.post_update();
+  l.forward({{in}}, o);
+  for (auto v : (*o[0])[0]) EXPECT_LT(v, float_t(0));
+}
+
+TEST(binary_fully_connected, packed_only) {
+  network<sequential> net1, net2, net3;
+  net1 << binary_fully_connected_layer(640, 10);
+  net1.init_weight();
+
+  vec_t in(640);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net1.predict(in);
+
+  auto path1 = unique_path(), path2 = unique_path();
+  net1.save(path1, content_type::weights_and_model, file_format::binary);
+  auto &l = net1.at<binary_fully_connected_layer>(0);
+  l.release_real_weights();
+  EXPECT_TRUE(l.weights()[0]->empty());
+  EXPECT_EQ(net1.predict(in), expected);
+  net1.save(path2, content_type::weights_and_model, file_format::binary);
+
+  // 1 bit instead of 32 per weight
+  std::ifstream f1(path1, std::ios::binary | std::ios::ate);
+  std::ifstream f2(path2, std::ios::binary | std::ios::ate);
+  EXPECT_LT(f2.tellg() * 16, f1.tellg());
+
+  net2.load(path2, content_type::weights_and_model, file_format::binary);
+  net3.from_json(net1.to_json(content_type::weights_and_model),
+                 content_type::weights_and_model);
+  for (auto *net : {&net2, &net3}) {
+    EXPECT_TRUE(net->at<binary_fully_connected_layer>(0).packed_only());
+    EXPECT_EQ(net->predict(in), expected);
+  }
+
+  adagrad opt;
+  std::vector<vec_t> x(1, in), y(1, vec_t(10));
+  EXPECT_THROW(net2.fit<mse>(opt, x, y, 1, 1), nn_error);
+}
+
+}  // namespace tiny_dnn
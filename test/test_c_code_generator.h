@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+inline bool source_contains(const std::string &s, const std::string &what) {
+  return s.find(what) != std::string::npos;
+}
+
+TEST(c_code_generator, generates_network) {
+  network<sequential> net;
+  net << convolutional_layer(8, 8, 3, 1, 2, padding::same) << tanh_layer()
+      << max_pooling_layer(8, 8, 2, 2) << fully_connected_layer(32, 4)
+      << tanh_layer() << fully_connected_layer(4, 2, false)
+      << softmax_layer();
+  net.init_weight();
+
+  c_code_generator gen(net, "small");
+  std::ostringstream h, c;
+  gen.generate_header(h);
+  gen.generate_source(c);
+
+  EXPECT_TRUE(source_contains(h.str(), "#define SMALL_IN_SIZE 64"));
+  EXPECT_TRUE(source_contains(h.str(), "#define SMALL_OUT_SIZE 2"));
+  EXPECT_TRUE(source_contains(h.str(), "void small_predict("));
+
+  const std::string src = c.str();
+  EXPECT_TRUE(source_contains(src, "static const float small_w0[18]") ||
+              source_contains(src, "static const double small_w0[18]"));
+  EXPECT_TRUE(source_contains(src, "small_b3[4]"));
+  EXPECT_FALSE(source_contains(src, "small_b5"));
+  EXPECT_TRUE(source_contains(src, "small_pad_input(in, small_pad,"));
+  EXPECT_TRUE(source_contains(src, "small_softmax(small_buf"));
+  EXPECT_TRUE(source_contains(src, ", out, 2);"));
+
+  // both tanh layers share a kernel; unused kernels are not emitted
+  const std::string tanh_kernel = "static void small_tanh(";
+  EXPECT_TRUE(source_contains(src, tanh_kernel));
+  EXPECT_EQ(src.find(tanh_kernel), src.rfind(tanh_kernel));
+  EXPECT_FALSE(source_contains(src, "small_avepool("));
+  EXPECT_FALSE(source_contains(src, "malloc"));
+}
+
+TEST(c_code_generator, quantized_weights) {
+  network<sequential> net;
+  net << fully_connected_layer(10, 5) << relu_layer()
+      << fully_connected_layer(5, 2);
+  net.init_weight();
+
+  std::ostringstream c;
+  c_code_generator(net, "q", true).generate_source(c);
+  EXPECT_TRUE(source_contains(c.str(), "static const signed char q_w0[50]"));
+  EXPECT_TRUE(source_contains(c.str(), "q_fc_q(q_buf0, out, q_w2, "));
+}
+
+TEST(c_code_generator, unsupported_layer) {
+  network<sequential> net;
+  net << fully_connected_layer(10, 5) << dropout_layer(5, 0.5);
+  EXPECT_THROW(c_code_generator gen(net), nn_error);
+}
+
+}  // namespace tiny_dnn
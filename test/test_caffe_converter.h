@@ -911,6 +911,74 @@ TEST(caffe_converter, fully_with_weights) {
   EXPECT_FLOAT_EQ(b->at(1), 9.0f);
 }
 
+TEST(caffe_converter, grouped_conv_to_packed_model) {
+  std::string json = R"(
+    name: "GroupNet"
+    input: "data"
+    input_shape {
+      dim: 1
+      dim: 2
+      dim: 2
+      dim: 2
+    }
+    layer {
+      name: "conv"
+      type: "Convolution"
+      bottom: "data"
+      top: "out"
+      convolution_param {
+        num_output: 4
+        kernel_size: 1
+        group: 2
+      }
+      blobs {
+        data: 1
+        data: 2
+        data: 3
+        data: 4
+        shape {
+          dim: 4
+          dim: 1
+          dim: 1
+          dim: 1
+        }
+      }
+      blobs {
+        data: 5
+        data: 6
+        data: 7
+        data: 8
+        shape {
+          dim: 4
+        }
+      }
+    }
+    )";
+
+  auto model = create_net_from_json(json);
+
+  // input 0 feeds outputs 0 and 1, input 1 feeds outputs 2 and 3
+  const vec_t *W = (*model)[0]->weights()[0];
+  ASSERT_EQ(W->size(), size_t(8));
+  EXPECT_FLOAT_EQ(W->at(0), 1.0f);
+  EXPECT_FLOAT_EQ(W->at(2), 2.0f);
+  EXPECT_FLOAT_EQ(W->at(5), 3.0f);
+  EXPECT_FLOAT_EQ(W->at(7), 4.0f);
+  EXPECT_FLOAT_EQ((*model)[0]->weights()[1]->at(3), 8.0f);
+
+  std::stringstream packed;
+  save_packed(*model, packed);
+  network<sequential> served;
+  load_packed(served, packed);
+
+  const vec_t *W2 = served[0]->weights()[0];
+  const vec_t expected = {1, 0, 2, 0, 0, 3, 0, 4};
+  EXPECT_EQ(*W2, expected);
+
+  vec_t in = {1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_EQ(model->predict(in), served.predict(in));
+}
+
 TEST(caffe_converter, load_weights_batchnorm) {
   /*
    * This test case tests detail::load_weights_batchnorm which is a low-level
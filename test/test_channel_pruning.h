@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+// zero out the given output channels so that pruning them is exact
+inline void zero_channels(layer *l,
+                          size_t channels,
+                          const std::vector<size_t> &zero) {
+  auto w             = l->weights();
+  const size_t block = w[0]->size() / channels;
+  for (auto c : zero) {
+    if (dynamic_cast<fully_connected_layer *>(l)) {
+      for (size_t i = 0; i < block; i++) (*w[0])[i * channels + c] = 0;
+    } else {
+      for (size_t i = 0; i < block; i++) (*w[0])[c * block + i] = 0;
+    }
+    (*w[1])[c] = 0;
+  }
+}
+
+TEST(channel_pruning, conv_filters) {
+  network<sequential> net;
+  net << convolutional_layer(8, 8, 3, 2, 6)
+      << batch_normalization_layer(6 * 6, 6, 1e-5, 0.999, net_phase::test)
+      << tanh_layer() << max_pooling_layer(6, 6, 6, 2)
+      << convolutional_layer(3, 3, 2, 6, 4) << relu_layer()
+      << fully_connected_layer(16, 3);
+  net.init_weight();
+  zero_channels(net[0], 6, {1, 3, 5});
+
+  auto imp = channel_pruner::importance(*net[0]);
+  EXPECT_EQ(imp.size(), 6u);
+  EXPECT_EQ(imp[1], 0);
+
+  network<sequential> pruned = channel_pruner::prune(net, 0, 3);
+  ASSERT_EQ(pruned.layer_size(), net.layer_size());
+  EXPECT_EQ(pruned[0]->out_shape()[0], shape3d(6, 6, 3));
+  EXPECT_EQ(pruned[4]->in_shape()[0], shape3d(3, 3, 3));
+  EXPECT_EQ(pruned[0]->param_count(), 3u * (3 * 3 * 2 + 1));
+
+  vec_t in(8 * 8 * 2);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  vec_t expected = net.predict(in);
+  vec_t actual   = pruned.predict(in);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5);
+  }
+}
+
+TEST(channel_pruning, fc_neurons) {
+  network<sequential> net;
+  net << fully_connected_layer(4, 6) << tanh_layer()
+      << fully_connected_layer(6, 2);
+  net.init_weight();
+  zero_channels(net[0], 6, {0, 2});
+
+  network<sequential> pruned =
+    channel_pruner::prune(net, 0, 4, prune_criterion::l2_norm);
+  EXPECT_EQ(pruned[0]->out_data_size(), 4u);
+  EXPECT_EQ(pruned[2]->in_data_size(), 4u);
+
+  vec_t in{0.1, -0.4, 0.3, 0.9};
+  vec_t expected = net.predict(in);
+  vec_t actual   = pruned.predict(in);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5);
+  }
+
+  // the pruned network can be fine-tuned
+  adagrad opt;
+  std::vector<vec_t> x(4, in), y(4, vec_t{0.5, -0.5});
+  EXPECT_TRUE(pruned.fit<mse>(opt, x, y, 2, 1));
+
+  // output layer cannot be pruned
+  EXPECT_THROW(channel_pruner::prune(net, 2, 1), nn_error);
+}
+
+TEST(channel_pruning, taylor_importance) {
+  network<sequential> net;
+  net << fully_connected_layer(4, 6) << tanh_layer()
+      << fully_connected_layer(6, 2);
+  net.init_weight();
+
+  const vec_t w0 = *net[0]->weights()[0];
+  taylor_importance t;
+  std::vector<vec_t> x(8, vec_t{0.1, -0.4, 0.3, 0.9});
+  std::vector<vec_t> y(8, vec_t{0.5, -0.5});
+  net.fit<mse>(t, x, y, 4, 1);
+
+  // weights are not touched
+  EXPECT_EQ(*net[0]->weights()[0], w0);
+
+  auto imp = channel_pruner::importance(*net[0], t);
+  EXPECT_EQ(imp.size(), 6u);
+  for (auto v : imp) EXPECT_GE(v, 0);
+
+  network<sequential> pruned = channel_pruner::prune(net, 0, 3, t);
+  EXPECT_EQ(pruned[0]->out_data_size(), 3u);
+}
+
+}  // namespace tiny_dnn
@@ -555,6 +555,41 @@ TEST(convolutional, fprop_nnp) {
 }
 #endif
 
+TEST(convolutional, fprop_fft) {
+  struct config {
+    serial_size_t w, h, kw, kh, in_c, out_c;
+    padding pad;
+    serial_size_t w_stride, h_stride;
+  };
+  // several tiles per axis, ragged edge tiles, strides and padding
+  const config configs[] = {{40, 33, 11, 11, 3, 4, padding::valid, 1, 1},
+                            {70, 61, 9, 13, 2, 3, padding::same, 1, 1},
+                            {31, 37, 11, 11, 3, 2, padding::valid, 4, 3},
+                            {12, 12, 15, 15, 1, 2, padding::same, 1, 1}};
+
+  for (const auto &c : configs) {
+    convolutional_layer l(c.w, c.h, c.kw, c.kh, c.in_c, c.out_c, c.pad, true,
+                          c.w_stride, c.h_stride);
+    tensor_buf buf(l), buf2(l);
+
+    for (int round = 0; round < 2; round++) {
+      l.set_backend_type(tiny_dnn::core::backend_t::internal);
+      l.forward_propagation(buf.in_buf(), buf.out_buf());
+      l.set_backend_type(tiny_dnn::core::backend_t::fft);
+      l.forward_propagation(buf.in_buf(), buf2.out_buf());
+
+      const vec_t &expected = buf.out_at(0)[0];
+      const vec_t &actual   = buf2.out_at(0)[0];
+      for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_NEAR(actual[i], expected[i], 1E-4);
+      }
+
+      // the cached filter spectra follow the weights
+      for (auto &w : buf.in_at(1)[0]) w *= float_t(-0.5);
+    }
+  }
+}
+
 TEST(convolutional, gradient_check) {  // tanh - mse
   network<sequential> nn;
   nn << convolutional_layer(5, 5, 3, 1, 1) << tanh();
@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(cost_model, fully_connected) {
+  fully_connected_layer fc(100, 10);
+
+  EXPECT_EQ(fc.param_count(), 1010u);
+  EXPECT_EQ(fc.weight_bytes(), 1010u * sizeof(float_t));
+  EXPECT_EQ(fc.activation_bytes(), 110u * sizeof(float_t));
+  EXPECT_EQ(fc.forward_flops(), 2010u);
+  EXPECT_EQ(fc.backward_flops(), 4010u);
+
+  // weights are amortized over the batch
+  EXPECT_GT(fc.arithmetic_intensity(64), fc.arithmetic_intensity(1));
+}
+
+TEST(cost_model, convolutional) {
+  convolutional_layer conv(32, 32, 5, 1, 6);
+
+  // 28x28x6 outputs, 5x5x1 multiply-adds each
+  EXPECT_EQ(conv.param_count(), 156u);
+  EXPECT_EQ(conv.forward_flops(), 2u * 28 * 28 * 6 * 25 + 28 * 28 * 6);
+
+  // connection table halves the work
+  convolutional_layer grouped(10, 10, 3, 4, 4, core::connection_table(2, 4, 4));
+  convolutional_layer dense(10, 10, 3, 4, 4);
+  EXPECT_EQ(grouped.forward_flops() - 8 * 8 * 4,
+            (dense.forward_flops() - 8 * 8 * 4) / 2);
+}
+
+TEST(cost_model, element_wise_default) {
+  tanh_layer t(shape3d(4, 4, 2));
+
+  EXPECT_EQ(t.param_count(), 0u);
+  EXPECT_EQ(t.forward_flops(), 32u);
+  EXPECT_EQ(t.backward_flops(), 32u);
+}
+
+TEST(cost_model, network_summary) {
+  network<sequential> net;
+  net << convolutional_layer(32, 32, 5, 1, 6) << tanh_layer()
+      << average_pooling_layer(28, 28, 6, 2) << tanh_layer()
+      << fully_connected_layer(14 * 14 * 6, 10);
+
+  uint64_t params = 0, flops = 0;
+  for (size_t i = 0; i < net.layer_size(); i++) {
+    params += net[i]->param_count();
+    flops += net[i]->forward_flops();
+  }
+  EXPECT_EQ(net.param_count(), params);
+  EXPECT_EQ(net.forward_flops(), flops);
+  EXPECT_GT(net.backward_flops(), net.forward_flops());
+
+  std::ostringstream os;
+  net.summary(os);
+  EXPECT_NE(os.str().find("conv"), std::string::npos);
+  EXPECT_NE(os.str().find("total"), std::string::npos);
+
+  // the stream's formatting is left as it was
+  std::ostringstream after;
+  after.precision(4);
+  net.summary(after);
+  after.str("");
+  after << 0.123456 << "|" << std::setw(3) << 1;
+  EXPECT_EQ(after.str(), "0.1235|  1");
+}
+
+TEST(cost_model, profiler_uses_cost_model) {
+  network<sequential> net;
+  layer_profiler prof(false);
+
+  net << fully_connected_layer(4, 3);
+  net.set_profiler(&prof);
+  net.predict(vec_t{1, 2, 3, 4});
+
+  ASSERT_EQ(prof.profiles().size(), 1u);
+  EXPECT_EQ(prof.profiles()[0].flops[0], net[0]->forward_flops());
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+inline std::vector<vec_t> cascade_inputs(size_t n, size_t dim) {
+  std::vector<vec_t> in(n, vec_t(dim));
+  for (auto &v : in) uniform_rand(v.begin(), v.end(), float_t(-2), float_t(2));
+  return in;
+}
+
+TEST(early_exit_cascade, chain_of_models) {
+  network<sequential> small, large;
+  small << fully_connected_layer(4, 3) << softmax_layer();
+  large << fully_connected_layer(4, 16) << tanh_layer()
+        << fully_connected_layer(16, 3) << softmax_layer();
+  small.init_weight();
+  large.init_weight();
+
+  const float_t threshold = float_t(0.5);
+  early_exit_cascade<sequential> c;
+  c.add_model(small, threshold).add_model(large, 0);
+
+  const std::vector<vec_t> in = cascade_inputs(40, 4);
+  std::vector<size_t> exits;
+  const std::vector<vec_t> out = c.predict(in, &exits);
+
+  ASSERT_EQ(out.size(), in.size());
+  size_t early = 0;
+  for (size_t i = 0; i < in.size(); i++) {
+    const vec_t s = small.predict(in[i]);
+    const bool confident = max_probability(s) >= threshold;
+    const vec_t expected = confident ? s : large.predict(in[i]);
+    EXPECT_EQ(exits[i], confident ? 0u : 1u);
+    for (size_t j = 0; j < expected.size(); j++) {
+      EXPECT_NEAR(expected[j], out[i][j], 1e-6);
+    }
+    early += confident;
+  }
+  EXPECT_EQ(c.exit_counts()[0], early);
+  EXPECT_EQ(c.exit_counts()[1], in.size() - early);
+}
+
+TEST(early_exit_cascade, backbone_exits) {
+  network<sequential> seg1, head1, seg2, head2;
+  seg1 << fully_connected_layer(4, 6) << tanh_layer();
+  head1 << fully_connected_layer(6, 3) << softmax_layer();
+  seg2 << fully_connected_layer(6, 6) << tanh_layer();
+  head2 << fully_connected_layer(6, 3) << softmax_layer();
+  for (auto *n : {&seg1, &head1, &seg2, &head2}) n->init_weight();
+
+  early_exit_cascade<sequential> c(top2_margin);
+  c.add_exit(seg1, head1, float_t(0.2)).add_exit(seg2, head2, 0);
+
+  const std::vector<vec_t> in = cascade_inputs(30, 4);
+  std::vector<size_t> exits;
+  const std::vector<vec_t> out = c.predict(in, &exits);
+
+  for (size_t i = 0; i < in.size(); i++) {
+    const vec_t f1 = seg1.predict(in[i]);
+    const vec_t p1 = head1.predict(f1);
+    const bool confident = top2_margin(p1) >= float_t(0.2);
+    const vec_t expected = confident ? p1 : head2.predict(seg2.predict(f1));
+    EXPECT_EQ(exits[i], confident ? 0u : 1u);
+    for (size_t j = 0; j < expected.size(); j++) {
+      EXPECT_NEAR(expected[j], out[i][j], 1e-6);
+    }
+  }
+}
+
+TEST(early_exit_cascade, thresholds) {
+  network<sequential> a, b;
+  a << fully_connected_layer(4, 3) << softmax_layer();
+  b << fully_connected_layer(4, 3) << softmax_layer();
+  a.init_weight();
+  b.init_weight();
+  const std::vector<vec_t> in = cascade_inputs(10, 4);
+
+  // unreachable threshold: the last exit answers everything
+  early_exit_cascade<sequential> never;
+  never.add_model(a, 2).add_model(b, 2);
+  never.predict(in);
+  EXPECT_EQ(never.exit_counts()[0], 0u);
+  EXPECT_EQ(never.exit_counts()[1], 10u);
+
+  early_exit_cascade<sequential> always;
+  always.add_model(a, 0).add_model(b, 0);
+  size_t exit = 1;
+  always.predict(in[0], &exit);
+  EXPECT_EQ(exit, 0u);
+  always.reset_counts();
+  EXPECT_EQ(always.exit_counts()[0], 0u);
+
+  early_exit_cascade<sequential> empty;
+  EXPECT_THROW(empty.predict(in), nn_error);
+}
+
+}  // namespace tiny_dnn
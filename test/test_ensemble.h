@@ -0,0 +1,107 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+inline void ensemble_members(std::vector<network<sequential>> &members) {
+  members.resize(4);
+  for (auto &m : members) {
+    m << fully_connected_layer(6, 12) << tanh_layer()
+      << fully_connected_layer(12, 3) << softmax_layer();
+    m.init_weight();
+  }
+}
+
+inline std::vector<vec_t> ensemble_inputs() {
+  std::vector<vec_t> in(20, vec_t(6));
+  for (auto &v : in) uniform_rand(v.begin(), v.end(), float_t(-2), float_t(2));
+  return in;
+}
+
+TEST(ensemble, mean) {
+  std::vector<network<sequential>> members;
+  ensemble_members(members);
+  const std::vector<vec_t> in = ensemble_inputs();
+
+  const std::vector<float_t> weights = {1, 2, 1, 4};
+  ensemble<sequential> e(ensemble_method::mean);
+  for (size_t m = 0; m < members.size(); m++) e.add(members[m], weights[m]);
+  EXPECT_EQ(e.size(), 4u);
+
+  const std::vector<vec_t> out = e.predict(in);
+  ASSERT_EQ(out.size(), in.size());
+  for (size_t i = 0; i < in.size(); i++) {
+    vec_t expected(3, float_t(0));
+    for (size_t m = 0; m < members.size(); m++) {
+      const vec_t p = members[m].predict(in[i]);
+      for (size_t j = 0; j < 3; j++) expected[j] += weights[m] * p[j] / 8;
+    }
+    for (size_t j = 0; j < 3; j++) EXPECT_NEAR(expected[j], out[i][j], 1e-6);
+  }
+}
+
+TEST(ensemble, vote) {
+  std::vector<network<sequential>> members;
+  ensemble_members(members);
+  const std::vector<vec_t> in = ensemble_inputs();
+
+  ensemble<sequential> e(ensemble_method::vote);
+  for (auto &m : members) e.add(m);
+
+  for (size_t i = 0; i < in.size(); i++) {
+    vec_t expected(3, float_t(0));
+    for (auto &m : members) expected[m.predict_label(in[i])] += 0.25;
+
+    const vec_t out = e.predict(in[i]);
+    for (size_t j = 0; j < 3; j++) EXPECT_FLOAT_EQ(expected[j], out[j]);
+  }
+}
+
+TEST(ensemble, same_result_on_one_thread) {
+  std::vector<network<sequential>> members;
+  ensemble_members(members);
+  const std::vector<vec_t> in = ensemble_inputs();
+
+  ensemble<sequential> concurrent, serial(ensemble_method::mean, 1);
+  for (auto &m : members) {
+    concurrent.add(m);
+    serial.add(m);
+  }
+
+  const std::vector<vec_t> a = concurrent.predict(in);
+  const std::vector<vec_t> b = serial.predict(in);
+  for (size_t i = 0; i < in.size(); i++) {
+    for (size_t j = 0; j < 3; j++) EXPECT_FLOAT_EQ(a[i][j], b[i][j]);
+  }
+  EXPECT_EQ(concurrent.predict_label(in[0]), serial.predict_label(in[0]));
+}
+
+TEST(ensemble, invalid_members) {
+  std::vector<network<sequential>> members;
+  ensemble_members(members);
+  const std::vector<vec_t> in = ensemble_inputs();
+
+  ensemble<sequential> e;
+  EXPECT_THROW(e.predict(in), nn_error);
+
+  e.add(members[0]);
+  EXPECT_THROW(e.add(members[0]), nn_error);
+  EXPECT_THROW(e.add(members[1], float_t(-1)), nn_error);
+
+  network<sequential> other;
+  other << fully_connected_layer(6, 4);
+  e.add(other);
+  EXPECT_THROW(e.predict(in), nn_error);
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(execution_context, budget_reserves_for_higher_priority) {
+  thread_budget budget(8);
+  execution_context low(0, 0, budget);
+  execution_context high(4, 1, budget);
+
+  // while high runs a loop on one worker, 2 more stay available to it
+  EXPECT_EQ(budget.borrow(&high, 1), 1u);
+  EXPECT_EQ(budget.borrow(&low, 8), 5u);
+  EXPECT_EQ(budget.borrow(&low, 8), 0u);
+  budget.give_back(&low, 0);
+  EXPECT_EQ(budget.borrow(&high, 8), 2u);
+  EXPECT_EQ(budget.available(), 0u);
+
+  // once high has taken its workers, nothing is held back for it
+  budget.give_back(&low, 5);
+  EXPECT_EQ(budget.borrow(&low, 2), 2u);
+  budget.give_back(&high, 2);
+  budget.give_back(&high, 1);
+  budget.give_back(&low, 2);
+  EXPECT_EQ(budget.available(), 8u);
+}
+
+TEST(execution_context, budget_ignores_idle_contexts) {
+  thread_budget budget(8, std::chrono::hours(1));
+  execution_context low(0, 0, budget);
+  execution_context high(4, 1, budget);
+
+  // a context that never ran a loop holds nothing back
+  EXPECT_EQ(budget.borrow(&low, 8), 8u);
+  budget.give_back(&low, 8);
+
+  // one that ran recently does, until `hold` has passed
+  budget.give_back(&high, budget.borrow(&high, 0));
+  EXPECT_EQ(budget.borrow(&low, 8), 5u);
+  budget.give_back(&low, 5);
+
+  thread_budget no_hold(8, std::chrono::steady_clock::duration::zero());
+  execution_context low2(0, 0, no_hold);
+  execution_context high2(4, 1, no_hold);
+  no_hold.give_back(&high2, no_hold.borrow(&high2, 0));
+  EXPECT_EQ(no_hold.borrow(&low2, 8), 8u);
+  no_hold.give_back(&low2, 8);
+}
+
+TEST(execution_context, scope_binds_thread) {
+  execution_context ctx(2);
+  EXPECT_EQ(execution_context::current(), nullptr);
+  {
+    execution_scope scope(&ctx);
+    EXPECT_EQ(execution_context::current(), &ctx);
+    EXPECT_EQ(worker_lease::max_threads(), 2u);
+
+    // other threads are not affected
+    std::thread([] {
+      EXPECT_EQ(execution_context::current(), nullptr);
+    }).join();
+  }
+  EXPECT_EQ(execution_context::current(), nullptr);
+}
+
+#if !defined(CNN_USE_TBB) && !defined(CNN_USE_GCD)
+TEST(execution_context, caps_parallel_for) {
+  execution_context ctx(1);
+  execution_scope scope(&ctx);
+
+  std::mutex m;
+  std::set<std::thread::id> threads;
+  size_t count = 0;
+  parallel_for(0, 1000,
+               [&](const blocked_range &r) {
+                 std::lock_guard<std::mutex> lock(m);
+                 threads.insert(std::this_thread::get_id());
+                 count += r.end() - r.begin();
+               },
+               1);
+
+  // a single thread: the calling one
+  EXPECT_EQ(count, 1000u);
+  ASSERT_EQ(threads.size(), 1u);
+  EXPECT_EQ(*threads.begin(), std::this_thread::get_id());
+}
+#endif  // !CNN_USE_TBB && !CNN_USE_GCD
+
+// workers are only borrowed by the default std::thread backend
+#if !defined(CNN_USE_TBB) && !defined(CNN_USE_GCD) && \
+  !defined(CNN_USE_OMP) && !defined(CNN_SINGLE_THREAD)
+TEST(execution_context, parallel_for_borrows_workers) {
+  thread_budget budget(3);
+  execution_context ctx(3, 0, budget);
+  execution_scope scope(&ctx);
+
+  std::mutex m;
+  std::set<std::thread::id> threads;
+  std::vector<int> visited(1000, 0);
+  parallel_for(0, visited.size(),
+               [&](const blocked_range &r) {
+                 std::lock_guard<std::mutex> lock(m);
+                 threads.insert(std::this_thread::get_id());
+                 for (size_t i = r.begin(); i < r.end(); i++) visited[i]++;
+               },
+               1);
+
+  EXPECT_EQ(threads.size(), 3u);
+  EXPECT_EQ(std::count(visited.begin(), visited.end(), 1), 1000);
+  EXPECT_EQ(budget.available(), 3u);
+}
+
+TEST(execution_context, idle_high_priority_does_not_starve) {
+  thread_budget budget(3);
+  execution_context idle(4, 1, budget);
+  execution_context ctx(4, 0, budget);
+  execution_scope scope(&ctx);
+
+  std::mutex m;
+  std::set<std::thread::id> threads;
+  std::vector<execution_context *> bound;
+  parallel_for(0, 1000,
+               [&](const blocked_range &) {
+                 std::lock_guard<std::mutex> lock(m);
+                 threads.insert(std::this_thread::get_id());
+                 bound.push_back(execution_context::current());
+               },
+               1);
+
+  // all workers go to ctx, and run with it as their context
+  EXPECT_EQ(threads.size(), 4u);
+  EXPECT_EQ(std::count(bound.begin(), bound.end(), &ctx), 4);
+}
+#endif
+
+TEST(execution_context, network) {
+  network<sequential> net;
+  net << fully_connected_layer(10, 20) << tanh_layer()
+      << fully_connected_layer(20, 4);
+  net.init_weight();
+
+  vec_t in(10);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net.predict(in);
+
+  auto ctx = std::make_shared<execution_context>(1, 1);
+  net.set_execution_context(ctx);
+  EXPECT_EQ(net.get_execution_context(), ctx);
+
+  const vec_t actual = net.predict(in);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_FLOAT_EQ(expected[i], actual[i]);
+  }
+  EXPECT_EQ(execution_context::current(), nullptr);
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,121 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(fake_quantization, forward_backward) {
+  fake_quantization_layer l(5);
+  vec_t in    = {-1.0, -0.3, 0.2, 0.55, 2.0};
+  vec_t delta = {1.0, 2.0, 3.0, 4.0, 5.0};
+  std::vector<const tensor_t *> o;
+
+  // the first training batch sets the range
+  EXPECT_FALSE(l.range_initialized());
+  l.forward({{in}}, o);
+  EXPECT_TRUE(l.range_initialized());
+  EXPECT_FLOAT_EQ(l.range_min(), -1.0);
+  EXPECT_FLOAT_EQ(l.range_max(), 2.0);
+  const float_t step = 3.0 / 255;
+  for (size_t i = 0; i < in.size(); i++) {
+    EXPECT_NEAR((*o[0])[0][i], in[i], step / 2 + 1e-6);
+  }
+
+  l.set_range(-0.5, 0.5);
+  l.set_context(net_phase::test);
+  l.forward({{in}}, o);
+  EXPECT_EQ(l.range_min(), -0.5);
+  EXPECT_NEAR((*o[0])[0][0], -0.5, 1e-6);
+  EXPECT_NEAR((*o[0])[0][4], 0.5, 1e-6);
+
+  // straight-through inside the range only
+  auto grads     = l.backward(std::vector<tensor_t>{{delta}});
+  vec_t expected = {0.0, 2.0, 3.0, 0.0, 0.0};
+  for (size_t i = 0; i < in.size(); i++) {
+    EXPECT_FLOAT_EQ(grads[0][0][i], expected[i]);
+  }
+  // the ema range is not trained
+  EXPECT_FALSE(l.trainable());
+  EXPECT_FLOAT_EQ(grads[1][0][0], 0);
+}
+
+TEST(fake_quantization, learned_range) {
+  fake_quantization_layer l(5, fake_quantization_mode::learned);
+  vec_t in    = {-1.0, -0.3, 0.2, 0.55, 2.0};
+  vec_t delta = {1.0, 2.0, 3.0, 4.0, 5.0};
+  l.set_range(-0.5, 0.5);
+  EXPECT_TRUE(l.trainable());
+
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  auto grads = l.backward(std::vector<tensor_t>{{delta}});
+  EXPECT_FLOAT_EQ(grads[1][0][0], 1.0);
+  EXPECT_FLOAT_EQ(grads[1][0][1], 9.0);
+
+  auto clone = clone_layer(l);
+  auto f     = dynamic_cast<fake_quantization_layer *>(clone.get());
+  ASSERT_TRUE(f != nullptr);
+  EXPECT_EQ(f->mode(), fake_quantization_mode::learned);
+}
+
+TEST(fake_quantization, weight_quantization) {
+  fully_connected_layer l(4, 3);
+  l.setup(false);
+  l.set_weight_quantization(true);
+
+  vec_t in       = {0.3, -0.7, 0.1, 0.9};
+  const vec_t W  = *l.weights()[0];
+  const vec_t &b = *l.weights()[1];
+  auto mm        = std::minmax_element(W.begin(), W.end());
+  vec_t Wq;
+  core::kernels::fake_quantize(W, *mm.first, *mm.second, Wq);
+
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  for (size_t j = 0; j < 3; j++) {
+    float_t expected = b[j];
+    for (size_t i = 0; i < 4; i++) expected += in[i] * Wq[i * 3 + j];
+    EXPECT_NEAR((*o[0])[0][j], expected, 1e-6);
+  }
+  // the float weights are untouched
+  EXPECT_EQ(*l.weights()[0], W);
+}
+
+TEST(fake_quantization, export) {
+  network<sequential> net;
+  net << fake_quantization_layer(shape3d(6, 6, 1))
+      << convolutional_layer(6, 6, 3, 1, 2) << relu_layer()
+      << fully_connected_layer(32, 2);
+  net[1]->set_weight_quantization(true);
+
+  std::vector<vec_t> x(8, vec_t(36)), y(8, vec_t{0.5, -0.5});
+  for (auto &v : x) uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+  adagrad opt;
+  net.fit<mse>(opt, x, y, 4, 2);
+
+  network<sequential> q = quantization_exporter::convert(net);
+  ASSERT_EQ(q.layer_size(), 3u);
+  EXPECT_EQ(q[0]->layer_type(), "q_conv");
+#ifndef CNN_USE_GEMMLOWP
+  EXPECT_EQ(q[2]->layer_type(), "fully-connected");
+#endif
+
+  for (const auto &v : x) {
+    vec_t expected = net.predict(v);
+    vec_t actual   = q.predict(v);
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 5e-2);
+    }
+  }
+}
+
+}  // namespace tiny_dnn
@@ -130,4 +130,62 @@ TEST(global_ave_pool, backward_multichannel) {
     EXPECT_FLOAT_EQ(in_grad_expected[i], in_grad[i]);
   }
 }
+
+TEST(global_ave_pool, fc_read_write) {
+  global_average_pooling_fc_layer l1(7, 5, 6, 3);
+  global_average_pooling_fc_layer l2(7, 5, 6, 3);
+
+  l1.init_weight();
+  l2.init_weight();
+
+  serialization_test(l1, l2);
+}
+
+TEST(global_ave_pool, fc_matches_separate_layers) {
+  for (bool has_bias : {true, false}) {
+    global_average_pooling_layer pool(7, 5, 6);
+    fully_connected_layer fc(6, 3, has_bias);
+    global_average_pooling_fc_layer fused(7, 5, 6, 3, has_bias);
+
+    fc.init_weight();
+    fused.init_weight();
+    *fused.weights()[0] = *fc.weights()[0];
+    if (has_bias) {
+      uniform_rand(fc.weights()[1]->begin(), fc.weights()[1]->end(), -1.0,
+                   1.0);
+      *fused.weights()[1] = *fc.weights()[1];
+    }
+
+    tensor_t in(2, vec_t(7 * 5 * 6));
+    for (auto &v : in) uniform_rand(v.begin(), v.end(), -1.0, 1.0);
+    tensor_t delta = {{1, -2, 0.5}, {0.25, 3, -1}};
+
+    std::vector<const tensor_t *> o;
+    pool.forward({in}, o);
+    const tensor_t pooled = *o[0];
+    fc.forward({pooled}, o);
+    const tensor_t expected = *o[0];
+    const auto fc_grads     = fc.backward(std::vector<tensor_t>{delta});
+    const auto pool_grads =
+      pool.backward(std::vector<tensor_t>{fc_grads[0]});
+
+    fused.forward({in}, o);
+    const auto grads = fused.backward(std::vector<tensor_t>{delta});
+
+    for (size_t s = 0; s < in.size(); s++) {
+      for (size_t i = 0; i < 3; i++) {
+        EXPECT_NEAR(expected[s][i], (*o[0])[s][i], 1e-5);
+      }
+      for (size_t i = 0; i < in[s].size(); i++) {
+        EXPECT_NEAR(pool_grads[0][s][i], grads[0][s][i], 1e-5);
+      }
+      for (size_t k = 1; k < grads.size(); k++) {
+        for (size_t i = 0; i < grads[k][s].size(); i++) {
+          EXPECT_NEAR(fc_grads[k][s][i], grads[k][s][i], 1e-5);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace tiny_dnn
@@ -0,0 +1,167 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(hierarchical_softmax, clusters) {
+  hierarchical_softmax_layer l(4, 10);
+  EXPECT_EQ(l.cluster_ends(), (std::vector<serial_size_t>{3, 6, 9, 10}));
+  EXPECT_EQ(l.in_shape()[1].size(), 16u);
+  EXPECT_EQ(l.in_shape()[3].size(), 40u);
+
+  hierarchical_softmax_layer a(4, 10, {2, 10});
+  EXPECT_EQ(a.clusters(), 2u);
+  EXPECT_THROW(hierarchical_softmax_layer(4, 10, {5, 5, 10}), nn_error);
+  EXPECT_THROW(hierarchical_softmax_layer(4, 10, {5, 9}), nn_error);
+}
+
+TEST(hierarchical_softmax, gradient) {
+  hierarchical_softmax_layer l(3, 7, {2, 3, 7});
+  l.setup(false);
+  for (auto w : l.weights()) {
+    uniform_rand(w->begin(), w->end(), float_t(-1), float_t(1));
+  }
+
+  vec_t in = {0.5, -1.0, 0.25};
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  float_t sum = 0;
+  for (auto p : (*o[0])[0]) sum += p;
+  EXPECT_NEAR(sum, 1, 1e-5);
+
+  const label_t t = 4;
+  auto nll        = [&](const vec_t &x) {
+    l.forward({{x}}, o);
+    return -std::log((*o[0])[0][t]);
+  };
+  l.forward({{in}}, o);
+  vec_t delta = class_nll::df((*o[0])[0], label_target{t, 0, 1});
+  auto grads  = l.backward(std::vector<tensor_t>{{delta}});
+
+  const float_t eps = 1e-2;
+  for (size_t i = 0; i < in.size(); i++) {
+    vec_t plus = in, minus = in;
+    plus[i] += eps;
+    minus[i] -= eps;
+    EXPECT_NEAR(grads[0][0][i], (nll(plus) - nll(minus)) / (2 * eps), 1e-2);
+  }
+  // only the true class's cluster is touched in the tail
+  for (label_t c = 0; c < 3; c++) EXPECT_EQ(grads[4][0][c], float_t(0));
+
+  // the training forward pass puts the head at the first class of each
+  // cluster
+  l.forward({{in}}, o);
+  const vec_t p = (*o[0])[0];
+  const std::vector<serial_size_t> begin = {0, 2, 3}, end = {2, 3, 7};
+  l.set_context(net_phase::train);
+  for (int pass = 0; pass < 2; pass++) {
+    l.forward({{in}}, o);
+    for (size_t k = 0; k < 3; k++) {
+      float_t head = 0;
+      for (size_t c = begin[k]; c < end[k]; c++) head += p[c];
+      EXPECT_NEAR((*o[0])[0][begin[k]], head, 1e-6);
+      for (size_t c = begin[k] + 1; c < end[k]; c++) {
+        EXPECT_EQ((*o[0])[0][c], float_t(0));
+      }
+    }
+  }
+}
+
+TEST(hierarchical_softmax, row_sparse_update) {
+  network<sequential> net;
+  net << hierarchical_softmax_layer(3, 20, {5, 10, 15, 20});
+  net.init_weight();
+  const vec_t Wt0 = *net[0]->weights()[2];
+  const vec_t Wh0 = *net[0]->weights()[0];
+
+  std::vector<vec_t> x       = {{0.5, -1, 0.25}, {1, 0.75, -0.5}};
+  std::vector<label_t> label = {7, 12};
+  adam opt;
+  net.train<class_nll>(opt, x, label, 2, 1);
+
+  // the tail is updated on the clusters of the labels only
+  const vec_t &Wt = *net[0]->weights()[2];
+  for (size_t c = 0; c < 20; c++) {
+    const bool scored = c >= 5 && c < 15;
+    for (size_t i = 0; i < 3; i++) {
+      EXPECT_EQ(Wt[c * 3 + i] != Wt0[c * 3 + i], scored);
+    }
+  }
+  EXPECT_NE(*net[0]->weights()[0], Wh0);
+
+  // the tail gradient is kept per row, not per sample and class
+  EXPECT_EQ(net[0]->weights_grads()[2]->size(), 1u);
+  EXPECT_EQ(net[0]->weights_grads()[3]->size(), 1u);
+}
+
+TEST(hierarchical_softmax, class_targets) {
+  // labels handed to the layer train exactly like one-hot targets
+  network<sequential> labeled, dense;
+  labeled << hierarchical_softmax_layer(3, 20, {5, 10, 15, 20});
+  dense << hierarchical_softmax_layer(3, 20, {5, 10, 15, 20});
+  labeled.init_weight();
+  dense.init_weight();
+  for (size_t i = 0; i < 4; i++) {
+    *dense[0]->weights()[i] = *labeled[0]->weights()[i];
+  }
+
+  std::vector<vec_t> x       = {{0.5, -1, 0.25}, {1, 0.75, -0.5}};
+  std::vector<label_t> label = {7, 12};
+  std::vector<vec_t> one_hot(2, vec_t(20, 0));
+  one_hot[0][7] = one_hot[1][12] = 1;
+  adam opt1, opt2;
+  labeled.train<class_nll>(opt1, x, label, 2, 2);
+  dense.train<class_nll>(opt2, x, one_hot, 2, 2);
+  for (size_t i = 0; i < 4; i++) {
+    const vec_t &a = *labeled[0]->weights()[i];
+    const vec_t &b = *dense[0]->weights()[i];
+    for (size_t j = 0; j < a.size(); j++) EXPECT_NEAR(a[j], b[j], 1e-5);
+  }
+  // no per-sample gradient reached the labeled layer
+  EXPECT_EQ(labeled[0]->outputs()[0]->get_gradient()->size(), 1u);
+  EXPECT_EQ(dense[0]->outputs()[0]->get_gradient()->size(), 2u);
+}
+
+TEST(hierarchical_softmax, train) {
+  const label_t n_classes = 100;
+  std::vector<vec_t> x;
+  std::vector<label_t> labels;
+  std::vector<vec_t> one_hot;
+  for (label_t i = 0; i < 200; i++) {
+    const label_t c = (i * 7) % n_classes;
+    vec_t v(7);
+    for (size_t j = 0; j < 7; j++) v[j] = float_t((c >> j) & 1) - 0.5;
+    x.push_back(v);
+    labels.push_back(c);
+    one_hot.push_back(vec_t(n_classes, 0));
+    one_hot.back()[c] = 1;
+  }
+
+  network<sequential> net;
+  net << hierarchical_softmax_layer(7, n_classes);
+  const float_t before = net.get_loss<class_nll>(x, one_hot);
+
+  adam opt;
+  opt.alpha = float_t(0.05);
+  net.train<class_nll>(opt, x, labels, 20, 20);
+  EXPECT_LT(net.get_loss<class_nll>(x, one_hot), before * 0.5);
+
+  // the clusters survive a round trip
+  auto clone = clone_layer(*net[0]);
+  auto h     = dynamic_cast<hierarchical_softmax_layer *>(clone.get());
+  ASSERT_TRUE(h != nullptr);
+  EXPECT_EQ(h->cluster_ends().size(), 10u);
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(layer_profiler, forward_backward) {
+  network<sequential> net;
+  adagrad opt;
+  layer_profiler prof;
+
+  net << fully_connected_layer(4, 3, true, core::backend_t::internal)
+      << tanh_layer() << fully_connected_layer(3, 2);
+  net.set_profiler(&prof);
+
+  std::vector<vec_t> in(8, vec_t{0.1, 0.2, 0.3, 0.4});
+  std::vector<vec_t> out(8, vec_t{0.5, -0.5});
+  net.fit<mse>(opt, in, out, 4, 1);
+
+  const auto &p = prof.profiles();
+  ASSERT_EQ(p.size(), 3u);
+  EXPECT_EQ(p[0].layer_type, "fully-connected");
+  EXPECT_EQ(p[0].engine, core::backend_t::internal);
+  EXPECT_EQ(p[1].layer_type, "tanh-activation");
+  for (size_t i = 0; i < p.size(); i++) {
+    EXPECT_EQ(p[i].index, i);
+    EXPECT_EQ(p[i].calls[0], 2u);  // 2 mini-batches
+    EXPECT_EQ(p[i].calls[1], 2u);
+    EXPECT_GE(p[i].seconds[0], 0.0);
+  }
+
+  // detached profiler does not record anything
+  net.set_profiler(nullptr);
+  net.predict(in[0]);
+  EXPECT_EQ(prof.profiles()[0].calls[0], 2u);
+}
+
+TEST(layer_profiler, flop_counter) {
+  network<sequential> net;
+  layer_profiler prof(false);
+
+  net << fully_connected_layer(4, 3);
+  net.set_profiler(&prof);
+  prof.set_flop_counter(
+    [](const layer &l, profile_phase, size_t samples) -> uint64_t {
+      return 2 * l.in_data_size() * l.out_data_size() * samples;
+    });
+
+  net.predict(vec_t{1, 2, 3, 4});
+
+  const auto &p = prof.profiles();
+  ASSERT_EQ(p.size(), 1u);
+  EXPECT_EQ(p[0].flops[0], 24u);
+  EXPECT_FALSE(prof.hw_counters_available());
+
+  std::ostringstream os;
+  prof.print(os);
+  EXPECT_NE(os.str().find("fully-connected"), std::string::npos);
+  EXPECT_NE(os.str().find("unavailable"), std::string::npos);
+}
+
+TEST(layer_profiler, perf_counters_graceful) {
+  // must never throw, whether or not the PMU is accessible
+  perf_counters pc;
+  hw_counter_values a = pc.read();
+  volatile float_t x  = 0;
+  for (int i = 0; i < 10000; i++) x = x + float_t(1);
+  hw_counter_values d = pc.read() - a;
+
+  for (int i = 0; i < hw_counter_count; i++) {
+    const hw_counter c = static_cast<hw_counter>(i);
+    if (!pc.available(c)) {
+      EXPECT_FALSE(d.valid[i]);
+      EXPECT_EQ(d[c], 0u);
+    }
+  }
+  if (pc.available(hw_counter::instructions)) {
+    EXPECT_GT(d[hw_counter::instructions], 0u);
+  }
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,149 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+// weights of an exactly rank-r fc layer: W = A B
+inline void set_low_rank_weights(layer *l, size_t in, size_t out, size_t r) {
+  vec_t a(in * r), b(r * out);
+  uniform_rand(a.begin(), a.end(), float_t(-1), float_t(1));
+  uniform_rand(b.begin(), b.end(), float_t(-1), float_t(1));
+  vec_t &w = *l->weights()[0];
+  for (size_t i = 0; i < in; i++) {
+    for (size_t o = 0; o < out; o++) {
+      float_t s = 0;
+      for (size_t k = 0; k < r; k++) s += a[i * r + k] * b[k * out + o];
+      w[i * out + o] = s;
+    }
+  }
+}
+
+TEST(low_rank_factorization, exact_rank) {
+  network<sequential> net;
+  net << fully_connected_layer(40, 30) << tanh_layer()
+      << fully_connected_layer(30, 3);
+  net.init_weight();
+  set_low_rank_weights(net[0], 40, 30, 4);
+
+  low_rank_params params;
+  params.energy = 0.999999;
+  low_rank_report report;
+  auto f = factorize_fully_connected(net, 0, params, &report);
+
+  EXPECT_EQ(report.rank, 4u);
+  EXPECT_NEAR(report.retained_energy, 1.0, 1e-6);
+  EXPECT_EQ(report.params_before, 40u * 30 + 30);
+  EXPECT_EQ(report.params_after, 40u * 4 + 4 * 30 + 30);
+  EXPECT_GT(report.speedup(), 1.0);
+
+  ASSERT_EQ(f.layer_size(), 4u);
+  EXPECT_EQ(f[0]->out_data_size(), 4u);
+  EXPECT_EQ(f[1]->in_data_size(), 4u);
+
+  vec_t in(40);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  vec_t expected = net.predict(in);
+  vec_t actual   = f.predict(in);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-3);
+  }
+}
+
+TEST(low_rank_factorization, fixed_rank_and_report) {
+  network<sequential> net;
+  net << fully_connected_layer(64, 64) << relu_layer()
+      << fully_connected_layer(64, 4);
+  net.init_weight();
+
+  low_rank_params params;
+  params.rank = 8;
+  std::vector<low_rank_report> reports;
+  auto f = factorize_fully_connected(net, params, &reports);
+
+  // the 64x4 layer would grow, so it is left alone
+  ASSERT_EQ(reports.size(), 2u);
+  EXPECT_EQ(reports[0].index, 0u);
+  EXPECT_EQ(reports[0].rank, 8u);
+  EXPECT_LT(reports[0].retained_energy, 1.0);
+  EXPECT_EQ(reports[1].index, 2u);
+  EXPECT_GE(reports[1].params_after, reports[1].params_before);
+  EXPECT_EQ(f.layer_size(), 4u);
+
+  std::ostringstream os;
+  os << reports;
+  EXPECT_NE(os.str().find("64x64"), std::string::npos);
+
+  adagrad opt;
+  std::vector<vec_t> x(4, vec_t(64, float_t(0.1)));
+  std::vector<vec_t> y(4, vec_t{0, 1, 0, 0});
+  EXPECT_TRUE(f.fit<mse>(opt, x, y, 2, 1));
+}
+
+TEST(low_rank_factorization, result_is_a_deep_copy) {
+  network<sequential> net;
+  net << fully_connected_layer(64, 4) << tanh_layer();
+  net.init_weight();
+  const vec_t w = *net[0]->weights()[0];
+
+  low_rank_params params;
+  params.rank = 8;
+  auto f = factorize_fully_connected(net, params);
+
+  // nothing was factorized, the copy must still be independent
+  ASSERT_EQ(f.layer_size(), 2u);
+  (*f[0]->weights()[0])[0] += 1;
+  EXPECT_EQ(*net[0]->weights()[0], w);
+}
+
+TEST(low_rank_factorization, fine_tune_and_accuracy) {
+  set_random_seed(3);
+  std::vector<vec_t> x(200, vec_t(16));
+  std::vector<label_t> y(x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    uniform_rand(x[i].begin(), x[i].end(), float_t(-1), float_t(1));
+    y[i] = (x[i][0] + x[i][1] > 0 ? 1 : 0) + (x[i][2] > 0 ? 2 : 0);
+  }
+
+  network<sequential> net;
+  net << fully_connected_layer(16, 64) << tanh_layer()
+      << fully_connected_layer(64, 4) << softmax_layer();
+  adagrad opt;
+  net.train<cross_entropy_multiclass>(opt, x, y, 10, 30);
+  const double accuracy = net.test(x, y).accuracy();
+
+  low_rank_params params;
+  params.rank = 2;
+  std::vector<low_rank_report> plain, tuned;
+  factorize_fully_connected<cross_entropy_multiclass>(net, params, opt, x, y,
+                                                      x, y, &plain);
+  params.fine_tune_epochs = 10;
+  auto f = factorize_fully_connected<cross_entropy_multiclass>(
+    net, params, opt, x, y, x, y, &tuned);
+
+  ASSERT_EQ(plain.size(), 2u);
+  ASSERT_EQ(tuned.size(), 2u);
+  EXPECT_TRUE(plain[0].has_accuracy());
+  EXPECT_DOUBLE_EQ(plain[0].accuracy_before, accuracy);
+  EXPECT_GT(plain[0].accuracy_drop(), 0);
+  EXPECT_GT(tuned[0].accuracy_after, plain[0].accuracy_after);
+  EXPECT_DOUBLE_EQ(f.test(x, y).accuracy(), tuned.back().accuracy_after);
+  // the original network is left untouched
+  EXPECT_DOUBLE_EQ(net.test(x, y).accuracy(), accuracy);
+
+  std::ostringstream os;
+  os << tuned;
+  EXPECT_NE(os.str().find("acc-drop"), std::string::npos);
+}
+
+}  // namespace tiny_dnn
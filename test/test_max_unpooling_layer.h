@@ -0,0 +1,80 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(max_unpool, forward) {
+  max_unpooling_layer l(2, 2, 2, 2, 2);  // 2x2 => 5x5
+
+  // clang-format off
+  vec_t in = {1, 2,
+              3, 4,
+              5, 6,
+              7, 8};
+
+  vec_t expected = {1, 0, 2, 0, 0,
+                    0, 0, 0, 0, 0,
+                    3, 0, 4, 0, 0,
+                    0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0,
+                    5, 0, 6, 0, 0,
+                    0, 0, 0, 0, 0,
+                    7, 0, 8, 0, 0,
+                    0, 0, 0, 0, 0,
+                    0, 0, 0, 0, 0};
+  // clang-format on
+
+  std::vector<const tensor_t *> out;
+  l.forward({{in}}, out);
+  vec_t res = (*out[0])[0];
+
+  ASSERT_EQ(expected.size(), res.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_FLOAT_EQ(expected[i], res[i]);
+  }
+}
+
+TEST(max_unpool, backward) {
+  max_unpooling_layer l(2, 2, 1, 2, 1);  // 2x2 => 3x3
+
+  // clang-format off
+  vec_t in = {1, 2,
+              3, 4};
+
+  vec_t delta = {1, 2, 3,
+                 4, 5, 6,
+                 7, 8, 9};
+
+  vec_t expected = {1, 2,
+                    4, 5};
+  // clang-format on
+
+  std::vector<const tensor_t *> out;
+  l.forward({{in}}, out);
+  vec_t in_grad = l.backward(std::vector<tensor_t>{{delta}})[0][0];
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_FLOAT_EQ(expected[i], in_grad[i]);
+  }
+}
+
+TEST(max_unpool, read_write) {
+  max_unpooling_layer l1(shape3d(10, 10, 3), 2, 1);
+  max_unpooling_layer l2(shape3d(10, 10, 3), 2, 1);
+
+  l1.setup(true);
+  l2.setup(true);
+
+  serialization_test(l1, l2);
+}
+
+}  // namespace tiny_dnn
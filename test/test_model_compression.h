@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(model_compression, lz_roundtrip) {
+  std::vector<uint8_t> src(5000);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = static_cast<uint8_t>(i < 2500 ? i % 7 : (i * 7919) >> 3);
+  }
+
+  auto z = compression::lz_compress(src.data(), src.size());
+  auto d = compression::lz_decompress(z.data(), z.size(), src.size());
+  EXPECT_EQ(d, src);
+  EXPECT_LT(z.size(), src.size());
+
+  // empty and tiny inputs
+  for (size_t n = 0; n < 6; n++) {
+    auto zn = compression::lz_compress(src.data(), n);
+    auto dn = compression::lz_decompress(zn.data(), zn.size(), n);
+    EXPECT_EQ(dn, std::vector<uint8_t>(src.begin(), src.begin() + n));
+  }
+
+  z[0] = 0xff;
+  EXPECT_THROW(compression::lz_decompress(z.data(), z.size(), src.size()),
+               nn_error);
+}
+
+TEST(model_compression, cluster_weights) {
+  vec_t w(1000);
+  uniform_rand(w.begin(), w.end(), float_t(-1), float_t(1));
+
+  auto cb = compression::cluster_weights(w, 4);
+  EXPECT_EQ(cb.codebook.size(), 16u);
+  EXPECT_TRUE(std::is_sorted(cb.codebook.begin(), cb.codebook.end()));
+
+  vec_t d = cb.decode();
+  ASSERT_EQ(d.size(), w.size());
+  for (size_t i = 0; i < w.size(); i++) {
+    EXPECT_NEAR(d[i], w[i], 0.1);
+  }
+
+  auto packed = compression::pack_bits(cb.indices, 4);
+  EXPECT_EQ(packed.size(), 500u);
+  EXPECT_EQ(compression::unpack_bits(packed.data(), w.size(), 4), cb.indices);
+}
+
+TEST(model_compression, lossless_roundtrip) {
+  network<sequential> net, net2;
+  net << fully_connected_layer(10, 100) << tanh_layer()
+      << fully_connected_layer(100, 2);
+  net.init_weight();
+
+  compression_params params;
+  params.bits = 0;
+  std::stringstream ss;
+  save_compressed(net, ss, params);
+  load_compressed(net2, ss);
+
+  EXPECT_TRUE(net.has_same_weights(net2, 0));
+  vec_t in(10, float_t(0.5));
+  EXPECT_EQ(net.predict(in), net2.predict(in));
+}
+
+TEST(model_compression, clustered_roundtrip) {
+  network<sequential> net, net2;
+  net << fully_connected_layer(100, 100) << tanh_layer()
+      << fully_connected_layer(100, 2);
+  net.init_weight();
+
+  std::ostringstream raw;
+  {
+    cereal::BinaryOutputArchive bo(raw);
+    net.to_archive(bo);
+  }
+
+  compression_params params;
+  params.bits = 4;
+  std::stringstream ss;
+  save_compressed(net, ss, params);
+  EXPECT_LT(ss.str().size() * 4, raw.str().size());
+
+  load_compressed(net2, ss);
+  EXPECT_TRUE(net.has_same_weights(net2, 0.1));
+  EXPECT_FALSE(net.has_same_weights(net2, 1e-6));
+
+  std::stringstream bad("not a model");
+  EXPECT_THROW(load_compressed(net2, bad), nn_error);
+}
+
+TEST(model_compression, clustered_accuracy) {
+  network<sequential> net, net2;
+  net << fully_connected_layer(64, 100) << tanh_layer()
+      << fully_connected_layer(100, 10) << softmax_layer();
+  net.init_weight();
+
+  std::vector<vec_t> in(20, vec_t(64));
+  std::vector<vec_t> expected;
+  for (auto &x : in) {
+    uniform_rand(x.begin(), x.end(), float_t(-1), float_t(1));
+    expected.push_back(net.predict(x));
+  }
+
+  std::stringstream ss;
+  save_compressed(net, ss);  // 6 bits
+  load_compressed(net2, ss);
+
+  auto &fc1 = net2.at<fully_connected_layer>(0);
+  auto &fc2 = net2.at<fully_connected_layer>(2);
+  EXPECT_EQ(fc1.get_weight_storage(), weight_storage::codebook);
+  EXPECT_EQ(fc2.get_weight_storage(), weight_storage::codebook);
+  EXPECT_EQ(fc1.codebook_weights().codebook().size(), 64u);
+  EXPECT_LT(fc1.codebook_weights().memory_bytes() * 3,
+            fc1.weights()[0]->size() * sizeof(float_t));
+
+  std::vector<vec_t> clustered;
+  for (size_t s = 0; s < in.size(); s++) {
+    clustered.push_back(net2.predict(in[s]));
+    for (size_t i = 0; i < expected[s].size(); i++) {
+      EXPECT_NEAR(clustered[s][i], expected[s][i], 0.02);
+    }
+  }
+
+  // the model record keeps the codebook storage
+  network<sequential> net3;
+  net3.from_json(net2.to_json(content_type::weights_and_model),
+                 content_type::weights_and_model);
+  EXPECT_EQ(net3.at<fully_connected_layer>(0).get_weight_storage(),
+            weight_storage::codebook);
+  for (size_t s = 0; s < in.size(); s++) {
+    EXPECT_EQ(net3.predict(in[s]), clustered[s]);
+  }
+
+  // the codebook kernel computes the same as the decoded dense weights
+  fc1.set_weight_storage(weight_storage::dense);
+  fc2.set_weight_storage(weight_storage::dense);
+  for (size_t s = 0; s < in.size(); s++) {
+    vec_t dense = net2.predict(in[s]);
+    for (size_t i = 0; i < dense.size(); i++) {
+      EXPECT_NEAR(dense[i], clustered[s][i], 1e-5);
+    }
+  }
+}
+
+TEST(model_compression, codebook_storage_reverts_on_update) {
+  network<sequential> net;
+  net << fully_connected_layer(4, 3);
+  auto &fc = net.at<fully_connected_layer>(0);
+  net.init_weight();
+
+  const std::vector<float_t> codebook = {-0.5, 0.25, 1.0};
+  const std::vector<uint8_t> indices  = {0, 1, 2, 2, 1, 0, 1, 1, 1, 0, 0, 2};
+  fc.set_codebook_weights(codebook, indices);
+  EXPECT_EQ(fc.get_weight_storage(), weight_storage::codebook);
+  EXPECT_EQ(fc.codebook_weights().to_dense(), *fc.weights()[0]);
+  EXPECT_THROW(fc.set_weight_storage(weight_storage::codebook), nn_error);
+
+  const vec_t x = {1, -2, 0.5, 3};
+  const vec_t y = net.predict(x);
+  const vec_t &w = *fc.weights()[0];
+  const vec_t &b = *fc.weights()[1];
+  for (size_t o = 0; o < 3; o++) {
+    float_t expected = b[o];
+    for (size_t i = 0; i < 4; i++) expected += x[i] * w[i * 3 + o];
+    EXPECT_NEAR(y[o], expected, 1e-6);
+  }
+
+  std::vector<vec_t> data = {x};
+  std::vector<vec_t> target = {vec_t(3, float_t(0))};
+  gradient_descent opt;
+  net.fit<mse>(opt, data, target, 1, 1);
+  EXPECT_EQ(fc.get_weight_storage(), weight_storage::dense);
+  EXPECT_TRUE(fc.codebook_weights().empty());
+}
+
+}  // namespace tiny_dnn
@@ -702,4 +702,65 @@ TEST(network, trainable) {
   EXPECT_NE(w4, w4_after_update);
 }
 
+TEST(network, label_target_gradient) {
+  vec_t y = {0.1, 0.6, 0.2, 0.1};
+  for (auto range : {std::make_pair(0.0, 1.0), std::make_pair(-0.8, 0.8)}) {
+    label_target t{2, float_t(range.first), float_t(range.second)};
+    vec_t dense(y.size(), t.min);
+    dense[t.label] = t.max;
+
+    EXPECT_NEAR(mse::f(y, t), mse::f(y, dense), 1e-6);
+    EXPECT_NEAR(cross_entropy_multiclass::f(y, t),
+                cross_entropy_multiclass::f(y, dense), 1e-6);
+    vec_t d1 = gradient<mse>(y, t), d2 = gradient<mse>(y, dense);
+    vec_t d3 = gradient<cross_entropy_multiclass>(y, t);
+    vec_t d4 = gradient<cross_entropy_multiclass>(y, dense);
+    // losses without a label_target overload fall back to a dense target
+    vec_t d5 = gradient<absolute>(y, t), d6 = gradient<absolute>(y, dense);
+    for (size_t i = 0; i < y.size(); i++) {
+      EXPECT_NEAR(d1[i], d2[i], 1e-6);
+      EXPECT_NEAR(d3[i], d4[i], 1e-6);
+      EXPECT_FLOAT_EQ(d5[i], d6[i]);
+    }
+  }
+}
+
+TEST(network, train_labels_matches_one_hot) {
+  network<sequential> net1, net2;
+  net1 << fully_connected_layer(3, 4) << tanh_layer()
+       << fully_connected_layer(4, 3) << tanh_layer();
+  net2 << fully_connected_layer(3, 4) << tanh_layer()
+       << fully_connected_layer(4, 3) << tanh_layer();
+  set_random_seed(7);
+  net1.init_weight();
+  set_random_seed(7);
+  net2.init_weight();
+  EXPECT_EQ(*net1[0]->weights()[0], *net2[0]->weights()[0]);
+
+  std::vector<vec_t> in = {{0.1, 0.2, -0.3}, {-0.5, 0.4, 0.0},
+                           {0.9, -0.1, 0.3}, {0.2, 0.2, 0.2},
+                           {-0.3, -0.6, 0.1}};
+  std::vector<label_t> labels = {0, 2, 1, 1, 0};
+  std::vector<vec_t> one_hot;
+  for (auto l : labels) {
+    vec_t v(3, net1[3]->out_value_range().first);
+    v[l] = net1[3]->out_value_range().second;
+    one_hot.push_back(v);
+  }
+
+  gradient_descent opt1, opt2;
+  net1.train<mse>(opt1, in, labels, 2, 3);
+  net2.fit<mse>(opt2, in, one_hot, 2, 3);
+  for (size_t i = 0; i < net1.layer_size(); i++) {
+    for (size_t w = 0; w < net1[i]->weights().size(); w++) {
+      const vec_t &w1 = *net1[i]->weights()[w];
+      const vec_t &w2 = *net2[i]->weights()[w];
+      for (size_t j = 0; j < w1.size(); j++) EXPECT_FLOAT_EQ(w1[j], w2[j]);
+    }
+  }
+
+  EXPECT_THROW(net1.train<mse>(opt1, in, std::vector<label_t>(5, 3), 1, 1),
+               nn_error);
+}
+
 }  // namespace tiny_dnn
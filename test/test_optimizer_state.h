@@ -0,0 +1,164 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <limits>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(optimizer_state, half_conversion) {
+  for (float v : {0.0f, 1.0f, -2.5f, 65504.0f, 6.103515625e-5f,
+                  5.9604645e-8f, -3.0517578e-5f}) {
+    EXPECT_EQ(half_to_float(float_to_half(v)), v);
+  }
+  // ties round to even
+  EXPECT_EQ(half_to_float(float_to_half(1.0f + 1.0f / 2048)), 1.0f);
+  EXPECT_EQ(half_to_float(float_to_half(1.0f + 3.0f / 2048)),
+            1.0f + 2.0f / 1024);
+  EXPECT_EQ(half_to_float(float_to_half(1e-9f)), 0.0f);
+  EXPECT_EQ(half_to_float(float_to_half(70000.0f)),
+            std::numeric_limits<float>::infinity());
+}
+
+TEST(optimizer_state, int8_blocks) {
+  optimizer_state s;
+  s.resize(300, state_precision::int8);
+  EXPECT_EQ(s.blocks(), 2u);
+  EXPECT_EQ(s.block_length(1), 44u);
+  EXPECT_EQ(s.memory_bytes(), 300u + 2 * sizeof(float));
+
+  vec_t in(256), out(256);
+  for (size_t i = 0; i < in.size(); i++) {
+    in[i] = float_t(std::pow(10.0, -3.0 * i / 256) * (i % 2 ? -1 : 1));
+  }
+  s.store(0, &in[0]);
+  s.load(0, &out[0]);
+  EXPECT_FLOAT_EQ(out[0], in[0]);
+  for (size_t i = 0; i < in.size(); i++) {
+    // half a step of the squared grid is about sqrt(|x| * scale) / 127
+    EXPECT_NEAR(out[i], in[i], std::sqrt(std::abs(in[i])) / 127 + 2e-5);
+  }
+}
+
+TEST(optimizer_state, tiny_gradients) {
+  // weights with tiny gradients share a block with one large gradient;
+  // their second moments fall below the block's grid. rounded to zero, they
+  // made the steps several times larger than in fp32
+  auto displacement = [](state_precision p) {
+    adam opt;
+    opt.set_state_precision(p);
+    vec_t w(256, float_t(0)), dw(256, float_t(1e-3));
+    dw[0] = float_t(1);
+    for (int t = 0; t < 200; t++) opt.update(dw, w, false);
+    return w;
+  };
+
+  const vec_t fp32 = displacement(state_precision::fp32);
+  for (auto p : {state_precision::fp16, state_precision::int8}) {
+    const vec_t w = displacement(p);
+    for (size_t i = 0; i < w.size(); i++) {
+      EXPECT_LE(std::abs(w[i]), std::abs(fp32[i]) * 1.5);
+      EXPECT_GE(std::abs(w[i]), std::abs(fp32[i]) * 0.05);
+    }
+  }
+}
+
+// update_rows must match a dense update whose other rows get no gradient
+template <typename Optimizer>
+void check_update_rows(state_precision p) {
+  const size_t row_size = 30;  // rows straddle the 256 value blocks
+  const std::vector<size_t> rows = {1, 8, 7};
+  Optimizer dense, sparse;
+  dense.set_state_precision(p);
+  sparse.set_state_precision(p);
+  vec_t w(10 * row_size);
+  uniform_rand(w.begin(), w.end(), float_t(-1), float_t(1));
+  vec_t w2 = w;
+
+  for (int t = 0; t < 3; t++) {
+    vec_t dw(rows.size() * row_size), full(w.size(), float_t(0));
+    uniform_rand(dw.begin(), dw.end(), float_t(-1), float_t(1));
+    for (size_t k = 0; k < rows.size(); k++) {
+      std::copy(&dw[k * row_size], &dw[k * row_size] + row_size,
+                &full[rows[k] * row_size]);
+    }
+    dense.update(full, w, false);
+    sparse.update_rows(dw, rows, row_size, w2, t == 1);
+  }
+  for (size_t i = 0; i < w.size(); i++) EXPECT_NEAR(w[i], w2[i], 1e-6);
+}
+
+TEST(optimizer_state, update_rows) {
+  for (auto p : {state_precision::fp32, state_precision::int8}) {
+    check_update_rows<adagrad>(p);
+    check_update_rows<RMSprop>(p);
+    check_update_rows<adam>(p);
+    check_update_rows<momentum>(p);
+  }
+
+  gradient_descent sgd;
+  vec_t w = {1, 2, 3, 4, 5, 6};
+  sgd.update_rows({1, 1}, {1}, 2, w, false);
+  const vec_t expected = {1, 2, 2.99, 3.99, 5, 6};
+  for (size_t i = 0; i < w.size(); i++) EXPECT_NEAR(w[i], expected[i], 1e-6);
+}
+
+TEST(optimizer_state, compressed_training) {
+  std::vector<vec_t> x, y;
+  for (int i = 0; i < 64; i++) {
+    vec_t v(8);
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+    x.push_back(v);
+    y.push_back({float_t(0.5) * v[0] - v[3], v[5] * float_t(0.25)});
+  }
+
+  auto train = [&](state_precision p, size_t *bytes) {
+    network<sequential> net;
+    net << fully_connected_layer(8, 32) << tanh_layer()
+        << fully_connected_layer(32, 2);
+    set_random_seed(3);
+    net.init_weight();
+
+    adam opt;
+    opt.set_state_precision(p);
+    net.fit<mse>(opt, x, y, 8, 60);
+    *bytes = opt.state_memory_bytes();
+    return net.get_loss<mse>(x, y);
+  };
+
+  size_t fp32_bytes, fp16_bytes, int8_bytes;
+  const float_t fp32_loss = train(state_precision::fp32, &fp32_bytes);
+  const float_t fp16_loss = train(state_precision::fp16, &fp16_bytes);
+  const float_t int8_loss = train(state_precision::int8, &int8_bytes);
+
+  EXPECT_EQ(fp16_bytes * sizeof(float_t), fp32_bytes * sizeof(uint16_t));
+  EXPECT_LT(int8_bytes * 3, fp32_bytes);
+  EXPECT_LT(fp16_loss, fp32_loss * 1.5 + 1e-3);
+  EXPECT_LT(int8_loss, fp32_loss * 2 + 1e-2);
+
+  // the other optimizers share the blockwise update
+  momentum m;
+  m.set_state_precision(state_precision::int8);
+  RMSprop r;
+  r.set_state_precision(state_precision::fp16);
+  adagrad g;
+  g.set_state_precision(state_precision::int8);
+  for (optimizer *o : std::vector<optimizer *>{&m, &r, &g}) {
+    network<sequential> net;
+    net << fully_connected_layer(8, 2);
+    net.init_weight();
+    const float_t before = net.get_loss<mse>(x, y);
+    net.fit<mse>(*o, x, y, 8, 20);
+    EXPECT_LT(net.get_loss<mse>(x, y), before);
+  }
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,96 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(packed_model, roundtrip) {
+  network<sequential> net, net2;
+  net << convolutional_layer(8, 8, 3, 2, 4) << relu_layer()
+      << max_pooling_layer(6, 6, 4, 2) << fully_connected_layer(36, 10)
+      << batch_normalization_layer(1, 10) << fully_connected_layer(10, 3)
+      << softmax_layer();
+  net.init_weight();
+
+  std::stringstream ss;
+  save_packed(net, ss);
+  load_packed(net2, ss);
+
+  EXPECT_TRUE(net.has_same_weights(net2, 0));
+  vec_t in(128);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  EXPECT_EQ(net.predict(in), net2.predict(in));
+}
+
+TEST(packed_model, grouped_filters_stored_compact) {
+  const core::connection_table groups(4, 16, 16);
+  network<sequential> net, dense, net2;
+  net << convolutional_layer(6, 6, 3, 16, 16, groups) << tanh_layer();
+  dense << convolutional_layer(6, 6, 3, 16, 16) << tanh_layer();
+  net.init_weight();
+
+  std::stringstream ss, ss_dense;
+  save_packed(net, ss);
+  save_packed(dense, ss_dense);
+  EXPECT_LT(ss.str().size() * 2, ss_dense.str().size());
+
+  load_packed(net2, ss);
+  const vec_t &w  = *net[0]->weights()[0];
+  const vec_t &w2 = *net2[0]->weights()[0];
+  ASSERT_EQ(w.size(), w2.size());
+  for (serial_size_t o = 0; o < 16; o++) {
+    for (serial_size_t i = 0; i < 16; i++) {
+      for (size_t k = 0; k < 9; k++) {
+        const size_t idx = (o * 16 + i) * 9 + k;
+        EXPECT_EQ(w2[idx], groups.is_connected(o, i) ? w[idx] : float_t(0));
+      }
+    }
+  }
+
+  vec_t in(576);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  EXPECT_EQ(net.predict(in), net2.predict(in));
+}
+
+TEST(packed_model, load_from_mapped_file) {
+  network<sequential> net, net2;
+  net << fully_connected_layer(20, 30) << tanh_layer()
+      << fully_connected_layer(30, 5);
+  net.init_weight();
+
+  const std::string path = unique_path();
+  save_packed(net, path);
+  load_packed(net2, path);
+  std::remove(path.c_str());
+
+  EXPECT_TRUE(net.has_same_weights(net2, 0));
+}
+
+TEST(packed_model, corrupted) {
+  network<sequential> net, net2;
+  net << fully_connected_layer(20, 30);
+  net.init_weight();
+
+  std::stringstream ss;
+  save_packed(net, ss);
+  const std::string s = ss.str();
+
+  std::stringstream truncated(s.substr(0, s.size() - 4));
+  EXPECT_THROW(load_packed(net2, truncated), nn_error);
+
+  std::stringstream bad("not a model");
+  EXPECT_THROW(load_packed(net2, bad), nn_error);
+}
+
+}  // namespace tiny_dnn
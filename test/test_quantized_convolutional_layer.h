@@ -95,24 +95,40 @@ TEST(quantized_convolutional, fprop) {
     {
         l.forward_propagation(in_data, out_data);
 
-        EXPECT_NEAR(-0.043426, out[0], 2E-2);
-        EXPECT_NEAR(1.6769816, out[1], 2E-2);
-        EXPECT_NEAR(1.4731820, out[2], 2E-2);
-        EXPECT_NEAR(1.0822733, out[3], 2E-2);
-        EXPECT_NEAR(0.0415336, out[4], 2E-2);
-        EXPECT_NEAR(-1.997466, out[5], 2E-2);
-        EXPECT_NEAR(0.4238461, out[6], 2E-2);
-        EXPECT_NEAR(1.1756143, out[7], 2E-2);
-        EXPECT_NEAR(0.8273983, out[8], 2E-2);
-        EXPECT_NEAR(-0.192101, out[9], 2E-2);
-        EXPECT_NEAR(1.2309504, out[10], 2E-2);
-        EXPECT_NEAR(2.2292108, out[11], 2E-2);
-        EXPECT_NEAR(0.5300441, out[12], 2E-2);
-        EXPECT_NEAR(1.7407004, out[13], 2E-2);
-        EXPECT_NEAR(1.6345025, out[14], 2E-2);
-        EXPECT_NEAR(0.6362420, out[15], 2E-2);
-        EXPECT_NEAR(3.4186277, out[16], 2E-2);
-        EXPECT_NEAR(-0.489455, out[17], 2E-2);
+        // float reference, and the error the uint8 steps of the input,
+        // the filters and the output may add to each of its values
+        convolutional_layer ref(5, 5, 3, 1, 2);
+        tensor_t ref_tensor = create_simple_tensor(18);
+        std::vector<tensor_t *> ref_data = {&ref_tensor};
+        ref.setup(false);
+        ref.forward_propagation(in_data, ref_data);
+        const vec_t &expected = ref_tensor[0];
+
+        float_t min_w, max_w;
+        core::kernels::weight_quantization_range(weight, &min_w, &max_w);
+        const auto in_range  = std::minmax_element(in.begin(), in.end());
+        const auto out_range = std::minmax_element(expected.begin(),
+                                                   expected.end());
+        const float_t in_step  = (*in_range.second - *in_range.first) / 255;
+        const float_t w_step   = (max_w - min_w) / 255;
+        const float_t out_step = (*out_range.second - *out_range.first) / 255;
+
+        for (serial_size_t o = 0; o < 2; o++) {
+          for (serial_size_t y = 0; y < 3; y++) {
+            for (serial_size_t x = 0; x < 3; x++) {
+              float_t bound = out_step;
+              for (serial_size_t ky = 0; ky < 3; ky++) {
+                for (serial_size_t kx = 0; kx < 3; kx++) {
+                  const float_t w = weight[o * 9 + ky * 3 + kx];
+                  const float_t v = in[(y + ky) * 5 + x + kx];
+                  bound += (std::abs(w) * in_step + std::abs(v) * w_step) / 2;
+                }
+              }
+              const serial_size_t i = o * 9 + y * 3 + x;
+              EXPECT_NEAR(expected[i], out[i], bound);
+            }
+          }
+        }
     }
   // clang-format on
 }
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <memory>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+// compares the gradients of sum(y * coef) with central differences
+inline void check_recurrent_gradient(layer *l) {
+  l->setup(false);
+  for (auto w : l->weights()) {
+    uniform_rand(w->begin(), w->end(), float_t(-0.5), float_t(0.5));
+  }
+  tensor_t in(2, vec_t(l->in_shape()[0].size()));
+  tensor_t coef(2, vec_t(l->out_shape()[0].size()));
+  for (auto &v : in) uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+  for (auto &v : coef) {
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+  }
+
+  std::vector<const tensor_t *> o;
+  auto loss = [&]() {
+    l->forward({in}, o);
+    double sum = 0;
+    for (size_t s = 0; s < in.size(); s++) {
+      for (size_t i = 0; i < coef[s].size(); i++) {
+        sum += (*o[0])[s][i] * coef[s][i];
+      }
+    }
+    return sum;
+  };
+  loss();
+  auto grads = l->backward(std::vector<tensor_t>{coef});
+
+  const double eps = 1e-3;
+  auto numeric     = [&](float_t *p) {
+    const float_t v = *p;
+    *p              = v + float_t(eps);
+    const double lp = loss();
+    *p              = v - float_t(eps);
+    const double lm = loss();
+    *p              = v;
+    return (lp - lm) / (2 * eps);
+  };
+
+  for (size_t s = 0; s < in.size(); s++) {
+    for (size_t i = 0; i < in[s].size(); i++) {
+      EXPECT_NEAR(grads[0][s][i], numeric(&in[s][i]), 2e-3);
+    }
+  }
+  for (size_t k = 1; k < grads.size(); k++) {
+    vec_t &w = *l->weights()[k - 1];
+    for (size_t i = 0; i < w.size(); i++) {
+      const double analytic = grads[k][0][i] + grads[k][1][i];
+      EXPECT_NEAR(analytic, numeric(&w[i]), 2e-3) << "input " << k;
+    }
+  }
+}
+
+TEST(recurrent, lstm_gradient) {
+  lstm_layer l(3, 4, 5);
+  check_recurrent_gradient(&l);
+  lstm_layer last(2, 3, 4, false);
+  check_recurrent_gradient(&last);
+}
+
+TEST(recurrent, gru_gradient) {
+  gru_layer l(3, 4, 5);
+  check_recurrent_gradient(&l);
+  gru_layer last(2, 3, 4, false);
+  check_recurrent_gradient(&last);
+}
+
+TEST(recurrent, truncated_bptt) {
+  std::vector<std::shared_ptr<recurrent_layer>> layers = {
+    std::make_shared<lstm_layer>(2, 3, 6, false, 2),
+    std::make_shared<gru_layer>(2, 3, 6, false, 2)};
+
+  for (auto &l : layers) {
+    l->setup(false);
+    vec_t in(12), delta(3, float_t(1));
+    uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+    std::vector<const tensor_t *> o;
+    l->forward({{in}}, o);
+    auto grads = l->backward(std::vector<tensor_t>{{delta}});
+
+    // only the last chunk of two steps sees the gradient of the output
+    for (size_t i = 0; i < 8; i++) EXPECT_EQ(grads[0][0][i], float_t(0));
+    float_t last = 0;
+    for (size_t i = 8; i < 12; i++) last += std::abs(grads[0][0][i]);
+    EXPECT_GT(last, float_t(0));
+  }
+}
+
+TEST(recurrent, train) {
+  // the mean of a sequence, which needs the whole sequence to be kept
+  std::vector<vec_t> x, y;
+  for (int i = 0; i < 64; i++) {
+    vec_t v(6);
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+    float_t mean = 0;
+    for (auto e : v) mean += e / 6;
+    x.push_back(v);
+    y.push_back({mean});
+  }
+
+  network<sequential> lstm_net, gru_net;
+  lstm_net << lstm_layer(1, 8, 6, false) << fully_connected_layer(8, 1);
+  gru_net << gru_layer(1, 8, 6, false) << fully_connected_layer(8, 1);
+
+  for (auto net : {&lstm_net, &gru_net}) {
+    net->init_weight();
+    const float_t before = net->get_loss<mse>(x, y);
+    adam opt;
+    opt.alpha = float_t(0.01);
+    net->fit<mse>(opt, x, y, 8, 30);
+    EXPECT_LT(net->get_loss<mse>(x, y), before * 0.25);
+
+    auto clone = clone_layer(*(*net)[0]);
+    auto r     = dynamic_cast<recurrent_layer *>(clone.get());
+    ASSERT_TRUE(r != nullptr);
+    EXPECT_EQ(r->seq_len(), 6u);
+    EXPECT_FALSE(r->return_sequences());
+  }
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,154 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(sampled_softmax, forward_backward) {
+  sampled_softmax_layer l(3, 4, 2);
+  l.setup(false);
+  vec_t &W = *l.weights()[0];
+  vec_t &b = *l.weights()[1];
+  uniform_rand(W.begin(), W.end(), float_t(-1), float_t(1));
+  b = {0.1, -0.2, 0.3, 0.0};
+
+  vec_t in = {0.5, -1.0, 0.25};
+  vec_t p(4);
+  float_t sum = 0;
+  for (size_t c = 0; c < 4; c++) {
+    p[c] = b[c];
+    for (size_t i = 0; i < 3; i++) p[c] += W[c * 3 + i] * in[i];
+    p[c] = std::exp(p[c]);
+    sum += p[c];
+  }
+  for (auto &v : p) v /= sum;
+
+  std::vector<const tensor_t *> o;
+  l.forward({{in}}, o);
+  for (size_t c = 0; c < 4; c++) EXPECT_NEAR((*o[0])[0][c], p[c], 1e-6);
+
+  // outside of training the gradient is the full softmax gradient
+  vec_t delta = class_nll::df((*o[0])[0], label_target{2, 0, 1});
+  auto grads  = l.backward(std::vector<tensor_t>{{delta}});
+  for (size_t c = 0; c < 4; c++) {
+    EXPECT_NEAR(grads[2][0][c], p[c] - (c == 2 ? 1 : 0), 1e-6);
+  }
+  for (size_t i = 0; i < 3; i++) {
+    float_t dx = 0;
+    for (size_t c = 0; c < 4; c++) {
+      dx += W[c * 3 + i] * (p[c] - (c == 2 ? 1 : 0));
+    }
+    EXPECT_NEAR(grads[0][0][i], dx, 1e-6);
+  }
+
+  // the training forward pass scores the drawn candidates only
+  l.set_context(net_phase::train);
+  l.forward({{in}}, o);
+  size_t scored = 0;
+  sum           = 0;
+  for (auto y : (*o[0])[0]) {
+    scored += y > 0;
+    sum += y;
+  }
+  EXPECT_EQ(scored, 2u);
+  EXPECT_NEAR(sum, 1, 1e-6);
+}
+
+TEST(sampled_softmax, proposal) {
+  sampled_softmax_layer l(2, 4, 3, candidate_sampler::uniform);
+  EXPECT_FLOAT_EQ(l.proposal(3), 0.25);
+
+  l.set_proposal({1, 0, 2, 1});
+  EXPECT_EQ(l.sampler(), candidate_sampler::custom);
+  EXPECT_FLOAT_EQ(l.proposal(1), 0);
+  EXPECT_FLOAT_EQ(l.proposal(2), 0.5);
+
+  auto clone = clone_layer(l);
+  auto s     = dynamic_cast<sampled_softmax_layer *>(clone.get());
+  ASSERT_TRUE(s != nullptr);
+  EXPECT_EQ(s->sampler(), candidate_sampler::custom);
+  EXPECT_FLOAT_EQ(s->proposal(2), 0.5);
+
+  sampled_softmax_layer z(2, 1000, 3);
+  float_t sum = 0;
+  for (label_t c = 0; c < 1000; c++) sum += z.proposal(c);
+  EXPECT_NEAR(sum, 1, 1e-4);
+  EXPECT_GT(z.proposal(0), z.proposal(999));
+
+  EXPECT_THROW(l.set_proposal({1, 2}), nn_error);
+  EXPECT_THROW(sampled_softmax_layer(2, 4, 3, candidate_sampler::custom),
+               nn_error);
+  EXPECT_THROW(sampled_softmax_layer(2, 4, 4), nn_error);
+  // fewer than n_candidates classes could ever be drawn
+  EXPECT_THROW(l.set_proposal({1, 0, 0, 1}), nn_error);
+}
+
+TEST(sampled_softmax, row_sparse_update) {
+  const serial_size_t in_dim = 4, n_classes = 50, n_candidates = 5;
+  network<sequential> net;
+  net << sampled_softmax_layer(in_dim, n_classes, n_candidates);
+  net.init_weight();
+  const vec_t W0 = *net[0]->weights()[0];
+  const vec_t b0 = *net[0]->weights()[1];
+
+  std::vector<vec_t> x       = {{0.5, -1, 0.25, 1}, {1, 0, -0.5, 0.5}};
+  std::vector<label_t> label = {7, 7};
+  adam opt;
+  net.train<class_nll>(opt, x, label, 2, 1);
+
+  // only the label and the candidates of the step are updated, and the
+  // candidates are distinct
+  const vec_t &W = *net[0]->weights()[0];
+  const vec_t &b = *net[0]->weights()[1];
+  size_t changed = 0;
+  for (size_t c = 0; c < n_classes; c++) {
+    const float_t *row     = &W[c * in_dim];
+    const bool row_changed = !std::equal(row, row + in_dim, &W0[c * in_dim]);
+    EXPECT_EQ(row_changed, b[c] != b0[c]);
+    changed += row_changed;
+  }
+  EXPECT_NE(b[7], b0[7]);
+  EXPECT_GE(changed, n_candidates);
+  EXPECT_LE(changed, n_candidates + 1);
+
+  // the weight gradient is kept per row, not per sample and class
+  EXPECT_EQ(net[0]->weights_grads()[0]->size(), 1u);
+  EXPECT_EQ(net[0]->weights_grads()[1]->size(), 1u);
+}
+
+TEST(sampled_softmax, train) {
+  const label_t n_classes = 200;
+  std::vector<vec_t> x;
+  std::vector<label_t> labels;
+  std::vector<vec_t> one_hot;
+  for (label_t i = 0; i < 400; i++) {
+    const label_t c = (i * 7) % n_classes;
+    vec_t v(8);
+    for (size_t j = 0; j < 8; j++) v[j] = float_t((c >> j) & 1) - 0.5;
+    x.push_back(v);
+    labels.push_back(c);
+    one_hot.push_back(vec_t(n_classes, 0));
+    one_hot.back()[c] = 1;
+  }
+
+  network<sequential> net;
+  net << sampled_softmax_layer(8, n_classes, 20, candidate_sampler::uniform);
+  const float_t before = net.get_loss<class_nll>(x, one_hot);
+
+  adam opt;
+  opt.alpha = float_t(0.05);
+  net.train<class_nll>(opt, x, labels, 20, 20);
+  EXPECT_LT(net.get_loss<class_nll>(x, one_hot), before * 0.5);
+}
+
+}  // namespace tiny_dnn
@@ -442,6 +442,8 @@ TEST(serialization, serialize_q_conv) {
   EXPECT_EQ(net[0]->in_shape()[0], shape3d(20, 20, 10));
   EXPECT_EQ(net[0]->in_shape()[1], shape3d(5, 5, 10 * 5));
   EXPECT_EQ(net[0]->out_shape()[0], shape3d(10, 10, 5));
+  // a record saved before versioning gets the defaults of later fields
+  EXPECT_FALSE(net[0]->weight_quantization());
 }
 
 TEST(serialization, serialize_q_deconv) {
@@ -907,4 +909,38 @@ TEST(serialization, graph_model_and_weights) {
   EXPECT_FLOAT_EQ(res1[1], res2[1]);
 }
 
+TEST(serialization, quantization_settings) {
+  network<sequential> net1, net2, net3;
+  net1 << quantized_convolutional_layer(4, 4, 3, 1, 2)
+       << fully_connected_layer(8, 3);
+  net1.init_weight();
+
+  // inputs outside of the fixed range, so that it changes the result
+  vec_t in(16);
+  uniform_rand(in.begin(), in.end(), float_t(-3), float_t(3));
+  const vec_t per_sample = net1.predict(in);
+
+  net1.at<quantized_convolutional_layer>(0).set_input_range(-1, 2);
+  net1[1]->set_weight_quantization(true);
+  const vec_t expected = net1.predict(in);
+  EXPECT_NE(per_sample, expected);
+
+  auto path = unique_path();
+  net1.save(path, content_type::weights_and_model);
+  net2.load(path, content_type::weights_and_model);
+  net3.from_json(net1.to_json(content_type::weights_and_model),
+                 content_type::weights_and_model);
+
+  for (auto *net : {&net2, &net3}) {
+    EXPECT_FALSE((*net)[0]->weight_quantization());
+    EXPECT_TRUE((*net)[1]->weight_quantization());
+
+    const vec_t actual = net->predict(in);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_FLOAT_EQ(expected[i], actual[i]);
+    }
+  }
+}
+
 }  // namespace tiny_dnn
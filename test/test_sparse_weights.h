@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+// zero all but every n-th weight
+inline void prune_weights(layer *l, size_t n) {
+  vec_t &w = *l->weights()[0];
+  for (size_t i = 0; i < w.size(); i++) {
+    if (i % n) w[i] = float_t(0);
+  }
+}
+
+TEST(sparse_weights, block_sparse_matrix) {
+  vec_t dense(5 * 11, float_t(0));
+  dense[0]      = 1;
+  dense[13]     = 2;
+  dense[2 * 11] = float_t(0.01);
+  dense[54]     = 3;
+
+  block_sparse_matrix m(&dense[0], 5, 11, 4);
+  EXPECT_EQ(m.nonzero_blocks(), 4u);
+  EXPECT_EQ(m.row_end(3) - m.row_begin(3), 0u);
+  EXPECT_EQ(m.block_col(m.row_begin(4)), 8u);
+  EXPECT_EQ(m.to_dense(), dense);
+
+  m.assign(&dense[0], 5, 11, 4, float_t(0.1));
+  EXPECT_EQ(m.nonzero_blocks(), 3u);
+  EXPECT_FLOAT_EQ(m.density(), float_t(12) / 55);
+}
+
+TEST(sparse_weights, fully_connected) {
+  network<sequential> net;
+  net << fully_connected_layer(37, 23) << relu_layer()
+      << fully_connected_layer(23, 5, false);
+  net.init_weight();
+  prune_weights(net[0], 50);
+  prune_weights(net[2], 3);
+
+  vec_t in(37);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net.predict(in);
+
+  for (size_t i : {0, 2}) {
+    net.at<fully_connected_layer>(i).set_weight_storage(weight_storage::sparse);
+  }
+  const vec_t actual = net.predict(in);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5);
+  }
+
+  auto &fc = net.at<fully_connected_layer>(0);
+  EXPECT_EQ(fc.sparse_weights().block_size(), vectorize::simd_width());
+  EXPECT_LT(fc.sparse_weights().memory_bytes(),
+            fc.weights()[0]->size() * sizeof(float_t));
+
+  // the sparse copy follows training
+  adagrad opt;
+  std::vector<vec_t> x(2, in), y(2, vec_t(5, float_t(0.1)));
+  net.fit<mse>(opt, x, y, 2, 1);
+  const vec_t trained = net.predict(in);
+  fc.set_weight_storage(weight_storage::dense);
+  net.at<fully_connected_layer>(2).set_weight_storage(weight_storage::dense);
+  EXPECT_EQ(fc.get_weight_storage(), weight_storage::dense);
+  const vec_t reference = net.predict(in);
+  for (size_t i = 0; i < reference.size(); i++) {
+    EXPECT_NEAR(reference[i], trained[i], 1e-5);
+  }
+}
+
+TEST(sparse_weights, convolutional) {
+  static const bool tbl[] = {true, false, true, true, false, true};
+  for (auto pad : {padding::valid, padding::same}) {
+    network<sequential> net;
+    net << convolutional_layer(9, 8, 3, 2, 3, connection_table(tbl, 2, 3),
+                               pad, true, 2, 1);
+    net.init_weight();
+    prune_weights(net[0], 4);
+
+    vec_t in(9 * 8 * 2);
+    uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+    const vec_t expected = net.predict(in);
+
+    auto &conv = net.at<convolutional_layer>(0);
+    conv.set_weight_storage(weight_storage::sparse);
+    const vec_t actual = net.predict(in);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-5);
+    }
+    EXPECT_LT(conv.sparse_weights().density(), float_t(0.3));
+  }
+}
+
+TEST(sparse_weights, serialization) {
+  network<sequential> net1, net2, net3;
+  net1 << convolutional_layer(6, 6, 3, 2, 4) << relu_layer()
+       << fully_connected_layer(64, 5);
+  net1.init_weight();
+  prune_weights(net1[0], 3);
+  prune_weights(net1[2], 7);
+
+  auto &conv = net1.at<convolutional_layer>(0);
+  auto &fc   = net1.at<fully_connected_layer>(2);
+  conv.set_weight_storage(weight_storage::sparse, float_t(0.05));
+  fc.set_weight_storage(weight_storage::sparse, float_t(0), false);
+  EXPECT_FALSE(conv.dense_released());
+  EXPECT_TRUE(fc.dense_released());
+  EXPECT_TRUE(fc.weights()[0]->empty());
+
+  vec_t in(6 * 6 * 2);
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net1.predict(in);
+
+  auto path = unique_path();
+  net1.save(path, content_type::weights_and_model);
+  net2.load(path, content_type::weights_and_model);
+  net3.from_json(net1.to_json(content_type::weights_and_model),
+                 content_type::weights_and_model);
+
+  for (auto *net : {&net2, &net3}) {
+    auto &c = net->at<convolutional_layer>(0);
+    auto &f = net->at<fully_connected_layer>(2);
+    EXPECT_EQ(c.get_weight_storage(), weight_storage::sparse);
+    EXPECT_EQ(f.get_weight_storage(), weight_storage::sparse);
+    EXPECT_FALSE(c.dense_released());
+    EXPECT_TRUE(f.dense_released());
+    EXPECT_EQ(c.sparse_weights().nonzero_blocks(),
+              conv.sparse_weights().nonzero_blocks());
+
+    const vec_t actual = net->predict(in);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_FLOAT_EQ(expected[i], actual[i]);
+    }
+  }
+
+  // training brings the dense weights back
+  adagrad opt;
+  std::vector<vec_t> x(1, in), y(1, vec_t(5, float_t(0.1)));
+  net2.fit<mse>(opt, x, y, 1, 1);
+  auto &f = net2.at<fully_connected_layer>(2);
+  EXPECT_FALSE(f.dense_released());
+  EXPECT_EQ(f.weights()[0]->size(), 64u * 5u);
+}
+
+}  // namespace tiny_dnn
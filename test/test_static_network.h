@@ -0,0 +1,110 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+namespace sl = static_layers;
+
+typedef static_network<sl::shape<14, 14, 2>,
+                       sl::conv<3, 3, 2, 4>,
+                       sl::tanh,
+                       sl::avepool<2>,
+                       sl::conv<3, 3, 4, 6>,
+                       sl::relu,
+                       sl::maxpool<2>,
+                       sl::fc<8>,
+                       sl::sigmoid,
+                       sl::fc<3>,
+                       sl::softmax>
+  static_test_net;
+
+// the network<sequential> static_test_net mirrors, with random weights and
+// biases
+inline void static_test_reference(network<sequential> &net) {
+  net << convolutional_layer(14, 14, 3, 2, 4) << tanh_layer()
+      << average_pooling_layer(12, 12, 4, 2)
+      << convolutional_layer(6, 6, 3, 4, 6) << relu_layer()
+      << max_pooling_layer(4, 4, 6, 2) << fully_connected_layer(24, 8)
+      << sigmoid_layer() << fully_connected_layer(8, 3) << softmax_layer();
+  net.init_weight();
+  for (size_t i = 0; i < net.depth(); i++) {
+    for (auto w : net[i]->weights()) {
+      uniform_rand(w->begin(), w->end(), float_t(-1), float_t(1));
+    }
+  }
+}
+
+TEST(static_network, shapes) {
+  static_assert(static_test_net::in_size() == 392, "");
+  static_assert(static_test_net::out_size() == 3, "");
+  EXPECT_EQ(static_test_net::param_size(),
+            (3 * 3 * 2 * 4 + 4) + (2 * 2 * 4 + 4) + (3 * 3 * 4 * 6 + 6) +
+              (24 * 8 + 8) + (8 * 3 + 3));
+}
+
+TEST(static_network, same_as_network) {
+  network<sequential> net;
+  static_test_reference(net);
+
+  std::stringstream ss;
+  ss << net;
+  static static_test_net snet;
+  snet.load(ss);
+
+  for (int n = 0; n < 10; n++) {
+    vec_t in(static_test_net::in_size());
+    uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+
+    const vec_t expected = net.predict(in);
+    float_t actual[static_test_net::out_size()];
+    snet.predict(in.data(), actual);
+    for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-5);
+    }
+    EXPECT_EQ(snet.predict_label(in.data()), net.predict_label(in));
+  }
+}
+
+TEST(static_network, load_from_array) {
+  network<sequential> net;
+  static_test_reference(net);
+
+  std::vector<float_t> params;
+  for (size_t i = 0; i < net.depth(); i++) {
+    for (auto w : net[i]->weights()) {
+      params.insert(params.end(), w->begin(), w->end());
+    }
+  }
+  ASSERT_EQ(params.size(), static_test_net::param_size());
+
+  static static_test_net snet;
+  snet.load(params.data());
+
+  vec_t in(static_test_net::in_size());
+  uniform_rand(in.begin(), in.end(), float_t(-1), float_t(1));
+  const vec_t expected = net.predict(in);
+  float_t actual[static_test_net::out_size()];
+  snet.predict(in.data(), actual);
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5);
+  }
+}
+
+TEST(static_network, load_truncated) {
+  std::stringstream ss("0.5 0.25");
+  static static_test_net snet;
+  EXPECT_THROW(snet.load(ss), nn_error);
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(telemetry, rolling_histogram) {
+  rolling_histogram h(4, {1.0, 2.0, 3.0});
+
+  h.observe(0.5);
+  h.observe(1.5);
+  h.observe(2.5);
+  EXPECT_EQ(h.count(), 3u);
+  EXPECT_DOUBLE_EQ(h.sum(), 4.5);
+  EXPECT_DOUBLE_EQ(h.quantile(0.5), 1.5);
+
+  auto c = h.cumulative_counts();
+  ASSERT_EQ(c.size(), 4u);
+  EXPECT_EQ(c[0], 1u);
+  EXPECT_EQ(c[1], 2u);
+  EXPECT_EQ(c[2], 3u);
+  EXPECT_EQ(c[3], 3u);
+
+  // window is 4: the oldest observation is evicted
+  h.observe(5.0);
+  h.observe(5.0);
+  EXPECT_EQ(h.count(), 4u);
+  EXPECT_DOUBLE_EQ(h.sum(), 14.0);
+  c = h.cumulative_counts();
+  EXPECT_EQ(c[0], 0u);
+  EXPECT_EQ(c[1], 1u);
+  EXPECT_EQ(c[2], 2u);
+  EXPECT_EQ(c[3], 4u);
+
+  // the lifetime totals see every observation, also after clear()
+  h.clear();
+  EXPECT_EQ(h.count(), 0u);
+  EXPECT_EQ(h.total_count(), 5u);
+  EXPECT_DOUBLE_EQ(h.total_sum(), 14.5);
+  c = h.total_cumulative_counts();
+  EXPECT_EQ(c[0], 1u);
+  EXPECT_EQ(c[1], 2u);
+  EXPECT_EQ(c[2], 3u);
+  EXPECT_EQ(c[3], 5u);
+}
+
+TEST(telemetry, counters) {
+  training_telemetry t(8);
+
+  for (int i = 0; i < 3; i++) {
+    t.begin_batch();
+    t.record_phase(train_phase::forward, 0.001);
+    t.end_batch(16);
+  }
+  t.end_epoch();
+
+  EXPECT_EQ(t.samples_total(), 48u);
+  EXPECT_EQ(t.batches_total(), 3u);
+  EXPECT_EQ(t.epochs_total(), 1u);
+  EXPECT_DOUBLE_EQ(t.mean_phase_seconds(train_phase::forward), 0.001);
+  EXPECT_DOUBLE_EQ(t.mean_phase_seconds(train_phase::update), 0.0);
+  EXPECT_GE(t.thread_utilization(), 0.0);
+  EXPECT_LE(t.thread_utilization(), 1.0);
+}
+
+TEST(telemetry, fit_callbacks) {
+  network<sequential> net;
+  adagrad opt;
+
+  net << fully_connected_layer(4, 3) << tanh_layer()
+      << fully_connected_layer(3, 2);
+
+  std::vector<vec_t> in(10, vec_t{0.1, 0.2, 0.3, 0.4});
+  std::vector<vec_t> out(10, vec_t{0.5, -0.5});
+
+  size_t last_batches = 0;
+  int epochs          = 0;
+
+  // both telemetry-aware and parameterless callbacks are accepted
+  net.fit<mse>(opt, in, out, 4, 2,
+               [&](const training_telemetry &t) {
+                 EXPECT_EQ(t.batches_total(), last_batches + 1);
+                 last_batches = t.batches_total();
+               },
+               [&]() { epochs++; });
+
+  const training_telemetry &t = net.telemetry();
+  EXPECT_EQ(epochs, 2);
+  EXPECT_EQ(t.batches_total(), 6u);  // ceil(10 / 4) * 2
+  EXPECT_EQ(t.samples_total(), 20u);
+  EXPECT_EQ(t.epochs_total(), 2u);
+  EXPECT_EQ(t.phase_histogram(train_phase::forward).count(), 6u);
+  EXPECT_EQ(t.phase_histogram(train_phase::update).count(), 6u);
+  EXPECT_GT(t.samples_per_second(), 0.0);
+}
+
+TEST(telemetry, prometheus) {
+  training_telemetry t;
+  t.begin_batch();
+  t.record_phase(train_phase::backward, 0.002);
+  t.end_batch(32);
+
+  std::ostringstream os;
+  t.write_prometheus(os);
+  const std::string s = os.str();
+
+  EXPECT_NE(s.find("# TYPE tiny_dnn_train_samples_total counter"),
+            std::string::npos);
+  EXPECT_NE(s.find("tiny_dnn_train_samples_total 32"), std::string::npos);
+  EXPECT_NE(s.find("# TYPE tiny_dnn_train_phase_seconds histogram"),
+            std::string::npos);
+  EXPECT_NE(
+    s.find("tiny_dnn_train_phase_seconds_count{phase=\"backward\"} 1"),
+    std::string::npos);
+  EXPECT_NE(s.find("le=\"+Inf\""), std::string::npos);
+  EXPECT_NE(s.find("# TYPE tiny_dnn_train_batch_seconds_window gauge"),
+            std::string::npos);
+  EXPECT_NE(s.find("tiny_dnn_train_phase_seconds_window{phase=\"backward\","
+                   "quantile=\"0.5\"} 0.002"),
+            std::string::npos);
+}
+
+TEST(telemetry, prometheus_histogram_is_cumulative) {
+  training_telemetry t(2);
+  for (int i = 0; i < 5; i++) {
+    t.begin_batch();
+    t.record_phase(train_phase::forward, 0.001);
+    t.end_batch(1);
+  }
+  t.reset_window();
+
+  std::ostringstream os;
+  t.write_prometheus(os);
+  const std::string s = os.str();
+
+  // the window holds 2 batches and was reset; the histogram counts all 5
+  EXPECT_EQ(t.phase_histogram(train_phase::forward).count(), 0u);
+  EXPECT_NE(s.find("tiny_dnn_train_phase_seconds_count{phase=\"forward\"} 5"),
+            std::string::npos);
+  EXPECT_NE(s.find("tiny_dnn_train_phase_seconds_bucket{phase=\"forward\","
+                   "le=\"+Inf\"} 5"),
+            std::string::npos);
+  EXPECT_NE(s.find("tiny_dnn_train_batch_seconds_count 5"), std::string::npos);
+}
+
+}  // namespace tiny_dnn
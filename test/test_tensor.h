@@ -566,6 +566,87 @@ TEST(tensor, dim) {
   EXPECT_EQ(t3.dim(), 2u);
 }
 
+TEST(tensor, expression_assign) {
+  // odd length, to cover the elements after the last full register
+  vec_t a(37), b(37), y;
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = float_t(i) * float_t(0.5);
+    b[i] = float_t(3) - float_t(i);
+  }
+
+  expr::assign(y, (expr::ref(a) + 2) * expr::ref(b) -
+                    expr::maximum(expr::ref(a), expr::ref(b)) / 4);
+
+  ASSERT_EQ(y.size(), a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    EXPECT_FLOAT_EQ((a[i] + 2) * b[i] - std::max(a[i], b[i]) / 4, y[i]);
+  }
+}
+
+TEST(tensor, expression_select) {
+  vec_t x = {-2, -1, 0, 1, 2}, y;
+
+  expr::assign(y, expr::where(expr::ref(x) < 0, expr::exp(expr::ref(x)) - 1,
+                              expr::ref(x)));
+
+  for (size_t i = 0; i < x.size(); i++) {
+    EXPECT_FLOAT_EQ(x[i] < 0 ? std::exp(x[i]) - 1 : x[i], y[i]);
+  }
+}
+
+TEST(tensor, expression_compare) {
+  // odd length, to cover the elements after the last full register
+  vec_t x(37), dy(37), y1, y2, y3;
+  for (size_t i = 0; i < x.size(); i++) {
+    x[i]  = float_t(i % 5) - 2;
+    dy[i] = float_t(i) * float_t(0.25);
+  }
+
+  // relu backward and leaky relu forward stay on the SIMD path
+  const auto in        = expr::ref(x);
+  const auto relu_grad = expr::ref(dy) * (in > float_t(0));
+  const auto leaky     = expr::where(in > float_t(0), in, float_t(0.1) * in);
+  const auto sign      = expr::where(in < float_t(0), float_t(-1), float_t(1));
+  static_assert(decltype(relu_grad)::vectorizable, "");
+  static_assert(decltype(leaky)::vectorizable, "");
+  static_assert(decltype(sign)::vectorizable, "");
+  expr::assign(y1, relu_grad);
+  expr::assign(y2, leaky);
+  expr::assign(y3, sign);
+
+  for (size_t i = 0; i < x.size(); i++) {
+    EXPECT_FLOAT_EQ(x[i] > 0 ? dy[i] : 0, y1[i]);
+    EXPECT_FLOAT_EQ(x[i] > 0 ? x[i] : float_t(0.1) * x[i], y2[i]);
+    EXPECT_FLOAT_EQ(x[i] < 0 ? -1 : 1, y3[i]);
+  }
+}
+
+TEST(tensor, expression_aliasing) {
+  vec_t x = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  expr::assign(x, expr::ref(x) * expr::ref(x) + 1);
+
+  for (size_t i = 0; i < x.size(); i++) {
+    EXPECT_FLOAT_EQ(float_t((i + 1) * (i + 1) + 1), x[i]);
+  }
+}
+
+TEST(tensor, expression_size_mismatch) {
+  vec_t a(3), b(4), y;
+
+  EXPECT_THROW(expr::assign(y, expr::ref(a) + expr::ref(b)), nn_error);
+}
+
+TEST(tensor, expression_to_tensor) {
+  Tensor<float_t> a({2, 3, 4}, 2), b({2, 3, 4}, 3), t({2, 3, 4});
+
+  t = expr::ref(a) * expr::ref(b) + 1;
+
+  for (auto it = t.host_begin(); it != t.host_end(); ++it) {
+    EXPECT_FLOAT_EQ(float_t(7), *it);
+  }
+}
+
 template <size_t N>
 std::ostream &print_tester(std::ostream &os) {
   os << "\nPrinting " << N << "-dimensional Tensor"
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(training_runner, fair_share_scheduler) {
+  fair_share_scheduler s(1);
+  const size_t a = s.add_client(1.0);
+  const size_t b = s.add_client(2.0);
+  const size_t c = s.add_client(1.0);
+
+  std::mutex m;
+  std::vector<size_t> grants;
+  auto client = [&](size_t id, int n) {
+    s.acquire(id);
+    for (int i = 0; i < n; i++) {
+      {
+        std::lock_guard<std::mutex> lock(m);
+        grants.push_back(id);
+      }
+      if (i + 1 < n) {
+        s.yield(id, 1.0);
+      } else {
+        s.release(id, 1.0);
+      }
+    }
+  };
+
+  // hold the only core until both clients are queued
+  s.acquire(c);
+  std::thread ta(client, a, 6), tb(client, b, 6);
+  while (s.waiting() < 2) std::this_thread::yield();
+  s.release(c, 0.0);
+  ta.join();
+  tb.join();
+
+  // b has twice the share of a, so it gets two turns for each of a's
+  const std::vector<size_t> expected = {a, b, b, a, b, b, a, b, b};
+  ASSERT_EQ(grants.size(), 12u);
+  EXPECT_EQ(std::vector<size_t>(grants.begin(), grants.begin() + 9),
+            expected);
+  EXPECT_DOUBLE_EQ(s.used(a), 6.0);
+  EXPECT_DOUBLE_EQ(s.used(b), 6.0);
+}
+
+TEST(training_runner, same_as_training_alone) {
+  std::vector<vec_t> x;
+  std::vector<label_t> y;
+  for (size_t i = 0; i < 48; i++) {
+    vec_t v(5);
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+    x.push_back(v);
+    y.push_back(static_cast<label_t>(i % 3));
+  }
+  const shared_dataset data(x, y);
+
+  // three pairs of identically initialized networks
+  std::vector<network<sequential>> nets(3), alone(3);
+  for (size_t i = 0; i < 3; i++) {
+    for (auto *n : {&nets[i], &alone[i]}) {
+      set_random_seed(static_cast<unsigned int>(i));
+      *n << fully_connected_layer(5, 8) << tanh_layer()
+         << fully_connected_layer(8, 3);
+      n->init_weight();
+    }
+  }
+
+  training_runner runner(2);
+  std::vector<adagrad> opts(3);
+  std::vector<int> batches(3, 0), epochs(3, 0);
+  for (size_t i = 0; i < 3; i++) {
+    runner.add<mse>(nets[i], opts[i], data, 8, 2, [&, i] { batches[i]++; },
+                    [&, i] { epochs[i]++; }, double(i + 1));
+  }
+  runner.run();
+
+  for (size_t i = 0; i < 3; i++) {
+    adagrad opt;
+    alone[i].train<mse>(opt, x, y, 8, 2, nop, nop, false, 1);
+    EXPECT_TRUE(nets[i].has_same_weights(alone[i], 1e-6));
+    EXPECT_EQ(batches[i], 12);
+    EXPECT_EQ(epochs[i], 2);
+    EXPECT_GE(runner.used(i), 0.0);
+  }
+}
+
+TEST(training_runner, models_run_single_threaded) {
+  std::vector<vec_t> x;
+  std::vector<label_t> y;
+  for (size_t i = 0; i < 16; i++) {
+    vec_t v(4);
+    uniform_rand(v.begin(), v.end(), float_t(-1), float_t(1));
+    x.push_back(v);
+    y.push_back(static_cast<label_t>(i % 6));
+  }
+  const shared_dataset data(x, y);
+
+  network<sequential> a, b;
+  a << fully_connected_layer(4, 8) << max_unpooling_layer(4, 2, 1, 2)
+    << relu_layer() << fake_quantization_layer(45)
+    << hierarchical_softmax_layer(45, 6);
+  b << fully_connected_layer(4, 8) << leaky_relu_layer()
+    << sampled_softmax_layer(8, 6, 3);
+
+  // any parallel loop of either model would borrow from this budget
+  thread_budget budget(4);
+  a.set_execution_context(std::make_shared<execution_context>(5, 0, budget));
+  b.set_execution_context(std::make_shared<execution_context>(5, 0, budget));
+
+  training_runner runner(2);
+  adagrad opt_a, opt_b;
+  runner.add<class_nll>(a, opt_a, data, 8, 2);
+  runner.add<class_nll>(b, opt_b, data, 8, 2);
+  runner.run();
+
+  EXPECT_EQ(budget.lent(), 0u);
+}
+
+TEST(training_runner, rejects_bad_batch_size) {
+  std::vector<vec_t> x(4, vec_t(2));
+  std::vector<vec_t> t(4, vec_t(1));
+  const shared_dataset data(x, t);
+
+  network<sequential> net;
+  net << fully_connected_layer(2, 1);
+  adagrad opt;
+  training_runner runner(1);
+  EXPECT_THROW(runner.add<mse>(net, opt, data, 5, 1), nn_error);
+  EXPECT_THROW(runner.add<mse>(net, opt, data, 0, 1), nn_error);
+}
+
+}  // namespace tiny_dnn
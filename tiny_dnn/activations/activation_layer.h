@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include "tiny_dnn/core/framework/elementwise_expression.h"
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/util/util.h"
 
@@ -73,7 +74,8 @@ class activation_layer : public layer {
                            std::vector<tensor_t *> &out_data) override {
     const tensor_t &x = *in_data[0];
     tensor_t &y       = *out_data[0];
-    for_i(x.size(), [&](int i) { forward_activation(x[i], y[i]); });
+    tiny_dnn::for_i(parallelize_, x.size(),
+                    [&](int i) { forward_activation(x[i], y[i]); });
   }
 
   void back_propagation(const std::vector<tensor_t *> &in_data,
@@ -84,8 +86,9 @@ class activation_layer : public layer {
     const tensor_t &dy = *out_grad[0];
     const tensor_t &x  = *in_data[0];
     const tensor_t &y  = *out_data[0];
-    for_i(x.size(),
-          [&](size_t i) { backward_activation(x[i], y[i], dx[i], dy[i]); });
+    tiny_dnn::for_i(parallelize_, x.size(), [&](size_t i) {
+      backward_activation(x[i], y[i], dx[i], dy[i]);
+    });
   }
 
   virtual std::string layer_type() const override = 0;
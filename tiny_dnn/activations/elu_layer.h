@@ -18,19 +18,19 @@ class elu_layer : public activation_layer {
   std::string layer_type() const override { return "elu-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = x[j] < float_t(0) ? (std::exp(x[j]) - float_t(1)) : x[j];
-    }
+    const auto in = expr::ref(x);
+    expr::assign(y, expr::where(in < float_t(0), expr::exp(in) - float_t(1),
+                                in));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of elu)
-      dx[j] = dy[j] * (y[j] > float_t(0) ? float_t(1) : (float_t(1) + y[j]));
-    }
+    // dx = dy * (gradient of elu)
+    const auto out = expr::ref(y);
+    expr::assign(dx, expr::ref(dy) * expr::where(out > float_t(0), float_t(1),
+                                                 float_t(1) + out));
   }
 
   std::pair<float_t, float_t> scale() const override {
@@ -67,19 +67,17 @@ class leaky_relu_layer : public activation_layer {
   float_t epsilon_value() const { return epsilon_; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = x[j] > float_t(0) ? x[j] : epsilon_ * x[j];
-    }
+    const auto in = expr::ref(x);
+    expr::assign(y, expr::where(in > float_t(0), in, epsilon_ * in));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of leaky relu)
-      dx[j] = dy[j] * (y[j] > float_t(0) ? float_t(1) : epsilon_);
-    }
+    // dx = dy * (gradient of leaky relu)
+    expr::assign(dx, expr::ref(dy) * expr::where(expr::ref(y) > float_t(0),
+                                                 float_t(1), epsilon_));
   }
 
   std::pair<float_t, float_t> scale() const override {
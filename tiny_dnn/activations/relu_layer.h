@@ -18,19 +18,15 @@ class relu_layer : public activation_layer {
   std::string layer_type() const override { return "relu-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = std::max(float_t(0), x[j]);
-    }
+    expr::assign(y, expr::maximum(expr::ref(x), float_t(0)));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of relu)
-      dx[j] = dy[j] * (y[j] > float_t(0) ? float_t(1) : float_t(0));
-    }
+    // dx = dy * (gradient of relu)
+    expr::assign(dx, expr::ref(dy) * (expr::ref(y) > float_t(0)));
   }
 
   std::pair<float_t, float_t> scale() const override {
@@ -18,19 +18,16 @@ class sigmoid_layer : public activation_layer {
   std::string layer_type() const override { return "sigmoid-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = float_t(1) / (float_t(1) + std::exp(-x[j]));
-    }
+    expr::assign(y, float_t(1) / (float_t(1) + expr::exp(-expr::ref(x))));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of sigmoid)
-      dx[j] = dy[j] * y[j] * (float_t(1) - y[j]);
-    }
+    // dx = dy * (gradient of sigmoid)
+    const auto out = expr::ref(y);
+    expr::assign(dx, expr::ref(dy) * out * (float_t(1) - out));
   }
 
   std::pair<float_t, float_t> scale() const override {
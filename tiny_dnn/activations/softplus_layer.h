@@ -77,23 +77,21 @@ class softplus_layer : public activation_layer {
   float_t threshold_value() const { return threshold_; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      float_t betain = beta_ * x[j];
-      y[j]           = (betain > threshold_) ? x[j]
-                                   : (1 / beta_) * std::log1p(std::exp(betain));
-    }
+    const auto in = expr::ref(x);
+    const auto betain = beta_ * in;
+    expr::assign(y, expr::where(betain > threshold_, in,
+                                (1 / beta_) * expr::log1p(expr::exp(betain))));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      float_t betaout = beta_ * y[j];
-      float_t exp_bo  = std::exp(betaout);
-      // dx = dy * (gradient of softplus)
-      dx[j] = (betaout > threshold_) ? dy[j] : dy[j] * (exp_bo - 1) / exp_bo;
-    }
+    // dx = dy * (gradient of softplus), 1 - exp(-beta * y)
+    const auto betaout = beta_ * expr::ref(y);
+    const auto delta   = expr::ref(dy);
+    expr::assign(dx, expr::where(betaout > threshold_, delta,
+                                 delta * (1 - expr::exp(-betaout))));
   }
 
   std::pair<float_t, float_t> scale() const override {
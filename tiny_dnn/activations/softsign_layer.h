@@ -18,20 +18,17 @@ class softsign_layer : public activation_layer {
   std::string layer_type() const override { return "softsign-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = x[j] / (1.0 + std::abs(x[j]));
-    }
+    const auto in = expr::ref(x);
+    expr::assign(y, in / (1 + expr::abs(in)));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of softsign)
-      auto d = 1.0 + std::abs(x[j]);
-      dx[j]  = dy[j] / (d * d);
-    }
+    // dx = dy * (gradient of softsign)
+    const auto d = 1 + expr::abs(expr::ref(x));
+    expr::assign(dx, expr::ref(dy) / (d * d));
   }
 
   std::pair<float_t, float_t> scale() const override {
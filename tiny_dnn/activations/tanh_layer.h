@@ -18,19 +18,16 @@ class tanh_layer : public activation_layer {
   std::string layer_type() const override { return "tanh-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      y[j] = std::tanh(x[j]);
-    }
+    expr::assign(y, expr::tanh(expr::ref(x)));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of tanh)
-      dx[j] = dy[j] * (float_t(1) - sqr(y[j]));
-    }
+    // dx = dy * (gradient of tanh)
+    const auto out = expr::ref(y);
+    expr::assign(dx, expr::ref(dy) * (float_t(1) - out * out));
   }
 
   std::pair<float_t, float_t> scale() const override {
@@ -18,21 +18,17 @@ class tanh_p1m2_layer : public activation_layer {
   std::string layer_type() const override { return "tanh-scaled-activation"; }
 
   void forward_activation(const vec_t &x, vec_t &y) override {
-    float_t ep;
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      ep   = std::exp(x[j]);
-      y[j] = ep / (ep + (float_t(1) / ep));
-    }
+    // e^x / (e^x + e^-x)
+    expr::assign(y, float_t(1) / (float_t(1) + expr::exp(-2 * expr::ref(x))));
   }
 
   void backward_activation(const vec_t &x,
                            const vec_t &y,
                            vec_t &dx,
                            const vec_t &dy) override {
-    for (serial_size_t j = 0; j < x.size(); j++) {
-      // dx = dy * (gradient of tanh-scaled)
-      dx[j] = dy[j] * (2 * y[j] * (float_t(1) - y[j]));
-    }
+    // dx = dy * (gradient of tanh-scaled)
+    const auto out = expr::ref(y);
+    expr::assign(dx, expr::ref(dy) * (2 * out * (float_t(1) - out)));
   }
 
   std::pair<float_t, float_t> scale() const override {
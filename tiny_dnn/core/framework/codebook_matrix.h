@@ -0,0 +1,98 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * weight matrix stored as 8-bit indices into a table of at most 256 shared
+ * values (weight sharing / k-means clustering).
+ *
+ * The indices are kept transposed with respect to the source, one
+ * contiguous byte row per output, so that a kernel streams through the
+ * indices of one output without strides and never expands them to float.
+ **/
+class codebook_matrix {
+ public:
+  codebook_matrix() : rows_(0), cols_(0) {}
+
+  /**
+   * @param codebook [in] shared values
+   * @param indices  [in] row-major rows x cols indices into codebook
+   * @param rows     [in] number of rows of the source matrix
+   * @param cols     [in] number of columns of the source matrix
+   **/
+  void assign(const std::vector<float_t> &codebook,
+              const std::vector<uint8_t> &indices,
+              serial_size_t rows,
+              serial_size_t cols) {
+    if (codebook.empty() || codebook.size() > 256)
+      throw nn_error("codebook must hold between 1 and 256 values");
+    if (indices.size() != static_cast<size_t>(rows) * cols)
+      throw nn_error("codebook index count does not match the matrix");
+
+    rows_     = rows;
+    cols_     = cols;
+    codebook_ = codebook;
+    packed_.resize(indices.size());
+    for (serial_size_t r = 0; r < rows; r++) {
+      for (serial_size_t c = 0; c < cols; c++) {
+        const uint8_t i = indices[static_cast<size_t>(r) * cols + c];
+        if (i >= codebook.size()) throw nn_error("codebook index out of range");
+        packed_[static_cast<size_t>(c) * rows + r] = i;
+      }
+    }
+  }
+
+  ///< expands back into a row-major rows x cols matrix
+  vec_t to_dense() const {
+    vec_t dense(packed_.size());
+    for (serial_size_t r = 0; r < rows_; r++) {
+      for (serial_size_t c = 0; c < cols_; c++) {
+        dense[static_cast<size_t>(r) * cols_ + c] = at(r, c);
+      }
+    }
+    return dense;
+  }
+
+  serial_size_t rows() const { return rows_; }
+  serial_size_t cols() const { return cols_; }
+
+  const std::vector<float_t> &codebook() const { return codebook_; }
+
+  float_t at(serial_size_t r, serial_size_t c) const {
+    return codebook_[packed_[static_cast<size_t>(c) * rows_ + r]];
+  }
+
+  ///< rows() indices of source column c, contiguous
+  const uint8_t *column(serial_size_t c) const {
+    return &packed_[static_cast<size_t>(c) * rows_];
+  }
+
+  ///< bytes used by the codebook and the indices
+  size_t memory_bytes() const {
+    return codebook_.size() * sizeof(float_t) + packed_.size();
+  }
+
+  bool empty() const { return packed_.empty(); }
+
+  friend struct serialization_buddy;
+
+ private:
+  serial_size_t rows_;
+  serial_size_t cols_;
+  std::vector<float_t> codebook_;
+  std::vector<uint8_t> packed_;
+};
+
+}  // namespace tiny_dnn
@@ -0,0 +1,408 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * lazy elementwise expressions.
+ *
+ * Arithmetic on expressions only builds a tree; nothing is computed until
+ * the tree is assigned, which evaluates the whole chain in a single pass
+ * over the operands without temporaries:
+ *
+ * @code
+ * // y = dy * (1 - y^2), one pass instead of three
+ * expr::assign(dx, expr::ref(dy) * (1 - expr::ref(y) * expr::ref(y)));
+ * @endcode
+ *
+ * Trees made only of +, -, *, /, maximum, minimum, comparisons, where and
+ * scalars are evaluated one SIMD register at a time (where evaluates both
+ * branches and blends them); trees containing a transcendental function
+ * fall back to a plain loop, which is still a single pass.
+ * The destination may alias any operand.
+ **/
+namespace expr {
+
+typedef vectorize::VECTORIZE_TYPE simd;
+typedef simd::register_type packet_t;
+
+// extent of a pair of operands, either of which may be a scalar (0)
+inline size_t common_extent(size_t a, size_t b) {
+  if (a != 0 && b != 0 && a != b) {
+    throw nn_error("elementwise operands must have the same size");
+  }
+  return a != 0 ? a : b;
+}
+
+template <typename E>
+struct expression {
+  const E &self() const { return static_cast<const E &>(*this); }
+};
+
+/**
+ * a contiguous range of values
+ **/
+class terminal : public expression<terminal> {
+ public:
+  static const bool vectorizable = true;
+
+  terminal(const float_t *p, size_t n) : p_(p), n_(n) {}
+
+  size_t extent() const { return n_; }
+
+  float_t operator[](size_t i) const { return p_[i]; }
+
+  packet_t packet(size_t i) const {
+    return simd::load<std::false_type>(p_ + i);
+  }
+
+ private:
+  const float_t *p_;
+  size_t n_;
+};
+
+/**
+ * a scalar, broadcast over any extent
+ **/
+class constant : public expression<constant> {
+ public:
+  static const bool vectorizable = true;
+
+  explicit constant(float_t v) : v_(v) {}
+
+  size_t extent() const { return 0; }
+
+  float_t operator[](size_t) const { return v_; }
+
+  packet_t packet(size_t) const { return simd::set1(v_); }
+
+ private:
+  float_t v_;
+};
+
+template <typename Op, typename L, typename R>
+class binary : public expression<binary<Op, L, R>> {
+ public:
+  static const bool vectorizable =
+    Op::vectorizable && L::vectorizable && R::vectorizable;
+
+  binary(const L &l, const R &r) : l_(l), r_(r) {}
+
+  size_t extent() const { return common_extent(l_.extent(), r_.extent()); }
+
+  float_t operator[](size_t i) const { return Op::apply(l_[i], r_[i]); }
+
+  packet_t packet(size_t i) const {
+    return Op::apply_packet(l_.packet(i), r_.packet(i));
+  }
+
+ private:
+  L l_;
+  R r_;
+};
+
+template <typename Op, typename E>
+class unary : public expression<unary<Op, E>> {
+ public:
+  static const bool vectorizable = Op::vectorizable && E::vectorizable;
+
+  unary(const Op &op, const E &e) : op_(op), e_(e) {}
+
+  size_t extent() const { return e_.extent(); }
+
+  float_t operator[](size_t i) const { return op_.apply(e_[i]); }
+
+  packet_t packet(size_t i) const { return op_.apply_packet(e_.packet(i)); }
+
+ private:
+  Op op_;
+  E e_;
+};
+
+/**
+ * c ? a : b, elementwise
+ **/
+template <typename C, typename A, typename B>
+class select : public expression<select<C, A, B>> {
+ public:
+  static const bool vectorizable =
+    C::vectorizable && A::vectorizable && B::vectorizable;
+
+  select(const C &c, const A &a, const B &b) : c_(c), a_(a), b_(b) {}
+
+  size_t extent() const {
+    return common_extent(c_.extent(),
+                         common_extent(a_.extent(), b_.extent()));
+  }
+
+  float_t operator[](size_t i) const {
+    return c_[i] != float_t(0) ? a_[i] : b_[i];
+  }
+
+  packet_t packet(size_t i) const {
+    return simd::blend(simd::not_zero(c_.packet(i)), a_.packet(i),
+                       b_.packet(i));
+  }
+
+ private:
+  C c_;
+  A a_;
+  B b_;
+};
+
+// operators
+
+struct plus_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return a + b; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::add(a, b);
+  }
+};
+
+struct minus_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return a - b; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::sub(a, b);
+  }
+};
+
+struct multiplies_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return a * b; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::mul(a, b);
+  }
+};
+
+struct divides_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return a / b; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::div(a, b);
+  }
+};
+
+struct maximum_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return a < b ? b : a; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::maximum(a, b);
+  }
+};
+
+struct minimum_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return b < a ? b : a; }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::minimum(a, b);
+  }
+};
+
+// comparisons yield 1 or 0
+struct greater_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return float_t(a > b); }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::mask_and(simd::greater(a, b), simd::set1(float_t(1)));
+  }
+};
+
+struct less_op {
+  static const bool vectorizable = true;
+  static float_t apply(float_t a, float_t b) { return float_t(a < b); }
+  static packet_t apply_packet(const packet_t &a, const packet_t &b) {
+    return simd::mask_and(simd::less(a, b), simd::set1(float_t(1)));
+  }
+};
+
+struct negate_op {
+  static const bool vectorizable = true;
+  float_t apply(float_t a) const { return -a; }
+  packet_t apply_packet(const packet_t &a) const {
+    return simd::sub(simd::zero(), a);
+  }
+};
+
+struct exp_op {
+  static const bool vectorizable = false;
+  float_t apply(float_t a) const { return std::exp(a); }
+};
+
+struct log1p_op {
+  static const bool vectorizable = false;
+  float_t apply(float_t a) const { return std::log1p(a); }
+};
+
+struct tanh_op {
+  static const bool vectorizable = false;
+  float_t apply(float_t a) const { return std::tanh(a); }
+};
+
+struct sqrt_op {
+  static const bool vectorizable = false;
+  float_t apply(float_t a) const { return std::sqrt(a); }
+};
+
+struct abs_op {
+  static const bool vectorizable = false;
+  float_t apply(float_t a) const { return std::abs(a); }
+};
+
+struct pow_op {
+  static const bool vectorizable = false;
+  explicit pow_op(float_t e) : e_(e) {}
+  float_t apply(float_t a) const { return std::pow(a, e_); }
+  float_t e_;
+};
+
+// building expressions
+
+inline terminal ref(const vec_t &v) { return terminal(v.data(), v.size()); }
+
+inline terminal ref(const float_t *p, size_t n) { return terminal(p, n); }
+
+#define CNN_EXPR_BINARY_FUNCTION(name, op)                                  \
+  template <typename L, typename R>                                         \
+  binary<op, L, R> name(const expression<L> &l, const expression<R> &r) {   \
+    return binary<op, L, R>(l.self(), r.self());                            \
+  }                                                                         \
+  template <typename L>                                                     \
+  binary<op, L, constant> name(const expression<L> &l, float_t r) {         \
+    return binary<op, L, constant>(l.self(), constant(r));                  \
+  }                                                                         \
+  template <typename R>                                                     \
+  binary<op, constant, R> name(float_t l, const expression<R> &r) {         \
+    return binary<op, constant, R>(constant(l), r.self());                  \
+  }
+
+CNN_EXPR_BINARY_FUNCTION(operator+, plus_op)
+CNN_EXPR_BINARY_FUNCTION(operator-, minus_op)
+CNN_EXPR_BINARY_FUNCTION(operator*, multiplies_op)
+CNN_EXPR_BINARY_FUNCTION(operator/, divides_op)
+CNN_EXPR_BINARY_FUNCTION(operator>, greater_op)
+CNN_EXPR_BINARY_FUNCTION(operator<, less_op)
+CNN_EXPR_BINARY_FUNCTION(maximum, maximum_op)
+CNN_EXPR_BINARY_FUNCTION(minimum, minimum_op)
+
+#undef CNN_EXPR_BINARY_FUNCTION
+
+#define CNN_EXPR_UNARY_FUNCTION(name, op)                \
+  template <typename E>                                  \
+  unary<op, E> name(const expression<E> &e) {            \
+    return unary<op, E>(op(), e.self());                 \
+  }
+
+CNN_EXPR_UNARY_FUNCTION(operator-, negate_op)
+CNN_EXPR_UNARY_FUNCTION(exp, exp_op)
+CNN_EXPR_UNARY_FUNCTION(log1p, log1p_op)
+CNN_EXPR_UNARY_FUNCTION(tanh, tanh_op)
+CNN_EXPR_UNARY_FUNCTION(sqrt, sqrt_op)
+CNN_EXPR_UNARY_FUNCTION(abs, abs_op)
+
+#undef CNN_EXPR_UNARY_FUNCTION
+
+template <typename E>
+unary<pow_op, E> pow(const expression<E> &e, float_t exponent) {
+  return unary<pow_op, E>(pow_op(exponent), e.self());
+}
+
+template <typename C, typename A, typename B>
+select<C, A, B> where(const expression<C> &c,
+                      const expression<A> &a,
+                      const expression<B> &b) {
+  return select<C, A, B>(c.self(), a.self(), b.self());
+}
+
+template <typename C, typename A>
+select<C, A, constant> where(const expression<C> &c,
+                             const expression<A> &a,
+                             float_t b) {
+  return select<C, A, constant>(c.self(), a.self(), constant(b));
+}
+
+template <typename C, typename B>
+select<C, constant, B> where(const expression<C> &c,
+                             float_t a,
+                             const expression<B> &b) {
+  return select<C, constant, B>(c.self(), constant(a), b.self());
+}
+
+template <typename C>
+select<C, constant, constant> where(const expression<C> &c,
+                                    float_t a,
+                                    float_t b) {
+  return select<C, constant, constant>(c.self(), constant(a), constant(b));
+}
+
+// evaluation
+
+namespace detail {
+
+template <typename E>
+void eval(float_t *dst, size_t begin, size_t end, const E &e, std::true_type) {
+  const size_t w = simd::unroll_size;
+  size_t i       = begin;
+  for (; i + w <= end; i += w) {
+    simd::store<std::false_type>(dst + i, e.packet(i));
+  }
+  for (; i < end; i++) dst[i] = e[i];
+}
+
+template <typename E>
+void eval(float_t *dst, size_t begin, size_t end, const E &e, std::false_type) {
+  for (size_t i = begin; i < end; i++) dst[i] = e[i];
+}
+
+}  // namespace detail
+
+/**
+ * evaluates e into dst[0, n) in one pass. With parallelize, ranges of at
+ * least 64k elements are split across threads; layers that already
+ * parallelize over samples should leave it off.
+ **/
+template <typename E>
+void assign(float_t *dst,
+            size_t n,
+            const expression<E> &e,
+            bool parallelize = false) {
+  const E &x         = e.self();
+  common_extent(x.extent(), n);
+  typedef std::integral_constant<bool, E::vectorizable> vectorized;
+
+  const size_t parallel_threshold = 65536;
+  if (parallelize && n >= parallel_threshold) {
+    for_(true, 0, n,
+         [&](const blocked_range &r) {
+           detail::eval(dst, r.begin(), r.end(), x, vectorized());
+         },
+         parallel_threshold / 4);
+  } else {
+    detail::eval(dst, 0, n, x, vectorized());
+  }
+}
+
+/**
+ * evaluates e into dst, resizing it to the operands' size
+ **/
+template <typename E>
+void assign(vec_t &dst, const expression<E> &e, bool parallelize = false) {
+  const size_t count = e.self().extent();
+  if (count != 0 && count != dst.size()) dst.resize(count);
+  assign(dst.data(), dst.size(), e, parallelize);
+}
+
+}  // namespace expr
+}  // namespace tiny_dnn
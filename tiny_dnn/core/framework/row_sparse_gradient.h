@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tiny_dnn/optimizers/optimizer.h"
+#include "tiny_dnn/util/product.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * gradient of a weight matrix stored as rows of row_size values (plus one
+ * bias per row), kept only for the rows a training step touches.
+ *
+ * Before the samples of a minibatch run in parallel, set_rows declares
+ * which rows each sample writes; each sample then accumulates into its own
+ * rows only. apply merges the samples and hands the touched rows to
+ * optimizer::update_rows, so neither the gradient nor the update ever
+ * spans the whole matrix.
+ **/
+class row_sparse_gradient {
+ public:
+  row_sparse_gradient() : row_size_(0) {}
+
+  ///< start a step of n samples; drops the gradient of the previous one
+  void reset(size_t samples, size_t row_size) {
+    row_size_ = row_size;
+    samples_.resize(samples);
+    clear();
+  }
+
+  void clear() {
+    for (auto &s : samples_) {
+      s.rows.clear();
+      s.w.clear();
+      s.b.clear();
+    }
+  }
+
+  ///< rows written by sample s, zero initialized; duplicates are allowed
+  void set_rows(size_t s, std::vector<size_t> rows) {
+    sample_rows &r = samples_[s];
+    r.rows         = std::move(rows);
+    r.w.assign(r.rows.size() * row_size_, float_t(0));
+    r.b.assign(r.rows.size(), float_t(0));
+  }
+
+  ///< row_size values of the k-th row declared for sample s
+  float_t *weight(size_t s, size_t k) {
+    return &samples_[s].w[k * row_size_];
+  }
+
+  float_t &bias(size_t s, size_t k) { return samples_[s].b[k]; }
+
+  bool empty() const {
+    for (const auto &s : samples_) {
+      if (!s.rows.empty()) return false;
+    }
+    return true;
+  }
+
+  /**
+   * sum the samples, scale the sum and update the touched rows of W and b.
+   * clears the gradient.
+   **/
+  void apply(optimizer *o,
+             vec_t &W,
+             vec_t &b,
+             float_t scale,
+             bool parallelize) {
+    std::vector<size_t> rows;
+    std::unordered_map<size_t, size_t> slot;
+    for (const auto &s : samples_) {
+      for (auto r : s.rows) {
+        if (slot.emplace(r, rows.size()).second) rows.push_back(r);
+      }
+    }
+
+    vec_t dW(rows.size() * row_size_, float_t(0));
+    vec_t db(rows.size(), float_t(0));
+    for (const auto &s : samples_) {
+      for (size_t k = 0; k < s.rows.size(); k++) {
+        const size_t j = slot[s.rows[k]];
+        vectorize::reduce<float_t>(&s.w[k * row_size_], row_size_,
+                                   &dW[j * row_size_]);
+        db[j] += s.b[k];
+      }
+    }
+    for (auto &v : dW) v *= scale;
+    for (auto &v : db) v *= scale;
+
+    if (!rows.empty()) {
+      o->update_rows(dW, rows, row_size_, W, parallelize);
+      o->update_rows(db, rows, 1, b, parallelize);
+    }
+    clear();
+  }
+
+ private:
+  struct sample_rows {
+    std::vector<size_t> rows;
+    vec_t w;
+    vec_t b;
+  };
+
+  size_t row_size_;
+  std::vector<sample_rows> samples_;
+};
+
+}  // namespace tiny_dnn
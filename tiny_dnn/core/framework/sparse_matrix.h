@@ -0,0 +1,147 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * selects how a layer multiplies by its weights at inference time
+ **/
+enum class weight_storage {
+  dense,    ///< plain vec_t, every weight is multiplied
+  sparse,   ///< blocked CSR, zero blocks are skipped
+  codebook  ///< 8-bit indices into a table of shared values
+};
+
+/**
+ * row-major matrix in blocked compressed sparse row (BCSR) format.
+ *
+ * Each row keeps only the 1 x block_size tiles that contain at least one
+ * weight whose magnitude exceeds the threshold. Tiles are stored
+ * contiguously so that a whole tile can be processed by one SIMD register
+ * when block_size equals vectorize::simd_width(). The last tile of a row
+ * may extend past cols(); its tail is zero padded.
+ **/
+class block_sparse_matrix {
+ public:
+  block_sparse_matrix() : rows_(0), cols_(0), block_(1) {}
+
+  /**
+   * @param dense      [in] row-major rows x cols source matrix
+   * @param rows       [in] number of rows
+   * @param cols       [in] number of columns
+   * @param block_size [in] width of a tile
+   * @param threshold  [in] weights with |w| <= threshold are treated as zero
+   **/
+  block_sparse_matrix(const float_t *dense,
+                      serial_size_t rows,
+                      serial_size_t cols,
+                      serial_size_t block_size,
+                      float_t threshold = float_t(0)) {
+    assign(dense, rows, cols, block_size, threshold);
+  }
+
+  void assign(const float_t *dense,
+              serial_size_t rows,
+              serial_size_t cols,
+              serial_size_t block_size,
+              float_t threshold = float_t(0)) {
+    if (block_size == 0) throw nn_error("block size must be positive");
+
+    rows_  = rows;
+    cols_  = cols;
+    block_ = block_size;
+    row_ptr_.assign(1, 0);
+    col_idx_.clear();
+    values_.clear();
+
+    for (serial_size_t r = 0; r < rows; r++) {
+      const float_t *row = dense + static_cast<size_t>(r) * cols;
+      for (serial_size_t c = 0; c < cols; c += block_size) {
+        const serial_size_t len = std::min(block_size, cols - c);
+        bool nonzero            = false;
+        for (serial_size_t i = 0; i < len && !nonzero; i++) {
+          nonzero = std::abs(row[c + i]) > threshold;
+        }
+        if (!nonzero) continue;
+
+        col_idx_.push_back(c);
+        for (serial_size_t i = 0; i < block_size; i++) {
+          const bool keep = i < len && std::abs(row[c + i]) > threshold;
+          values_.push_back(keep ? row[c + i] : float_t(0));
+        }
+      }
+      row_ptr_.push_back(static_cast<serial_size_t>(col_idx_.size()));
+    }
+  }
+
+  ///< expands back into a row-major rows x cols matrix
+  vec_t to_dense() const {
+    vec_t dense(static_cast<size_t>(rows_) * cols_, float_t(0));
+    for (serial_size_t r = 0; r < rows_; r++) {
+      for (serial_size_t b = row_ptr_[r]; b < row_ptr_[r + 1]; b++) {
+        const serial_size_t len = std::min(block_, cols_ - col_idx_[b]);
+        std::copy(block(b), block(b) + len,
+                  &dense[static_cast<size_t>(r) * cols_ + col_idx_[b]]);
+      }
+    }
+    return dense;
+  }
+
+  serial_size_t rows() const { return rows_; }
+  serial_size_t cols() const { return cols_; }
+  serial_size_t block_size() const { return block_; }
+
+  ///< number of stored tiles
+  size_t nonzero_blocks() const { return col_idx_.size(); }
+
+  ///< fraction of the dense matrix that is stored (including tile padding)
+  float_t density() const {
+    const size_t total = static_cast<size_t>(rows_) * cols_;
+    return total == 0 ? float_t(0)
+                      : static_cast<float_t>(values_.size()) / total;
+  }
+
+  ///< bytes used by values and indices
+  size_t memory_bytes() const {
+    return values_.size() * sizeof(float_t) +
+           (row_ptr_.size() + col_idx_.size()) * sizeof(serial_size_t);
+  }
+
+  ///< first tile of row r is row_begin(r), one past the last is row_end(r)
+  serial_size_t row_begin(serial_size_t r) const { return row_ptr_[r]; }
+  serial_size_t row_end(serial_size_t r) const { return row_ptr_[r + 1]; }
+
+  ///< first column covered by tile b
+  serial_size_t block_col(serial_size_t b) const { return col_idx_[b]; }
+
+  ///< block_size() values of tile b
+  const float_t *block(serial_size_t b) const {
+    return &values_[static_cast<size_t>(b) * block_];
+  }
+
+  bool empty() const { return col_idx_.empty(); }
+
+  friend struct serialization_buddy;
+
+ private:
+  serial_size_t rows_;
+  serial_size_t cols_;
+  serial_size_t block_;
+  std::vector<serial_size_t> row_ptr_;
+  std::vector<serial_size_t> col_idx_;
+  vec_t values_;
+};
+
+}  // namespace tiny_dnn
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "tiny_dnn/core/framework/device.fwd.h"
+#include "tiny_dnn/core/framework/elementwise_expression.h"
 
 #if defined(USE_OPENCL) || defined(USE_CUDA)
 #ifdef USE_OPENCL
@@ -80,6 +81,19 @@ class Tensor {
     return *this;
   }
 
+  /**
+   * Evaluates an elementwise expression into the tensor in a single pass,
+   * e.g. t = expr::ref(a) * 2 + expr::ref(b). The operands must have as
+   * many elements as the tensor.
+   * @param e expression built from expr::ref and the expr operators
+   * @return
+   */
+  template <typename E>
+  Tensor &operator=(const expr::expression<E> &e) {
+    expr::assign(host_data(), size(), e, true);
+    return *this;
+  }
+
 //~Tensor() = default;
 
 // TODO(Randl): implement copy and move constructors
@@ -150,6 +164,15 @@ class Tensor {
 
   const auto host_end() const { return storage_.cxend(); }
 
+  /**
+   *
+   * @return pointer to the contiguous elements of a Tensor that owns its
+   * storage (not of a subView)
+   */
+  U *host_data() { return storage_.raw_data(); }
+
+  const U *host_data() const { return storage_.raw_data(); }
+
 // TODO(Randl)
 /*
 const auto host_flatten() const {
@@ -266,4 +289,12 @@ auto host_data() {
   Storage storage_;
 };
 
+namespace expr {
+
+inline terminal ref(const Tensor<float_t> &t) {
+  return terminal(t.host_data(), t.size());
+}
+
+}  // namespace expr
+
 }  // namespace tiny_dnn
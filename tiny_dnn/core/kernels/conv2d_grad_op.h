@@ -38,7 +38,9 @@ class Conv2dGradOp : public core::OpKernel {
 
     const core::backend_t engine = context.engine();
 
-    if (engine == core::backend_t::internal) {
+    // the fft engine only speeds up the forward pass
+    if (engine == core::backend_t::internal ||
+        engine == core::backend_t::fft) {
       kernels::conv2d_op_internal(prev_out, W[0], dW, db, curr_delta,
                                   prev_delta, params, context.parallelize());
     } else if (engine == core::backend_t::avx) {
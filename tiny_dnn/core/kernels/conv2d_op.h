@@ -10,6 +10,7 @@
 #include "tiny_dnn/core/framework/op_kernel.h"
 
 #include "tiny_dnn/core/kernels/conv2d_op_avx.h"
+#include "tiny_dnn/core/kernels/conv2d_op_fft.h"
 #include "tiny_dnn/core/kernels/conv2d_op_internal.h"
 #include "tiny_dnn/core/kernels/conv2d_op_nnpack.h"
 
@@ -45,10 +46,17 @@ class Conv2dOp : public core::OpKernel {
     } else if (engine == core::backend_t::avx) {
       kernels::conv2d_op_avx(in_data, W[0], bias[0], out_data, params,
                              context.parallelize());
+    } else if (engine == core::backend_t::fft) {
+      kernels::conv2d_op_fft(in_data, W[0], bias[0], out_data, params,
+                             fft_bank_, context.parallelize());
     } else {
       throw nn_error("Not supported engine: " + to_string(engine));
     }
   }
+
+ private:
+  // filter spectra of the fft engine, cached across calls
+  kernels::fft_filter_bank fft_bank_;
 };
 
 }  // namespace tiny_dnn
@@ -0,0 +1,262 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "tiny_dnn/core/params/conv_params.h"
+
+namespace tiny_dnn {
+namespace kernels {
+
+typedef std::complex<float_t> fft_complex;
+
+/**
+ * in-place radix-2 transforms of size n x n (n a power of two)
+ **/
+class fft_plan {
+ public:
+  fft_plan() : n_(0) {}
+
+  explicit fft_plan(size_t n) : n_(n), twiddle_(n / 2), reversed_(n) {
+    const double pi = std::acos(-1.0);
+    for (size_t k = 0; k < n / 2; k++) {
+      const double a = -2.0 * pi * k / n;
+      twiddle_[k]    = fft_complex(static_cast<float_t>(std::cos(a)),
+                                static_cast<float_t>(std::sin(a)));
+    }
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    for (size_t i = 0; i < n; i++) {
+      size_t r = 0;
+      for (size_t b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+      reversed_[i] = r;
+    }
+  }
+
+  size_t size() const { return n_; }
+
+  /**
+   * 2D forward transform; only the first `rows` rows may be non-zero
+   **/
+  void forward(fft_complex *a, size_t rows) const {
+    for (size_t y = 0; y < rows; y++) transform(&a[y * n_], 1, false);
+    for (size_t x = 0; x < n_; x++) transform(&a[x], n_, false);
+  }
+
+  /**
+   * 2D inverse transform, scaled by 1 / n^2
+   **/
+  void inverse(fft_complex *a) const {
+    for (size_t x = 0; x < n_; x++) transform(&a[x], n_, true);
+    for (size_t y = 0; y < n_; y++) transform(&a[y * n_], 1, true);
+    const float_t scale = float_t(1) / static_cast<float_t>(n_ * n_);
+    for (size_t i = 0; i < n_ * n_; i++) a[i] *= scale;
+  }
+
+ private:
+  void transform(fft_complex *a, size_t stride, bool inverse) const {
+    for (size_t i = 0; i < n_; i++) {
+      const size_t r = reversed_[i];
+      if (i < r) std::swap(a[i * stride], a[r * stride]);
+    }
+    for (size_t len = 2; len <= n_; len <<= 1) {
+      const size_t half = len / 2, step = n_ / len;
+      for (size_t i = 0; i < n_; i += len) {
+        for (size_t k = 0; k < half; k++) {
+          const fft_complex w =
+            inverse ? std::conj(twiddle_[k * step]) : twiddle_[k * step];
+          fft_complex &u      = a[(i + k) * stride];
+          fft_complex &v      = a[(i + k + half) * stride];
+          const fft_complex t = v * w;
+          v                   = u - t;
+          u += t;
+        }
+      }
+    }
+  }
+
+  size_t n_;
+  std::vector<fft_complex> twiddle_;
+  std::vector<size_t> reversed_;
+};
+
+/**
+ * transform size and filter spectra of one convolution, rebuilt whenever
+ * the weights change
+ **/
+class fft_filter_bank {
+ public:
+  void update(const vec_t &W, const core::conv_params &params) {
+    const size_t n = transform_size(params);
+    if (n == plan_.size() && W == weights_) return;
+
+    if (n != plan_.size()) plan_ = fft_plan(n);
+    weights_ = W;
+
+    const serial_size_t kw = params.weight.width_;
+    const serial_size_t kh = params.weight.height_;
+    const size_t filters   = params.in.depth_ * params.out.depth_;
+    spectra_.assign(filters * n * n, fft_complex(0));
+    for (size_t f = 0; f < filters; f++) {
+      fft_complex *s   = &spectra_[f * n * n];
+      const float_t *w = &W[params.weight.get_index(0, 0, f)];
+      for (serial_size_t y = 0; y < kh; y++) {
+        for (serial_size_t x = 0; x < kw; x++) s[y * n + x] = w[y * kw + x];
+      }
+      plan_.forward(s, kh);
+      // correlation multiplies by the conjugate spectrum
+      for (size_t i = 0; i < n * n; i++) s[i] = std::conj(s[i]);
+    }
+  }
+
+  const fft_plan &plan() const { return plan_; }
+
+  ///< conjugate spectrum of the filter from input channel inc to output o
+  const fft_complex *spectrum(serial_size_t o,
+                              serial_size_t inc,
+                              const core::conv_params &params) const {
+    const size_t n = plan_.size();
+    return &spectra_[(params.in.depth_ * o + inc) * n * n];
+  }
+
+  /**
+   * a power of two with at least a kernel's worth of room for each tile,
+   * large enough to amortize the overlap but no larger than the image
+   **/
+  static size_t transform_size(const core::conv_params &params) {
+    const size_t k = std::max(params.weight.width_, params.weight.height_);
+    const size_t extent =
+      std::max(params.in_padded.width_, params.in_padded.height_) + k - 1;
+    size_t n = 8;
+    while (n < 4 * k && n < extent) n <<= 1;
+    while (n < 2 * k) n <<= 1;
+    return n;
+  }
+
+ private:
+  fft_plan plan_;
+  vec_t weights_;
+  std::vector<fft_complex> spectra_;
+};
+
+/**
+ * convolution through tiled overlap-add FFTs.
+ *
+ * Each input channel is cut into tiles of (n - kh + 1) x (n - kw + 1),
+ * which are transformed once. For every output channel the spectra are
+ * multiplied by the cached filter spectra and summed over the input
+ * channels before a single inverse transform, whose n x n result is added
+ * into the stride-1 output around the tile. Strided outputs are taken
+ * from the stride-1 result. The cost per output pixel no longer grows
+ * with the kernel area, which pays off from about 9x9 kernels upwards.
+ **/
+inline void conv2d_op_fft(const tensor_t &in_data,
+                          const vec_t &W,
+                          const vec_t &bias,
+                          tensor_t &out_data,
+                          const core::conv_params &params,
+                          fft_filter_bank &bank,
+                          const bool parallelize) {
+  bank.update(W, params);
+
+  const fft_plan &plan   = bank.plan();
+  const size_t n         = plan.size();
+  const serial_size_t iw = params.in_padded.width_;
+  const serial_size_t ih = params.in_padded.height_;
+  const serial_size_t id = params.in.depth_;
+  const serial_size_t od = params.out.depth_;
+  const serial_size_t kw = params.weight.width_;
+  const serial_size_t kh = params.weight.height_;
+  const size_t tw = n - kw + 1, th = n - kh + 1;
+  // stride-1 output
+  const size_t fw = iw - kw + 1, fh = ih - kh + 1;
+
+  for_(parallelize, 0, in_data.size(),
+       [&](const blocked_range &r) {
+         std::vector<fft_complex> tiles(id * n * n), acc(n * n);
+         vec_t full(od * fw * fh);
+
+         for (size_t sample = r.begin(); sample < r.end(); sample++) {
+           const vec_t &in = in_data[sample];
+           vec_t &a        = out_data[sample];
+           std::fill(full.begin(), full.end(), float_t(0));
+
+           for (size_t ty = 0; ty < ih; ty += th) {
+             for (size_t tx = 0; tx < iw; tx += tw) {
+               const size_t h = std::min(th, ih - ty);
+               const size_t w = std::min(tw, iw - tx);
+
+               // the input tile spectra are shared by all output channels
+               for (serial_size_t inc = 0; inc < id; inc++) {
+                 fft_complex *t = &tiles[inc * n * n];
+                 std::fill(t, t + n * n, fft_complex(0));
+                 const float_t *src =
+                   &in[params.in_padded.get_index(tx, ty, inc)];
+                 for (size_t y = 0; y < h; y++) {
+                   for (size_t x = 0; x < w; x++) t[y * n + x] = src[x];
+                   src += iw;
+                 }
+                 plan.forward(t, h);
+               }
+
+               // the tile touches outputs [t - k + 1, t + h) of each axis
+               const size_t y0 = ty >= kh - 1 ? ty - kh + 1 : 0;
+               const size_t x0 = tx >= kw - 1 ? tx - kw + 1 : 0;
+               const size_t y1 = std::min(ty + h, fh);
+               const size_t x1 = std::min(tx + w, fw);
+
+               for (serial_size_t o = 0; o < od; o++) {
+                 bool connected = false;
+                 std::fill(acc.begin(), acc.end(), fft_complex(0));
+                 for (serial_size_t inc = 0; inc < id; inc++) {
+                   if (!params.tbl.is_connected(o, inc)) continue;
+                   connected              = true;
+                   const fft_complex *t   = &tiles[inc * n * n];
+                   const fft_complex *flt = bank.spectrum(o, inc, params);
+                   for (size_t i = 0; i < n * n; i++) acc[i] += t[i] * flt[i];
+                 }
+                 if (!connected) continue;
+                 plan.inverse(&acc[0]);
+
+                 // negative offsets wrap around the n x n result
+                 float_t *dst = &full[o * fw * fh];
+                 for (size_t y = y0; y < y1; y++) {
+                   const fft_complex *row = &acc[((y + n - ty) % n) * n];
+                   for (size_t x = x0; x < x1; x++) {
+                     dst[y * fw + x] += row[(x + n - tx) % n].real();
+                   }
+                 }
+               }
+             }
+           }
+
+           for (serial_size_t o = 0; o < od; o++) {
+             const float_t *src = &full[o * fw * fh];
+             float_t *pa        = &a[params.out.get_index(0, 0, o)];
+             for (serial_size_t y = 0; y < params.out.height_; y++) {
+               const float_t *row = &src[y * params.h_stride * fw];
+               for (serial_size_t x = 0; x < params.out.width_; x++) {
+                 *pa++ = row[x * params.w_stride];
+               }
+             }
+             if (params.has_bias) {
+               vectorize::add(bias[o], params.out.area(),
+                              &a[params.out.get_index(0, 0, o)]);
+             }
+           }
+         }
+       },
+       0);
+}
+
+}  // namespace kernels
+}  // namespace tiny_dnn
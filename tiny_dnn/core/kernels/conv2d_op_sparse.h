@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include "tiny_dnn/core/framework/sparse_matrix.h"
+
+namespace tiny_dnn {
+namespace kernels {
+
+/**
+ * sparse convolution through im2col.
+ * W is the out_depth x (in_depth * kh * kw) filter matrix in blocked CSR
+ * form. Each sample is lowered into a (in_depth * kh * kw) x out_area column
+ * matrix, of which only the rows referenced by a stored weight are built,
+ * and then multiplied by W one output row at a time.
+ **/
+inline void conv2d_op_sparse(const tensor_t &in_data,
+                             const block_sparse_matrix &W,
+                             const vec_t &bias,
+                             tensor_t &out_data,
+                             const core::conv_params &params,
+                             const bool parallelize) {
+  const serial_size_t ow       = params.out.width_;
+  const serial_size_t oh       = params.out.height_;
+  const serial_size_t kw       = params.weight.width_;
+  const serial_size_t kh       = params.weight.height_;
+  const serial_size_t out_area = params.out.area();
+
+  // rows of the column matrix that are actually needed
+  std::vector<serial_size_t> slot(W.cols(), W.cols());
+  std::vector<serial_size_t> live;
+  for (serial_size_t b = 0; b < W.nonzero_blocks(); b++) {
+    const serial_size_t end =
+      std::min(W.block_col(b) + W.block_size(), W.cols());
+    for (serial_size_t k = W.block_col(b); k < end; k++) {
+      if (slot[k] != W.cols()) continue;
+      slot[k] = static_cast<serial_size_t>(live.size());
+      live.push_back(k);
+    }
+  }
+
+  for_(parallelize, 0, in_data.size(),
+       [&](const blocked_range &r) {
+         vec_t cols(live.size() * out_area);
+         for (size_t sample = r.begin(); sample < r.end(); sample++) {
+           const vec_t &in = in_data[sample];
+           vec_t &a        = out_data[sample];
+
+           // im2col
+           for (size_t s = 0; s < live.size(); s++) {
+             const serial_size_t k   = live[s];
+             const serial_size_t inc = k / (kw * kh);
+             const serial_size_t wy  = (k / kw) % kh;
+             const serial_size_t wx  = k % kw;
+             float_t *dst            = &cols[s * out_area];
+             for (serial_size_t y = 0; y < oh; y++) {
+               const float_t *src = &in[params.in_padded.get_index(
+                 wx, y * params.h_stride + wy, inc)];
+               for (serial_size_t x = 0; x < ow; x++) {
+                 *dst++ = src[x * params.w_stride];
+               }
+             }
+           }
+
+           // out[o] = sum_k W[o][k] * cols[k]
+           for (serial_size_t o = 0; o < params.out.depth_; o++) {
+             float_t *pa = &a[params.out.get_index(0, 0, o)];
+             vectorize::fill(pa, out_area, float_t{0});
+             for (serial_size_t b = W.row_begin(o); b < W.row_end(o); b++) {
+               const float_t *w      = W.block(b);
+               const serial_size_t k = W.block_col(b);
+               const serial_size_t len =
+                 std::min(W.block_size(), W.cols() - k);
+               for (serial_size_t i = 0; i < len; i++) {
+                 if (w[i] == float_t{0}) continue;
+                 vectorize::muladd(&cols[slot[k + i] * out_area], w[i],
+                                   out_area, pa);
+               }
+             }
+             if (params.has_bias) {
+               vectorize::add(bias[o], out_area, pa);
+             }
+           }
+         }
+       },
+       0);
+}
+
+}  // namespace kernels
+}  // namespace tiny_dnn
@@ -0,0 +1,53 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <vector>
+
+#include "tiny_dnn/core/framework/codebook_matrix.h"
+#include "tiny_dnn/core/params/fully_params.h"
+
+namespace tiny_dnn {
+namespace kernels {
+
+/**
+ * forward pass on codebook (shared value) weights.
+ * W holds the in_size x out_size weight matrix as indices, one contiguous
+ * byte row per output. Inputs that share a weight value are summed first
+ * and multiplied once, so each output costs in_size additions plus one
+ * multiply per codebook entry, and the weights are never expanded to float.
+ **/
+inline void fully_connected_op_codebook(const tensor_t &in_data,
+                                        const codebook_matrix &W,
+                                        const vec_t &bias,
+                                        tensor_t &out_data,
+                                        const fully_params &params,
+                                        const bool layer_parallelize) {
+  const std::vector<float_t> &lut = W.codebook();
+
+  for_i(layer_parallelize, in_data.size(), [&](int sample) {
+    const vec_t &in = in_data[sample];
+    vec_t &out      = out_data[sample];
+    std::vector<float_t> bins(lut.size());
+
+    for (serial_size_t o = 0; o < params.out_size_; o++) {
+      const uint8_t *idx = W.column(o);
+      std::fill(bins.begin(), bins.end(), float_t{0});
+      for (serial_size_t c = 0; c < params.in_size_; c++) {
+        bins[idx[c]] += in[c];
+      }
+
+      float_t sum = params.has_bias_ ? bias[o] : float_t{0};
+      for (size_t k = 0; k < lut.size(); k++) sum += bins[k] * lut[k];
+      out[o] = sum;
+    }
+  });
+}
+
+}  // namespace kernels
+}  // namespace tiny_dnn
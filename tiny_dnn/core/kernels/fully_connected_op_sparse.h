@@ -0,0 +1,53 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include "tiny_dnn/core/framework/sparse_matrix.h"
+#include "tiny_dnn/core/params/fully_params.h"
+
+namespace tiny_dnn {
+namespace kernels {
+
+/**
+ * sparse x dense forward pass.
+ * W holds the in_size x out_size weight matrix in blocked CSR form, so each
+ * row is the fan-out of one input and each tile updates block_size()
+ * consecutive outputs at once. Inputs that are exactly zero (e.g. after
+ * relu) skip their row entirely.
+ **/
+inline void fully_connected_op_sparse(const tensor_t &in_data,
+                                      const block_sparse_matrix &W,
+                                      const vec_t &bias,
+                                      tensor_t &out_data,
+                                      const fully_params &params,
+                                      const bool layer_parallelize) {
+  for_i(layer_parallelize, in_data.size(), [&](int sample) {
+    const vec_t &in = in_data[sample];
+    vec_t &out      = out_data[sample];
+
+    if (params.has_bias_) {
+      std::copy(bias.begin(), bias.end(), out.begin());
+    } else {
+      vectorize::fill(&out[0], out.size(), float_t{0});
+    }
+
+    for (serial_size_t c = 0; c < params.in_size_; c++) {
+      const float_t x = in[c];
+      if (x == float_t{0}) continue;
+      for (serial_size_t b = W.row_begin(c); b < W.row_end(c); b++) {
+        const serial_size_t col = W.block_col(b);
+        vectorize::muladd(W.block(b), x,
+                          std::min(W.block_size(), params.out_size_ - col),
+                          &out[col]);
+      }
+    }
+  });
+}
+
+}  // namespace kernels
+}  // namespace tiny_dnn
@@ -24,9 +24,6 @@ class GlobalAvePoolGradOp : public core::OpKernel {
     tensor_t &prev_delta = context.input_grad(0);
     tensor_t &curr_delta = context.output_grad(0);
 
-    // initialize outputs
-    fill_tensor(prev_delta, float_t{0});
-
     // only internal kernel op implemented yet, so use it regardless
     // of the specified backend engine
     kernels::global_avepool_grad_op_internal(prev_delta, curr_delta, params,
@@ -24,9 +24,6 @@ class GlobalAvePoolOp : public core::OpKernel {
     const tensor_t &in_data = context.input(0);
     tensor_t &out_data      = context.output(0);
 
-    // initialize outputs
-    fill_tensor(out_data, float_t{0});
-
     // only internal kernel op implemented yet, so use it regardless
     // of the specified backend engine
     kernels::global_avepool_op_internal(in_data, out_data, params,
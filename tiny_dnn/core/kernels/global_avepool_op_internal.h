@@ -7,6 +7,8 @@
 */
 #pragma once
 
+#include <algorithm>
+
 namespace tiny_dnn {
 namespace kernels {
 
@@ -20,11 +22,9 @@ inline void global_avepool_op_internal(
     vec_t &out      = out_data[sample];
 
     const size_t pool_area = params.in.width_ * params.in.height_;
+    const float_t scale    = float_t(1) / static_cast<float_t>(pool_area);
     for (size_t i = 0; i < params.in.depth_; i++) {
-      for (size_t j = 0; j < pool_area; j++) {
-        out[i] += in[i * pool_area + j];
-      }
-      out[i] /= pool_area;
+      out[i] = vectorize::sum(&in[i * pool_area], pool_area) * scale;
     }
   });
 }
@@ -40,11 +40,76 @@ inline void global_avepool_grad_op_internal(
 
     const size_t pool_area = params.in.width_ * params.in.height_;
     for (size_t i = 0; i < params.in.depth_; i++) {
-      const float_t pi = curr[i] / pool_area;
-      for (size_t j = 0; j < pool_area; j++) {
-        prev[i * pool_area + j] = pi;
-      }
+      const float_t pi = curr[i] / static_cast<float_t>(pool_area);
+      vectorize::fill(&prev[i * pool_area], pool_area, pi);
+    }
+  });
+}
+
+/**
+ * global average pooling followed by a fully-connected layer, in one pass
+ * over the feature map: each channel's mean is scattered into the outputs
+ * as soon as it is known, so the pooled vector is never stored.
+ * W is laid out like the weights of fully_connected_layer, one row of
+ * out_size per channel.
+ **/
+inline void global_avepool_fc_op_internal(const tensor_t &in_data,
+                                          const vec_t &W,
+                                          const vec_t &bias,
+                                          tensor_t &out_data,
+                                          const shape3d &in_shape,
+                                          serial_size_t out_size,
+                                          const bool layer_parallelize) {
+  for_i(layer_parallelize, in_data.size(), [&](int sample) {
+    const vec_t &in = in_data[sample];
+    vec_t &out      = out_data[sample];
+
+    const size_t pool_area = in_shape.width_ * in_shape.height_;
+    const float_t scale    = float_t(1) / static_cast<float_t>(pool_area);
+    if (bias.empty()) {
+      vectorize::fill(&out[0], out_size, float_t(0));
+    } else {
+      std::copy(bias.begin(), bias.end(), out.begin());
+    }
+    for (size_t c = 0; c < in_shape.depth_; c++) {
+      const float_t mean =
+        vectorize::sum(&in[c * pool_area], pool_area) * scale;
+      vectorize::muladd(&W[c * out_size], mean, out_size, &out[0]);
+    }
+  });
+}
+
+/**
+ * gradients of global_avepool_fc_op_internal; the channel means are
+ * recomputed from the input rather than kept from the forward pass.
+ * dW and db accumulate, prev_delta is overwritten.
+ **/
+inline void global_avepool_fc_grad_op_internal(const tensor_t &in_data,
+                                               const vec_t &W,
+                                               tensor_t &dW,
+                                               tensor_t *db,
+                                               const tensor_t &curr_delta,
+                                               tensor_t &prev_delta,
+                                               const shape3d &in_shape,
+                                               serial_size_t out_size,
+                                               const bool layer_parallelize) {
+  for_i(layer_parallelize, in_data.size(), [&](int sample) {
+    const vec_t &in   = in_data[sample];
+    const vec_t &curr = curr_delta[sample];
+    vec_t &prev       = prev_delta[sample];
+
+    const size_t pool_area = in_shape.width_ * in_shape.height_;
+    const float_t scale    = float_t(1) / static_cast<float_t>(pool_area);
+    for (size_t c = 0; c < in_shape.depth_; c++) {
+      const float_t mean =
+        vectorize::sum(&in[c * pool_area], pool_area) * scale;
+      vectorize::muladd(&curr[0], mean, out_size, &dW[sample][c * out_size]);
+
+      const float_t g =
+        vectorize::dot(&curr[0], &W[c * out_size], out_size) * scale;
+      vectorize::fill(&prev[c * pool_area], pool_area, g);
     }
+    if (db) vectorize::add(&curr[0], out_size, &(*db)[sample][0]);
   });
 }
 
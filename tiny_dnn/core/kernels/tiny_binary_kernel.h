@@ -0,0 +1,299 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef CNN_USE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#include "tiny_dnn/core/params/conv_params.h"
+#include "tiny_dnn/core/params/fully_params.h"
+
+namespace tiny_dnn {
+namespace core {
+namespace kernels {
+
+/**
+ * 1-bit kernels: values are binarized to sign(x) in {-1, +1} (0 maps to +1)
+ * and packed 64 per word, bit set for +1. The dot product of two n-element
+ * sign vectors is n - 2 * popcount(a xor b).
+ **/
+typedef uint64_t bit_word;
+
+inline serial_size_t binary_words(serial_size_t n) { return (n + 63) / 64; }
+
+inline float_t binary_sign(float_t x) {
+  return x >= float_t(0) ? float_t(1) : float_t(-1);
+}
+
+inline serial_size_t popcount(bit_word x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+  return static_cast<serial_size_t>(__popcnt64(x));
+#elif defined(__GNUC__)
+  return static_cast<serial_size_t>(__builtin_popcountll(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return static_cast<serial_size_t>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+///< number of differing bits of two n-word bit strings
+inline serial_size_t hamming_distance(const bit_word *a,
+                                      const bit_word *b,
+                                      serial_size_t n) {
+  serial_size_t i = 0, d = 0;
+#ifdef CNN_USE_AVX2
+  // popcount of 4 words at once through a 4-bit lookup table
+  const __m256i lut  = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i acc        = _mm256_setzero_si256();
+  for (; i + 4 <= n; i += 4) {
+    const __m256i v = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+    const __m256i hi =
+      _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+    acc = _mm256_add_epi64(
+      acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  alignas(32) uint64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+  d = static_cast<serial_size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+  for (; i < n; i++) d += popcount(a[i] ^ b[i]);
+  return d;
+}
+
+///< +-1 dot product of two packed sign vectors of n elements
+inline float_t binary_dot(const bit_word *a,
+                          const bit_word *b,
+                          serial_size_t n) {
+  return static_cast<float_t>(n) -
+         float_t(2) * static_cast<float_t>(
+                        hamming_distance(a, b, binary_words(n)));
+}
+
+///< packs sign bits of src[0], src[stride], ... src[(n-1)*stride]
+inline void pack_signs(const float_t *src,
+                       serial_size_t n,
+                       size_t stride,
+                       bit_word *dst) {
+  const serial_size_t words = binary_words(n);
+  for (serial_size_t w = 0; w < words; w++) dst[w] = 0;
+  for (serial_size_t i = 0; i < n; i++) {
+    if (src[i * stride] >= float_t(0)) dst[i / 64] |= bit_word(1) << (i % 64);
+  }
+}
+
+/**
+ * binarizes a rows x cols weight matrix row by row.
+ * Element (r, k) is W[r * row_stride + k * col_stride]. Each row is
+ * approximated by alpha[r] * sign(W_r) with alpha[r] = mean(|W_r|).
+ **/
+inline void pack_binary_weights(const vec_t &W,
+                                serial_size_t rows,
+                                serial_size_t cols,
+                                size_t row_stride,
+                                size_t col_stride,
+                                std::vector<bit_word> &bits,
+                                vec_t &alpha) {
+  const serial_size_t words = binary_words(cols);
+  bits.resize(static_cast<size_t>(rows) * words);
+  alpha.resize(rows);
+  for (serial_size_t r = 0; r < rows; r++) {
+    const float_t *w = &W[r * row_stride];
+    float_t sum{0};
+    for (serial_size_t k = 0; k < cols; k++) sum += std::abs(w[k * col_stride]);
+    alpha[r] = cols ? sum / cols : float_t(0);
+    pack_signs(w, cols, col_stride, &bits[r * words]);
+  }
+}
+
+/**
+ * out[o] = alpha[o] * <sign(in), sign(W_o)> + b[o]
+ **/
+inline void tiny_binary_fully_connected_kernel(const fully_params &params,
+                                               const tensor_t &in,
+                                               const std::vector<bit_word> &W,
+                                               const vec_t &alpha,
+                                               const vec_t &b,
+                                               tensor_t &out,
+                                               const bool layer_parallelize) {
+  const serial_size_t words = binary_words(params.in_size_);
+  for_(layer_parallelize, 0, in.size(), [&](const blocked_range &r) {
+    std::vector<bit_word> x(words);
+    for (size_t sample = r.begin(); sample < r.end(); sample++) {
+      pack_signs(&in[sample][0], params.in_size_, 1, &x[0]);
+      for (serial_size_t o = 0; o < params.out_size_; o++) {
+        out[sample][o] =
+          alpha[o] * binary_dot(&x[0], &W[o * words], params.in_size_);
+        if (params.has_bias_) out[sample][o] += b[o];
+      }
+    }
+  });
+}
+
+/**
+ * straight-through estimator: sign() passes the gradient where |x| <= 1.
+ * The weight gradient follows XNOR-Net, dW = g * (1 / n + alpha * 1{|W|<=1}).
+ **/
+inline void tiny_binary_fully_connected_back_kernel(
+  const fully_params &params,
+  const tensor_t &prev_out,
+  const vec_t &W,
+  const vec_t &alpha,
+  tensor_t &dW,
+  tensor_t &db,
+  const tensor_t &curr_delta,
+  tensor_t &prev_delta,
+  const bool layer_parallelize) {
+  const serial_size_t in_size  = params.in_size_;
+  const serial_size_t out_size = params.out_size_;
+  const float_t rcp_n          = float_t(1) / in_size;
+  for_i(layer_parallelize, prev_out.size(), [&](int sample) {
+    const vec_t &x     = prev_out[sample];
+    const vec_t &delta = curr_delta[sample];
+    for (serial_size_t c = 0; c < in_size; c++) {
+      const float_t *w = &W[c * out_size];
+      const float_t xb = binary_sign(x[c]);
+      float_t *pdw     = &dW[sample][c * out_size];
+      float_t sum{0};
+      for (serial_size_t o = 0; o < out_size; o++) {
+        sum += delta[o] * alpha[o] * binary_sign(w[o]);
+        const float_t ste = std::abs(w[o]) <= float_t(1) ? alpha[o] : 0;
+        pdw[o] += delta[o] * xb * (rcp_n + ste);
+      }
+      prev_delta[sample][c] = std::abs(x[c]) <= float_t(1) ? sum : 0;
+    }
+    if (params.has_bias_) {
+      for (serial_size_t o = 0; o < out_size; o++) db[sample][o] += delta[o];
+    }
+  });
+}
+
+/**
+ * binary convolution on a padded input.
+ * Every receptive field is packed into in_depth * kh * kw bits (the bit
+ * order matches the filter layout), so one output is a single xnor/popcount
+ * pass over binary_words(in_depth * kh * kw) words.
+ **/
+inline void tiny_binary_conv2d_kernel(const conv_params &params,
+                                      const tensor_t &in,
+                                      const std::vector<bit_word> &W,
+                                      const vec_t &alpha,
+                                      const vec_t &b,
+                                      tensor_t &out,
+                                      const bool layer_parallelize) {
+  const serial_size_t kw    = params.weight.width_;
+  const serial_size_t kh    = params.weight.height_;
+  const serial_size_t n     = params.in.depth_ * kw * kh;
+  const serial_size_t words = binary_words(n);
+  const serial_size_t area  = params.out.area();
+  for_(layer_parallelize, 0, in.size(), [&](const blocked_range &r) {
+    std::vector<bit_word> patches(static_cast<size_t>(area) * words);
+    for (size_t sample = r.begin(); sample < r.end(); sample++) {
+      std::fill(patches.begin(), patches.end(), bit_word(0));
+      for (serial_size_t y = 0; y < params.out.height_; y++) {
+        for (serial_size_t x = 0; x < params.out.width_; x++) {
+          bit_word *p = &patches[(y * params.out.width_ + x) * words];
+          serial_size_t k = 0;
+          for (serial_size_t inc = 0; inc < params.in.depth_; inc++) {
+            for (serial_size_t wy = 0; wy < kh; wy++) {
+              const float_t *src = &in[sample][params.in_padded.get_index(
+                x * params.w_stride, y * params.h_stride + wy, inc)];
+              for (serial_size_t wx = 0; wx < kw; wx++, k++) {
+                if (src[wx] >= float_t(0)) p[k / 64] |= bit_word(1) << (k % 64);
+              }
+            }
+          }
+        }
+      }
+      for (serial_size_t o = 0; o < params.out.depth_; o++) {
+        float_t *pa      = &out[sample][params.out.get_index(0, 0, o)];
+        const float_t bo = params.has_bias ? b[o] : float_t(0);
+        for (serial_size_t i = 0; i < area; i++) {
+          pa[i] =
+            alpha[o] * binary_dot(&patches[i * words], &W[o * words], n) + bo;
+        }
+      }
+    }
+  });
+}
+
+///< straight-through estimator backward of tiny_binary_conv2d_kernel
+inline void tiny_binary_conv2d_back_kernel(const conv_params &params,
+                                           const tensor_t &prev_out,
+                                           const vec_t &W,
+                                           const vec_t &alpha,
+                                           tensor_t &dW,
+                                           tensor_t &db,
+                                           const tensor_t &curr_delta,
+                                           tensor_t &prev_delta,
+                                           const bool layer_parallelize) {
+  const serial_size_t kw    = params.weight.width_;
+  const serial_size_t kh    = params.weight.height_;
+  const serial_size_t id    = params.in.depth_;
+  const serial_size_t n     = id * kw * kh;
+  const float_t rcp_n       = float_t(1) / n;
+  const serial_size_t iw    = params.in_padded.width_;
+  const serial_size_t ow    = params.out.width_;
+  const serial_size_t oh    = params.out.height_;
+  for_i(layer_parallelize, prev_out.size(), [&](int sample) {
+    const vec_t &x = prev_out[sample];
+    vec_t &dx      = prev_delta[sample];
+    std::fill(dx.begin(), dx.end(), float_t(0));
+    for (serial_size_t o = 0; o < params.out.depth_; o++) {
+      const float_t *delta = &curr_delta[sample][params.out.get_index(0, 0, o)];
+      for (serial_size_t k = 0; k < n; k++) {
+        const serial_size_t inc = k / (kw * kh);
+        const serial_size_t wy  = (k / kw) % kh;
+        const serial_size_t wx  = k % kw;
+        const float_t w         = W[o * n + k];
+        const float_t gx        = alpha[o] * binary_sign(w);
+        const float_t gw =
+          rcp_n + (std::abs(w) <= float_t(1) ? alpha[o] : float_t(0));
+        const size_t base = params.in_padded.get_index(wx, wy, inc);
+        float_t sum{0};
+        for (serial_size_t y = 0; y < oh; y++) {
+          size_t idx = base + y * params.h_stride * iw;
+          for (serial_size_t xo = 0; xo < ow; xo++) {
+            const float_t g = delta[y * ow + xo];
+            sum += g * binary_sign(x[idx]);
+            dx[idx] += g * gx;
+            idx += params.w_stride;
+          }
+        }
+        dW[sample][o * n + k] += sum * gw;
+      }
+      if (params.has_bias) {
+        for (serial_size_t i = 0; i < params.out.area(); i++) {
+          db[sample][o] += delta[i];
+        }
+      }
+    }
+    for (size_t i = 0; i < dx.size(); i++) {
+      if (std::abs(x[i]) > float_t(1)) dx[i] = float_t(0);
+    }
+  });
+}
+
+}  // namespace kernels
+}  // namespace core
+}  // namespace tiny_dnn
@@ -7,6 +7,12 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
+#include "tiny_dnn/core/params/params.h"
+#include "tiny_dnn/util/util.h"
+
 namespace tiny_dnn {
 namespace core {
 namespace kernels {
@@ -249,6 +255,47 @@ void quantize_down_and_shrink_range(std::vector<T1> &input,
                                                  *max_new, &(*output)[0]);
 }
 
+// range of a weight tensor, widened when degenerate so that it is invertible
+inline void weight_quantization_range(const vec_t &w,
+                                      float_t *min_w,
+                                      float_t *max_w) {
+  auto mm = std::minmax_element(w.begin(), w.end());
+  *min_w  = *mm.first;
+  *max_w  = *mm.second;
+  if (*min_w == *max_w) {
+    *max_w = w[0] + 1e-3f;
+    *min_w = w[0] - 1e-3f;
+  }
+}
+
+// range of a kernel input: the fixed one of params, or that of the sample
+inline void input_quantization_range(const Params &params,
+                                     const vec_t &in,
+                                     float_t *min_in,
+                                     float_t *max_in) {
+  if (params.input_min != params.input_max) {
+    *min_in = params.input_min;
+    *max_in = params.input_max;
+    return;
+  }
+  auto mm = std::minmax_element(in.begin(), in.end());
+  *min_in = *mm.first;
+  *max_in = *mm.second;
+}
+
+// rounds every value to the nearest of the 256 uint8 levels over [min, max],
+// staying in float (simulated quantization for training)
+inline void fake_quantize(const vec_t &src,
+                          float_t min_v,
+                          float_t max_v,
+                          vec_t &dst) {
+  dst.resize(src.size());
+  for (size_t i = 0; i < src.size(); i++) {
+    dst[i] = quantized_to_float<uint8_t>(
+      float_to_quantized<uint8_t>(src[i], min_v, max_v), min_v, max_v);
+  }
+}
+
 }  // namespace kernels
 }  // namespace core
 }  // namespace tiny_dnn
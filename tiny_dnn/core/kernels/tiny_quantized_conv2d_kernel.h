@@ -21,57 +21,30 @@ inline void tiny_quantized_conv2d_kernel(const conv_params &params,
                                          vec_t &a,
                                          const bool layer_parallelize) {
   // image quantization
-  float_t min_input(in[0]);
-  float_t max_input(in[0]);
-  for (serial_size_t inc = 0; inc < params.in.depth_; inc++) {
-    for (serial_size_t ins = 0;
-         ins < params.in_padded.height_ * params.in_padded.height_; ins++) {
-      serial_size_t idx = params.in_padded.get_index(0, 0, inc);
-      min_input         = std::min(min_input, (&in[idx])[ins]);
-      max_input         = std::max(max_input, (&in[idx])[ins]);
-    }
-  }
+  float_t min_input, max_input;
+  input_quantization_range(params, in, &min_input, &max_input);
   std::vector<uint8_t> in_quantized =
     float_tensor_to_quantized<uint8_t>(in, min_input, max_input);
   // filter quantization
-  float_t min_filter(W[0]);
-  float_t max_filter(W[0]);
-  for (serial_size_t inc = 0; inc < params.in_padded.depth_; inc++) {
-    for (serial_size_t ins = 0;
-         ins < params.weight.height_ * params.weight.height_; ins++) {
-      serial_size_t idx = params.in_padded.get_index(0, 0, inc);
-      min_filter        = std::min(min_filter, (&W[idx])[ins]);
-      max_filter        = std::max(max_filter, (&W[idx])[ins]);
-    }
-  }
-  if (min_filter == max_filter) {
-    max_filter = W[0] + 1e-3f;
-    min_filter = W[0] - 1e-3f;
-  }
+  float_t min_filter, max_filter;
+  weight_quantization_range(W, &min_filter, &max_filter);
   std::vector<uint8_t> W_quantized =
     float_tensor_to_quantized<uint8_t>(W, min_filter, max_filter);
-  // bias quantization
-  float_t min_bias(0);
-  float_t max_bias(0);
-  std::vector<uint8_t> bias_quantized;
-  if (params.has_bias) {
-    for (serial_size_t inc = 0; inc < params.out.depth_; inc++) {
-      min_bias = std::min(min_bias, bias[inc]);
-      max_bias = std::max(max_bias, bias[inc]);
-    }
-    if (min_bias == max_bias) {
-      max_bias = bias[0] + 1e-3f;
-      min_bias = bias[0] - 1e-3f;
-    }
-    bias_quantized =
-      float_tensor_to_quantized<uint8_t>(bias, min_bias, max_bias);
-  }
   // output range
   float_t min_output_value;
   float_t max_output_value;
   quantization_range_for_multiplication<uint8_t, uint8_t, int32_t>(
     min_input, max_input, min_filter, max_filter, &min_output_value,
     &max_output_value);
+  // bias quantization, directly into the 32bit accumulator scale
+  std::vector<int32_t> bias_quantized;
+  if (params.has_bias) {
+    bias_quantized.resize(params.out.depth_);
+    for (serial_size_t o = 0; o < params.out.depth_; o++) {
+      bias_quantized[o] = float_to_quantized<int32_t>(
+        bias[o], min_output_value, max_output_value);
+    }
+  }
 
   std::vector<int32_t> a_quantized(a.size(), static_cast<int32_t>(0));
 
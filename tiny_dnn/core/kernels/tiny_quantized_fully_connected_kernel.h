@@ -24,12 +24,8 @@ inline void tiny_quantized_fully_connected_kernel(
   vec_t &out,
   const bool layer_parallelize) {
   // input quantization
-  float_t min_input(in[0]);
-  float_t max_input(in[0]);
-  for (serial_size_t c = 0; c < params.in_size_; c++) {
-    min_input = std::min(min_input, in[c]);
-    max_input = std::max(max_input, in[c]);
-  }
+  float_t min_input, max_input;
+  input_quantization_range(params, in, &min_input, &max_input);
   std::vector<uint8_t> in_quantized =
     float_tensor_to_quantized<uint8_t>(in, min_input, max_input);
   // filter quantization
@@ -7,6 +7,9 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <deque>
+
 #include "params.h"
 
 namespace tiny_dnn {
@@ -53,6 +56,14 @@ struct connection_table {
 
   bool is_empty() const { return rows_ == 0 && cols_ == 0; }
 
+  ///< number of connected (input, output) channel pairs
+  serial_size_t connections(serial_size_t in_depth,
+                            serial_size_t out_depth) const {
+    if (is_empty()) return in_depth * out_depth;
+    return static_cast<serial_size_t>(
+      std::count(connected_.begin(), connected_.end(), true));
+  }
+
   std::deque<bool> connected_;
   serial_size_t rows_;
   serial_size_t cols_;
@@ -7,6 +7,8 @@
 */
 #pragma once
 
+#include "tiny_dnn/config.h"
+
 namespace tiny_dnn {
 namespace core {
 
@@ -18,12 +20,17 @@ class global_avepool_params;
 /* Base class to model operation parameters */
 class Params {
  public:
-  Params() {}
+  Params() : input_min(0), input_max(0) {}
 
   conv_params &conv();
   fully_params &fully();
   maxpool_params &maxpool();
   global_avepool_params &global_avepool();
+
+  /* Fixed input range of the quantized kernels. While both are equal the
+   * kernels take the range of every sample instead. */
+  float_t input_min;
+  float_t input_max;
 };
 
 }  // namespace core
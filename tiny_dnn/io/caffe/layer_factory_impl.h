@@ -24,6 +24,7 @@
 #include "tiny_dnn/layers/linear_layer.h"
 #include "tiny_dnn/layers/lrn_layer.h"
 #include "tiny_dnn/layers/max_pooling_layer.h"
+#include "tiny_dnn/util/parallel_for.h"
 
 typedef tiny_dnn::shape3d shape_t;
 
@@ -65,12 +66,20 @@ inline void read_proto_from_text(const std::string &prototxt,
 inline void read_proto_from_binary(const std::string &protobinary,
                                    google::protobuf::Message *message) {
   int fd = CNN_OPEN_BINARY(protobinary.c_str());
+  if (fd == -1) {
+    throw nn_error("file not found: " + protobinary);
+  }
+
   google::protobuf::io::FileInputStream rawstr(fd);
   google::protobuf::io::CodedInputStream codedstr(&rawstr);
 
   rawstr.SetCloseOnDelete(true);
+#if GOOGLE_PROTOBUF_VERSION >= 3006000
+  codedstr.SetTotalBytesLimit(std::numeric_limits<int>::max());
+#else
   codedstr.SetTotalBytesLimit(std::numeric_limits<int>::max(),
                               std::numeric_limits<int>::max() / 2);
+#endif
 
   if (!message->ParseFromCodedStream(&codedstr)) {
     throw nn_error("failed to parse");
@@ -320,7 +329,7 @@ inline std::shared_ptr<layer> create_batchnorm(
 
   // weight
   if (layer.blobs_size() > 0) {
-    auto global_stats = layer.blobs();
+    const auto &global_stats = layer.blobs();
     if (global_stats.size() != 3) {
       throw std::runtime_error("unexpected bn stored statistics");
     }
@@ -343,11 +352,10 @@ inline std::shared_ptr<layer> create_batchnorm(
 
 inline void load_weights_fullyconnected(const caffe::LayerParameter &src,
                                         layer *dst) {
-  auto weights = src.blobs(0);
-  int curr     = 0;
+  const auto &weights = src.blobs(0);
 
-  const auto dst_out_size = dst->out_size();
-  const auto dst_in_size  = dst->in_size();
+  const size_t dst_out_size = dst->out_size();
+  const size_t dst_in_size  = dst->in_size();
 
   if (dst_out_size * dst_in_size !=
       static_cast<serial_size_t>(weights.data_size())) {
@@ -359,24 +367,29 @@ inline void load_weights_fullyconnected(const caffe::LayerParameter &src,
   vec_t &w = *dst->weights()[0];
   vec_t &b = *dst->weights()[1];
 
-  // fill weights
-  for (size_t o = 0; o < dst_out_size; o++) {
-    for (size_t i = 0; i < dst_in_size; i++) {
-      // TODO: how to access to weights?
-      // dst->weight()[i * dst->out_size() + o] = weights.data(curr++); //
-      // transpose
-      w[i * dst_out_size + o] = weights.data(curr++);  // transpose
-    }
-  }
+  // fill weights: caffe stores out x in, tiny-dnn in x out. transpose in
+  // strips of input rows so that reads and writes both stay in cache
+  const float *s    = weights.data().data();
+  const size_t tile = 16;
+  for_i(dst->parallelize(), (dst_in_size + tile - 1) / tile,
+        [&](size_t t) {
+          const size_t i0 = t * tile;
+          const size_t i1 = std::min(i0 + tile, dst_in_size);
+          for (size_t o = 0; o < dst_out_size; o++) {
+            const float *row = s + o * dst_in_size;
+            for (size_t i = i0; i < i1; i++) w[i * dst_out_size + o] = row[i];
+          }
+        },
+        1);
 
   // fill bias
   if (src.inner_product_param().bias_term()) {
-    auto biases = src.blobs(1);
-    for (size_t o = 0; o < dst_out_size; o++) {
-      // TODO: how to access to biases?
-      // dst->bias()[o] = biases.data(o);
-      b[o] = biases.data(o);
+    const auto &biases = src.blobs(1);
+    if (static_cast<size_t>(biases.data_size()) < dst_out_size) {
+      throw nn_error("bias size mismatch: " + src.name());
     }
+    std::copy(biases.data().begin(), biases.data().begin() + dst_out_size,
+              b.begin());
   }
 }
 
@@ -421,51 +434,55 @@ inline std::shared_ptr<layer> create_fullyconnected(
 }
 
 inline void load_weights_conv(const caffe::LayerParameter &src, layer *dst) {
-  // fill weight
-  auto weights = src.blobs(0);
+  const auto &weights    = src.blobs(0);
+  const auto &conv_param = src.convolution_param();
 
-  // TODO: check if it works
-  // int out_channels = dst->out_shape().depth_;
-  // int in_channels = dst->in_shape().depth_;
-  int out_channels = dst->out_data_shape()[0].depth_;
-  int in_channels  = dst->in_data_shape()[0].depth_;
+  const size_t out_channels = dst->out_data_shape()[0].depth_;
+  const size_t in_channels  = dst->in_data_shape()[0].depth_;
+  const size_t window_size  = get_kernel_size_2d(conv_param);
+  const size_t taps         = window_size * window_size;
 
   connection_table table;
-  auto conv_param = src.convolution_param();
-  int dst_idx     = 0;
-  int src_idx     = 0;
-  int window_size = get_kernel_size_2d(conv_param);
+  size_t group_in = in_channels;
 
   if (conv_param.has_group()) {
     table = connection_table(conv_param.group(), in_channels, out_channels);
+    group_in /= conv_param.group();
+  }
+
+  if (static_cast<size_t>(weights.data_size()) !=
+      out_channels * group_in * taps) {
+    throw nn_error(std::string("layer size mismatch!") + "caffe(" + src.name() +
+                   "):" + to_string(weights.data_size()) + "\n" + "tiny-dnn(" +
+                   dst->layer_type() + "):" +
+                   to_string(out_channels * group_in * taps));
   }
 
   vec_t &w = *dst->weights()[0];
   vec_t &b = *dst->weights()[1];
 
-  // fill weights
-  for (int o = 0; o < out_channels; o++) {
-    for (int i = 0; i < in_channels; i++) {
-      if (!table.is_connected(o, i)) {
-        dst_idx += window_size * window_size;
-        continue;
-      }
-      for (int x = 0; x < window_size * window_size; x++) {
-        // TODO
-        // dst->weight()[dst_idx++] = weights.data(src_idx++);
-        w[dst_idx++] = weights.data(src_idx++);
-      }
-    }
-  }
+  // fill weights: caffe keeps only the group_in filters each output channel
+  // is connected to, so copy them filter by filter into the dense array
+  const float *s = weights.data().data();
+  for_i(dst->parallelize(), out_channels,
+        [&](size_t o) {
+          const float *p = s + o * group_in * taps;
+          for (size_t i = 0; i < in_channels; i++) {
+            if (!table.is_connected(o, i)) continue;
+            std::copy(p, p + taps, &w[(o * in_channels + i) * taps]);
+            p += taps;
+          }
+        },
+        1);
 
   // fill bias
   if (conv_param.bias_term()) {
-    auto biases = src.blobs(1);
-    for (int o = 0; o < out_channels; o++) {
-      // TODO
-      // dst->bias()[o] = biases.data(o);
-      b[o] = biases.data(o);
+    const auto &biases = src.blobs(1);
+    if (static_cast<size_t>(biases.data_size()) < out_channels) {
+      throw nn_error("bias size mismatch: " + src.name());
     }
+    std::copy(biases.data().begin(), biases.data().begin() + out_channels,
+              b.begin());
   }
 }
 
@@ -475,7 +492,7 @@ inline void load_weights_batchnorm(const caffe::LayerParameter &src,
     throw nn_error("batch-norm layer expected");
 
   if (src.blobs_size() > 0) {
-    auto global_stats = src.blobs();
+    const auto &global_stats = src.blobs();
     if (global_stats.size() != 3) {
       throw nn_error("unexpected format for batch-norm statistics");
     }
@@ -917,15 +934,18 @@ struct layer_node {
 class caffe_layer_vector {
  public:
   explicit caffe_layer_vector(const caffe::NetParameter &net_orig)
-    : net(net_orig) {
-    if (net.layers_size() > 0) {
-      upgradev1net(net_orig, &net);
+    : net(&net_orig) {
+    // only the deprecated V1 format needs a converted copy; weight blobs of
+    // current models are referenced in place
+    if (net_orig.layers_size() > 0) {
+      upgradev1net(net_orig, &upgraded);
+      net = &upgraded;
     }
 
-    nodes.reserve(net.layer_size());
+    nodes.reserve(net->layer_size());
 
-    for (int i = 0; i < net.layer_size(); i++) {
-      auto &l = net.layer(i);
+    for (int i = 0; i < net->layer_size(); i++) {
+      auto &l = net->layer(i);
 
       if (layer_table.find(l.name()) != layer_table.end()) continue;
 
@@ -1096,7 +1116,8 @@ class caffe_layer_vector {
 #undef COPY_PARAM
   }
 
-  caffe::NetParameter net;
+  const caffe::NetParameter *net;
+  caffe::NetParameter upgraded;
   layer_node *root_node;
   /* layer name -> layer */
   std::map<std::string, layer_node *> layer_table;
@@ -6,6 +6,7 @@
     in the LICENSE file.
 */
 #pragma once
+#include "tiny_dnn/core/framework/elementwise_expression.h"
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/util/util.h"
 
@@ -41,17 +42,24 @@ class elementwise_add_layer : public layer {
     const tensor_t &in1 = *in_data[0];
     tensor_t &out       = *out_data[0];
 
-    out = in1;
-
-    // @todo parallelize
-    for (size_t sample = 0; sample < in1.size(); ++sample) {
-      for (serial_size_t i = 1; i < num_args_; i++) {
-        std::transform((*in_data[i])[sample].begin(),
-                       (*in_data[i])[sample].end(), out[sample].begin(),
-                       out[sample].begin(),
-                       [](float_t x, float_t y) { return x + y; });
+    // two inputs per pass over the output
+    for_i(in1.size(), [&](size_t sample) {
+      vec_t &y = out[sample];
+      if (num_args_ == 1) {
+        y = in1[sample];
+        return;
+      }
+      expr::assign(y, expr::ref(in1[sample]) +
+                        expr::ref((*in_data[1])[sample]));
+      serial_size_t i = 2;
+      for (; i + 1 < num_args_; i += 2) {
+        expr::assign(y, expr::ref(y) + expr::ref((*in_data[i])[sample]) +
+                          expr::ref((*in_data[i + 1])[sample]));
+      }
+      if (i < num_args_) {
+        expr::assign(y, expr::ref(y) + expr::ref((*in_data[i])[sample]));
       }
-    }
+    });
   }
 
   void back_propagation(const std::vector<tensor_t *> &in_data,
@@ -229,6 +229,8 @@ class average_pooling_layer : public partial_connected_layer {
   }
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
+  friend class c_code_generator;
 
  private:
   serial_size_t stride_x_;
@@ -11,7 +11,7 @@
 #include <string>
 #include <vector>
 
-#include "tiny_dnn/layers/partial_connected_layer.h"
+#include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/util/util.h"
 
 #ifdef DNN_USE_IMAGE_API
@@ -25,32 +25,36 @@ inline void tiny_average_unpooling_kernel(
   bool parallelize,
   const std::vector<tensor_t *> &in_data,
   std::vector<tensor_t *> &out_data,
+  const shape3d &in_dim,
   const shape3d &out_dim,
-  float_t scale_factor,
-  std::vector<typename partial_connected_layer::wi_connections> &out2wi) {
-  CNN_UNREFERENCED_PARAMETER(scale_factor);
-  for_i(parallelize, in_data[0]->size(), [&](size_t sample) {
-    const vec_t &in = (*in_data[0])[sample];
-    const vec_t &W  = (*in_data[1])[0];
-    const vec_t &b  = (*in_data[2])[0];
-    vec_t &out      = (*out_data[0])[sample];
-
-    auto oarea = out_dim.area();
-    size_t idx = 0;
-    for (size_t d = 0; d < out_dim.depth_; ++d) {
-      float_t weight = W[d];  // * scale_factor;
-      float_t bias   = b[d];
-      for (size_t i = 0; i < oarea; ++i, ++idx) {
-        const auto &connections = out2wi[idx];
-        float_t value{0};
-        for (auto connection : connections) value += in[connection.second];
-        value *= weight;
-        value += bias;
-        out[idx] = value;
+  serial_size_t pool_size,
+  serial_size_t stride) {
+  const tensor_t &in = *in_data[0];
+  const vec_t &W     = (*in_data[1])[0];
+  const vec_t &b     = (*in_data[2])[0];
+  tensor_t &out      = *out_data[0];
+
+  for_i(parallelize, in.size() * in_dim.depth_, [&](size_t i) {
+    const size_t sample   = i / in_dim.depth_;
+    const serial_size_t c = static_cast<serial_size_t>(i % in_dim.depth_);
+    const float_t *src    = &in[sample][in_dim.get_index(0, 0, c)];
+    float_t *dst          = &out[sample][out_dim.get_index(0, 0, c)];
+    vec_t row(out_dim.width_);
+
+    vectorize::fill(dst, out_dim.area(), b[c]);
+    for (serial_size_t y = 0; y < in_dim.height_; y++) {
+      // the contribution of one input row, added to each output row that
+      // its windows cover
+      vectorize::fill(&row[0], row.size(), float_t{0});
+      for (serial_size_t x = 0; x < in_dim.width_; x++) {
+        vectorize::add(W[c] * src[y * in_dim.width_ + x], pool_size,
+                       &row[x * stride]);
+      }
+      for (serial_size_t dy = 0; dy < pool_size; dy++) {
+        vectorize::add(&row[0], row.size(),
+                       dst + (y * stride + dy) * out_dim.width_);
       }
     }
-
-    assert(out.size() == out2wi.size());
   });
 }
 
@@ -62,57 +66,50 @@ inline void tiny_average_unpooling_back_kernel(
   std::vector<tensor_t *> &out_grad,
   std::vector<tensor_t *> &in_grad,
   const shape3d &in_dim,
-  float_t scale_factor,
-  std::vector<typename partial_connected_layer::io_connections> &weight2io,
-  std::vector<typename partial_connected_layer::wo_connections> &in2wo,
-  std::vector<std::vector<serial_size_t>> &bias2out) {
+  const shape3d &out_dim,
+  serial_size_t pool_size,
+  serial_size_t stride) {
   CNN_UNREFERENCED_PARAMETER(out_data);
-  CNN_UNREFERENCED_PARAMETER(scale_factor);
-  for_i(parallelize, in_data[0]->size(), [&](size_t sample) {
-    const vec_t &prev_out = (*in_data[0])[sample];
-    const vec_t &W        = (*in_data[1])[0];
-    vec_t &dW             = (*in_grad[1])[sample];
-    vec_t &db             = (*in_grad[2])[sample];
-    vec_t &prev_delta     = (*in_grad[0])[sample];
-    vec_t &curr_delta     = (*out_grad[0])[sample];
-
-    auto inarea = in_dim.area();
-    size_t idx  = 0;
-    for (size_t i = 0; i < in_dim.depth_; ++i) {
-      float_t weight = W[i];  // * scale_factor;
-      for (size_t j = 0; j < inarea; ++j, ++idx) {
-        prev_delta[idx] = weight * curr_delta[in2wo[idx][0].second];
+  const tensor_t &prev_out = *in_data[0];
+  const vec_t &W           = (*in_data[1])[0];
+  tensor_t &dW             = *in_grad[1];
+  tensor_t &db             = *in_grad[2];
+  tensor_t &prev_delta     = *in_grad[0];
+  const tensor_t &curr     = *out_grad[0];
+
+  for_i(parallelize, prev_out.size() * in_dim.depth_, [&](size_t i) {
+    const size_t sample    = i / in_dim.depth_;
+    const serial_size_t c  = static_cast<serial_size_t>(i % in_dim.depth_);
+    const serial_size_t ix = in_dim.get_index(0, 0, c);
+    const float_t *delta   = &curr[sample][out_dim.get_index(0, 0, c)];
+    vec_t rows(out_dim.width_);
+
+    float_t dw = 0;
+    for (serial_size_t y = 0; y < in_dim.height_; y++) {
+      // sum the rows of the windows first, then each window's columns
+      std::copy(delta + y * stride * out_dim.width_,
+                delta + (y * stride + 1) * out_dim.width_, rows.begin());
+      for (serial_size_t dy = 1; dy < pool_size; dy++) {
+        vectorize::add(delta + (y * stride + dy) * out_dim.width_,
+                       rows.size(), &rows[0]);
+      }
+      for (serial_size_t x = 0; x < in_dim.width_; x++) {
+        const size_t idx        = ix + y * in_dim.width_ + x;
+        const float_t g         = vectorize::sum(&rows[x * stride], pool_size);
+        prev_delta[sample][idx] = W[c] * g;
+        dw += prev_out[sample][idx] * g;
       }
     }
-
-    for (size_t i = 0; i < weight2io.size(); ++i) {
-      const auto &connections = weight2io[i];
-      float_t diff{0};
-
-      for (auto connection : connections)
-        diff += prev_out[connection.first] * curr_delta[connection.second];
-
-      dW[i] += diff;  // * scale_factor;
-    }
-
-    for (size_t i = 0; i < bias2out.size(); i++) {
-      const std::vector<serial_size_t> &outs = bias2out[i];
-      float_t diff{0};
-
-      for (auto o : outs) diff += curr_delta[o];
-
-      db[i] += diff;
-    }
+    dW[sample][c] += dw;
+    db[sample][c] += vectorize::sum(delta, out_dim.area());
   });
 }
 
 /**
  * average pooling with trainable weights
  **/
-class average_unpooling_layer : public partial_connected_layer {
+class average_unpooling_layer : public layer {
  public:
-  using Base = partial_connected_layer;
-
   /**
    * @param in_width     [in] width of input image
    * @param in_height    [in] height of input image
@@ -123,17 +120,8 @@ class average_unpooling_layer : public partial_connected_layer {
                           serial_size_t in_height,
                           serial_size_t in_channels,
                           serial_size_t pooling_size)
-    : Base(in_width * in_height * in_channels,
-           in_width * in_height * in_channels * sqr(pooling_size),
-           in_channels,
-           in_channels,
-           float_t(1) * sqr(pooling_size)),
-      stride_(pooling_size),
-      in_(in_width, in_height, in_channels),
-      out_(in_width * pooling_size, in_height * pooling_size, in_channels),
-      w_(pooling_size, (in_height == 1 ? 1 : pooling_size), in_channels) {
-    init_connection(pooling_size);
-  }
+    : average_unpooling_layer(
+        in_width, in_height, in_channels, pooling_size, pooling_size) {}
 
   /**
    * @param in_width     [in] width of input image
@@ -148,19 +136,25 @@ class average_unpooling_layer : public partial_connected_layer {
                           serial_size_t in_channels,
                           serial_size_t pooling_size,
                           serial_size_t stride)
-    : Base(in_width * in_height * in_channels,
-           unpool_out_dim(in_width, pooling_size, stride) *
-             unpool_out_dim(in_height, pooling_size, stride) * in_channels,
-           in_channels,
-           in_channels,
-           float_t(1) * sqr(pooling_size)),
+    : layer(std_input_order(true), {vector_type::data}),
+      pool_size_(pooling_size),
       stride_(stride),
       in_(in_width, in_height, in_channels),
       out_(unpool_out_dim(in_width, pooling_size, stride),
            unpool_out_dim(in_height, pooling_size, stride),
            in_channels),
-      w_(pooling_size, (in_height == 1 ? 1 : pooling_size), in_channels) {
-    init_connection(pooling_size);
+      w_(pooling_size, (in_height == 1 ? 1 : pooling_size), in_channels) {}
+
+  serial_size_t fan_in_size() const override {
+    return sqr((pool_size_ + stride_ - 1) / stride_);
+  }
+
+  serial_size_t fan_out_size() const override { return sqr(pool_size_); }
+
+  uint64_t forward_flops() const override {
+    // multiply-add per window element, then scale and bias per output
+    return 2 * static_cast<uint64_t>(in_.size()) * sqr(pool_size_) +
+           2 * static_cast<uint64_t>(out_.size());
   }
 
   std::vector<index3d<serial_size_t>> in_shape() const override {
@@ -175,22 +169,23 @@ class average_unpooling_layer : public partial_connected_layer {
 
   void forward_propagation(const std::vector<tensor_t *> &in_data,
                            std::vector<tensor_t *> &out_data) override {
-    tiny_average_unpooling_kernel(parallelize_, in_data, out_data, out_,
-                                  Base::scale_factor_, Base::out2wi_);
+    tiny_average_unpooling_kernel(parallelize_, in_data, out_data, in_, out_,
+                                  pool_size_, stride_);
   }
 
   void back_propagation(const std::vector<tensor_t *> &in_data,
                         const std::vector<tensor_t *> &out_data,
                         std::vector<tensor_t *> &out_grad,
                         std::vector<tensor_t *> &in_grad) override {
-    tiny_average_unpooling_back_kernel(
-      parallelize_, in_data, out_data, out_grad, in_grad, in_,
-      Base::scale_factor_, Base::weight2io_, Base::in2wo_, Base::bias2out_);
+    tiny_average_unpooling_back_kernel(parallelize_, in_data, out_data,
+                                       out_grad, in_grad, in_, out_,
+                                       pool_size_, stride_);
   }
 
   friend struct serialization_buddy;
 
  private:
+  serial_size_t pool_size_;
   serial_size_t stride_;
   shape3d in_;
   shape3d out_;
@@ -201,41 +196,6 @@ class average_unpooling_layer : public partial_connected_layer {
                                       serial_size_t stride) {
     return static_cast<int>((in_size - 1) * stride + pooling_size);
   }
-
-  void init_connection(serial_size_t pooling_size) {
-    for (serial_size_t c = 0; c < in_.depth_; ++c) {
-      for (serial_size_t y = 0; y < in_.height_; ++y) {
-        for (serial_size_t x = 0; x < in_.width_; ++x) {
-          connect_kernel(pooling_size, x, y, c);
-        }
-      }
-    }
-
-    for (serial_size_t c = 0; c < in_.depth_; ++c) {
-      for (serial_size_t y = 0; y < out_.height_; ++y) {
-        for (serial_size_t x = 0; x < out_.width_; ++x) {
-          this->connect_bias(c, out_.get_index(x, y, c));
-        }
-      }
-    }
-  }
-
-  void connect_kernel(serial_size_t pooling_size,
-                      serial_size_t x,
-                      serial_size_t y,
-                      serial_size_t inc) {
-    serial_size_t dymax = std::min(pooling_size, out_.height_ - y);
-    serial_size_t dxmax = std::min(pooling_size, out_.width_ - x);
-    serial_size_t dstx  = x * stride_;
-    serial_size_t dsty  = y * stride_;
-    serial_size_t inidx = in_.get_index(x, y, inc);
-    for (serial_size_t dy = 0; dy < dymax; ++dy) {
-      for (serial_size_t dx = 0; dx < dxmax; ++dx) {
-        this->connect_weight(inidx, out_.get_index(dstx + dx, dsty + dy, inc),
-                             inc);
-      }
-    }
-  }
 };
 
 }  // namespace tiny_dnn
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 
+#include "tiny_dnn/core/framework/elementwise_expression.h"
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/util/math_functions.h"
 #include "tiny_dnn/util/util.h"
@@ -76,6 +77,15 @@ class batch_normalization_layer : public layer {
   ///< number of outgoing connections for each input unit
   serial_size_t fan_out_size() const override { return 1; }
 
+  ///< mean, variance and normalization: a handful of operations per element
+  uint64_t forward_flops() const override {
+    return 5 * static_cast<uint64_t>(in_channels_) * in_spatial_size_;
+  }
+
+  uint64_t backward_flops() const override {
+    return 8 * static_cast<uint64_t>(in_channels_) * in_spatial_size_;
+  }
+
   std::vector<index3d<serial_size_t>> in_shape() const override {
     return {index3d<serial_size_t>(in_spatial_size_, 1, in_channels_)};
   }
@@ -95,14 +105,13 @@ class batch_normalization_layer : public layer {
 
     CNN_UNREFERENCED_PARAMETER(in_data);
 
-    tensor_t delta_dot_y = curr_out;
+    tensor_t delta_dot_y(num_samples);
     vec_t mean_delta_dot_y, mean_delta, mean_Y;
 
-    for (serial_size_t i = 0; i < num_samples; i++) {
-      for (serial_size_t j = 0; j < curr_out[0].size(); j++) {
-        delta_dot_y[i][j] *= curr_delta[i][j];
-      }
-    }
+    for_i(num_samples, [&](int i) {
+      expr::assign(delta_dot_y[i], expr::ref(curr_out[i]) *
+                                     expr::ref(curr_delta[i]));
+    });
 
     moments(delta_dot_y, in_spatial_size_, in_channels_, mean_delta_dot_y);
     moments(curr_delta, in_spatial_size_, in_channels_, mean_delta);
@@ -114,15 +123,14 @@ class batch_normalization_layer : public layer {
     //
     for_i(num_samples, [&](int i) {
       for (serial_size_t j = 0; j < in_channels_; j++) {
-        for (serial_size_t k = 0; k < in_spatial_size_; k++) {
-          serial_size_t index = j * in_spatial_size_ + k;
-
-          prev_delta[i][index] = curr_delta[i][index] - mean_delta[j] -
-                                 mean_delta_dot_y[j] * curr_out[i][index];
-
-          // stddev_ is calculated in the forward pass
-          prev_delta[i][index] /= stddev_[j];
-        }
+        const size_t offset = j * in_spatial_size_;
+        const auto dy = expr::ref(&curr_delta[i][offset], in_spatial_size_);
+        const auto y  = expr::ref(&curr_out[i][offset], in_spatial_size_);
+
+        // stddev_ is calculated in the forward pass
+        expr::assign(&prev_delta[i][offset], in_spatial_size_,
+                     (dy - mean_delta[j] - mean_delta_dot_y[j] * y) /
+                       stddev_[j]);
       }
     });
   }
@@ -148,11 +156,10 @@ class batch_normalization_layer : public layer {
       float_t *outptr      = &out[i][0];
 
       for (size_t j = 0; j < in_channels_; j++) {
-        float_t m = mean[j];
-
-        for (size_t k = 0; k < in_spatial_size_; k++) {
-          *outptr++ = (*inptr++ - m) / stddev_[j];
-        }
+        const size_t offset = j * in_spatial_size_;
+        const auto x        = expr::ref(inptr + offset, in_spatial_size_);
+        expr::assign(outptr + offset, in_spatial_size_,
+                     (x - mean[j]) / stddev_[j]);
       }
     });
 
@@ -208,11 +215,18 @@ class batch_normalization_layer : public layer {
     calc_stddev(variance);
   }
 
+  ///< running mean used in the test phase
+  const vec_t &mean() const { return mean_; }
+
+  ///< running variance used in the test phase
+  const vec_t &variance() const { return variance_; }
+
   float_t epsilon() const { return eps_; }
 
   float_t momentum() const { return momentum_; }
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
 
  private:
   void calc_stddev(const vec_t &variance) {
@@ -0,0 +1,245 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/core/kernels/tiny_binary_kernel.h"
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * 2D convolution with 1-bit filters and activations.
+ *
+ * Each receptive field and each filter is binarized to its signs and packed
+ * into 64-bit words, so one output is one xnor + popcount pass scaled by the
+ * mean magnitude of the filter. Zero padding binarizes to +1. Real-valued
+ * filters are kept for training, which backpropagates through sign() with a
+ * straight-through estimator.
+ **/
+class binary_convolutional_layer : public layer {
+ public:
+  /**
+   * constructing binary convolutional layer
+   *
+   * @param in_width     [in] input image width
+   * @param in_height    [in] input image height
+   * @param window_size  [in] window(kernel) size of convolution
+   * @param in_channels  [in] input image channels (grayscale=1, rgb=3)
+   * @param out_channels [in] output image channels
+   * @param pad_type     [in] rounding strategy (valid or same)
+   * @param has_bias     [in] whether to add a bias vector to the filter
+   *outputs
+   * @param w_stride     [in] horizontal interval at which to apply the filters
+   * @param h_stride     [in] vertical interval at which to apply the filters
+   **/
+  binary_convolutional_layer(serial_size_t in_width,
+                             serial_size_t in_height,
+                             serial_size_t window_size,
+                             serial_size_t in_channels,
+                             serial_size_t out_channels,
+                             padding pad_type       = padding::valid,
+                             bool has_bias          = true,
+                             serial_size_t w_stride = 1,
+                             serial_size_t h_stride = 1)
+    : binary_convolutional_layer(in_width,
+                                 in_height,
+                                 window_size,
+                                 window_size,
+                                 in_channels,
+                                 out_channels,
+                                 pad_type,
+                                 has_bias,
+                                 w_stride,
+                                 h_stride) {}
+
+  /**
+   * constructing binary convolutional layer
+   *
+   * @param in_width      [in] input image width
+   * @param in_height     [in] input image height
+   * @param window_width  [in] window_width(kernel) size of convolution
+   * @param window_height [in] window_height(kernel) size of convolution
+   * @param in_channels   [in] input image channels (grayscale=1, rgb=3)
+   * @param out_channels  [in] output image channels
+   * @param pad_type      [in] rounding strategy (valid or same)
+   * @param has_bias      [in] whether to add a bias vector to the filter
+   *outputs
+   * @param w_stride      [in] horizontal interval at which to apply the filters
+   * @param h_stride      [in] vertical interval at which to apply the filters
+   **/
+  binary_convolutional_layer(serial_size_t in_width,
+                             serial_size_t in_height,
+                             serial_size_t window_width,
+                             serial_size_t window_height,
+                             serial_size_t in_channels,
+                             serial_size_t out_channels,
+                             padding pad_type       = padding::valid,
+                             bool has_bias          = true,
+                             serial_size_t w_stride = 1,
+                             serial_size_t h_stride = 1)
+    : layer(std_input_order(has_bias), {vector_type::data}),
+      packed_dirty_(true),
+      packed_only_(false) {
+    conv_set_params(shape3d(in_width, in_height, in_channels), window_width,
+                    window_height, out_channels, pad_type, has_bias, w_stride,
+                    h_stride);
+    layer::set_backend_type(core::backend_t::internal);
+  }
+
+  ///< number of incoming connections for each output unit
+  serial_size_t fan_in_size() const override {
+    return params_.weight.width_ * params_.weight.height_ * params_.in.depth_;
+  }
+
+  ///< number of outgoing connections for each input unit
+  serial_size_t fan_out_size() const override {
+    return (params_.weight.width_ / params_.w_stride) *
+           (params_.weight.height_ / params_.h_stride) * params_.out.depth_;
+  }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    if (params_.has_bias) {
+      return {params_.in, params_.weight,
+              index3d<serial_size_t>(1, 1, params_.out.depth_)};
+    } else {
+      return {params_.in, params_.weight};
+    }
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {params_.out};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    static const vec_t no_bias;
+    padding_op_.copy_and_pad_input(*in_data[0], prev_out_padded_);
+
+    pack_weights((*in_data[1])[0]);
+    core::kernels::tiny_binary_conv2d_kernel(
+      params_, *in_data_padded(in_data), packed_W_, alpha_,
+      params_.has_bias ? (*in_data[2])[0] : no_bias, *out_data[0],
+      layer::parallelize());
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    static tensor_t no_bias;
+    if (packed_only_)
+      throw nn_error("binary layer without real-valued filters can't train");
+    tensor_t &prev_delta = params_.pad_type == padding::same
+                             ? prev_delta_padded_
+                             : *in_grad[0];
+    prev_delta.resize(in_grad[0]->size(), vec_t(params_.in_padded.size()));
+
+    core::kernels::tiny_binary_conv2d_back_kernel(
+      params_, *in_data_padded(in_data), (*in_data[1])[0], alpha_,
+      *in_grad[1], params_.has_bias ? *in_grad[2] : no_bias, *out_grad[0],
+      prev_delta, layer::parallelize());
+
+    padding_op_.copy_and_unpad_delta(prev_delta_padded_, *in_grad[0]);
+  }
+
+  /**
+   * the filters are packed again on the next forward pass after a weight
+   * update or a change of phase. Call post_update() after editing the
+   * filters directly.
+   **/
+  void post_update() override { packed_dirty_ = !packed_only_; }
+
+  void set_context(net_phase ctx) override {
+    CNN_UNREFERENCED_PARAMETER(ctx);
+    packed_dirty_ = !packed_only_;
+  }
+
+  ///< bit-packed signs of the filters, one row of words per output channel
+  const std::vector<core::kernels::bit_word> &packed_weights() const {
+    return packed_W_;
+  }
+
+  /**
+   * keep only the packed signs and alpha of the filters, for a network
+   * that only runs inference. The real-valued filters are freed, the model
+   * record then stores 1 bit per weight, and the layer can't be trained.
+   **/
+  void release_real_weights() {
+    pack_weights(*weights()[0]);
+    vec_t().swap(*weights()[0]);
+    packed_only_ = true;
+  }
+
+  ///< true once release_real_weights was called
+  bool packed_only() const { return packed_only_; }
+
+  std::string layer_type() const override { return std::string("b_conv"); }
+
+  friend struct serialization_buddy;
+
+ private:
+  tensor_t *in_data_padded(const std::vector<tensor_t *> &in) {
+    return (params_.pad_type == padding::valid) ? in[0] : &prev_out_padded_;
+  }
+
+  void pack_weights(const vec_t &W) {
+    if (!packed_dirty_) return;
+    const serial_size_t n = fan_in_size();
+    core::kernels::pack_binary_weights(W, params_.out.depth_, n, n, 1,
+                                       packed_W_, alpha_);
+    packed_dirty_ = false;
+  }
+
+  void conv_set_params(const shape3d &in,
+                       serial_size_t w_width,
+                       serial_size_t w_height,
+                       serial_size_t outc,
+                       padding ptype,
+                       bool has_bias,
+                       serial_size_t w_stride,
+                       serial_size_t h_stride) {
+    params_.in = in;
+    params_.in_padded =
+      shape3d(ptype == padding::same ? in.width_ + w_width - 1 : in.width_,
+              ptype == padding::same ? in.height_ + w_height - 1 : in.height_,
+              in.depth_);
+    params_.out =
+      shape3d(conv_out_length(in.width_, w_width, w_stride, ptype),
+              conv_out_length(in.height_, w_height, h_stride, ptype), outc);
+    params_.weight   = shape3d(w_width, w_height, in.depth_ * outc);
+    params_.has_bias = has_bias;
+    params_.pad_type = ptype;
+    params_.w_stride = w_stride;
+    params_.h_stride = h_stride;
+
+    padding_op_ = core::Conv2dPadding(params_);
+  }
+
+  /* The convolution parameters */
+  core::conv_params params_;
+
+  /* Padding operation */
+  core::Conv2dPadding padding_op_;
+
+  /* Buffers to store padded data */
+  tensor_t prev_out_padded_;
+  tensor_t prev_delta_padded_;
+
+  /* binarized filters, packed again after each weight update */
+  std::vector<core::kernels::bit_word> packed_W_;
+  vec_t alpha_;
+  bool packed_dirty_;
+  bool packed_only_;
+};
+
+}  // namespace tiny_dnn
@@ -0,0 +1,149 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/core/kernels/tiny_binary_kernel.h"
+#include "tiny_dnn/layers/layer.h"
+
+namespace tiny_dnn {
+
+/**
+ * fully-connected layer with 1-bit weights and activations.
+ *
+ * Inputs and weights are binarized to their signs and packed into 64-bit
+ * words, so each output is one xnor + popcount pass scaled by the mean
+ * magnitude of its weights. Real-valued weights are kept for training,
+ * which backpropagates through sign() with a straight-through estimator.
+ **/
+class binary_fully_connected_layer : public layer {
+ public:
+  /**
+   * @param in_dim [in] number of elements of the input
+   * @param out_dim [in] number of elements of the output
+   * @param has_bias [in] whether to include additional bias to the layer
+   **/
+  binary_fully_connected_layer(serial_size_t in_dim,
+                               serial_size_t out_dim,
+                               bool has_bias = true)
+    : layer(std_input_order(has_bias), {vector_type::data}),
+      packed_dirty_(true),
+      packed_only_(false) {
+    set_params(in_dim, out_dim, has_bias);
+    layer::set_backend_type(core::backend_t::internal);
+  }
+
+  serial_size_t fan_in_size() const override { return params_.in_size_; }
+
+  serial_size_t fan_out_size() const override { return params_.out_size_; }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    if (params_.has_bias_) {
+      return {index3d<serial_size_t>(params_.in_size_, 1, 1),
+              index3d<serial_size_t>(params_.in_size_, params_.out_size_, 1),
+              index3d<serial_size_t>(params_.out_size_, 1, 1)};
+    } else {
+      return {index3d<serial_size_t>(params_.in_size_, 1, 1),
+              index3d<serial_size_t>(params_.in_size_, params_.out_size_, 1)};
+    }
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {index3d<serial_size_t>(params_.out_size_, 1, 1)};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    static const vec_t no_bias;
+    pack_weights((*in_data[1])[0]);
+    core::kernels::tiny_binary_fully_connected_kernel(
+      params_, *in_data[0], packed_W_, alpha_,
+      params_.has_bias_ ? (*in_data[2])[0] : no_bias, *out_data[0],
+      layer::parallelize());
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    static tensor_t no_bias;
+    if (packed_only_)
+      throw nn_error("binary layer without real-valued weights can't train");
+    core::kernels::tiny_binary_fully_connected_back_kernel(
+      params_, *in_data[0], (*in_data[1])[0], alpha_, *in_grad[1],
+      params_.has_bias_ ? *in_grad[2] : no_bias, *out_grad[0], *in_grad[0],
+      layer::parallelize());
+  }
+
+  /**
+   * the weights are packed again on the next forward pass after a weight
+   * update or a change of phase. Call post_update() after editing the
+   * weights directly.
+   **/
+  void post_update() override { packed_dirty_ = !packed_only_; }
+
+  void set_context(net_phase ctx) override {
+    CNN_UNREFERENCED_PARAMETER(ctx);
+    packed_dirty_ = !packed_only_;
+  }
+
+  ///< bit-packed signs of the weights, one row of words per output
+  const std::vector<core::kernels::bit_word> &packed_weights() const {
+    return packed_W_;
+  }
+
+  /**
+   * keep only the packed signs and alpha of the weights, for a network
+   * that only runs inference. The real-valued weights are freed, the model
+   * record then stores 1 bit per weight, and the layer can't be trained.
+   **/
+  void release_real_weights() {
+    pack_weights(*weights()[0]);
+    vec_t().swap(*weights()[0]);
+    packed_only_ = true;
+  }
+
+  ///< true once release_real_weights was called
+  bool packed_only() const { return packed_only_; }
+
+  std::string layer_type() const override { return "b_fully-connected"; }
+
+  friend struct serialization_buddy;
+
+ protected:
+  void set_params(const serial_size_t in_size,
+                  const serial_size_t out_size,
+                  bool has_bias) {
+    params_.in_size_  = in_size;
+    params_.out_size_ = out_size;
+    params_.has_bias_ = has_bias;
+  }
+
+  void pack_weights(const vec_t &W) {
+    if (!packed_dirty_) return;
+    core::kernels::pack_binary_weights(W, params_.out_size_, params_.in_size_,
+                                       1, params_.out_size_, packed_W_,
+                                       alpha_);
+    packed_dirty_ = false;
+  }
+
+ private:
+  /* The layer parameters */
+  core::fully_params params_;
+
+  /* binarized weights, packed again after each weight update */
+  std::vector<core::kernels::bit_word> packed_W_;
+  vec_t alpha_;
+  bool packed_dirty_;
+  bool packed_only_;
+};
+
+}  // namespace tiny_dnn
@@ -15,6 +15,7 @@
 #include "tiny_dnn/core/kernels/conv2d_op.h"
 #include "tiny_dnn/core/kernels/conv2d_op_libdnn.h"
 #include "tiny_dnn/core/kernels/conv2d_op_opencl.h"
+#include "tiny_dnn/core/kernels/conv2d_op_sparse.h"
 
 #include "tiny_dnn/util/util.h"
 
@@ -219,7 +220,12 @@ class convolutional_layer : public layer {
                       serial_size_t w_stride = 1,
                       serial_size_t h_stride = 1,
                       backend_t backend_type = core::default_engine())
-    : layer(std_input_order(has_bias), {vector_type::data}) {
+    : layer(std_input_order(has_bias), {vector_type::data}),
+      storage_(weight_storage::dense),
+      sparse_threshold_(0),
+      sparse_dirty_(true),
+      dense_released_(false),
+      phase_(net_phase::test) {
     conv_set_params(shape3d(in_width, in_height, in_channels), window_width,
                     window_height, out_channels, pad_type, has_bias, w_stride,
                     h_stride, connection_table);
@@ -234,7 +240,13 @@ class convolutional_layer : public layer {
       padding_op_(std::move(other.padding_op_)),
       kernel_fwd_(std::move(other.kernel_fwd_)),
       kernel_back_(std::move(other.kernel_back_)),
-      cws_(std::move(other.cws_)) {
+      cws_(std::move(other.cws_)),
+      storage_(other.storage_),
+      sparse_threshold_(other.sparse_threshold_),
+      sparse_W_(std::move(other.sparse_W_)),
+      sparse_dirty_(other.sparse_dirty_),
+      dense_released_(other.dense_released_),
+      phase_(other.phase_) {
     init_backend(std::move(other.engine()));
   }
 
@@ -249,6 +261,15 @@ class convolutional_layer : public layer {
            (params_.weight.height_ / params_.h_stride) * params_.out.depth_;
   }
 
+  uint64_t forward_flops() const override {
+    return 2 * macs() + (params_.has_bias ? params_.out.size() : 0);
+  }
+
+  ///< input gradient and weight gradient cost a forward pass each
+  uint64_t backward_flops() const override {
+    return 4 * macs() + (params_.has_bias ? params_.out.size() : 0);
+  }
+
   /**
    * @param in_data      input vectors of this layer (data, weight, bias)
    * @param out_data     output vectors
@@ -262,6 +283,15 @@ class convolutional_layer : public layer {
     std::copy(in_data.begin(), in_data.end(), fwd_in_data_.begin());
     fwd_in_data_[0] = in_data_padded(in_data);
 
+    if (storage_ == weight_storage::sparse && phase_ == net_phase::test) {
+      static const vec_t no_bias;
+      const vec_t &bias = params_.has_bias ? (*in_data[2])[0] : no_bias;
+      kernels::conv2d_op_sparse(*fwd_in_data_[0], sparse_weights(), bias,
+                                *out_data[0], params_, layer::parallelize());
+      return;
+    }
+    restore_dense();
+
     // forward convolutional op context
     fwd_ctx_.set_in_out(fwd_in_data_, out_data);
     fwd_ctx_.setParallelize(layer::parallelize());
@@ -330,6 +360,64 @@ class convolutional_layer : public layer {
 
   std::string layer_type() const override { return std::string("conv"); }
 
+  void post_update() override { sparse_dirty_ = true; }
+
+  void set_context(net_phase ctx) override { phase_ = ctx; }
+
+  /**
+   * select how the filters are applied at inference time.
+   * With weight_storage::sparse the filters are kept additionally as an
+   * out_depth x (in_depth * kh * kw) blocked CSR matrix and the test phase
+   * runs im2col + sparse GEMM, lowering only the input taps that meet a
+   * stored weight. SIMD runs along the output pixels here, so tiles are a
+   * single weight wide. Training always uses the dense filters; the sparse
+   * copy is rebuilt after each weight update. Call this again after editing
+   * the weights directly.
+   *
+   * With keep_dense = false the dense filters are freed once the sparse
+   * copy exists; the first training pass (or a later call of this
+   * function) expands them back, with the dropped taps set to 0.
+   *
+   * @param storage    [in] dense or sparse
+   * @param threshold  [in] weights with |w| <= threshold are treated as zero
+   * @param keep_dense [in] false frees the dense filters (sparse only)
+   **/
+  void set_weight_storage(weight_storage storage,
+                          float_t threshold = float_t(0),
+                          bool keep_dense   = true) {
+    if (storage == weight_storage::codebook)
+      throw nn_error("codebook storage is not supported by convolution");
+    restore_dense();
+    storage_          = storage;
+    sparse_threshold_ = threshold;
+    sparse_dirty_     = true;
+    if (storage == weight_storage::sparse && !keep_dense) release_dense();
+  }
+
+  weight_storage get_weight_storage() const { return storage_; }
+
+  ///< true while only the sparse copy of the filters is kept
+  bool dense_released() const { return dense_released_; }
+
+  ///< filters in blocked CSR form, unconnected channels dropped
+  const block_sparse_matrix &sparse_weights() {
+    if (sparse_dirty_ && !dense_released_) {
+      const serial_size_t id   = params_.in.depth_;
+      const serial_size_t taps = params_.weight.area();
+      vec_t w                  = *weights()[0];
+      for (serial_size_t o = 0; o < params_.out.depth_; o++) {
+        for (serial_size_t inc = 0; inc < id; inc++) {
+          if (params_.tbl.is_connected(o, inc)) continue;
+          std::fill_n(&w[(o * id + inc) * taps], taps, float_t(0));
+        }
+      }
+      sparse_W_.assign(&w[0], params_.out.depth_, id * taps, 1,
+                       sparse_threshold_);
+      sparse_dirty_ = false;
+    }
+    return sparse_W_;
+  }
+
   // TODO(edgar): check this
   std::string kernel_file() const override {
     return std::string(
@@ -393,8 +481,19 @@ class convolutional_layer : public layer {
 #endif  // DNN_USE_IMAGE_API
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
+  friend class c_code_generator;
+  friend class quantization_exporter;
+  friend class packed_model_io;
 
  private:
+  ///< multiply-adds of one sample, honoring the connection table
+  uint64_t macs() const {
+    return static_cast<uint64_t>(params_.out.width_) * params_.out.height_ *
+           params_.weight.width_ * params_.weight.height_ *
+           params_.tbl.connections(params_.in.depth_, params_.out.depth_);
+  }
+
   tensor_t *in_data_padded(const std::vector<tensor_t *> &in) {
     return (params_.pad_type == padding::valid) ? in[0]
                                                 : &cws_.prev_out_padded_;
@@ -468,7 +567,8 @@ class convolutional_layer : public layer {
       core::OpKernelConstruction(layer::device(), &params_);
 
     if (backend_type == backend_t::internal ||
-        backend_type == backend_t::nnpack || backend_type == backend_t::avx) {
+        backend_type == backend_t::nnpack || backend_type == backend_t::avx ||
+        backend_type == backend_t::fft) {
       kernel_fwd_.reset(new Conv2dOp(ctx));
       kernel_back_.reset(new Conv2dGradOp(ctx));
       return;
@@ -487,6 +587,18 @@ class convolutional_layer : public layer {
     }
   }
 
+  void release_dense() {
+    sparse_weights();
+    vec_t().swap(*weights()[0]);
+    dense_released_ = true;
+  }
+
+  void restore_dense() {
+    if (!dense_released_) return;
+    *weights()[0]   = sparse_W_.to_dense();
+    dense_released_ = false;
+  }
+
  private:
   /* The convolution parameters */
   conv_params params_;
@@ -513,6 +625,14 @@ class convolutional_layer : public layer {
     tensor_t prev_out_padded_;
     tensor_t prev_delta_padded_;
   } cws_;
+
+  /* Inference-time weight representation */
+  weight_storage storage_;
+  float_t sparse_threshold_;
+  block_sparse_matrix sparse_W_;
+  bool sparse_dirty_;
+  bool dense_released_;
+  net_phase phase_;
 };
 
 }  // namespace tiny_dnn
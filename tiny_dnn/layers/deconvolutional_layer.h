@@ -226,6 +226,15 @@ class deconvolutional_layer : public layer {
            (params_.weight.height_ * params_.h_stride) * params_.out.depth_;
   }
 
+  uint64_t forward_flops() const override {
+    return 2 * macs() + (params_.has_bias ? params_.out_unpadded.size() : 0);
+  }
+
+  ///< input gradient and weight gradient cost a forward pass each
+  uint64_t backward_flops() const override {
+    return 4 * macs() + (params_.has_bias ? params_.out_unpadded.size() : 0);
+  }
+
   void forward_propagation(const std::vector<tensor_t *> &in_data,
                            std::vector<tensor_t *> &out_data) override {
     // launch deconvolutional kernel
@@ -307,8 +316,16 @@ class deconvolutional_layer : public layer {
 #endif  // DNN_USE_IMAGE_API
 
   friend struct serialization_buddy;
+  friend class packed_model_io;
 
  private:
+  ///< multiply-adds of one sample, honoring the connection table
+  uint64_t macs() const {
+    return static_cast<uint64_t>(params_.in.width_) * params_.in.height_ *
+           params_.weight.width_ * params_.weight.height_ *
+           params_.tbl.connections(params_.in.depth_, params_.out.depth_);
+  }
+
   void init_backend(const backend_t backend_type) {
     std::shared_ptr<core::backend> backend = nullptr;
 
@@ -133,6 +133,7 @@ class dropout_layer : public layer {
   }
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
 
  private:
   net_phase phase_;
@@ -0,0 +1,228 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/core/kernels/tiny_quantization_kernel.h"
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * how a fake_quantization_layer tracks the range of its input
+ **/
+enum class fake_quantization_mode {
+  ema,     ///< exponential moving average of the batch min/max
+  learned  ///< [min, max] is a trainable parameter
+};
+
+/**
+ * simulated uint8 quantization of activations (quantization-aware training)
+ *
+ * Rounds its input to the 256 levels the quantized kernels use over
+ * [min, max] while staying in float, so the network learns to tolerate the
+ * rounding. The backward pass is a straight-through estimator that passes
+ * the gradient inside the range and blocks it outside. The range always
+ * contains zero, and is initialized from the first training batch.
+ *
+ * Place one in front of each layer that will be exported to its
+ * quantized_* counterpart; see quantization_exporter.
+ **/
+class fake_quantization_layer : public layer {
+ public:
+  typedef layer Base;
+
+  /**
+   * @param in_shape [in] shape of the input (and output) data
+   * @param mode     [in] how the range is tracked
+   * @param momentum [in] momentum of the moving average (ema mode only)
+   * @param phase    [in] specify the current context (train/test)
+   **/
+  explicit fake_quantization_layer(
+    const shape3d &in_shape,
+    fake_quantization_mode mode = fake_quantization_mode::ema,
+    float_t momentum            = float_t(0.99),
+    net_phase phase             = net_phase::train)
+    : Base({vector_type::data, vector_type::weight}, {vector_type::data}),
+      in_shape_(in_shape),
+      mode_(mode),
+      momentum_(momentum),
+      phase_(phase) {
+    init();
+  }
+
+  /**
+   * @param in_size  [in] number of elements of the input
+   * @param mode     [in] how the range is tracked
+   * @param momentum [in] momentum of the moving average (ema mode only)
+   * @param phase    [in] specify the current context (train/test)
+   **/
+  explicit fake_quantization_layer(
+    serial_size_t in_size,
+    fake_quantization_mode mode = fake_quantization_mode::ema,
+    float_t momentum            = float_t(0.99),
+    net_phase phase             = net_phase::train)
+    : fake_quantization_layer(shape3d(in_size, 1, 1), mode, momentum, phase) {
+  }
+
+  serial_size_t fan_in_size() const override { return 1; }
+
+  serial_size_t fan_out_size() const override { return 1; }
+
+  ///< clamp, scale, round and rescale each element
+  uint64_t forward_flops() const override {
+    return 4 * static_cast<uint64_t>(in_shape_.size());
+  }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    return {in_shape_, index3d<serial_size_t>(2, 1, 1)};
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {in_shape_};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    const tensor_t &in = *in_data[0];
+    tensor_t &out      = *out_data[0];
+    vec_t &range       = (*in_data[1])[0];
+
+    if (phase_ == net_phase::train) {
+      float_t batch_min = in[0][0], batch_max = in[0][0];
+      for (const auto &sample : in) {
+        auto mm   = std::minmax_element(sample.begin(), sample.end());
+        batch_min = std::min(batch_min, *mm.first);
+        batch_max = std::max(batch_max, *mm.second);
+      }
+      if (!initialized(range)) {
+        range[0] = batch_min;
+        range[1] = batch_max;
+      } else if (mode_ == fake_quantization_mode::ema) {
+        range[0] = momentum_ * range[0] + (1 - momentum_) * batch_min;
+        range[1] = momentum_ * range[1] + (1 - momentum_) * batch_max;
+      }
+    }
+
+    if (!initialized(range)) {
+      out = in;
+      return;
+    }
+
+    float_t min_v, max_v;
+    nudged_range(range, &min_v, &max_v);
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      core::kernels::fake_quantize(in[sample], min_v, max_v, out[sample]);
+    });
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    const tensor_t &x  = *in_data[0];
+    const tensor_t &dy = *out_grad[0];
+    tensor_t &dx       = *in_grad[0];
+    tensor_t &drange   = *in_grad[1];
+    const vec_t &range = (*in_data[1])[0];
+
+    if (!initialized(range)) {
+      dx = dy;
+      return;
+    }
+
+    float_t min_v, max_v;
+    nudged_range(range, &min_v, &max_v);
+    const bool learned = mode_ == fake_quantization_mode::learned;
+
+    tiny_dnn::for_i(parallelize_, x.size(), [&](int sample) {
+      const vec_t &xs  = x[sample];
+      const vec_t &dys = dy[sample];
+      vec_t &dxs       = dx[sample];
+      float_t dmin = 0, dmax = 0;
+      for (size_t i = 0; i < xs.size(); i++) {
+        if (xs[i] < min_v) {
+          dxs[i] = float_t(0);
+          dmin += dys[i];
+        } else if (xs[i] > max_v) {
+          dxs[i] = float_t(0);
+          dmax += dys[i];
+        } else {
+          dxs[i] = dys[i];
+        }
+      }
+      if (learned) {
+        drange[sample][0] += dmin;
+        drange[sample][1] += dmax;
+      }
+    });
+  }
+
+  void set_context(net_phase ctx) override { phase_ = ctx; }
+
+  std::string layer_type() const override { return "fake-quantization"; }
+
+  fake_quantization_mode mode() const { return mode_; }
+
+  float_t momentum() const { return momentum_; }
+
+  ///< false until the first training batch has been seen
+  bool range_initialized() const { return initialized(*weights()[0]); }
+
+  ///< lower end of the range the input is quantized over
+  float_t range_min() const {
+    float_t min_v, max_v;
+    nudged_range(*weights()[0], &min_v, &max_v);
+    return min_v;
+  }
+
+  ///< upper end of the range the input is quantized over
+  float_t range_max() const {
+    float_t min_v, max_v;
+    nudged_range(*weights()[0], &min_v, &max_v);
+    return max_v;
+  }
+
+  void set_range(float_t min_v, float_t max_v) {
+    if (min_v > max_v) throw nn_error("invalid quantization range");
+    vec_t &range = *weights()[0];
+    range[0]     = min_v;
+    range[1]     = max_v;
+    initialized_ = true;
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  void init() {
+    // a zero-width range marks it as not yet observed
+    Base::weight_init(weight_init::constant(0));
+    if (mode_ == fake_quantization_mode::ema) set_trainable(false);
+  }
+
+  static bool initialized(const vec_t &range) { return range[0] != range[1]; }
+
+  // the range always covers zero, the value of relu cut-offs and padding
+  static void nudged_range(const vec_t &range, float_t *min_v, float_t *max_v) {
+    *min_v = std::min(range[0], float_t(0));
+    *max_v = std::max(range[1], float_t(0));
+    if (*min_v == *max_v) *max_v = *min_v + float_t(1e-3);
+  }
+
+  shape3d in_shape_;
+  fake_quantization_mode mode_;
+  float_t momentum_;
+  net_phase phase_;
+};
+
+}  // namespace tiny_dnn
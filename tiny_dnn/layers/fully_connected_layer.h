@@ -10,6 +10,8 @@
 
 #include "tiny_dnn/core/kernels/fully_connected_grad_op.h"
 #include "tiny_dnn/core/kernels/fully_connected_op.h"
+#include "tiny_dnn/core/kernels/fully_connected_op_codebook.h"
+#include "tiny_dnn/core/kernels/fully_connected_op_sparse.h"
 
 namespace tiny_dnn {
 
@@ -27,7 +29,12 @@ class fully_connected_layer : public layer {
                         serial_size_t out_dim,
                         bool has_bias          = true,
                         backend_t backend_type = core::default_engine())
-    : layer(std_input_order(has_bias), {vector_type::data}) {
+    : layer(std_input_order(has_bias), {vector_type::data}),
+      storage_(weight_storage::dense),
+      sparse_threshold_(0),
+      sparse_dirty_(true),
+      dense_released_(false),
+      phase_(net_phase::test) {
     set_params(in_dim, out_dim, has_bias);
     init_backend(backend_type);
     layer::set_backend_type(backend_type);
@@ -38,7 +45,14 @@ class fully_connected_layer : public layer {
     : layer(std::move(other)),
       params_(std::move(other.params_)),
       kernel_fwd_(std::move(other.kernel_fwd_)),
-      kernel_back_(std::move(other.kernel_back_)) {
+      kernel_back_(std::move(other.kernel_back_)),
+      storage_(other.storage_),
+      sparse_threshold_(other.sparse_threshold_),
+      sparse_W_(std::move(other.sparse_W_)),
+      sparse_dirty_(other.sparse_dirty_),
+      dense_released_(other.dense_released_),
+      codebook_W_(std::move(other.codebook_W_)),
+      phase_(other.phase_) {
     init_backend(std::move(other.engine()));
   }
 
@@ -46,6 +60,17 @@ class fully_connected_layer : public layer {
 
   serial_size_t fan_out_size() const override { return params_.out_size_; }
 
+  uint64_t forward_flops() const override {
+    return 2 * static_cast<uint64_t>(params_.in_size_) * params_.out_size_ +
+           (params_.has_bias_ ? params_.out_size_ : 0);
+  }
+
+  ///< input gradient and weight gradient cost a forward pass each
+  uint64_t backward_flops() const override {
+    return 4 * static_cast<uint64_t>(params_.in_size_) * params_.out_size_ +
+           (params_.has_bias_ ? params_.out_size_ : 0);
+  }
+
   std::vector<index3d<serial_size_t>> in_shape() const override {
     if (params_.has_bias_) {
       return {index3d<serial_size_t>(params_.in_size_, 1, 1),
@@ -63,6 +88,24 @@ class fully_connected_layer : public layer {
 
   void forward_propagation(const std::vector<tensor_t *> &in_data,
                            std::vector<tensor_t *> &out_data) override {
+    if (storage_ == weight_storage::sparse && phase_ == net_phase::test) {
+      static const vec_t no_bias;
+      const vec_t &bias = params_.has_bias_ ? (*in_data[2])[0] : no_bias;
+      kernels::fully_connected_op_sparse(*in_data[0], sparse_weights(), bias,
+                                         *out_data[0], params_,
+                                         layer::parallelize());
+      return;
+    }
+    if (storage_ == weight_storage::codebook && phase_ == net_phase::test) {
+      static const vec_t no_bias;
+      const vec_t &bias = params_.has_bias_ ? (*in_data[2])[0] : no_bias;
+      kernels::fully_connected_op_codebook(*in_data[0], codebook_W_, bias,
+                                           *out_data[0], params_,
+                                           layer::parallelize());
+      return;
+    }
+    restore_dense();
+
     // forward fully connected op context
     fwd_ctx_.set_in_out(in_data, out_data);
     fwd_ctx_.setParallelize(layer::parallelize());
@@ -85,9 +128,94 @@ class fully_connected_layer : public layer {
     kernel_back_->compute(bwd_ctx_);
   }
 
+  void post_update() override {
+    sparse_dirty_ = true;
+    // the indices no longer describe the updated weights
+    if (storage_ == weight_storage::codebook) {
+      storage_    = weight_storage::dense;
+      codebook_W_ = codebook_matrix();
+    }
+  }
+
+  void set_context(net_phase ctx) override { phase_ = ctx; }
+
+  /**
+   * select how the weights are multiplied at inference time.
+   * With weight_storage::sparse the weight matrix is kept additionally in
+   * blocked CSR form with tiles as wide as a SIMD register, and the test
+   * phase skips every tile that is entirely zero. Training always uses the
+   * dense weights; the sparse copy is rebuilt after each weight update.
+   * Call this again after editing the weights directly.
+   * weight_storage::codebook is selected by set_codebook_weights.
+   *
+   * A network that only runs inference can drop the dense weights with
+   * keep_dense = false: weights()[0] is then empty, and the first
+   * training pass (or a later call of this function) expands the sparse
+   * copy back, with the weights treated as zero set to 0.
+   *
+   * @param storage    [in] dense or sparse
+   * @param threshold  [in] weights with |w| <= threshold are treated as zero
+   * @param keep_dense [in] false frees the dense weights (sparse only)
+   **/
+  void set_weight_storage(weight_storage storage,
+                          float_t threshold = float_t(0),
+                          bool keep_dense   = true) {
+    if (storage == weight_storage::codebook)
+      throw nn_error("use set_codebook_weights to select codebook storage");
+    restore_dense();
+    storage_          = storage;
+    codebook_W_       = codebook_matrix();
+    sparse_threshold_ = threshold;
+    sparse_dirty_     = true;
+    if (storage == weight_storage::sparse && !keep_dense) release_dense();
+  }
+
+  weight_storage get_weight_storage() const { return storage_; }
+
+  ///< true while only the sparse copy of the weights is kept
+  bool dense_released() const { return dense_released_; }
+
+  ///< weights in blocked CSR form (in_size rows, out_size columns)
+  const block_sparse_matrix &sparse_weights() {
+    if (sparse_dirty_ && !dense_released_) {
+      sparse_W_.assign(&(*weights()[0])[0], params_.in_size_,
+                       params_.out_size_,
+                       static_cast<serial_size_t>(vectorize::simd_width()),
+                       sparse_threshold_);
+      sparse_dirty_ = false;
+    }
+    return sparse_W_;
+  }
+
+  /**
+   * replace the weights by shared values and select
+   * weight_storage::codebook: the test phase then multiplies with the
+   * indices directly (see kernels::fully_connected_op_codebook), while the
+   * dense weights are set to the decoded values for training. The first
+   * weight update switches the layer back to weight_storage::dense.
+   *
+   * @param codebook [in] at most 256 shared values
+   * @param indices  [in] one index per weight, in the order of weights()[0]
+   **/
+  void set_codebook_weights(const std::vector<float_t> &codebook,
+                            const std::vector<uint8_t> &indices) {
+    restore_dense();
+    codebook_W_.assign(codebook, indices, params_.in_size_, params_.out_size_);
+    vec_t &w = *weights()[0];
+    for (size_t i = 0; i < w.size(); i++) w[i] = codebook[indices[i]];
+    storage_      = weight_storage::codebook;
+    sparse_dirty_ = true;
+  }
+
+  ///< weights as codebook indices, empty unless storage is codebook
+  const codebook_matrix &codebook_weights() const { return codebook_W_; }
+
   std::string layer_type() const override { return "fully-connected"; }
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
+  friend class c_code_generator;
+  friend class quantization_exporter;
 
  protected:
   void set_params(const serial_size_t in_size,
@@ -111,6 +239,18 @@ class fully_connected_layer : public layer {
     }
   }
 
+  void release_dense() {
+    sparse_weights();
+    vec_t().swap(*weights()[0]);
+    dense_released_ = true;
+  }
+
+  void restore_dense() {
+    if (!dense_released_) return;
+    *weights()[0]   = sparse_W_.to_dense();
+    dense_released_ = false;
+  }
+
  private:
   /* The layer parameters */
   fully_params params_;
@@ -124,6 +264,15 @@ class fully_connected_layer : public layer {
   /* Forward and backward ops */
   std::shared_ptr<core::OpKernel> kernel_fwd_;
   std::shared_ptr<core::OpKernel> kernel_back_;
+
+  /* Inference-time weight representation */
+  weight_storage storage_;
+  float_t sparse_threshold_;
+  block_sparse_matrix sparse_W_;
+  bool sparse_dirty_;
+  bool dense_released_;
+  codebook_matrix codebook_W_;
+  net_phase phase_;
 };
 
 }  // namespace tiny_dnn
@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/core/kernels/global_avepool_op_internal.h"
+#include "tiny_dnn/layers/layer.h"
+
+namespace tiny_dnn {
+
+/**
+ * global average pooling fused with a fully-connected classifier.
+ *
+ * Computes the same as global_average_pooling_layer followed by
+ * fully_connected_layer(channels, out_dim), reading the feature map once
+ * and never materializing the pooled vector. The weights have the layout
+ * of that fully_connected_layer's, so they can be copied over as is.
+ **/
+class global_average_pooling_fc_layer : public layer {
+ public:
+  global_average_pooling_fc_layer(const shape3d &in_shape,
+                                  serial_size_t out_dim,
+                                  bool has_bias = true)
+    : global_average_pooling_fc_layer(in_shape.width_,
+                                      in_shape.height_,
+                                      in_shape.depth_,
+                                      out_dim,
+                                      has_bias) {}
+
+  /**
+   * @param in_width    [in] width of input image
+   * @param in_height   [in] height of input image
+   * @param in_channels [in] the number of input image channels (depth)
+   * @param out_dim     [in] number of elements of the output
+   * @param has_bias    [in] whether to include additional bias to the layer
+   **/
+  global_average_pooling_fc_layer(serial_size_t in_width,
+                                  serial_size_t in_height,
+                                  serial_size_t in_channels,
+                                  serial_size_t out_dim,
+                                  bool has_bias = true)
+    : layer(std_input_order(has_bias), {vector_type::data}),
+      in_(in_width, in_height, in_channels),
+      out_size_(out_dim),
+      has_bias_(has_bias) {}
+
+  serial_size_t fan_in_size() const override { return in_.depth_; }
+
+  serial_size_t fan_out_size() const override { return out_size_; }
+
+  uint64_t forward_flops() const override {
+    return in_.size() + 2 * static_cast<uint64_t>(in_.depth_) * out_size_ +
+           (has_bias_ ? out_size_ : 0);
+  }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    if (has_bias_) {
+      return {in_, index3d<serial_size_t>(in_.depth_, out_size_, 1),
+              index3d<serial_size_t>(out_size_, 1, 1)};
+    } else {
+      return {in_, index3d<serial_size_t>(in_.depth_, out_size_, 1)};
+    }
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {index3d<serial_size_t>(out_size_, 1, 1)};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    static const vec_t no_bias;
+    const vec_t &bias = has_bias_ ? (*in_data[2])[0] : no_bias;
+    kernels::global_avepool_fc_op_internal(*in_data[0], (*in_data[1])[0],
+                                           bias, *out_data[0], in_,
+                                           out_size_, layer::parallelize());
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    kernels::global_avepool_fc_grad_op_internal(
+      *in_data[0], (*in_data[1])[0], *in_grad[1],
+      has_bias_ ? in_grad[2] : nullptr, *out_grad[0], *in_grad[0], in_,
+      out_size_, layer::parallelize());
+  }
+
+  std::string layer_type() const override {
+    return std::string("global-ave-pool-fc");
+  }
+
+  std::pair<serial_size_t, serial_size_t> pool_size() const {
+    return std::make_pair(in_.width_, in_.height_);
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  shape3d in_;
+  serial_size_t out_size_;
+  bool has_bias_;
+};
+
+}  // namespace tiny_dnn
@@ -57,6 +57,10 @@ class global_average_pooling_layer : public layer {
 
   serial_size_t fan_out_size() const override { return 1; }
 
+  uint64_t forward_flops() const override {
+    return params_.in.size() + params_.out.size();
+  }
+
   void forward_propagation(const std::vector<tensor_t *> &in_data,
                            std::vector<tensor_t *> &out_data) override {
     fwd_ctx_.set_in_out(in_data, out_data);
@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/layers/recurrent_layer.h"
+
+namespace tiny_dnn {
+
+/**
+ * gated recurrent unit layer.
+ *
+ * The three gates of a step are laid out [update, reset, candidate]:
+ *
+ *     z, r = sigmoid(x W + h U + b)
+ *     n = tanh(x W_n + b_n + r * (h U_n + b_hn)),  h' = (1 - z) * n + z * h
+ *
+ * The reset gate is applied after the recurrent product, so that h U of
+ * all three gates is one product per step. b_hn is the separate recurrent
+ * bias of the candidate.
+ **/
+class gru_layer : public recurrent_layer {
+ public:
+  /**
+   * @param in_dim           [in] number of elements of each step's input
+   * @param hidden_size      [in] number of elements of the hidden state
+   * @param seq_len          [in] number of steps of each sample
+   * @param return_sequences [in] output every step, or only the last one
+   * @param bptt_steps       [in] truncation length of backpropagation
+   *                              through time (0: the whole sequence)
+   **/
+  gru_layer(serial_size_t in_dim,
+            serial_size_t hidden_size,
+            serial_size_t seq_len,
+            bool return_sequences    = true,
+            serial_size_t bptt_steps = 0)
+    : recurrent_layer({vector_type::data, vector_type::weight,
+                       vector_type::weight, vector_type::bias,
+                       vector_type::bias},
+                      in_dim,
+                      hidden_size,
+                      seq_len,
+                      3,
+                      return_sequences,
+                      bptt_steps) {}
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    return {index3d<serial_size_t>(in_size_, seq_len_, 1),
+            index3d<serial_size_t>(in_size_, gate_width(), 1),
+            index3d<serial_size_t>(hidden_size_, gate_width(), 1),
+            index3d<serial_size_t>(gate_width(), 1, 1),
+            index3d<serial_size_t>(hidden_size_, 1, 1)};
+  }
+
+  std::string layer_type() const override { return "gru"; }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    const tensor_t &in    = *in_data[0];
+    const vec_t &W        = (*in_data[1])[0];
+    const vec_t &U        = (*in_data[2])[0];
+    const vec_t &b        = (*in_data[3])[0];
+    const vec_t &bn       = (*in_data[4])[0];
+    tensor_t &out         = *out_data[0];
+    const size_t batch    = in.size();
+    const serial_size_t H = hidden_size_, G = gate_width();
+
+    gate_acts_.resize(batch);
+    hn_.resize(batch);
+    hidden_.resize(batch);
+    for_i(batch, [&](int s) {
+      input_projection(in[s], W, b, &gate_acts_[s]);
+      hn_[s].resize(seq_len_ * H);
+      hidden_[s].resize(seq_len_ * H);
+    });
+
+    const bool step_parallel = parallelize_steps(batch);
+    vec_t h(batch * H, float_t(0)), a(batch * G);
+    for (serial_size_t t = 0; t < seq_len_; t++) {
+      for_(step_parallel, 0, batch, [&](const blocked_range &r) {
+        const size_t s0 = r.begin(), rows = r.end() - r.begin();
+        std::fill(&a[s0 * G], &a[s0 * G] + rows * G, float_t(0));
+        gemm_nn(rows, G, H, &h[s0 * H], &U[0], &a[s0 * G]);
+
+        for (size_t s = r.begin(); s < r.end(); s++) {
+          float_t *g        = &gate_acts_[s][t * G];
+          const float_t *hu = &a[s * G];
+          float_t *hn       = &hn_[s][t * H];
+          float_t *hs       = &h[s * H];
+
+          vectorize::add(hu, 2 * H, g);
+          sigmoid_block(g, 2 * H);
+          for (serial_size_t j = 0; j < H; j++) {
+            hn[j] = hu[2 * H + j] + bn[j];
+            g[2 * H + j] += g[H + j] * hn[j];
+          }
+          tanh_block(g + 2 * H, H);
+          for (serial_size_t j = 0; j < H; j++) {
+            hs[j] = (1 - g[j]) * g[2 * H + j] + g[j] * hs[j];
+          }
+          std::copy(hs, hs + H, &hidden_[s][t * H]);
+          if (float_t *y = output(out[s], t)) std::copy(hs, hs + H, y);
+        }
+      });
+    }
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    const tensor_t &in    = *in_data[0];
+    const vec_t &W        = (*in_data[1])[0];
+    const vec_t &U        = (*in_data[2])[0];
+    const tensor_t &dy    = *out_grad[0];
+    tensor_t &dx          = *in_grad[0];
+    tensor_t &dW          = *in_grad[1];
+    tensor_t &dU          = *in_grad[2];
+    tensor_t &db          = *in_grad[3];
+    tensor_t &dbn         = *in_grad[4];
+    const size_t batch    = in.size();
+    const serial_size_t H = hidden_size_, G = gate_width();
+
+    const bool step_parallel = parallelize_steps(batch);
+    // gradients of the input and of the recurrent pre-activations; they
+    // differ in the candidate, which the reset gate scales
+    std::vector<vec_t> dP(batch, vec_t(seq_len_ * G));
+    std::vector<vec_t> dR(batch, vec_t(seq_len_ * G));
+    vec_t dh(batch * H, float_t(0)), hp_grad(batch * H), da(batch * G);
+
+    for (serial_size_t t = seq_len_; t-- > 0;) {
+      for_(step_parallel, 0, batch, [&](const blocked_range &r) {
+        for (size_t s = r.begin(); s < r.end(); s++) {
+          const float_t *g    = &gate_acts_[s][t * G];
+          const float_t *hn   = &hn_[s][t * H];
+          const float_t *hp   = t > 0 ? &hidden_[s][(t - 1) * H] : nullptr;
+          const float_t *dy_t = output_grad(dy[s], t);
+          float_t *dp = &dP[s][t * G], *dr = &da[s * G];
+          float_t *dhs = &dh[s * H], *dhp = &hp_grad[s * H];
+
+          for (serial_size_t j = 0; j < H; j++) {
+            const float_t z = g[j], rs = g[H + j], n = g[2 * H + j];
+            const float_t gh = dhs[j] + (dy_t ? dy_t[j] : float_t(0));
+            const float_t h0 = hp ? hp[j] : float_t(0);
+            const float_t dn = gh * (1 - z) * (1 - n * n);
+            dp[j]            = gh * (h0 - n) * z * (1 - z);
+            dp[H + j]        = dn * hn[j] * rs * (1 - rs);
+            dp[2 * H + j]    = dn;
+            dr[j]            = dp[j];
+            dr[H + j]        = dp[H + j];
+            dr[2 * H + j]    = dn * rs;
+            dhp[j]           = gh * z;
+          }
+          vectorize::add(dr + 2 * H, H, &dbn[s][0]);
+          std::copy(dr, dr + G, &dR[s][t * G]);
+        }
+
+        const size_t s0 = r.begin(), rows = r.end() - r.begin();
+        if (t == 0 || truncated(t)) {
+          std::fill(&dh[s0 * H], &dh[s0 * H] + rows * H, float_t(0));
+          return;
+        }
+        std::copy(&hp_grad[s0 * H], &hp_grad[s0 * H] + rows * H, &dh[s0 * H]);
+        gemm_nt(rows, H, G, &da[s0 * G], &U[0], &dh[s0 * H]);
+      });
+    }
+
+    for_i(batch, [&](int s) {
+      // hidden state entering each step
+      vec_t hp(seq_len_ * H, float_t(0));
+      std::copy(hidden_[s].begin(), hidden_[s].end() - H, hp.begin() + H);
+      gemm_tn(H, G, seq_len_, &hp[0], &dR[s][0], &dU[s][0]);
+      input_projection_grad(in[s], W, dP[s], &dx[s], &dW[s], &db[s]);
+    });
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  std::vector<vec_t> gate_acts_;  // activated gates of every step
+  std::vector<vec_t> hn_;         // h U_n + b_hn of every step
+  std::vector<vec_t> hidden_;     // hidden state after every step
+};
+
+}  // namespace tiny_dnn
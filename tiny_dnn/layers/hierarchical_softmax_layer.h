@@ -0,0 +1,388 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tiny_dnn/core/framework/row_sparse_gradient.h"
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/lossfunctions/loss_function.h"
+#include "tiny_dnn/util/product.h"
+
+namespace tiny_dnn {
+
+/**
+ * two-level softmax over clusters of classes.
+ *
+ * The classes are split into contiguous clusters. A head softmax picks the
+ * cluster and a tail softmax picks the class within it, so that
+ * p(c) = p(cluster(c)) * p(c | cluster(c)). In the test phase all classes
+ * are evaluated. In the train phase the forward pass evaluates only the
+ * head and outputs p(cluster) at the first class of each cluster, zero
+ * elsewhere; back_propagation adds the tail of the true class's cluster
+ * once the label is known. Trained with class_nll on labels, the network
+ * hands the labels over directly (set_class_targets) instead of a one-hot
+ * gradient. The tail gradient is kept for that cluster's rows only and
+ * applied with optimizer::update_rows, so a step costs
+ * O((clusters + cluster size) * in_dim) per sample. With the default
+ * sqrt(n_classes) clusters of equal size this is O(sqrt(n_classes)).
+ * Sorting the classes by frequency and giving cluster_ends a small first
+ * cluster makes frequent classes cheap, as in adaptive softmax. Train it
+ * with class_nll.
+ *
+ * Weights are stored one row of in_dim per cluster (head) and per class
+ * (tail).
+ **/
+class hierarchical_softmax_layer : public layer {
+ public:
+  /**
+   * @param in_dim       [in] number of elements of the input
+   * @param n_classes    [in] number of classes (elements of the output)
+   * @param cluster_ends [in] one past the last class of each cluster,
+   *                          ascending and ending at n_classes;
+   *                          empty for ceil(sqrt(n_classes)) equal clusters
+   **/
+  hierarchical_softmax_layer(
+    serial_size_t in_dim,
+    serial_size_t n_classes,
+    const std::vector<serial_size_t> &cluster_ends = {})
+    : layer({vector_type::data, vector_type::weight, vector_type::bias,
+             vector_type::weight, vector_type::bias},
+            {vector_type::data}),
+      in_size_(in_dim),
+      n_classes_(n_classes),
+      cluster_ends_(cluster_ends),
+      head_cached_(false),
+      out_clean_(false),
+      sparse_grads_(false),
+      phase_(net_phase::test) {
+    if (cluster_ends_.empty()) {
+      const serial_size_t n = static_cast<serial_size_t>(
+        std::ceil(std::sqrt(static_cast<double>(n_classes))));
+      const serial_size_t width = (n_classes + n - 1) / n;
+      for (serial_size_t end = width; end < n_classes; end += width) {
+        cluster_ends_.push_back(end);
+      }
+      cluster_ends_.push_back(n_classes);
+    }
+    serial_size_t prev = 0;
+    for (auto end : cluster_ends_) {
+      if (end <= prev) throw nn_error("cluster_ends must be ascending");
+      prev = end;
+    }
+    if (prev != n_classes) {
+      throw nn_error("the last cluster must end at n_classes");
+    }
+    cluster_of_.resize(n_classes);
+    for (serial_size_t k = 0; k < clusters(); k++) {
+      for (serial_size_t c = cluster_begin(k); c < cluster_ends_[k]; c++) {
+        cluster_of_[c] = k;
+      }
+    }
+  }
+
+  serial_size_t fan_in_size() const override { return in_size_; }
+
+  serial_size_t fan_out_size() const override { return n_classes_; }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    return {index3d<serial_size_t>(in_size_, 1, 1),
+            index3d<serial_size_t>(in_size_, clusters(), 1),
+            index3d<serial_size_t>(clusters(), 1, 1),
+            index3d<serial_size_t>(in_size_, n_classes_, 1),
+            index3d<serial_size_t>(n_classes_, 1, 1)};
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {index3d<serial_size_t>(n_classes_, 1, 1)};
+  }
+
+  std::pair<float_t, float_t> out_value_range() const override {
+    return {float_t(0), float_t(1)};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    const tensor_t &in = *in_data[0];
+    tensor_t &out      = *out_data[0];
+
+    if (phase_ == net_phase::train) {
+      head_.resize(in.size());
+      tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+        vec_t &head = head_[sample];
+        vec_t &y    = out[sample];
+        head.resize(clusters());
+        head_softmax(in_data, in[sample], &head[0]);
+        // the other classes are still zero once the output is clean
+        if (!out_clean_) std::fill(y.begin(), y.end(), float_t(0));
+        for (serial_size_t k = 0; k < clusters(); k++) {
+          y[cluster_begin(k)] = head[k];
+        }
+      });
+      head_cached_ = true;
+      out_clean_   = true;
+      return;
+    }
+
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      const vec_t &x = in[sample];
+      vec_t &y       = out[sample];
+      vec_t head(clusters());
+      head_softmax(in_data, x, &head[0]);
+      for (serial_size_t k = 0; k < clusters(); k++) {
+        tail_softmax(in_data, x, k, &y[cluster_begin(k)]);
+        for (serial_size_t c = cluster_begin(k); c < cluster_ends_[k]; c++) {
+          y[c] *= head[k];
+        }
+      }
+    });
+    out_clean_ = false;
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    const tensor_t &in = *in_data[0];
+    const vec_t &Wh    = (*in_data[1])[0];
+    const vec_t &Wt    = (*in_data[3])[0];
+    const tensor_t &dy = *out_grad[0];
+    tensor_t &dx       = *in_grad[0];
+    tensor_t &dWh      = *in_grad[1];
+    tensor_t &dbh      = *in_grad[2];
+    tensor_t &dWt      = *in_grad[3];
+    tensor_t &dbt      = *in_grad[4];
+
+    // the tail rows are kept sparse while training; the dense gradient is
+    // used outside of training, e.g. for gradient checks
+    const bool sampled = phase_ == net_phase::train;
+    const bool cached  = sampled && head_cached_ && head_.size() == in.size();
+    const bool labeled = !targets_.empty();
+    if (labeled && targets_.size() != in.size()) {
+      throw nn_error("one class target per sample is required");
+    }
+    if (sampled) {
+      tail_grad_.reset(in.size(), in_size_);
+      sparse_grads_ = true;
+    }
+
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      const vec_t &x = in[sample];
+      vec_t &dxs     = dx[sample];
+      std::fill(dxs.begin(), dxs.end(), float_t(0));
+
+      label_t t;
+      float_t weight;
+      if (labeled) {
+        t      = targets_[sample];
+        weight = target_weights_[sample];
+        if (weight == float_t(0)) return;
+      } else if (!class_nll::marked_class(dy[sample], &t, &weight)) {
+        return;
+      }
+
+      // -log p(t) = -log p(k) - log p(t | k); both terms are plain
+      // softmax cross-entropies
+      const serial_size_t k = cluster_of_[t];
+      vec_t head(clusters());
+      if (cached) {
+        head = head_[sample];
+      } else {
+        head_softmax(in_data, x, &head[0]);
+      }
+      for (serial_size_t j = 0; j < clusters(); j++) {
+        const float_t g = weight * (head[j] - (j == k ? 1 : 0));
+        accumulate(Wh, g, x, j, &dxs, &dWh[sample][j * in_size_],
+                   &dbh[sample][j]);
+      }
+
+      const serial_size_t begin = cluster_begin(k);
+      vec_t tail(cluster_ends_[k] - begin);
+      tail_softmax(in_data, x, k, &tail[0]);
+      if (sampled) {
+        std::vector<size_t> rows(tail.size());
+        for (size_t i = 0; i < rows.size(); i++) rows[i] = begin + i;
+        tail_grad_.set_rows(sample, std::move(rows));
+      }
+      for (serial_size_t c = begin; c < cluster_ends_[k]; c++) {
+        const float_t g = weight * (tail[c - begin] - (c == t ? 1 : 0));
+        if (sampled) {
+          accumulate(Wt, g, x, c, &dxs, tail_grad_.weight(sample, c - begin),
+                     &tail_grad_.bias(sample, c - begin));
+        } else {
+          accumulate(Wt, g, x, c, &dxs, &dWt[sample][c * in_size_],
+                     &dbt[sample][c]);
+        }
+      }
+    });
+    head_cached_ = false;
+    targets_.clear();
+  }
+
+  bool set_class_targets(const std::vector<label_t> &labels,
+                         const vec_t &weights) override {
+    for (auto t : labels) {
+      if (t >= n_classes_) throw nn_error("class label out of range");
+    }
+    targets_        = labels;
+    target_weights_ = weights;
+    return true;
+  }
+
+  /**
+   * while training the tail collects its gradient in tail_grad_ and the
+   * loss arrives as labels, so the tail gradients keep a single slot and
+   * the output gradient is sized by set_out_grads only
+   **/
+  void set_sample_count(serial_size_t sample_count) override {
+    if (phase_ != net_phase::train) {
+      layer::set_sample_count(sample_count);
+      return;
+    }
+    auto resize = [sample_count](tensor_t *tensor) {
+      tensor->resize(sample_count, (*tensor)[0]);
+    };
+    auto single = [](tensor_t *tensor) {
+      tensor->resize(1);
+      tensor->shrink_to_fit();
+    };
+    auto in = inputs();
+    resize(in[0]->get_data());
+    resize(in[0]->get_gradient());
+    resize(in[1]->get_gradient());
+    resize(in[2]->get_gradient());
+    single(in[3]->get_gradient());
+    single(in[4]->get_gradient());
+    resize(outputs()[0]->get_data());
+  }
+
+  /**
+   * the head is updated densely, the tail only on the rows of the
+   * clusters scored in the train phase
+   **/
+  void update_weight(optimizer *o, serial_size_t batch_size) override {
+    if (!sparse_grads_) {
+      layer::update_weight(o, batch_size);
+      return;
+    }
+    const float_t scale = float_t(1) / float_t(batch_size);
+    auto w              = weights();
+    auto dw             = weights_grads();
+    for (size_t i = 0; i < 2; i++) {
+      tensor_t &g = *dw[i];
+      if (trainable()) {
+        vec_t diff = g[0];
+        for (size_t s = 1; s < g.size(); s++) {
+          vectorize::reduce<float_t>(&g[s][0], diff.size(), &diff[0]);
+        }
+        for (auto &v : diff) v *= scale;
+        o->update(diff, *w[i], parallelize_);
+      }
+      for (auto &v : g) std::fill(v.begin(), v.end(), float_t(0));
+    }
+    if (trainable()) tail_grad_.apply(o, *w[2], *w[3], scale, parallelize_);
+    tail_grad_.clear();
+    sparse_grads_ = false;
+    post_update();
+  }
+
+  void set_context(net_phase ctx) override { phase_ = ctx; }
+
+  std::string layer_type() const override { return "hierarchical-softmax"; }
+
+  serial_size_t clusters() const {
+    return static_cast<serial_size_t>(cluster_ends_.size());
+  }
+
+  const std::vector<serial_size_t> &cluster_ends() const {
+    return cluster_ends_;
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  serial_size_t cluster_begin(serial_size_t k) const {
+    return k == 0 ? 0 : cluster_ends_[k - 1];
+  }
+
+  // writes the softmax over rows [begin, end) of W, b into z
+  void softmax_rows(const vec_t &W,
+                    const vec_t &b,
+                    const vec_t &x,
+                    serial_size_t begin,
+                    serial_size_t end,
+                    float_t *z) const {
+    const size_t n = end - begin;
+    for (size_t i = 0; i < n; i++) {
+      const size_t row = begin + i;
+      z[i] = vectorize::dot(&W[row * in_size_], &x[0], in_size_) + b[row];
+    }
+    const float_t alpha = *std::max_element(z, z + n);
+    float_t sum         = 0;
+    for (size_t i = 0; i < n; i++) {
+      z[i] = std::exp(z[i] - alpha);
+      sum += z[i];
+    }
+    for (size_t i = 0; i < n; i++) z[i] /= sum;
+  }
+
+  void head_softmax(const std::vector<tensor_t *> &in_data,
+                    const vec_t &x,
+                    float_t *z) const {
+    softmax_rows((*in_data[1])[0], (*in_data[2])[0], x, 0, clusters(), z);
+  }
+
+  void tail_softmax(const std::vector<tensor_t *> &in_data,
+                    const vec_t &x,
+                    serial_size_t k,
+                    float_t *z) const {
+    softmax_rows((*in_data[3])[0], (*in_data[4])[0], x, cluster_begin(k),
+                 cluster_ends_[k], z);
+  }
+
+  // gradient g of the logit of row r of W, into dW_row (in_size values)
+  // and db_row
+  void accumulate(const vec_t &W,
+                  float_t g,
+                  const vec_t &x,
+                  serial_size_t r,
+                  vec_t *dx,
+                  float_t *dW_row,
+                  float_t *db_row) const {
+    if (g == float_t(0)) return;
+    const size_t row = static_cast<size_t>(r) * in_size_;
+    vectorize::muladd(&W[row], g, in_size_, &(*dx)[0]);
+    vectorize::muladd(&x[0], g, in_size_, dW_row);
+    *db_row += g;
+  }
+
+  serial_size_t in_size_;
+  serial_size_t n_classes_;
+  std::vector<serial_size_t> cluster_ends_;
+  std::vector<serial_size_t> cluster_of_;
+
+  /* head softmax of the current minibatch, from the train forward pass */
+  tensor_t head_;
+  bool head_cached_;
+  bool out_clean_;  // train-phase output is zero off the cluster begins
+
+  /* labels of the minibatch, see set_class_targets */
+  std::vector<label_t> targets_;
+  vec_t target_weights_;
+
+  row_sparse_gradient tail_grad_;
+  bool sparse_grads_;
+  net_phase phase_;
+};
+
+}  // namespace tiny_dnn
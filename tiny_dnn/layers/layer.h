@@ -18,6 +18,7 @@
 
 #include "tiny_dnn/core/backend.h"
 #include "tiny_dnn/core/framework/device.fwd.h"
+#include "tiny_dnn/core/kernels/tiny_quantization_kernel.h"
 #include "tiny_dnn/node.h"
 
 #include "tiny_dnn/util/parallel_for.h"
@@ -66,7 +67,9 @@ class layer : public node {
       in_channels_(in_type.size()),
       out_channels_(out_type.size()),
       in_type_(in_type),
-      out_type_(out_type) {
+      out_type_(out_type),
+      backend_type_(core::default_engine()),
+      quantize_weights_(false) {
     weight_init_ = std::make_shared<weight_init::xavier>();
     bias_init_   = std::make_shared<weight_init::constant>();
     trainable_   = true;
@@ -255,6 +258,15 @@ class layer : public node {
 
   bool trainable() const { return trainable_; }
 
+  /**
+   * simulate uint8 weights during training and inference: forward and
+   * backward see the weights rounded to 256 levels over their range while
+   * updates keep accumulating in float
+   **/
+  void set_weight_quantization(bool quantize) { quantize_weights_ = quantize; }
+
+  bool weight_quantization() const { return quantize_weights_; }
+
   /**
    * return output value range
    * used only for calculating target value from label-id in final(output)
@@ -311,6 +323,64 @@ class layer : public node {
    **/
   virtual serial_size_t fan_out_size() const { return out_shape()[0].width_; }
 
+  /////////////////////////////////////////////////////////////////////////
+  // cost model
+
+  /**
+   * floating point operations of one forward pass, per sample.
+   * a multiply-add counts as 2 operations.
+   * the default assumes one operation per output element, which fits
+   * element-wise layers; override if the layer does more work.
+   **/
+  virtual uint64_t forward_flops() const { return out_data_size(); }
+
+  /**
+   * floating point operations of one backward pass, per sample.
+   * by default the input gradient costs as much as the forward pass, and
+   * layers with trainable weights pay the same again for weight gradients.
+   **/
+  virtual uint64_t backward_flops() const {
+    return param_count() > 0 ? 2 * forward_flops() : forward_flops();
+  }
+
+  /**
+   * number of trainable parameters (weights and biases)
+   **/
+  uint64_t param_count() const {
+    const auto shapes = in_shape();
+    uint64_t n        = 0;
+    for (size_t i = 0; i < in_type_.size() && i < shapes.size(); i++) {
+      if (is_trainable_weight(in_type_[i])) n += shapes[i].size();
+    }
+    return n;
+  }
+
+  /**
+   * bytes of trainable parameters
+   **/
+  uint64_t weight_bytes() const { return param_count() * sizeof(float_t); }
+
+  /**
+   * bytes of input and output activations of one sample
+   **/
+  uint64_t activation_bytes() const {
+    return (static_cast<uint64_t>(in_data_size()) + out_data_size()) *
+           sizeof(float_t);
+  }
+
+  /**
+   * forward flops per byte of compulsory memory traffic (weights plus
+   * activations of one sample), i.e. the x-axis of a roofline plot.
+   * weights are re-used across a mini-batch, so pass the batch size to
+   * amortize them.
+   **/
+  double arithmetic_intensity(size_t batch_size = 1) const {
+    const double bytes =
+      static_cast<double>(weight_bytes()) / std::max<size_t>(batch_size, 1) +
+      activation_bytes();
+    return bytes > 0 ? forward_flops() / bytes : 0.0;
+  }
+
   /////////////////////////////////////////////////////////////////////////
   // setter
   template <typename WeightInit>
@@ -428,6 +498,22 @@ class layer : public node {
    **/
   virtual void set_context(net_phase ctx) { CNN_UNREFERENCED_PARAMETER(ctx); }
 
+  /**
+   * output layers that score classes sparsely take the labels of a
+   * class_nll minibatch in place of the one-hot loss gradient and return
+   * true; the others return false. They hold for the next
+   * back_propagation only.
+   *
+   * @param labels  [in] true class of each sample
+   * @param weights [in] gradient class_nll puts at the label of each sample
+   **/
+  virtual bool set_class_targets(const std::vector<label_t> &labels,
+                                 const vec_t &weights) {
+    CNN_UNREFERENCED_PARAMETER(labels);
+    CNN_UNREFERENCED_PARAMETER(weights);
+    return false;
+  }
+
   /* @brief Performs layer forward operation given an input tensor and
    * returns the computed data in tensor form.
    *
@@ -516,6 +602,7 @@ class layer : public node {
     for (size_t i = 0; i < in_channels_; i++) {
       fwd_in_data_[i] = ith_in_node(i)->get_data();
     }
+    if (quantize_weights_) quantize_weights(fwd_in_data_);
 
     // resize outs and stuff to have room for every input sample in
     // the batch
@@ -546,6 +633,8 @@ class layer : public node {
       bwd_in_data_[i] = nd->get_data();
       bwd_in_grad_[i] = nd->get_gradient();
     }
+    // gradients flow to the float weights (straight-through estimator)
+    if (quantize_weights_) quantize_weights(bwd_in_data_);
     for (serial_size_t i = 0; i < out_channels_; i++) {
       const auto &nd   = ith_out_node(i);
       bwd_out_data_[i] = nd->get_data();
@@ -640,7 +729,11 @@ class layer : public node {
     }
   }
 
-  void update_weight(optimizer *o, serial_size_t batch_size) {
+  /**
+   * apply the merged gradient of a minibatch and clear all gradients.
+   * layers that keep their own (e.g. row-sparse) gradients override it.
+   **/
+  virtual void update_weight(optimizer *o, serial_size_t batch_size) {
     float_t rcp_batch_size = float_t(1) / float_t(batch_size);
     auto &diff             = weights_diff_;
     for (serial_size_t i = 0; i < static_cast<serial_size_t>(in_type_.size());
@@ -653,7 +746,7 @@ class layer : public node {
         }
         // parallelize only when target size is big enough to mitigate
         // thread spawning overhead.
-        bool parallelize = (target.size() >= 512);
+        bool parallelize = parallelize_ && (target.size() >= 512);
         o->update(diff, target, parallelize);
       }
     }
@@ -739,6 +832,7 @@ class layer : public node {
   }
 
   friend struct serialization_buddy;
+  friend class packed_model_io;
 
  private:
   /** Flag indicating whether the layer/node parameters are trainable */
@@ -755,6 +849,28 @@ class layer : public node {
   std::vector<tensor_t *> bwd_out_data_;
   std::vector<tensor_t *> bwd_out_grad_;
 
+  /** Flag indicating whether forward/backward see fake-quantized weights */
+  bool quantize_weights_;
+  /** uint8-rounded copies of the weight inputs, used by quantize_weights */
+  std::vector<tensor_t> quantized_weights_;
+
+  /* @brief Replaces each weight input by a copy rounded to the 256 levels
+   * of its own range. Biases are left in float since the quantized kernels
+   * keep them in int32.
+   */
+  void quantize_weights(std::vector<tensor_t *> &data) {
+    quantized_weights_.resize(in_channels_);
+    for (size_t i = 0; i < in_channels_; i++) {
+      if (in_type_[i] != vector_type::weight) continue;
+      const vec_t &w = (*data[i])[0];
+      float_t min_w, max_w;
+      core::kernels::weight_quantization_range(w, &min_w, &max_w);
+      quantized_weights_[i].resize(1);
+      core::kernels::fake_quantize(w, min_w, max_w, quantized_weights_[i][0]);
+      data[i] = &quantized_weights_[i];
+    }
+  }
+
   /* @brief Allocates the necessary edge memory in a specific
    * incoming connection.
    *
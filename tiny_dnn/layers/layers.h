@@ -10,15 +10,22 @@
 #include "tiny_dnn/layers/average_pooling_layer.h"
 #include "tiny_dnn/layers/average_unpooling_layer.h"
 #include "tiny_dnn/layers/batch_normalization_layer.h"
+#include "tiny_dnn/layers/binary_convolutional_layer.h"
+#include "tiny_dnn/layers/binary_fully_connected_layer.h"
 #include "tiny_dnn/layers/concat_layer.h"
 #include "tiny_dnn/layers/convolutional_layer.h"
 #include "tiny_dnn/layers/deconvolutional_layer.h"
 #include "tiny_dnn/layers/dropout_layer.h"
+#include "tiny_dnn/layers/fake_quantization_layer.h"
 #include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/layers/global_average_pooling_fc_layer.h"
 #include "tiny_dnn/layers/global_average_pooling_layer.h"
+#include "tiny_dnn/layers/gru_layer.h"
+#include "tiny_dnn/layers/hierarchical_softmax_layer.h"
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/layers/linear_layer.h"
 #include "tiny_dnn/layers/lrn_layer.h"
+#include "tiny_dnn/layers/lstm_layer.h"
 #include "tiny_dnn/layers/max_pooling_layer.h"
 #include "tiny_dnn/layers/max_unpooling_layer.h"
 #include "tiny_dnn/layers/partial_connected_layer.h"
@@ -26,4 +33,6 @@
 #include "tiny_dnn/layers/quantized_convolutional_layer.h"
 #include "tiny_dnn/layers/quantized_deconvolutional_layer.h"
 #include "tiny_dnn/layers/quantized_fully_connected_layer.h"
+#include "tiny_dnn/layers/recurrent_layer.h"
+#include "tiny_dnn/layers/sampled_softmax_layer.h"
 #include "tiny_dnn/layers/slice_layer.h"
@@ -72,6 +72,11 @@ class lrn_layer : public layer {
 
   serial_size_t fan_out_size() const override { return size_; }
 
+  ///< running square sum across channels, then scale and pow per element
+  uint64_t forward_flops() const override {
+    return 8 * static_cast<uint64_t>(in_shape_.size());
+  }
+
   std::vector<shape3d> in_shape() const override { return {in_shape_}; }
 
   std::vector<shape3d> out_shape() const override { return {in_shape_}; }
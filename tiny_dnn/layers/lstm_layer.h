@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/layers/recurrent_layer.h"
+
+namespace tiny_dnn {
+
+/**
+ * long short-term memory layer.
+ *
+ * The four gates of a step are laid out [input, forget, output, cell]:
+ *
+ *     i, f, o = sigmoid(x W + h U + b),  g = tanh(x W + h U + b)
+ *     c' = f * c + i * g,  h' = o * tanh(c')
+ *
+ * Forward keeps only the gate activations and the cell states of each
+ * step; the hidden states are recomputed from them during backward.
+ **/
+class lstm_layer : public recurrent_layer {
+ public:
+  /**
+   * @param in_dim           [in] number of elements of each step's input
+   * @param hidden_size      [in] number of elements of the hidden state
+   * @param seq_len          [in] number of steps of each sample
+   * @param return_sequences [in] output every step, or only the last one
+   * @param bptt_steps       [in] truncation length of backpropagation
+   *                              through time (0: the whole sequence)
+   **/
+  lstm_layer(serial_size_t in_dim,
+             serial_size_t hidden_size,
+             serial_size_t seq_len,
+             bool return_sequences    = true,
+             serial_size_t bptt_steps = 0)
+    : recurrent_layer({vector_type::data, vector_type::weight,
+                       vector_type::weight, vector_type::bias},
+                      in_dim,
+                      hidden_size,
+                      seq_len,
+                      4,
+                      return_sequences,
+                      bptt_steps) {}
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    return {index3d<serial_size_t>(in_size_, seq_len_, 1),
+            index3d<serial_size_t>(in_size_, gate_width(), 1),
+            index3d<serial_size_t>(hidden_size_, gate_width(), 1),
+            index3d<serial_size_t>(gate_width(), 1, 1)};
+  }
+
+  std::string layer_type() const override { return "lstm"; }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    const tensor_t &in    = *in_data[0];
+    const vec_t &W        = (*in_data[1])[0];
+    const vec_t &U        = (*in_data[2])[0];
+    const vec_t &b        = (*in_data[3])[0];
+    tensor_t &out         = *out_data[0];
+    const size_t batch    = in.size();
+    const serial_size_t H = hidden_size_, G = gate_width();
+
+    gate_acts_.resize(batch);
+    cells_.resize(batch);
+    for_i(batch, [&](int s) {
+      input_projection(in[s], W, b, &gate_acts_[s]);
+      cells_[s].resize(seq_len_ * H);
+    });
+
+    const bool step_parallel = parallelize_steps(batch);
+    vec_t h(batch * H, float_t(0)), c(batch * H, float_t(0));
+    vec_t a(batch * G);
+    for (serial_size_t t = 0; t < seq_len_; t++) {
+      for_(step_parallel, 0, batch, [&](const blocked_range &r) {
+        const size_t s0 = r.begin(), rows = r.end() - r.begin();
+        for (size_t s = r.begin(); s < r.end(); s++) {
+          const float_t *p = &gate_acts_[s][t * G];
+          std::copy(p, p + G, &a[s * G]);
+        }
+        gemm_nn(rows, G, H, &h[s0 * H], &U[0], &a[s0 * G]);
+
+        for (size_t s = r.begin(); s < r.end(); s++) {
+          float_t *g = &a[s * G];
+          sigmoid_block(g, 3 * H);
+          tanh_block(g + 3 * H, H);
+          std::copy(g, g + G, &gate_acts_[s][t * G]);
+
+          float_t *cs = &c[s * H], *hs = &h[s * H];
+          for (serial_size_t j = 0; j < H; j++) {
+            cs[j] = g[H + j] * cs[j] + g[j] * g[3 * H + j];
+            hs[j] = g[2 * H + j] * std::tanh(cs[j]);
+          }
+          std::copy(cs, cs + H, &cells_[s][t * H]);
+          if (float_t *y = output(out[s], t)) std::copy(hs, hs + H, y);
+        }
+      });
+    }
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    const tensor_t &in    = *in_data[0];
+    const vec_t &W        = (*in_data[1])[0];
+    const vec_t &U        = (*in_data[2])[0];
+    const tensor_t &dy    = *out_grad[0];
+    tensor_t &dx          = *in_grad[0];
+    tensor_t &dW          = *in_grad[1];
+    tensor_t &dU          = *in_grad[2];
+    tensor_t &db          = *in_grad[3];
+    const size_t batch    = in.size();
+    const serial_size_t H = hidden_size_, G = gate_width();
+
+    const bool step_parallel = parallelize_steps(batch);
+    // gradients of the gate pre-activations of every step
+    std::vector<vec_t> dP(batch, vec_t(seq_len_ * G));
+    vec_t dh(batch * H, float_t(0)), dc(batch * H, float_t(0));
+    vec_t da(batch * G);
+
+    for (serial_size_t t = seq_len_; t-- > 0;) {
+      for_(step_parallel, 0, batch, [&](const blocked_range &r) {
+        for (size_t s = r.begin(); s < r.end(); s++) {
+          const float_t *g    = &gate_acts_[s][t * G];
+          const float_t *c    = &cells_[s][t * H];
+          const float_t *cp   = t > 0 ? &cells_[s][(t - 1) * H] : nullptr;
+          const float_t *dy_t = output_grad(dy[s], t);
+          float_t *dhs = &dh[s * H], *dcs = &dc[s * H], *d = &da[s * G];
+
+          for (serial_size_t j = 0; j < H; j++) {
+            const float_t i = g[j], f = g[H + j], o = g[2 * H + j];
+            const float_t z = g[3 * H + j], tc = std::tanh(c[j]);
+            const float_t gh = dhs[j] + (dy_t ? dy_t[j] : float_t(0));
+            const float_t gc = dcs[j] + gh * o * (1 - tc * tc);
+            d[j]             = gc * z * i * (1 - i);
+            d[H + j]         = gc * (cp ? cp[j] : float_t(0)) * f * (1 - f);
+            d[2 * H + j]     = gh * tc * o * (1 - o);
+            d[3 * H + j]     = gc * i * (1 - z * z);
+            dcs[j]           = gc * f;
+          }
+          std::copy(d, d + G, &dP[s][t * G]);
+        }
+
+        const size_t s0 = r.begin(), rows = r.end() - r.begin();
+        std::fill(&dh[s0 * H], &dh[s0 * H] + rows * H, float_t(0));
+        if (t == 0 || truncated(t)) {
+          std::fill(&dc[s0 * H], &dc[s0 * H] + rows * H, float_t(0));
+        } else {
+          gemm_nt(rows, H, G, &da[s0 * G], &U[0], &dh[s0 * H]);
+        }
+      });
+    }
+
+    for_i(batch, [&](int s) {
+      // hidden state entering each step
+      vec_t hp(seq_len_ * H, float_t(0));
+      for (serial_size_t t = 1; t < seq_len_; t++) {
+        const float_t *o = &gate_acts_[s][(t - 1) * G + 2 * H];
+        const float_t *c = &cells_[s][(t - 1) * H];
+        for (serial_size_t j = 0; j < H; j++) {
+          hp[t * H + j] = o[j] * std::tanh(c[j]);
+        }
+      }
+      gemm_tn(H, G, seq_len_, &hp[0], &dP[s][0], &dU[s][0]);
+      input_projection_grad(in[s], W, dP[s], &dx[s], &dW[s], &db[s]);
+    });
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  std::vector<vec_t> gate_acts_;  // activated gates of every step
+  std::vector<vec_t> cells_;      // cell state after every step
+};
+
+}  // namespace tiny_dnn
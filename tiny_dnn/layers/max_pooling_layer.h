@@ -115,6 +115,15 @@ class max_pooling_layer : public layer {
 
   serial_size_t fan_out_size() const override { return 1; }
 
+  ///< one comparison per pooling window element
+  uint64_t forward_flops() const override {
+    return static_cast<uint64_t>(params_.out.size()) * params_.pool_size_x *
+           params_.pool_size_y;
+  }
+
+  ///< gradients are only routed to the max inputs
+  uint64_t backward_flops() const override { return params_.in.size(); }
+
   void forward_propagation(const std::vector<tensor_t *> &in_data,
                            std::vector<tensor_t *> &out_data) override {
     // forward convolutional op context
@@ -164,6 +173,8 @@ class max_pooling_layer : public layer {
   }
 
   friend struct serialization_buddy;
+  friend class channel_pruner;
+  friend class c_code_generator;
 
  private:
   /* The Max Poling operation params */
@@ -43,6 +43,13 @@ class partial_connected_layer : public layer {
 
   serial_size_t fan_out_size() const override { return max_size(in2wo_); }
 
+  uint64_t forward_flops() const override {
+    uint64_t connections = 0;
+    for (const auto &w : weight2io_) connections += w.size();
+    // multiply-add per connection, then scale and bias per output
+    return 2 * connections + 2 * out2wi_.size();
+  }
+
   void connect_weight(serial_size_t input_index,
                       serial_size_t output_index,
                       serial_size_t weight_index) {
@@ -9,6 +9,7 @@
 
 #include <cmath>
 
+#include "tiny_dnn/core/framework/elementwise_expression.h"
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/util/util.h"
 
@@ -58,10 +59,9 @@ class power_layer : public layer {
     const tensor_t &x = *in_data[0];
     tensor_t &y       = *out_data[0];
 
-    for (serial_size_t i = 0; i < x.size(); i++) {
-      std::transform(x[i].begin(), x[i].end(), y[i].begin(),
-                     [=](float_t x) { return scale_ * std::pow(x, factor_); });
-    }
+    for_i(x.size(), [&](size_t i) {
+      expr::assign(y[i], scale_ * expr::pow(expr::ref(x[i]), factor_));
+    });
   }
 
   void back_propagation(const std::vector<tensor_t *> &in_data,
@@ -73,23 +73,21 @@ class power_layer : public layer {
     const tensor_t &x  = *in_data[0];
     const tensor_t &y  = *out_data[0];
 
-    for (serial_size_t i = 0; i < x.size(); i++) {
-      for (serial_size_t j = 0; j < x[i].size(); j++) {
-        // f(x) = (scale*x)^factor
-        // ->
-        //   dx = dy * df(x)
-        //      = dy * scale * factor * (scale * x)^(factor - 1)
-        //      = dy * scale * factor * (scale * x)^factor * (scale *
-        //      x)^(-1)
-        //      = dy * factor * y / x
-        if (std::abs(x[i][j]) > 1e-10) {
-          dx[i][j] = dy[i][j] * factor_ * y[i][j] / x[i][j];
-        } else {
-          dx[i][j] =
-            dy[i][j] * scale_ * factor_ * std::pow(x[i][j], factor_ - 1.0f);
-        }
-      }
-    }
+    // f(x) = scale * x^factor
+    // ->
+    //   dx = dy * df(x)
+    //      = dy * scale * factor * x^(factor - 1)
+    //      = dy * factor * y / x
+    // where x is not too close to zero
+    for_i(x.size(), [&](size_t i) {
+      const auto xi  = expr::ref(x[i]);
+      const auto dyi = expr::ref(dy[i]);
+      expr::assign(
+        dx[i], expr::where(expr::abs(xi) > float_t(1e-10),
+                           dyi * factor_ * expr::ref(y[i]) / xi,
+                           dyi * (scale_ * factor_) *
+                             expr::pow(xi, factor_ - float_t(1))));
+    });
   }
 
   float_t factor() const { return factor_; }
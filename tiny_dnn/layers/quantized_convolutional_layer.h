@@ -278,6 +278,15 @@ class quantized_convolutional_layer : public layer {
 
   std::string layer_type() const override { return "q_conv"; }
 
+  /**
+   * quantize the input over a fixed range, e.g. one learned with a
+   * fake_quantization_layer, instead of the range of every sample
+   **/
+  void set_input_range(float_t min_input, float_t max_input) {
+    params_.input_min = min_input;
+    params_.input_max = max_input;
+  }
+
 #ifdef DNN_USE_IMAGE_API
   image<> weight_to_image() const {
     image<> img;
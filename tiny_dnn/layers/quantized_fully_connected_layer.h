@@ -76,6 +76,15 @@ class quantized_fully_connected_layer : public layer {
 
   std::string layer_type() const override { return "q_fully-connected"; }
 
+  /**
+   * quantize the input over a fixed range, e.g. one learned with a
+   * fake_quantization_layer, instead of the range of every sample
+   **/
+  void set_input_range(float_t min_input, float_t max_input) {
+    params_.input_min = min_input;
+    params_.input_max = max_input;
+  }
+
   friend struct serialization_buddy;
 
  protected:
@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/util/product.h"
+
+namespace tiny_dnn {
+
+/**
+ * base class of the gated recurrent layers (lstm_layer, gru_layer).
+ *
+ * Each sample is a whole sequence of seq_len steps of in_dim values, laid
+ * out step after step. The output is the hidden state of every step, or
+ * of the last step only if return_sequences is false. The state starts
+ * from zero for every sample.
+ *
+ * All gates of a step are computed together: the input projection
+ * X * W + b of the whole sequence is a single (seq_len x in_dim) *
+ * (in_dim x gates * hidden) product per sample, and the recurrent term of
+ * a step is one (batch x hidden) * (hidden x gates * hidden) product over
+ * the whole minibatch. W and U are stored row-major like the weights of
+ * fully_connected_layer, with the gates side by side in each row.
+ **/
+class recurrent_layer : public layer {
+ public:
+  recurrent_layer(const std::vector<vector_type> &in_types,
+                  serial_size_t in_dim,
+                  serial_size_t hidden_size,
+                  serial_size_t seq_len,
+                  serial_size_t gates,
+                  bool return_sequences,
+                  serial_size_t bptt_steps)
+    : layer(in_types, {vector_type::data}),
+      in_size_(in_dim),
+      hidden_size_(hidden_size),
+      seq_len_(seq_len),
+      gates_(gates),
+      return_sequences_(return_sequences),
+      bptt_steps_(bptt_steps) {
+    if (seq_len == 0) throw nn_error("sequence length must be positive");
+  }
+
+  serial_size_t fan_in_size() const override {
+    return in_size_ + hidden_size_;
+  }
+
+  serial_size_t fan_out_size() const override { return hidden_size_; }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {index3d<serial_size_t>(hidden_size_,
+                                   return_sequences_ ? seq_len_ : 1, 1)};
+  }
+
+  serial_size_t hidden_size() const { return hidden_size_; }
+
+  serial_size_t seq_len() const { return seq_len_; }
+
+  bool return_sequences() const { return return_sequences_; }
+
+  /**
+   * truncate backpropagation through time to chunks of `steps` steps; the
+   * gradient does not flow from one chunk into the previous one.
+   * 0 backpropagates through the whole sequence.
+   **/
+  void set_bptt_steps(serial_size_t steps) { bptt_steps_ = steps; }
+
+  serial_size_t bptt_steps() const { return bptt_steps_; }
+
+  friend struct serialization_buddy;
+
+ protected:
+  // width of one step of the gate pre-activations
+  serial_size_t gate_width() const { return gates_ * hidden_size_; }
+
+  // true if the recurrent gradient of step t must not reach step t - 1
+  bool truncated(serial_size_t t) const {
+    return bptt_steps_ != 0 && t % bptt_steps_ == 0;
+  }
+
+  // threads are only worth starting for steps with enough work
+  bool parallelize_steps(size_t batch) const {
+    return parallelize_ && batch * hidden_size_ * gate_width() >= 65536;
+  }
+
+  // P = X * W + b over the whole sequence of one sample
+  void input_projection(const vec_t &x,
+                        const vec_t &W,
+                        const vec_t &b,
+                        vec_t *P) const {
+    const serial_size_t G = gate_width();
+    P->resize(seq_len_ * G);
+    for (serial_size_t t = 0; t < seq_len_; t++) {
+      std::copy(b.begin(), b.end(), P->begin() + t * G);
+    }
+    gemm_nn(seq_len_, G, in_size_, &x[0], &W[0], &(*P)[0]);
+  }
+
+  // gradients of the input projection from its gradient dP
+  void input_projection_grad(const vec_t &x,
+                             const vec_t &W,
+                             const vec_t &dP,
+                             vec_t *dx,
+                             vec_t *dW,
+                             vec_t *db) const {
+    const serial_size_t G = gate_width();
+    std::fill(dx->begin(), dx->end(), float_t(0));
+    gemm_nt(seq_len_, in_size_, G, &dP[0], &W[0], &(*dx)[0]);
+    gemm_tn(in_size_, G, seq_len_, &x[0], &dP[0], &(*dW)[0]);
+    for (serial_size_t t = 0; t < seq_len_; t++) {
+      vectorize::add(&dP[t * G], G, &(*db)[0]);
+    }
+  }
+
+  // incoming gradient of the hidden state of step t
+  const float_t *output_grad(const vec_t &dy, serial_size_t t) const {
+    if (return_sequences_) return &dy[t * hidden_size_];
+    return t + 1 == seq_len_ ? &dy[0] : nullptr;
+  }
+
+  float_t *output(vec_t &y, serial_size_t t) const {
+    if (return_sequences_) return &y[t * hidden_size_];
+    return t + 1 == seq_len_ ? &y[0] : nullptr;
+  }
+
+  // C (m x n) += A (m x k) * B (k x n); B is walked in blocks of rows
+  // that stay in cache across all rows of A
+  static void gemm_nn(serial_size_t m,
+                      serial_size_t n,
+                      serial_size_t k,
+                      const float_t *A,
+                      const float_t *B,
+                      float_t *C) {
+    const serial_size_t kb = std::max<serial_size_t>(1, 16384 / n);
+    for (serial_size_t p0 = 0; p0 < k; p0 += kb) {
+      const serial_size_t p1 = std::min(k, p0 + kb);
+      for (serial_size_t i = 0; i < m; i++) {
+        for (serial_size_t p = p0; p < p1; p++) {
+          vectorize::muladd(&B[p * n], A[i * k + p], n, &C[i * n]);
+        }
+      }
+    }
+  }
+
+  // C (m x n) += A (m x k) * B^T, B being (n x k)
+  static void gemm_nt(serial_size_t m,
+                      serial_size_t n,
+                      serial_size_t k,
+                      const float_t *A,
+                      const float_t *B,
+                      float_t *C) {
+    for (serial_size_t i = 0; i < m; i++) {
+      for (serial_size_t j = 0; j < n; j++) {
+        C[i * n + j] += vectorize::dot(&A[i * k], &B[j * k], k);
+      }
+    }
+  }
+
+  // C (m x n) += A^T * B, A being (k x m) and B (k x n)
+  static void gemm_tn(serial_size_t m,
+                      serial_size_t n,
+                      serial_size_t k,
+                      const float_t *A,
+                      const float_t *B,
+                      float_t *C) {
+    for (serial_size_t p = 0; p < k; p++) {
+      for (serial_size_t i = 0; i < m; i++) {
+        vectorize::muladd(&B[p * n], A[p * m + i], n, &C[i * n]);
+      }
+    }
+  }
+
+  // activations over contiguous blocks of gates
+  static void sigmoid_block(float_t *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      x[i] = float_t(1) / (float_t(1) + std::exp(-x[i]));
+    }
+  }
+
+  static void tanh_block(float_t *x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = std::tanh(x[i]);
+  }
+
+  serial_size_t in_size_;
+  serial_size_t hidden_size_;
+  serial_size_t seq_len_;
+  serial_size_t gates_;
+  bool return_sequences_;
+  serial_size_t bptt_steps_;
+};
+
+}  // namespace tiny_dnn
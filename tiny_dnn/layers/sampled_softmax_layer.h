@@ -0,0 +1,435 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tiny_dnn/core/framework/row_sparse_gradient.h"
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/lossfunctions/loss_function.h"
+#include "tiny_dnn/util/product.h"
+#include "tiny_dnn/util/random.h"
+
+namespace tiny_dnn {
+
+/**
+ * proposal distribution of the negative classes of sampled softmax
+ **/
+enum class candidate_sampler {
+  log_uniform,  ///< Zipfian, P(c) ~ log((c + 2) / (c + 1)); sort by frequency
+  uniform,      ///< every class equally likely
+  custom        ///< user proposal, see set_proposal
+};
+
+/**
+ * fully-connected layer followed by softmax, trained by sampled softmax.
+ *
+ * In the test phase it outputs the full softmax over all classes. In the
+ * train phase it scores only n_candidates distinct classes, drawn from the
+ * proposal once per minibatch without replacement, plus the true class of
+ * each sample. Their logits are corrected by the log of their expected
+ * counts (Jean et al., 2015). The train-phase output therefore holds the
+ * softmax over the drawn candidates, zero for every other class; it is
+ * not the model distribution and the true class only joins the softmax in
+ * back_propagation, once the label is known. Trained with class_nll on
+ * labels, the network hands the labels over directly (set_class_targets)
+ * instead of a one-hot gradient. The weight gradient is kept for the
+ * scored rows only and applied with optimizer::update_rows, so a training
+ * step costs O(batch * n_candidates * in_dim) and no per-sample work
+ * depends on n_classes:
+ *
+ *     net << fully_connected_layer(256, 128) << relu_layer()
+ *         << sampled_softmax_layer(128, 100000, 64);
+ *     net.train<class_nll>(opt, x, labels, 32, 10);
+ *
+ * Weights are stored one row of in_dim per class, so that a sampled class
+ * is a contiguous read.
+ **/
+class sampled_softmax_layer : public layer {
+ public:
+  /**
+   * @param in_dim       [in] number of elements of the input
+   * @param n_classes    [in] number of classes (elements of the output)
+   * @param n_candidates [in] negative classes sampled per training step
+   * @param sampler      [in] proposal distribution of the negatives
+   **/
+  sampled_softmax_layer(
+    serial_size_t in_dim,
+    serial_size_t n_classes,
+    serial_size_t n_candidates,
+    candidate_sampler sampler = candidate_sampler::log_uniform)
+    : layer({vector_type::data, vector_type::weight, vector_type::bias},
+            {vector_type::data}),
+      in_size_(in_dim),
+      n_classes_(n_classes),
+      n_candidates_(n_candidates),
+      sampler_(sampler),
+      tries_(0),
+      scored_(false),
+      out_clean_(false),
+      sparse_grads_(false),
+      phase_(net_phase::test) {
+    if (sampler == candidate_sampler::custom) {
+      throw nn_error("use set_proposal to give a custom proposal");
+    }
+    if (n_candidates >= n_classes) {
+      throw nn_error("n_candidates must be smaller than n_classes");
+    }
+  }
+
+  serial_size_t fan_in_size() const override { return in_size_; }
+
+  serial_size_t fan_out_size() const override { return n_classes_; }
+
+  std::vector<index3d<serial_size_t>> in_shape() const override {
+    return {index3d<serial_size_t>(in_size_, 1, 1),
+            index3d<serial_size_t>(in_size_, n_classes_, 1),
+            index3d<serial_size_t>(n_classes_, 1, 1)};
+  }
+
+  std::vector<index3d<serial_size_t>> out_shape() const override {
+    return {index3d<serial_size_t>(n_classes_, 1, 1)};
+  }
+
+  std::pair<float_t, float_t> out_value_range() const override {
+    return {float_t(0), float_t(1)};
+  }
+
+  void forward_propagation(const std::vector<tensor_t *> &in_data,
+                           std::vector<tensor_t *> &out_data) override {
+    const tensor_t &in = *in_data[0];
+    const vec_t &W     = (*in_data[1])[0];
+    const vec_t &b     = (*in_data[2])[0];
+    tensor_t &out      = *out_data[0];
+
+    if (phase_ == net_phase::train) {
+      score_candidates(in, W, b);
+      tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+        vec_t &y = out[sample];
+        vec_t p  = candidate_logits_[sample];
+        softmax(&p[0], p.size());
+        // only the previous candidates are nonzero once the output is clean
+        if (out_clean_) {
+          for (auto c : written_) y[c] = float_t(0);
+        } else {
+          std::fill(y.begin(), y.end(), float_t(0));
+        }
+        for (size_t k = 0; k < candidates_.size(); k++) {
+          y[candidates_[k]] = p[k];
+        }
+      });
+      written_   = candidates_;
+      out_clean_ = true;
+      return;
+    }
+
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      vec_t &y = out[sample];
+      for (serial_size_t c = 0; c < n_classes_; c++) {
+        y[c] = logit(W, b, in[sample], c);
+      }
+      softmax(&y[0], n_classes_);
+    });
+    out_clean_ = false;
+  }
+
+  void back_propagation(const std::vector<tensor_t *> &in_data,
+                        const std::vector<tensor_t *> &out_data,
+                        std::vector<tensor_t *> &out_grad,
+                        std::vector<tensor_t *> &in_grad) override {
+    CNN_UNREFERENCED_PARAMETER(out_data);
+    const tensor_t &in = *in_data[0];
+    const vec_t &W     = (*in_data[1])[0];
+    const vec_t &b     = (*in_data[2])[0];
+    const tensor_t &dy = *out_grad[0];
+    tensor_t &dx       = *in_grad[0];
+    tensor_t &dW       = *in_grad[1];
+    tensor_t &db       = *in_grad[2];
+
+    // negatives are shared by the minibatch; the full softmax is used
+    // outside of training, e.g. for gradient checks
+    const bool sampled = phase_ == net_phase::train;
+    const bool labeled = !targets_.empty();
+    if (labeled && targets_.size() != in.size()) {
+      throw nn_error("one class target per sample is required");
+    }
+    if (sampled) {
+      if (!scored_) score_candidates(in, W, b);
+      grad_.reset(in.size(), in_size_);
+      sparse_grads_ = true;
+    }
+
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      const vec_t &x = in[sample];
+      vec_t &dxs     = dx[sample];
+      std::fill(dxs.begin(), dxs.end(), float_t(0));
+
+      label_t t;
+      float_t weight;
+      if (labeled) {
+        t      = targets_[sample];
+        weight = target_weights_[sample];
+        if (weight == float_t(0)) return;
+      } else if (!class_nll::marked_class(dy[sample], &t, &weight)) {
+        return;
+      }
+
+      // scored classes; the true class is classes[target]
+      std::vector<size_t> classes;
+      vec_t z;
+      size_t target;
+      if (sampled) {
+        const vec_t &zc = candidate_logits_[sample];
+        classes.push_back(t);
+        classes.insert(classes.end(), candidates_.begin(), candidates_.end());
+        z.resize(classes.size());
+        z[0] = logit(W, b, x, t) - std::log(expected_count(t));
+        for (size_t k = 0; k < candidates_.size(); k++) {
+          // accidental hits of the true class are removed
+          z[k + 1] = candidates_[k] == t
+                       ? -std::numeric_limits<float_t>::infinity()
+                       : zc[k];
+        }
+        target = 0;
+      } else {
+        classes.resize(n_classes_);
+        z.resize(n_classes_);
+        for (serial_size_t c = 0; c < n_classes_; c++) {
+          classes[c] = c;
+          z[c]       = logit(W, b, x, c);
+        }
+        target = t;
+      }
+      softmax(&z[0], z.size());
+      if (sampled) grad_.set_rows(sample, classes);
+
+      for (size_t k = 0; k < classes.size(); k++) {
+        const float_t g = weight * (z[k] - (k == target ? 1 : 0));
+        if (g == float_t(0)) continue;
+        const size_t row = classes[k] * in_size_;
+        vectorize::muladd(&W[row], g, in_size_, &dxs[0]);
+        if (sampled) {
+          vectorize::muladd(&x[0], g, in_size_, grad_.weight(sample, k));
+          grad_.bias(sample, k) += g;
+        } else {
+          vectorize::muladd(&x[0], g, in_size_, &dW[sample][row]);
+          db[sample][classes[k]] += g;
+        }
+      }
+    });
+    scored_ = false;
+    targets_.clear();
+  }
+
+  bool set_class_targets(const std::vector<label_t> &labels,
+                         const vec_t &weights) override {
+    for (auto t : labels) {
+      if (t >= n_classes_) throw nn_error("class label out of range");
+    }
+    targets_        = labels;
+    target_weights_ = weights;
+    return true;
+  }
+
+  /**
+   * while training the class weights collect their gradient in grad_ and
+   * the loss arrives as labels, so the weight gradients keep a single slot
+   * and the output gradient is sized by set_out_grads only
+   **/
+  void set_sample_count(serial_size_t sample_count) override {
+    if (phase_ != net_phase::train) {
+      layer::set_sample_count(sample_count);
+      return;
+    }
+    auto resize = [sample_count](tensor_t *tensor) {
+      tensor->resize(sample_count, (*tensor)[0]);
+    };
+    auto single = [](tensor_t *tensor) {
+      tensor->resize(1);
+      tensor->shrink_to_fit();
+    };
+    auto in = inputs();
+    resize(in[0]->get_data());
+    resize(in[0]->get_gradient());
+    single(in[1]->get_gradient());
+    single(in[2]->get_gradient());
+    resize(outputs()[0]->get_data());
+  }
+
+  ///< row-sparse update of the rows scored in the train phase
+  void update_weight(optimizer *o, serial_size_t batch_size) override {
+    if (!sparse_grads_) {
+      layer::update_weight(o, batch_size);
+      return;
+    }
+    if (trainable()) {
+      grad_.apply(o, *weights()[0], *weights()[1],
+                  float_t(1) / float_t(batch_size), parallelize_);
+    }
+    grad_.clear();
+    sparse_grads_ = false;
+    post_update();
+  }
+
+  void set_context(net_phase ctx) override { phase_ = ctx; }
+
+  std::string layer_type() const override { return "sampled-softmax"; }
+
+  serial_size_t n_candidates() const { return n_candidates_; }
+
+  candidate_sampler sampler() const { return sampler_; }
+
+  /**
+   * sample the negatives from q (one non-negative weight per class,
+   * normalized internally)
+   **/
+  void set_proposal(const vec_t &q) {
+    if (q.size() != n_classes_) {
+      throw nn_error("proposal must have one weight per class");
+    }
+    cdf_.resize(q.size());
+    float_t sum = 0;
+    for (size_t c = 0; c < q.size(); c++) {
+      if (q[c] < 0) throw nn_error("proposal weights must be non-negative");
+      sum += q[c];
+      cdf_[c] = sum;
+    }
+    if (sum <= 0) throw nn_error("proposal must not be all zero");
+    const size_t support = static_cast<size_t>(
+      std::count_if(q.begin(), q.end(), [](float_t v) { return v > 0; }));
+    if (support < n_candidates_) {
+      throw nn_error("proposal must cover at least n_candidates classes");
+    }
+    for (auto &v : cdf_) v /= sum;
+    sampler_ = candidate_sampler::custom;
+  }
+
+  ///< probability of drawing class c as a negative
+  float_t proposal(label_t c) const {
+    switch (sampler_) {
+      case candidate_sampler::uniform: return float_t(1) / n_classes_;
+      case candidate_sampler::custom:
+        return cdf_[c] - (c == 0 ? float_t(0) : cdf_[c - 1]);
+      default:
+        return static_cast<float_t>(std::log((c + 2.0) / (c + 1.0)) /
+                                    std::log(n_classes_ + 1.0));
+    }
+  }
+
+  friend struct serialization_buddy;
+
+ private:
+  float_t logit(const vec_t &W,
+                const vec_t &b,
+                const vec_t &x,
+                label_t c) const {
+    return vectorize::dot(&W[static_cast<size_t>(c) * in_size_], &x[0],
+                          in_size_) +
+           b[c];
+  }
+
+  static void softmax(float_t *z, size_t n) {
+    const float_t alpha = *std::max_element(z, z + n);
+    float_t sum         = 0;
+    for (size_t i = 0; i < n; i++) {
+      z[i] = std::exp(z[i] - alpha);
+      sum += z[i];
+    }
+    for (size_t i = 0; i < n; i++) z[i] /= sum;
+  }
+
+  label_t draw() const {
+    const double u = uniform_rand(0.0, 1.0);
+    label_t c;
+    switch (sampler_) {
+      case candidate_sampler::uniform:
+        c = static_cast<label_t>(u * n_classes_);
+        break;
+      case candidate_sampler::custom:
+        c = static_cast<label_t>(
+          std::lower_bound(cdf_.begin(), cdf_.end(), float_t(u)) -
+          cdf_.begin());
+        break;
+      default:
+        c = static_cast<label_t>(std::exp(u * std::log(n_classes_ + 1.0))) - 1;
+        break;
+    }
+    return std::min(c, n_classes_ - 1);
+  }
+
+  // probability that c is among the candidates, i.e. drawn at least once
+  // in the tries_ draws it took to collect them
+  float_t expected_count(label_t c) const {
+    const double q = std::min<double>(proposal(c), 1.0 - 1e-12);
+    const double e = -std::expm1(tries_ * std::log1p(-q));
+    return static_cast<float_t>(
+      std::max<double>(e, std::numeric_limits<float_t>::min()));
+  }
+
+  // n_candidates distinct classes, drawn until that many were seen
+  void draw_candidates() {
+    std::unordered_set<label_t> seen;
+    candidates_.clear();
+    tries_ = 0;
+    while (candidates_.size() < n_candidates_) {
+      const label_t c = draw();
+      tries_++;
+      if (seen.insert(c).second) candidates_.push_back(c);
+    }
+  }
+
+  // draws the candidates of a minibatch and their corrected logits
+  void score_candidates(const tensor_t &in, const vec_t &W, const vec_t &b) {
+    draw_candidates();
+    vec_t log_expected(candidates_.size());
+    for (size_t k = 0; k < candidates_.size(); k++) {
+      log_expected[k] = std::log(expected_count(candidates_[k]));
+    }
+    candidate_logits_.resize(in.size());
+    tiny_dnn::for_i(parallelize_, in.size(), [&](int sample) {
+      vec_t &z = candidate_logits_[sample];
+      z.resize(candidates_.size());
+      for (size_t k = 0; k < candidates_.size(); k++) {
+        z[k] = logit(W, b, in[sample], candidates_[k]) - log_expected[k];
+      }
+    });
+    scored_ = true;
+  }
+
+  serial_size_t in_size_;
+  serial_size_t n_classes_;
+  serial_size_t n_candidates_;
+  candidate_sampler sampler_;
+  vec_t cdf_;  // cumulative custom proposal
+
+  /* candidates of the current minibatch */
+  std::vector<label_t> candidates_;
+  size_t tries_;
+  tensor_t candidate_logits_;
+  bool scored_;
+
+  /* classes set in the train-phase output; the rest of it is zero */
+  std::vector<label_t> written_;
+  bool out_clean_;
+
+  /* labels of the minibatch, see set_class_targets */
+  std::vector<label_t> targets_;
+  vec_t target_weights_;
+
+  row_sparse_gradient grad_;
+  bool sparse_grads_;
+  net_phase phase_;
+};
+
+}  // namespace tiny_dnn
@@ -6,10 +6,25 @@
     in the LICENSE file.
 */
 #pragma once
+#include <algorithm>
+#include <limits>
+
 #include "tiny_dnn/util/util.h"
 
 namespace tiny_dnn {
 
+/**
+ * one-hot target of a classification sample, without the dense vector:
+ * element `label` is `max` and every other element is `min`
+ **/
+struct label_target {
+  label_t label;
+  float_t min;
+  float_t max;
+
+  float_t operator[](size_t i) const { return i == label ? max : min; }
+};
+
 // mean-squared-error loss function for regression
 class mse {
  public:
@@ -32,6 +47,28 @@ class mse {
 
     return d;
   }
+
+  static float_t f(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    float_t d{0.0};
+
+    for (serial_size_t i = 0; i < y.size(); ++i)
+      d += (y[i] - t.min) * (y[i] - t.min);
+    d += (t.min - t.max) * (float_t(2) * y[t.label] - t.min - t.max);
+
+    return d / static_cast<float_t>(y.size());
+  }
+
+  static vec_t df(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    vec_t d(y.size());
+    float_t factor = float_t(2) / static_cast<float_t>(y.size());
+
+    for (serial_size_t i = 0; i < y.size(); ++i) d[i] = factor * (y[i] - t.min);
+    d[t.label] = factor * (y[t.label] - t.max);
+
+    return d;
+  }
 };
 
 // absolute loss function for regression
@@ -146,14 +183,119 @@ class cross_entropy_multiclass {
 
     return d;
   }
+
+  static float_t f(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    float_t d = -t.max * std::log(y[t.label]);
+
+    // only the true class contributes for the usual 0/1 targets
+    if (t.min != float_t(0)) {
+      for (serial_size_t i = 0; i < y.size(); ++i)
+        if (i != t.label) d += -t.min * std::log(y[i]);
+    }
+    return d;
+  }
+
+  static vec_t df(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    vec_t d(y.size(), float_t(0));
+
+    if (t.min != float_t(0)) {
+      for (serial_size_t i = 0; i < y.size(); ++i) d[i] = -t.min / y[i];
+    }
+    d[t.label] = -t.max / y[t.label];
+
+    return d;
+  }
 };
 
+/**
+ * negative log-likelihood of the true class, for output layers which
+ * compute their own gradient (sampled_softmax_layer,
+ * hierarchical_softmax_layer).
+ *
+ * f expects probabilities. df only marks the true class, weighted by its
+ * target value; the layer's back_propagation reads the mark back with
+ * marked_class and derives the gradient of its logits itself.
+ **/
+class class_nll {
+ public:
+  static float_t f(const vec_t &y, const vec_t &t) {
+    assert(y.size() == t.size());
+    const size_t label = max_index(t);
+    return -std::log(std::max(y[label], std::numeric_limits<float_t>::min()));
+  }
+
+  static vec_t df(const vec_t &y, const vec_t &t) {
+    assert(y.size() == t.size());
+    vec_t d(y.size(), float_t(0));
+    const size_t label = max_index(t);
+    d[label]           = t[label];
+    return d;
+  }
+
+  static float_t f(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    return -std::log(
+      std::max(y[t.label], std::numeric_limits<float_t>::min()));
+  }
+
+  static vec_t df(const vec_t &y, const label_target &t) {
+    assert(t.label < y.size());
+    vec_t d(y.size(), float_t(0));
+    d[t.label] = t.max;
+    return d;
+  }
+
+  ///< df(y, t) at t.label, the only element it sets
+  static float_t df_label(const label_target &t) { return t.max; }
+
+  /**
+   * finds the class marked by df in an incoming gradient.
+   * returns false if no class is marked (e.g. a zero target cost).
+   **/
+  static bool marked_class(const vec_t &dy, label_t *label, float_t *weight) {
+    for (size_t i = 0; i < dy.size(); i++) {
+      if (dy[i] != float_t(0)) {
+        *label  = static_cast<label_t>(i);
+        *weight = dy[i];
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+namespace detail {
+
+// losses with a label_target overload use it ...
+template <typename E>
+auto label_gradient(const vec_t &y, const label_target &t, int)
+  -> decltype(E::df(y, t)) {
+  return E::df(y, t);
+}
+
+// ... the others see a one-hot vector built for this sample only
+template <typename E>
+vec_t label_gradient(const vec_t &y, const label_target &t, long) {
+  vec_t dense(y.size(), t.min);
+  dense[t.label] = t.max;
+  return E::df(y, dense);
+}
+
+}  // namespace detail
+
 template <typename E>
 vec_t gradient(const vec_t &y, const vec_t &t) {
   assert(y.size() == t.size());
   return E::df(y, t);
 }
 
+template <typename E>
+vec_t gradient(const vec_t &y, const label_target &t) {
+  return detail::label_gradient<E>(y, t, 0);
+}
+
 template <typename E>
 std::vector<vec_t> gradient(const std::vector<vec_t> &y,
                             const std::vector<vec_t> &t) {
@@ -217,4 +359,29 @@ std::vector<tensor_t> gradient(const std::vector<tensor_t> &y,
   return gradients;
 }
 
+// gradient for a minibatch of class labels (single output channel)
+template <typename E>
+std::vector<tensor_t> gradient(const std::vector<tensor_t> &y,
+                               const std::vector<label_target> &t,
+                               const std::vector<tensor_t> &t_cost) {
+  const serial_size_t sample_count = static_cast<serial_size_t>(y.size());
+
+  std::vector<tensor_t> gradients(sample_count);
+
+  assert(y.size() == t.size());
+  assert(t_cost.empty() || t_cost.size() == t.size());
+
+  for (serial_size_t sample = 0; sample < sample_count; ++sample) {
+    assert(y[sample].size() == 1);
+
+    gradients[sample] = {gradient<E>(y[sample][0], t[sample])};
+
+    if (sample < t_cost.size()) {
+      apply_cost_if_defined(gradients[sample], t_cost[sample]);
+    }
+  }
+
+  return gradients;
+}
+
 }  // namespace tiny_dnn
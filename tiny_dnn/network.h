@@ -16,6 +16,7 @@
 #include <iterator>
 #include <limits>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
@@ -23,6 +24,7 @@
 
 #include "tiny_dnn/lossfunctions/loss_function.h"
 #include "tiny_dnn/nodes.h"
+#include "tiny_dnn/util/telemetry.h"
 #include "tiny_dnn/util/util.h"
 
 namespace tiny_dnn {
@@ -96,6 +98,22 @@ enum grad_check_mode {
 template <typename NetType>
 class network;
 
+namespace detail {
+
+// callbacks of fit/train may take the training telemetry or nothing
+template <typename Callback>
+auto invoke_train_callback(Callback &f, const training_telemetry &t, int)
+  -> decltype(f(t), void()) {
+  f(t);
+}
+
+template <typename Callback>
+void invoke_train_callback(Callback &f, const training_telemetry &, long) {
+  f();
+}
+
+}  // namespace detail
+
 template <typename Layer>
 network<sequential> &operator<<(network<sequential> &n, Layer &&l);
 
@@ -207,8 +225,9 @@ class network {
    *
    * The difference between train and fit method is how to specify desired
    * output.
-   * This method takes label_t argument and convert to target vector
-   * automatically.
+   * This method takes label_t argument and computes the loss gradient
+   * against the implied one-hot target directly, without materializing a
+   * target vector per sample.
    * To train correctly, output dimension of last layer must be greater or
    * equal
    * to
@@ -220,9 +239,12 @@ class network {
    * @param batch_size         number of samples per parameter update
    * @param epoch              number of training epochs
    * @param on_batch_enumerate callback for each mini-batch enumerate
+   *                           (optionally taking const training_telemetry&)
    * @param on_epoch_enumerate callback for each epoch
+   *                           (optionally taking const training_telemetry&)
    * @param reset_weights      set true if reset current network weights
-   * @param n_threads          number of tasks
+   * @param n_threads          number of tasks (1: train on the calling
+   *                           thread only)
    * @param t_cost             target costs (leave to nullptr in order to
    * assume
    * equal cost for every target)
@@ -247,14 +269,18 @@ class network {
     if (inputs.size() < batch_size || class_labels.size() < batch_size) {
       return false;
     }
-    std::vector<tensor_t> input_tensor, output_tensor, t_cost_tensor;
+    const serial_size_t dim_out = out_data_size();
+    for (size_t i = 0; i < class_labels.size(); i++) {
+      check_t(i, class_labels[i], dim_out);
+    }
+    std::vector<tensor_t> input_tensor, t_cost_tensor;
     normalize_tensor(inputs, input_tensor);
-    normalize_tensor(class_labels, output_tensor);
     if (!t_cost.empty()) normalize_tensor(t_cost, t_cost_tensor);
 
-    return fit<Error>(optimizer, input_tensor, output_tensor, batch_size, epoch,
-                      on_batch_enumerate, on_epoch_enumerate, reset_weights,
-                      n_threads, t_cost_tensor);
+    return train_epochs<Error>(optimizer, input_tensor, class_labels,
+                               batch_size, epoch, on_batch_enumerate,
+                               on_epoch_enumerate, reset_weights, n_threads,
+                               t_cost_tensor);
   }
 
   /**
@@ -302,9 +328,12 @@ class network {
    * @param batch_size         number of samples per parameter update
    * @param epoch              number of training epochs
    * @param on_batch_enumerate callback for each mini-batch enumerate
+   *                           (optionally taking const training_telemetry&)
    * @param on_epoch_enumerate callback for each epoch
+   *                           (optionally taking const training_telemetry&)
    * @param reset_weights      set true if reset current network weights
-   * @param n_threads          number of tasks
+   * @param n_threads          number of tasks (1: train on the calling
+   *                           thread only)
    * @param t_cost             target costs (leave to nullptr in order to
    * assume
    * equal cost for every target)
@@ -401,6 +430,34 @@ class network {
    */
   void stop_ongoing_training() { stop_training_ = true; }
 
+  /**
+   * throughput / latency statistics collected by fit and train
+   *
+   * It is safe to read from another thread while training is ongoing.
+   */
+  const training_telemetry &telemetry() const { return telemetry_; }
+
+  training_telemetry &telemetry() { return telemetry_; }
+
+  /**
+   * attach a per-layer profiler (nullptr to detach).
+   * The profiler is not owned and must outlive its use by the network.
+   */
+  void set_profiler(layer_profiler *profiler) { net_.set_profiler(profiler); }
+
+  /**
+   * run the parallel loops of this network's prediction and training under
+   * ctx, which caps their threads and sets their priority (nullptr to
+   * detach). The context may be shared by several networks.
+   */
+  void set_execution_context(std::shared_ptr<execution_context> ctx) {
+    context_ = ctx;
+  }
+
+  std::shared_ptr<execution_context> get_execution_context() const {
+    return context_;
+  }
+
   /**
    * test and generate confusion-matrix for classification task
    **/
@@ -562,6 +619,73 @@ class network {
    */
   serial_size_t in_data_size() const { return net_.in_data_size(); }
 
+  /**
+   * total number of trainable parameters
+   **/
+  uint64_t param_count() const {
+    uint64_t n = 0;
+    for (const auto &l : net_) n += l->param_count();
+    return n;
+  }
+
+  /**
+   * floating point operations of one forward pass, per sample
+   **/
+  uint64_t forward_flops() const {
+    uint64_t n = 0;
+    for (const auto &l : net_) n += l->forward_flops();
+    return n;
+  }
+
+  /**
+   * floating point operations of one backward pass, per sample
+   **/
+  uint64_t backward_flops() const {
+    uint64_t n = 0;
+    for (const auto &l : net_) n += l->backward_flops();
+    return n;
+  }
+
+  /**
+   * print per-layer output size, parameters, FLOPs and bytes (per sample)
+   * followed by the network totals
+   **/
+  template <typename Char, typename CharTraits>
+  void summary(std::basic_ostream<Char, CharTraits> &os) const {
+    // the caller's formatting is restored on return
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision     = os.precision();
+
+    os << std::left << std::setw(4) << "#" << std::setw(20) << "layer"
+       << std::right << std::setw(10) << "out" << std::setw(12) << "params"
+       << std::setw(14) << "fwd-FLOP" << std::setw(14) << "bwd-FLOP"
+       << std::setw(12) << "weight-B" << std::setw(12) << "act-B"
+       << std::setw(10) << "FLOP/B" << std::endl;
+
+    uint64_t weight_bytes = 0, activation_bytes = 0;
+    size_t index          = 0;
+    for (const auto &l : net_) {
+      os << std::left << std::setw(4) << index++ << std::setw(20)
+         << l->layer_type() << std::right << std::setw(10)
+         << l->out_data_size() << std::setw(12) << l->param_count()
+         << std::setw(14) << l->forward_flops() << std::setw(14)
+         << l->backward_flops() << std::setw(12) << l->weight_bytes()
+         << std::setw(12) << l->activation_bytes() << std::setw(10)
+         << std::fixed << std::setprecision(2) << l->arithmetic_intensity()
+         << std::endl;
+      weight_bytes += l->weight_bytes();
+      activation_bytes += l->activation_bytes();
+    }
+    os << std::left << std::setw(24) << "total" << std::right << std::setw(10)
+       << "" << std::setw(12) << param_count() << std::setw(14)
+       << forward_flops() << std::setw(14) << backward_flops()
+       << std::setw(12) << weight_bytes << std::setw(12) << activation_bytes
+       << std::endl;
+
+    os.flags(flags);
+    os.precision(precision);
+  }
+
   /**
    * set weight initializer to all layers
    **/
@@ -754,6 +878,8 @@ class network {
                               const std::vector<layer *> &inputs,
                               const std::vector<layer *> &outputs);
 
+  friend class training_runner;
+
   template <typename Error,
             typename Optimizer,
             typename OnBatchEnumerate,
@@ -768,24 +894,49 @@ class network {
            const bool reset_weights            = false,
            const int n_threads                 = CNN_TASK_SIZE,
            const std::vector<tensor_t> &t_cost = std::vector<tensor_t>()) {
+    return train_epochs<Error>(optimizer, inputs, desired_outputs, batch_size,
+                               epoch, on_batch_enumerate, on_epoch_enumerate,
+                               reset_weights, n_threads, t_cost);
+  }
+
+  // Target is tensor_t for regression, label_t for classification
+  template <typename Error,
+            typename Optimizer,
+            typename OnBatchEnumerate,
+            typename OnEpochEnumerate,
+            typename Target>
+  bool train_epochs(Optimizer &optimizer,
+                    const std::vector<tensor_t> &inputs,
+                    const std::vector<Target> &desired_outputs,
+                    size_t batch_size,
+                    int epoch,
+                    OnBatchEnumerate on_batch_enumerate,
+                    OnEpochEnumerate on_epoch_enumerate,
+                    const bool reset_weights,
+                    const int n_threads,
+                    const std::vector<tensor_t> &t_cost) {
     // check_training_data(in, t);
     check_target_cost_matrix(desired_outputs, t_cost);
+    execution_scope scope(context_.get());
     set_netphase(net_phase::train);
     net_.setup(reset_weights);
 
-    for (auto n : net_) n->set_parallelize(true);
+    for (auto n : net_) n->set_parallelize(n_threads > 1);
     optimizer.reset();
     stop_training_ = false;
     in_batch_.resize(batch_size);
     t_batch_.resize(batch_size);
+    label_batch_.resize(batch_size);
     for (int iter = 0; iter < epoch && !stop_training_; iter++) {
       for (size_t i = 0; i < inputs.size() && !stop_training_;
            i += batch_size) {
-        train_once<Error>(
-          optimizer, &inputs[i], &desired_outputs[i],
-          static_cast<int>(std::min(batch_size, inputs.size() - i)), n_threads,
-          get_target_cost_sample_pointer(t_cost, i));
-        on_batch_enumerate();
+        const int size =
+          static_cast<int>(std::min(batch_size, inputs.size() - i));
+        telemetry_.begin_batch();
+        train_once<Error>(optimizer, &inputs[i], &desired_outputs[i], size,
+                          n_threads, get_target_cost_sample_pointer(t_cost, i));
+        telemetry_.end_batch(static_cast<size_t>(size));
+        detail::invoke_train_callback(on_batch_enumerate, telemetry_, 0);
 
         /* if (i % 100 == 0 && layers_.is_exploded()) {
           std::cout << "[Warning]Detected infinite value in weight. stop
@@ -793,7 +944,8 @@ class network {
             return false;
         } */
       }
-      on_epoch_enumerate();
+      telemetry_.end_epoch();
+      detail::invoke_train_callback(on_epoch_enumerate, telemetry_, 0);
     }
     set_netphase(net_phase::test);
     return true;
@@ -804,15 +956,36 @@ class network {
    *
    * @param size is the number of data points to use in this batch
    */
-  template <typename E, typename Optimizer>
+  template <typename E, typename Optimizer, typename Target>
   void train_once(Optimizer &optimizer,
                   const tensor_t *in,
-                  const tensor_t *t,
+                  const Target *t,
                   int size,
                   const int nbThreads,
                   const tensor_t *t_cost) {
     if (size == 1) {
-      bprop<E>(fprop(in[0]), t[0], t_cost ? t_cost[0] : tensor_t());
+      std::vector<tensor_t> out, delta;
+      const auto target = sample_targets(t[0]);
+      const std::vector<tensor_t> cost{t_cost ? t_cost[0] : tensor_t()};
+      bool labeled;
+      {
+        train_phase_scope p(telemetry_, train_phase::forward);
+        out = fprop(std::vector<tensor_t>{in[0]});
+      }
+      {
+        train_phase_scope p(telemetry_, train_phase::loss);
+        labeled = set_class_targets<E>(target, cost, 0);
+        if (!labeled) delta = gradient<E>(out, target, cost);
+      }
+      {
+        train_phase_scope p(telemetry_, train_phase::backward);
+        if (labeled) {
+          net_.backward_from_targets();
+        } else {
+          net_.backward(delta);
+        }
+      }
+      train_phase_scope p(telemetry_, train_phase::update);
       net_.update_weights(&optimizer, 1);
     } else {
       train_onebatch<E>(optimizer, in, t, size, nbThreads, t_cost);
@@ -828,21 +1001,40 @@ class network {
    *
    * @param batch_size the number of data points to use in this batch
    */
-  template <typename E, typename Optimizer>
+  template <typename E, typename Optimizer, typename Target>
   void train_onebatch(Optimizer &optimizer,
                       const tensor_t *in,
-                      const tensor_t *t,
+                      const Target *t,
                       int batch_size,
                       const int num_tasks,
                       const tensor_t *t_cost) {
     CNN_UNREFERENCED_PARAMETER(num_tasks);
-    std::copy(&in[0], &in[0] + batch_size, &in_batch_[0]);
-    std::copy(&t[0], &t[0] + batch_size, &t_batch_[0]);
-    std::vector<tensor_t> t_cost_batch =
-      t_cost ? std::vector<tensor_t>(&t_cost[0], &t_cost[0] + batch_size)
-             : std::vector<tensor_t>();
-
-    bprop<E>(fprop(in_batch_), t_batch_, t_cost_batch);
+    std::vector<tensor_t> t_cost_batch, out, delta;
+    {
+      train_phase_scope p(telemetry_, train_phase::data_copy);
+      std::copy(&in[0], &in[0] + batch_size, &in_batch_[0]);
+      copy_targets(t, batch_size);
+      if (t_cost) t_cost_batch.assign(&t_cost[0], &t_cost[0] + batch_size);
+    }
+    {
+      train_phase_scope p(telemetry_, train_phase::forward);
+      out = fprop(in_batch_);
+    }
+    bool labeled;
+    {
+      train_phase_scope p(telemetry_, train_phase::loss);
+      labeled = set_class_targets<E>(batch_targets(t), t_cost_batch, 0);
+      if (!labeled) delta = gradient<E>(out, batch_targets(t), t_cost_batch);
+    }
+    {
+      train_phase_scope p(telemetry_, train_phase::backward);
+      if (labeled) {
+        net_.backward_from_targets();
+      } else {
+        net_.backward(delta);
+      }
+    }
+    train_phase_scope p(telemetry_, train_phase::update);
     net_.update_weights(&optimizer, batch_size);
   }
 
@@ -865,6 +1057,7 @@ class network {
   }
 
   std::vector<tensor_t> fprop(const std::vector<tensor_t> &in) {
+    execution_scope scope(context_.get());
     return net_.forward(in);
   }
 
@@ -1027,6 +1220,67 @@ class network {
       check_target_cost_element(t[i], t_cost[i]);
   }
 
+  void check_target_cost_matrix(const std::vector<label_t> &t,
+                                const std::vector<tensor_t> &t_cost) {
+    if (!t_cost.empty() && t.size() != t_cost.size()) {
+      throw nn_error(
+        "if target cost is supplied, "
+        "its length must equal that of target data");
+    }
+  }
+
+  // losses that set the label only (class_nll) hand label targets to an
+  // output layer that takes them, see layer::set_class_targets
+  template <typename E>
+  auto set_class_targets(const std::vector<label_target> &t,
+                         const std::vector<tensor_t> &t_cost,
+                         int) -> decltype(E::df_label(t[0]), bool()) {
+    std::vector<label_t> labels(t.size());
+    vec_t weights(t.size());
+    for (size_t s = 0; s < t.size(); s++) {
+      labels[s]  = t[s].label;
+      weights[s] = E::df_label(t[s]);
+      if (s < t_cost.size() && !t_cost[s].empty()) {
+        weights[s] *= t_cost[s][0][t[s].label];
+      }
+    }
+    return net_.set_class_targets(labels, weights);
+  }
+
+  template <typename E, typename Targets>
+  bool set_class_targets(const Targets &,
+                         const std::vector<tensor_t> &,
+                         long) {
+    return false;
+  }
+
+  label_target as_target(label_t t) const {
+    return label_target{t, net_.target_value_min(), net_.target_value_max()};
+  }
+
+  std::vector<tensor_t> sample_targets(const tensor_t &t) const { return {t}; }
+
+  std::vector<label_target> sample_targets(label_t t) const {
+    return {as_target(t)};
+  }
+
+  // fill the minibatch target buffer with the first `size` targets of t
+  void copy_targets(const tensor_t *t, int size) {
+    std::copy(&t[0], &t[0] + size, &t_batch_[0]);
+  }
+
+  void copy_targets(const label_t *t, int size) {
+    for (int i = 0; i < size; i++) label_batch_[i] = as_target(t[i]);
+  }
+
+  const std::vector<tensor_t> &batch_targets(const tensor_t *) const {
+    return t_batch_;
+  }
+
+  const std::vector<label_target> &batch_targets(const label_t *) const {
+    return label_batch_;
+  }
+
   const tensor_t *get_target_cost_sample_pointer(
     const std::vector<tensor_t> &t_cost, size_t i) {
     if (!t_cost.empty()) {
@@ -1060,8 +1314,11 @@ class network {
   std::string name_;
   NetType net_;
   bool stop_training_;
+  training_telemetry telemetry_;
+  std::shared_ptr<execution_context> context_;
   std::vector<tensor_t> in_batch_;
   std::vector<tensor_t> t_batch_;
+  std::vector<label_target> label_batch_;
 };
 
 /**
@@ -18,6 +18,7 @@
 
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/optimizers/optimizer.h"
+#include "tiny_dnn/util/layer_profiler.h"
 #include "tiny_dnn/util/util.h"
 
 namespace cereal {
@@ -81,6 +82,8 @@ class nodes {
   typedef std::vector<layer *>::iterator iterator;
   typedef std::vector<layer *>::const_iterator const_iterator;
 
+  nodes() : profiler_(nullptr) {}
+
   /**
    * propagate gradient
    * @param first        : gradient of cost function(dE/dy)
@@ -95,6 +98,24 @@ class nodes {
   virtual std::vector<tensor_t> forward(
     const std::vector<tensor_t> &first) = 0;  // NOLINT
 
+  /**
+   * hands the labels of a class_nll minibatch to the output layer in place
+   * of the loss gradient (see layer::set_class_targets). Returns false if
+   * it can't take them; otherwise backward_from_targets runs the backward
+   * pass.
+   **/
+  virtual bool set_class_targets(const std::vector<label_t> &labels,
+                                 const vec_t &weights) {
+    return !nodes_.empty() && nodes_.back()->set_class_targets(labels, weights);
+  }
+
+  ///< backward pass after set_class_targets
+  void backward_from_targets() {
+    for (auto l = nodes_.rbegin(); l != nodes_.rend(); l++) {
+      backward_layer(*l);
+    }
+  }
+
   /**
    * update weights and clear all gradients
    **/
@@ -119,6 +140,13 @@ class nodes {
     }
   }
 
+  /**
+   * attach a profiler to every forward/backward call (nullptr to detach)
+   **/
+  void set_profiler(layer_profiler *profiler) { profiler_ = profiler; }
+
+  layer_profiler *profiler() const { return profiler_; }
+
   size_t size() const { return nodes_.size(); }
   iterator begin() { return nodes_.begin(); }
   iterator end() { return nodes_.end(); }
@@ -250,6 +278,16 @@ class nodes {
     }
   }
 
+  void forward_layer(layer *l) {
+    layer_profiler::scope s(profiler_, *l, profile_phase::forward);
+    l->forward();
+  }
+
+  void backward_layer(layer *l) {
+    layer_profiler::scope s(profiler_, *l, profile_phase::backward);
+    l->backward();
+  }
+
   template <typename T>
   void push_back_impl(T &&node, std::true_type) {  // is_rvalue_reference
     own_nodes_.push_back(
@@ -267,6 +305,8 @@ class nodes {
   std::vector<std::shared_ptr<layer>> own_nodes_;
   /* List of all nodes which includes own_nodes */
   std::vector<layer *> nodes_;
+  /* Optional per-layer profiler, not owned */
+  layer_profiler *profiler_;
 };
 
 /**
@@ -282,7 +322,7 @@ class sequential : public nodes {
     nodes_.back()->set_out_grads(&reordered_grad[0], 1);
 
     for (auto l = nodes_.rbegin(); l != nodes_.rend(); l++) {
-      (*l)->backward();
+      backward_layer(*l);
     }
   }
 
@@ -294,7 +334,7 @@ class sequential : public nodes {
     nodes_.front()->set_in_data(&reordered_data[0], 1);
 
     for (auto l : nodes_) {
-      l->forward();
+      forward_layer(l);
     }
 
     std::vector<const tensor_t *> out;
@@ -382,10 +422,16 @@ class graph : public nodes {
     }
 
     for (auto l = nodes_.rbegin(); l != nodes_.rend(); l++) {
-      (*l)->backward();
+      backward_layer(*l);
     }
   }
 
+  bool set_class_targets(const std::vector<label_t> &labels,
+                         const vec_t &weights) override {
+    return output_layers_.size() == 1 &&
+           output_layers_[0]->set_class_targets(labels, weights);
+  }
+
   std::vector<tensor_t> forward(const std::vector<tensor_t> &in_data) override {
     size_t input_data_channel_count = in_data[0].size();
 
@@ -404,7 +450,7 @@ class graph : public nodes {
     }
 
     for (auto l : nodes_) {
-      l->forward();
+      forward_layer(l);
     }
     return merge_outs();
   }
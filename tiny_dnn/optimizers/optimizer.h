@@ -7,8 +7,11 @@
 */
 #pragma once
 
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
 
+#include "tiny_dnn/optimizers/optimizer_state.h"
 #include "tiny_dnn/util/util.h"
 
 namespace tiny_dnn {
@@ -27,13 +30,59 @@ struct optimizer {
   virtual ~optimizer()               = default;
   virtual void update(const vec_t &dW, vec_t &W, bool parallelize) = 0;
   virtual void reset() {}  // override to implement pre-learning action
+
+  /**
+   * row-sparse update: W holds rows of row_size values, and only the rows
+   * listed in rows (distinct) are updated, with dW[k * row_size, ...)
+   * being the gradient of row rows[k]. The other rows and their state are
+   * left alone ("lazy" update), so a step costs O(rows.size() * row_size).
+   * The default expands dW and runs the dense update on all of W.
+   **/
+  virtual void update_rows(const vec_t &dW,
+                           const std::vector<size_t> &rows,
+                           size_t row_size,
+                           vec_t &W,
+                           bool parallelize) {
+    vec_t full(W.size(), float_t(0));
+    for (size_t k = 0; k < rows.size(); k++) {
+      std::copy(&dW[k * row_size], &dW[k * row_size] + row_size,
+                &full[rows[k] * row_size]);
+    }
+    update(full, W, parallelize);
+  }
 };
 
 // helper class to hold N values for each weight
 template <int N>
 struct stateful_optimizer : public optimizer {
+  stateful_optimizer() : precision_(state_precision::fp32) {}
+
   void reset() override {
     for (auto &e : E_) e.clear();
+    for (auto &c : C_) c.clear();
+  }
+
+  /**
+   * keep the per-weight state in fp16 or blockwise 8-bit instead of
+   * float_t, cutting its memory by 2x or ~4x. Discards the current state.
+   **/
+  void set_state_precision(state_precision precision) {
+    precision_ = precision;
+    reset();
+  }
+
+  state_precision get_state_precision() const { return precision_; }
+
+  ///< bytes held by the state of all weights seen so far
+  size_t state_memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto &e : E_) {
+      for (const auto &v : e) bytes += v.second.size() * sizeof(float_t);
+    }
+    for (const auto &c : C_) {
+      for (const auto &v : c) bytes += v.second.memory_bytes();
+    }
+    return bytes;
   }
 
  protected:
@@ -43,7 +92,123 @@ struct stateful_optimizer : public optimizer {
     if (E_[Index][&key].empty()) E_[Index][&key].resize(key.size(), float_t());
     return E_[Index][&key];
   }
+
+  /**
+   * runs the update kernel f(s, begin, n) over consecutive ranges of key,
+   * where s[k] points to the n values of the k-th state for
+   * key[begin, begin + n). Compressed state is decoded before and encoded
+   * after each call, so it never exists in full precision.
+   **/
+  template <typename Func>
+  void for_each_state_block(const vec_t &key, bool parallelize, Func f) {
+    if (precision_ == state_precision::fp32) {
+      float_t *state[N];
+      for (int k = 0; k < N; k++) {
+        vec_t &e = E_[k][&key];
+        if (e.empty()) e.resize(key.size(), float_t());
+        state[k] = &e[0];
+      }
+      for_(parallelize, 0, key.size(), [&](const blocked_range &r) {
+        float_t *s[N];
+        for (int k = 0; k < N; k++) s[k] = state[k] + r.begin();
+        f(s, r.begin(), r.end() - r.begin());
+      });
+      return;
+    }
+
+    optimizer_state *state[N];
+    for (int k = 0; k < N; k++) {
+      optimizer_state &c = C_[k][&key];
+      if (c.size() != key.size()) c.resize(key.size(), precision_);
+      state[k] = &c;
+    }
+    for_i(parallelize, state[0]->blocks(),
+          [&](size_t b) {
+            float_t buf[N][optimizer_state::block_size];
+            float_t *s[N];
+            for (int k = 0; k < N; k++) {
+              state[k]->load(b, buf[k]);
+              s[k] = buf[k];
+            }
+            f(s, b * optimizer_state::block_size, state[0]->block_length(b));
+            for (int k = 0; k < N; k++) state[k]->store(b, buf[k]);
+          },
+          1);
+  }
+
+  /**
+   * like for_each_state_block, restricted to the given rows of key:
+   * f(s, j, i, n) updates key[i, i + n), whose gradient starts at j in the
+   * compact row-sparse gradient (see optimizer::update_rows).
+   **/
+  template <typename Func>
+  void for_each_state_row(const vec_t &key,
+                          const std::vector<size_t> &rows,
+                          size_t row_size,
+                          bool parallelize,
+                          Func f) {
+    if (precision_ == state_precision::fp32) {
+      float_t *state[N];
+      for (int k = 0; k < N; k++) {
+        vec_t &e = E_[k][&key];
+        if (e.empty()) e.resize(key.size(), float_t());
+        state[k] = &e[0];
+      }
+      for_i(parallelize, rows.size(),
+            [&](size_t r) {
+              const size_t i = rows[r] * row_size;
+              float_t *s[N];
+              for (int k = 0; k < N; k++) s[k] = state[k] + i;
+              f(s, r * row_size, i, row_size);
+            },
+            1);
+      return;
+    }
+
+    // rows may share a block: visit them in order so that each block is
+    // decoded and encoded once, as in for_each_state_block
+    optimizer_state *state[N];
+    for (int k = 0; k < N; k++) {
+      optimizer_state &c = C_[k][&key];
+      if (c.size() != key.size()) c.resize(key.size(), precision_);
+      state[k] = &c;
+    }
+    std::vector<size_t> order(rows.size());
+    for (size_t r = 0; r < order.size(); r++) order[r] = r;
+    std::sort(order.begin(), order.end(),
+              [&](size_t x, size_t y) { return rows[x] < rows[y]; });
+
+    const size_t bs   = optimizer_state::block_size;
+    const size_t none = static_cast<size_t>(-1);
+    size_t loaded     = none;
+    float_t buf[N][optimizer_state::block_size];
+    for (auto r : order) {
+      const size_t begin = rows[r] * row_size, end = begin + row_size;
+      for (size_t b = begin / bs; b * bs < end; b++) {
+        if (b != loaded) {
+          for (int k = 0; k < N; k++) {
+            if (loaded != none) state[k]->store(loaded, buf[k]);
+            state[k]->load(b, buf[k]);
+          }
+          loaded = b;
+        }
+        const size_t lo = std::max(begin, b * bs);
+        const size_t hi = std::min(end, b * bs + state[0]->block_length(b));
+        float_t *s[N];
+        for (int k = 0; k < N; k++) s[k] = buf[k] + (lo - b * bs);
+        f(s, r * row_size + (lo - begin), lo, hi - lo);
+      }
+    }
+    if (loaded != none) {
+      for (int k = 0; k < N; k++) state[k]->store(loaded, buf[k]);
+    }
+  }
+
   std::unordered_map<const vec_t *, vec_t> E_[N];
+  std::unordered_map<const vec_t *, optimizer_state> C_[N];
+
+ private:
+  state_precision precision_;
 };
 
 /**
@@ -57,15 +222,32 @@ struct adagrad : public stateful_optimizer<1> {
   adagrad() : alpha(float_t(0.01)), eps(float_t(1e-8)) {}
 
   void update(const vec_t &dW, vec_t &W, bool parallelize) {
-    vec_t &g = get<0>(W);
-    for_i(parallelize, static_cast<int>(W.size()), [&](int i) {
-      g[i] += dW[i] * dW[i];
-      W[i] -= alpha * dW[i] / (std::sqrt(g[i]) + eps);
+    for_each_state_block(W, parallelize, [&](float_t **s, size_t i0, size_t n) {
+      step(s, &dW[i0], &W[i0], n);
     });
   }
 
+  void update_rows(const vec_t &dW,
+                   const std::vector<size_t> &rows,
+                   size_t row_size,
+                   vec_t &W,
+                   bool parallelize) override {
+    for_each_state_row(W, rows, row_size, parallelize,
+                       [&](float_t **s, size_t j0, size_t i0, size_t n) {
+                         step(s, &dW[j0], &W[i0], n);
+                       });
+  }
+
   float_t alpha;  // learning rate
  private:
+  void step(float_t **s, const float_t *dW, float_t *W, size_t n) {
+    float_t *g = s[0];
+    for (size_t i = 0; i < n; i++) {
+      g[i] += dW[i] * dW[i];
+      W[i] -= alpha * dW[i] / (std::sqrt(g[i]) + eps);
+    }
+  }
+
   float_t eps;
 };
 
@@ -79,17 +261,33 @@ struct RMSprop : public stateful_optimizer<1> {
   RMSprop() : alpha(float_t(0.0001)), mu(float_t(0.99)), eps(float_t(1e-8)) {}
 
   void update(const vec_t &dW, vec_t &W, bool parallelize) {
-    vec_t &g = get<0>(W);
-
-    for_i(parallelize, static_cast<int>(W.size()), [&](int i) {
-      g[i] = mu * g[i] + (1 - mu) * dW[i] * dW[i];
-      W[i] -= alpha * dW[i] / std::sqrt(g[i] + eps);
+    for_each_state_block(W, parallelize, [&](float_t **s, size_t i0, size_t n) {
+      step(s, &dW[i0], &W[i0], n);
     });
   }
 
+  void update_rows(const vec_t &dW,
+                   const std::vector<size_t> &rows,
+                   size_t row_size,
+                   vec_t &W,
+                   bool parallelize) override {
+    for_each_state_row(W, rows, row_size, parallelize,
+                       [&](float_t **s, size_t j0, size_t i0, size_t n) {
+                         step(s, &dW[j0], &W[i0], n);
+                       });
+  }
+
   float_t alpha;  // learning rate
   float_t mu;     // decay term
  private:
+  void step(float_t **s, const float_t *dW, float_t *W, size_t n) {
+    float_t *g = s[0];
+    for (size_t i = 0; i < n; i++) {
+      g[i] = mu * g[i] + (1 - mu) * dW[i] * dW[i];
+      W[i] -= alpha * dW[i] / std::sqrt(g[i] + eps);
+    }
+  }
+
   float_t eps;  // constant value to avoid zero-division
 };
 
@@ -109,21 +307,29 @@ struct adam : public stateful_optimizer<2> {
       eps(float_t(1e-8)) {}
 
   void update(const vec_t &dW, vec_t &W, bool parallelize) {
-    vec_t &mt = get<0>(W);
-    vec_t &vt = get<1>(W);
-
     b1_t *= b1;
     b2_t *= b2;
 
-    for_i(parallelize, static_cast<int>(W.size()), [&](int i) {
-      mt[i] = b1 * mt[i] + (float_t(1) - b1) * dW[i];
-      vt[i] = b2 * vt[i] + (float_t(1) - b2) * dW[i] * dW[i];
-
-      W[i] -= alpha * (mt[i] / (float_t(1) - b1_t)) /
-              std::sqrt((vt[i] / (float_t(1) - b2_t)) + eps);
+    for_each_state_block(W, parallelize, [&](float_t **s, size_t i0, size_t n) {
+      step(s, &dW[i0], &W[i0], n);
     });
   }
 
+  ///< the moments of rows without gradient do not decay (lazy adam)
+  void update_rows(const vec_t &dW,
+                   const std::vector<size_t> &rows,
+                   size_t row_size,
+                   vec_t &W,
+                   bool parallelize) override {
+    b1_t *= b1;
+    b2_t *= b2;
+
+    for_each_state_row(W, rows, row_size, parallelize,
+                       [&](float_t **s, size_t j0, size_t i0, size_t n) {
+                         step(s, &dW[j0], &W[i0], n);
+                       });
+  }
+
   float_t alpha;  // learning rate
   float_t b1;     // decay term
   float_t b2;     // decay term
@@ -131,6 +337,18 @@ struct adam : public stateful_optimizer<2> {
   float_t b2_t;   // decay term power t
 
  private:
+  void step(float_t **s, const float_t *dW, float_t *W, size_t n) {
+    float_t *mt = s[0];
+    float_t *vt = s[1];
+    for (size_t i = 0; i < n; i++) {
+      mt[i] = b1 * mt[i] + (float_t(1) - b1) * dW[i];
+      vt[i] = b2 * vt[i] + (float_t(1) - b2) * dW[i] * dW[i];
+
+      W[i] -= alpha * (mt[i] / (float_t(1) - b1_t)) /
+              std::sqrt((vt[i] / (float_t(1) - b2_t)) + eps);
+    }
+  }
+
   float_t eps;  // constant value to avoid zero-division
 };
 
@@ -147,6 +365,22 @@ struct gradient_descent : public optimizer {
           [&](int i) { W[i] = W[i] - alpha * (dW[i] + lambda * W[i]); });
   }
 
+  void update_rows(const vec_t &dW,
+                   const std::vector<size_t> &rows,
+                   size_t row_size,
+                   vec_t &W,
+                   bool parallelize) override {
+    for_i(parallelize, rows.size(),
+          [&](size_t k) {
+            const float_t *g = &dW[k * row_size];
+            float_t *w       = &W[rows[k] * row_size];
+            for (size_t i = 0; i < row_size; i++) {
+              w[i] = w[i] - alpha * (g[i] + lambda * w[i]);
+            }
+          },
+          1);
+  }
+
   float_t alpha;   // learning rate
   float_t lambda;  // weight decay
 };
@@ -163,18 +397,35 @@ struct momentum : public stateful_optimizer<1> {
   momentum() : alpha(float_t(0.01)), lambda(float_t{0}), mu(float_t(0.9)) {}
 
   void update(const vec_t &dW, vec_t &W, bool parallelize) {
-    vec_t &dWprev = get<0>(W);
-
-    for_i(parallelize, static_cast<int>(W.size()), [&](int i) {
-      float_t V = mu * dWprev[i] - alpha * (dW[i] + W[i] * lambda);
-      W[i] += V;
-      dWprev[i] = V;
+    for_each_state_block(W, parallelize, [&](float_t **s, size_t i0, size_t n) {
+      step(s, &dW[i0], &W[i0], n);
     });
   }
 
+  void update_rows(const vec_t &dW,
+                   const std::vector<size_t> &rows,
+                   size_t row_size,
+                   vec_t &W,
+                   bool parallelize) override {
+    for_each_state_row(W, rows, row_size, parallelize,
+                       [&](float_t **s, size_t j0, size_t i0, size_t n) {
+                         step(s, &dW[j0], &W[i0], n);
+                       });
+  }
+
   float_t alpha;   // learning rate
   float_t lambda;  // weight decay
   float_t mu;      // momentum
+
+ private:
+  void step(float_t **s, const float_t *dW, float_t *W, size_t n) {
+    float_t *dWprev = s[0];
+    for (size_t i = 0; i < n; i++) {
+      float_t V = mu * dWprev[i] - alpha * (dW[i] + W[i] * lambda);
+      W[i] += V;
+      dWprev[i] = V;
+    }
+  }
 };
 
 }  // namespace tiny_dnn
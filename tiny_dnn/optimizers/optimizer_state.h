@@ -0,0 +1,188 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * how an optimizer stores its per-weight state (moments, accumulators)
+ **/
+enum class state_precision {
+  fp32,  ///< one float_t per value
+  fp16,  ///< one IEEE half per value
+  int8   ///< one 8-bit code per value plus one float scale per block
+};
+
+/**
+ * round to the nearest IEEE 754 binary16 value (ties to even)
+ **/
+inline uint16_t float_to_half(float value) {
+  uint32_t x;
+  std::memcpy(&x, &value, sizeof(x));
+  const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+  x &= 0x7fffffffu;
+
+  if (x >= 0x7f800000u) {  // inf, nan
+    return sign | 0x7c00u | (x > 0x7f800000u ? 0x200u : 0u);
+  }
+  if (x >= 0x477ff000u) return sign | 0x7c00u;  // rounds past 65504
+  if (x < 0x38800000u) {                         // half subnormal or zero
+    if (x <= 0x33000000u) return sign;
+    const uint32_t shift = 126 - (x >> 23);
+    const uint32_t m     = (x & 0x7fffffu) | 0x800000u;
+    const uint32_t rem   = m & ((1u << shift) - 1);
+    const uint32_t half  = 1u << (shift - 1);
+    uint32_t h           = m >> shift;
+    if (rem > half || (rem == half && (h & 1))) h++;
+    return static_cast<uint16_t>(sign | h);
+  }
+  // rebias the exponent from 127 to 15; a carry may round up into it
+  uint32_t h         = (x - 0x38000000u) >> 13;
+  const uint32_t rem = x & 0x1fffu;
+  if (rem > 0x1000u || (rem == 0x1000u && (h & 1))) h++;
+  return static_cast<uint16_t>(sign | h);
+}
+
+inline float half_to_float(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  uint32_t e          = (h >> 10) & 0x1fu;
+  uint32_t m          = h & 0x3ffu;
+  uint32_t x;
+
+  if (e == 0x1f) {
+    x = sign | 0x7f800000u | (m << 13);
+  } else if (e != 0) {
+    x = sign | ((e + 112) << 23) | (m << 13);
+  } else if (m == 0) {
+    x = sign;
+  } else {  // subnormal, normalize the mantissa
+    e = 113;
+    while (!(m & 0x400u)) {
+      m <<= 1;
+      e--;
+    }
+    x = sign | (e << 23) | ((m & 0x3ffu) << 13);
+  }
+  float value;
+  std::memcpy(&value, &x, sizeof(value));
+  return value;
+}
+
+/**
+ * one optimizer state vector held in reduced precision.
+ *
+ * Values are accessed a block at a time: load() decodes a block into
+ * float_t, the update kernel works on it, and store() encodes it back.
+ * In int8 mode each block keeps its largest magnitude as scale and every
+ * value as a signed code q, decoded to scale * (q / 127)^2. Squaring
+ * gives small values a much finer grid than a linear code would, which
+ * second moments spanning several decades need.
+ *
+ * Non-zero values never decode to zero: they are clamped to the smallest
+ * non-zero step of their block (scale / 127^2 in int8, 2^-24 in fp16).
+ * A second moment rounded to zero would otherwise turn Adam's step into
+ * alpha * m / sqrt(eps); the floor errs towards smaller steps instead.
+ **/
+class optimizer_state {
+ public:
+  static constexpr size_t block_size = 256;
+
+  optimizer_state() : precision_(state_precision::fp16), size_(0) {}
+
+  ///< zero-filled state of n values
+  void resize(size_t n, state_precision precision) {
+    if (precision == state_precision::fp32) {
+      throw nn_error("fp32 state is kept uncompressed");
+    }
+    precision_ = precision;
+    size_      = n;
+    half_.clear();
+    codes_.clear();
+    scales_.clear();
+    if (precision == state_precision::fp16) {
+      half_.assign(n, uint16_t(0));
+    } else {
+      codes_.assign(n, int8_t(0));
+      scales_.assign(blocks(), 0.0f);
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  size_t blocks() const { return (size_ + block_size - 1) / block_size; }
+
+  ///< number of values in block b
+  size_t block_length(size_t b) const {
+    return std::min(size_t(block_size), size_ - b * block_size);
+  }
+
+  ///< decode block b into dst[0, block_length(b))
+  void load(size_t b, float_t *dst) const {
+    const size_t begin = b * block_size, n = block_length(b);
+    if (precision_ == state_precision::fp16) {
+      for (size_t i = 0; i < n; i++) dst[i] = half_to_float(half_[begin + i]);
+      return;
+    }
+    const float_t scale = scales_[b] / float_t(127 * 127);
+    for (size_t i = 0; i < n; i++) {
+      const float_t q = codes_[begin + i];
+      dst[i]          = scale * q * std::abs(q);
+    }
+  }
+
+  ///< encode src[0, block_length(b)) into block b
+  void store(size_t b, const float_t *src) {
+    const size_t begin = b * block_size, n = block_length(b);
+    if (precision_ == state_precision::fp16) {
+      for (size_t i = 0; i < n; i++) {
+        uint16_t h = float_to_half(static_cast<float>(src[i]));
+        if ((h & 0x7fffu) == 0 && src[i] != 0) h |= 1u;
+        half_[begin + i] = h;
+      }
+      return;
+    }
+    float_t max_abs = 0;
+    for (size_t i = 0; i < n; i++) {
+      max_abs = std::max(max_abs, std::abs(src[i]));
+    }
+    scales_[b] = static_cast<float>(max_abs);
+    if (max_abs == 0) {
+      std::fill(&codes_[begin], &codes_[begin] + n, int8_t(0));
+      return;
+    }
+    const float_t rcp = float_t(1) / max_abs;
+    for (size_t i = 0; i < n; i++) {
+      float_t q = std::round(127 * std::sqrt(std::abs(src[i]) * rcp));
+      if (q == 0 && src[i] != 0) q = 1;
+      codes_[begin + i] = static_cast<int8_t>(src[i] < 0 ? -q : q);
+    }
+  }
+
+  ///< bytes used by codes and scales
+  size_t memory_bytes() const {
+    return half_.size() * sizeof(uint16_t) + codes_.size() * sizeof(int8_t) +
+           scales_.size() * sizeof(float);
+  }
+
+ private:
+  state_precision precision_;
+  size_t size_;
+  std::vector<uint16_t> half_;
+  std::vector<int8_t> codes_;
+  std::vector<float> scales_;
+};
+
+}  // namespace tiny_dnn
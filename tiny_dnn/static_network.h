@@ -0,0 +1,411 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <istream>
+#include <type_traits>
+
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/util/nn_error.h"
+
+namespace tiny_dnn {
+
+/**
+ * layers of a static_network.
+ *
+ * Each layer is a descriptor whose member template bind<In> gives, for an
+ * input shape In, the output shape (out_shape), the number of weights and
+ * biases (weight_size, bias_size) and the forward pass
+ * forward(in, out, weight, bias). Every size is a template argument, so
+ * loops have constant trip counts that the compiler can unroll, and shape
+ * errors are reported at compile time.
+ **/
+namespace static_layers {
+
+/**
+ * width x height x depth, laid out as tiny_dnn's shape3d
+ **/
+template <size_t W, size_t H, size_t D>
+struct shape {
+  static constexpr size_t width  = W;
+  static constexpr size_t height = H;
+  static constexpr size_t depth  = D;
+  static constexpr size_t size   = W * H * D;
+};
+
+template <size_t W, size_t H, size_t D>
+constexpr size_t shape<W, H, D>::width;
+template <size_t W, size_t H, size_t D>
+constexpr size_t shape<W, H, D>::height;
+template <size_t W, size_t H, size_t D>
+constexpr size_t shape<W, H, D>::depth;
+template <size_t W, size_t H, size_t D>
+constexpr size_t shape<W, H, D>::size;
+
+/**
+ * convolutional_layer with valid padding, a bias and a full connection
+ * table
+ **/
+template <size_t KW, size_t KH, size_t InC, size_t OutC, size_t Stride = 1>
+struct conv {
+  template <typename In>
+  struct bind {
+    static_assert(In::depth == InC, "conv: input depth mismatch");
+    static_assert(In::width >= KW && In::height >= KH,
+                  "conv: kernel larger than the input");
+
+    typedef shape<(In::width - KW) / Stride + 1,
+                  (In::height - KH) / Stride + 1,
+                  OutC>
+      out_shape;
+    static constexpr size_t weight_size = KW * KH * InC * OutC;
+    static constexpr size_t bias_size   = OutC;
+
+    static void forward(const float_t *in,
+                        float_t *out,
+                        const float_t *w,
+                        const float_t *b) {
+      const size_t iw = In::width;
+      const size_t ih = In::height;
+      const size_t ow = out_shape::width;
+      const size_t oh = out_shape::height;
+
+      for (size_t o = 0; o < OutC; o++) {
+        for (size_t y = 0; y < oh; y++) {
+          for (size_t x = 0; x < ow; x++) {
+            float_t sum = b[o];
+            for (size_t c = 0; c < InC; c++) {
+              const float_t *pw = w + (InC * o + c) * KH * KW;
+              const float_t *pin =
+                in + (c * ih + y * Stride) * iw + x * Stride;
+              for (size_t wy = 0; wy < KH; wy++) {
+                for (size_t wx = 0; wx < KW; wx++) {
+                  sum += pw[wy * KW + wx] * pin[wy * iw + wx];
+                }
+              }
+            }
+            out[(o * oh + y) * ow + x] = sum;
+          }
+        }
+      }
+    }
+  };
+};
+
+/**
+ * fully_connected_layer with a bias
+ **/
+template <size_t Out>
+struct fc {
+  template <typename In>
+  struct bind {
+    typedef shape<Out, 1, 1> out_shape;
+    static constexpr size_t weight_size = In::size * Out;
+    static constexpr size_t bias_size   = Out;
+
+    static void forward(const float_t *in,
+                        float_t *out,
+                        const float_t *w,
+                        const float_t *b) {
+      for (size_t i = 0; i < Out; i++) out[i] = b[i];
+      for (size_t c = 0; c < In::size; c++) {
+        const float_t v   = in[c];
+        const float_t *pw = w + c * Out;
+        for (size_t i = 0; i < Out; i++) out[i] += pw[i] * v;
+      }
+    }
+  };
+};
+
+/**
+ * average_pooling_layer of pool size and stride N, with its per-channel
+ * weight and bias. As in average_pooling_layer, the weights take
+ * N x N x depth values of which only the first depth are used.
+ **/
+template <size_t N>
+struct avepool {
+  template <typename In>
+  struct bind {
+    static_assert(In::width % N == 0 && In::height % N == 0,
+                  "avepool: input size is not a multiple of the pool size");
+
+    typedef shape<In::width / N, In::height / N, In::depth> out_shape;
+    static constexpr size_t weight_size = N * N * In::depth;
+    static constexpr size_t bias_size   = In::depth;
+
+    static void forward(const float_t *in,
+                        float_t *out,
+                        const float_t *w,
+                        const float_t *b) {
+      for (size_t d = 0; d < In::depth; d++) {
+        const float_t weight = w[d] * (float_t(1) / (N * N));
+        for (size_t y = 0; y < out_shape::height; y++) {
+          for (size_t x = 0; x < out_shape::width; x++) {
+            const float_t *pin =
+              in + (d * In::height + y * N) * In::width + x * N;
+            float_t sum{0};
+            for (size_t py = 0; py < N; py++) {
+              for (size_t px = 0; px < N; px++) sum += pin[py * In::width + px];
+            }
+            out[(d * out_shape::height + y) * out_shape::width + x] =
+              sum * weight + b[d];
+          }
+        }
+      }
+    }
+  };
+};
+
+/**
+ * max_pooling_layer of pool size and stride N
+ **/
+template <size_t N>
+struct maxpool {
+  template <typename In>
+  struct bind {
+    static_assert(In::width % N == 0 && In::height % N == 0,
+                  "maxpool: input size is not a multiple of the pool size");
+
+    typedef shape<In::width / N, In::height / N, In::depth> out_shape;
+    static constexpr size_t weight_size = 0;
+    static constexpr size_t bias_size   = 0;
+
+    static void forward(const float_t *in,
+                        float_t *out,
+                        const float_t *,
+                        const float_t *) {
+      for (size_t d = 0; d < In::depth; d++) {
+        for (size_t y = 0; y < out_shape::height; y++) {
+          for (size_t x = 0; x < out_shape::width; x++) {
+            const float_t *pin =
+              in + (d * In::height + y * N) * In::width + x * N;
+            float_t m = pin[0];
+            for (size_t py = 0; py < N; py++) {
+              for (size_t px = 0; px < N; px++) {
+                m = std::max(m, pin[py * In::width + px]);
+              }
+            }
+            out[(d * out_shape::height + y) * out_shape::width + x] = m;
+          }
+        }
+      }
+    }
+  };
+};
+
+#define CNN_STATIC_ACTIVATION(name, f)                                   \
+  struct name {                                                          \
+    template <typename In>                                               \
+    struct bind {                                                        \
+      typedef In out_shape;                                              \
+      static constexpr size_t weight_size = 0;                           \
+      static constexpr size_t bias_size   = 0;                           \
+                                                                         \
+      static void forward(const float_t *in,                             \
+                          float_t *out,                                  \
+                          const float_t *,                               \
+                          const float_t *) {                             \
+        for (size_t i = 0; i < In::size; i++) {                          \
+          const float_t x = in[i];                                       \
+          out[i]          = (f);                                         \
+        }                                                                \
+      }                                                                  \
+    };                                                                   \
+  };
+
+CNN_STATIC_ACTIVATION(tanh, std::tanh(x))
+CNN_STATIC_ACTIVATION(relu, std::max(x, float_t(0)))
+CNN_STATIC_ACTIVATION(sigmoid, float_t(1) / (float_t(1) + std::exp(-x)))
+
+#undef CNN_STATIC_ACTIVATION
+
+struct softmax {
+  template <typename In>
+  struct bind {
+    typedef In out_shape;
+    static constexpr size_t weight_size = 0;
+    static constexpr size_t bias_size   = 0;
+
+    static void forward(const float_t *in,
+                        float_t *out,
+                        const float_t *,
+                        const float_t *) {
+      const float_t alpha = *std::max_element(in, in + In::size);
+      float_t denominator(0);
+      for (size_t i = 0; i < In::size; i++) {
+        out[i] = std::exp(in[i] - alpha);
+        denominator += out[i];
+      }
+      for (size_t i = 0; i < In::size; i++) out[i] /= denominator;
+    }
+  };
+};
+
+}  // namespace static_layers
+
+namespace detail {
+
+constexpr size_t static_max(size_t a, size_t b) { return a > b ? a : b; }
+
+/**
+ * the parameters of a layer followed by the rest of the chain
+ **/
+template <typename In, typename... Layers>
+struct static_chain;
+
+template <typename In>
+struct static_chain<In> {
+  typedef In out_shape;
+  static constexpr size_t buffer_size = 0;
+  static constexpr size_t param_size  = 0;
+
+  void forward(const float_t *, float_t *, float_t *, float_t *) const {}
+  void load(std::istream &) {}
+  void load(const float_t *&) {}
+};
+
+template <typename In, typename L, typename... Rest>
+struct static_chain<In, L, Rest...> {
+  typedef typename L::template bind<In> layer;
+  typedef static_chain<typename layer::out_shape, Rest...> next;
+  typedef typename next::out_shape out_shape;
+  typedef std::integral_constant<bool, sizeof...(Rest) == 0> is_last;
+
+  // largest output of a layer other than the last
+  static constexpr size_t buffer_size =
+    is_last::value ? 0 : static_max(layer::out_shape::size, next::buffer_size);
+  static constexpr size_t param_size =
+    layer::weight_size + layer::bias_size + next::param_size;
+
+  /**
+   * runs the chain from in to out, alternating between the buffers a and b
+   * for the intermediate outputs
+   **/
+  void forward(const float_t *in, float_t *out, float_t *a, float_t *b) const {
+    forward(in, out, a, b, is_last());
+  }
+
+  void load(std::istream &is) {
+    for (auto &w : weight) is >> w;
+    for (auto &w : bias) is >> w;
+    rest.load(is);
+  }
+
+  void load(const float_t *&src) {
+    std::copy(src, src + weight.size(), weight.begin());
+    src += weight.size();
+    std::copy(src, src + bias.size(), bias.begin());
+    src += bias.size();
+    rest.load(src);
+  }
+
+  std::array<float_t, layer::weight_size> weight;
+  std::array<float_t, layer::bias_size> bias;
+  next rest;
+
+ private:
+  void forward(const float_t *in,
+               float_t *out,
+               float_t *,
+               float_t *,
+               std::true_type) const {
+    layer::forward(in, out, weight.data(), bias.data());
+  }
+
+  void forward(const float_t *in,
+               float_t *out,
+               float_t *a,
+               float_t *b,
+               std::false_type) const {
+    layer::forward(in, a, weight.data(), bias.data());
+    rest.forward(a, out, b, a);
+  }
+};
+
+}  // namespace detail
+
+/**
+ * a sequential network fixed at compile time, for inference on targets
+ * where network<sequential> is too large or too slow.
+ *
+ * Layers and shapes are template arguments, so there is no virtual call,
+ * heap allocation or runtime shape check: the weights and two buffers
+ * sized for the largest intermediate output are held by value, and the
+ * forward pass of each layer is inlined with constant loop bounds. Declare
+ * the network static (or global) to keep it off the stack.
+ *
+ * Weights are read in the order network<sequential>::save(std::ostream&)
+ * writes them (weights then bias of each layer, activations having none),
+ * so a trained network is moved over with:
+ *
+ * @code
+ * typedef static_network<static_layers::shape<32, 32, 1>,
+ *                        static_layers::conv<5, 5, 1, 6>,
+ *                        static_layers::tanh,
+ *                        static_layers::avepool<2>,
+ *                        static_layers::fc<10>>
+ *   lenet;
+ *
+ * std::stringstream ss;
+ * ss << trained;  // network<sequential> of the same layers
+ * static lenet net;
+ * net.load(ss);
+ * net.predict(image, scores);
+ * @endcode
+ *
+ * or from an array holding the same values, e.g. one compiled into flash.
+ **/
+template <typename In, typename... Layers>
+class static_network {
+  static_assert(sizeof...(Layers) > 0, "static_network needs a layer");
+  typedef detail::static_chain<In, Layers...> chain;
+
+ public:
+  typedef In in_shape;
+  typedef typename chain::out_shape out_shape;
+
+  static constexpr size_t in_size() { return in_shape::size; }
+  static constexpr size_t out_size() { return out_shape::size; }
+  static constexpr size_t param_size() { return chain::param_size; }
+
+  /**
+   * @param in  [in]  in_size() values
+   * @param out [out] out_size() values
+   **/
+  void predict(const float_t *in, float_t *out) {
+    chain_.forward(in, out, buffer_[0].data(), buffer_[1].data());
+  }
+
+  // index of the largest output
+  size_t predict_label(const float_t *in) {
+    std::array<float_t, out_shape::size> out;
+    predict(in, out.data());
+    return static_cast<size_t>(std::max_element(out.begin(), out.end()) -
+                               out.begin());
+  }
+
+  void load(std::istream &is) {
+    chain_.load(is);
+    if (!is) throw nn_error("failed to read the weights of static_network");
+  }
+
+  /**
+   * @param params [in] param_size() values
+   **/
+  void load(const float_t *params) { chain_.load(params); }
+
+ private:
+  chain chain_;
+  std::array<float_t, chain::buffer_size> buffer_[2];
+};
+
+}  // namespace tiny_dnn
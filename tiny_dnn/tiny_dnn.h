@@ -10,6 +10,7 @@
 #include "tiny_dnn/config.h"
 #include "tiny_dnn/network.h"
 #include "tiny_dnn/nodes.h"
+#include "tiny_dnn/static_network.h"
 
 #include "tiny_dnn/core/framework/tensor.h"
 
@@ -20,19 +21,26 @@
 #include "tiny_dnn/layers/average_pooling_layer.h"
 #include "tiny_dnn/layers/average_unpooling_layer.h"
 #include "tiny_dnn/layers/batch_normalization_layer.h"
+#include "tiny_dnn/layers/binary_convolutional_layer.h"
+#include "tiny_dnn/layers/binary_fully_connected_layer.h"
 #include "tiny_dnn/layers/concat_layer.h"
 #include "tiny_dnn/layers/convolutional_layer.h"
 #include "tiny_dnn/layers/deconvolutional_layer.h"
 #include "tiny_dnn/layers/dropout_layer.h"
+#include "tiny_dnn/layers/fake_quantization_layer.h"
 #include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/layers/gru_layer.h"
+#include "tiny_dnn/layers/hierarchical_softmax_layer.h"
 #include "tiny_dnn/layers/input_layer.h"
 #include "tiny_dnn/layers/linear_layer.h"
 #include "tiny_dnn/layers/lrn_layer.h"
+#include "tiny_dnn/layers/lstm_layer.h"
 #include "tiny_dnn/layers/max_pooling_layer.h"
 #include "tiny_dnn/layers/max_unpooling_layer.h"
 #include "tiny_dnn/layers/power_layer.h"
 #include "tiny_dnn/layers/quantized_convolutional_layer.h"
 #include "tiny_dnn/layers/quantized_deconvolutional_layer.h"
+#include "tiny_dnn/layers/sampled_softmax_layer.h"
 #include "tiny_dnn/layers/slice_layer.h"
 
 #include "tiny_dnn/activations/elu_layer.h"
@@ -52,9 +60,13 @@
 #include "tiny_dnn/lossfunctions/loss_function.h"
 #include "tiny_dnn/optimizers/optimizer.h"
 
+#include "tiny_dnn/util/c_code_generator.h"
 #include "tiny_dnn/util/deform.h"
+#include "tiny_dnn/util/early_exit_cascade.h"
+#include "tiny_dnn/util/ensemble.h"
 #include "tiny_dnn/util/graph_visualizer.h"
 #include "tiny_dnn/util/product.h"
+#include "tiny_dnn/util/training_runner.h"
 #include "tiny_dnn/util/weight_init.h"
 
 #include "tiny_dnn/io/cifar10_parser.h"
@@ -69,6 +81,12 @@
 #ifndef CNN_NO_SERIALIZATION
 #include "tiny_dnn/util/deserialization_helper.h"
 #include "tiny_dnn/util/serialization_helper.h"
+#include "tiny_dnn/util/background_evaluator.h"
+#include "tiny_dnn/util/channel_pruning.h"
+#include "tiny_dnn/util/low_rank_factorization.h"
+#include "tiny_dnn/util/model_compression.h"
+#include "tiny_dnn/util/packed_model.h"
+#include "tiny_dnn/util/quantization_exporter.h"
 #endif  // CNN_NO_SERIALIZATION
 
 // shortcut version of layer names
@@ -79,6 +97,8 @@ using conv = tiny_dnn::convolutional_layer;
 
 using q_conv = tiny_dnn::quantized_convolutional_layer;
 
+using b_conv = tiny_dnn::binary_convolutional_layer;
+
 using max_pool = tiny_dnn::max_pooling_layer;
 
 using ave_pool = tiny_dnn::average_pooling_layer;
@@ -87,6 +107,8 @@ using fc = tiny_dnn::fully_connected_layer;
 
 using dense = tiny_dnn::fully_connected_layer;
 
+using b_fc = tiny_dnn::binary_fully_connected_layer;
+
 #ifdef CNN_USE_GEMMLOWP
 using q_fc = tiny_dnn::quantized_fully_connected_layer;
 #endif
@@ -95,12 +117,18 @@ using add = tiny_dnn::elementwise_add_layer;
 
 using dropout = tiny_dnn::dropout_layer;
 
+using fake_quant = tiny_dnn::fake_quantization_layer;
+
+using gru = tiny_dnn::gru_layer;
+
 using input = tiny_dnn::input_layer;
 
 using linear = linear_layer;
 
 using lrn = tiny_dnn::lrn_layer;
 
+using lstm = tiny_dnn::lstm_layer;
+
 using concat = tiny_dnn::concat_layer;
 
 using deconv = tiny_dnn::deconvolutional_layer;
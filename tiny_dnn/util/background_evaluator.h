@@ -0,0 +1,257 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tiny_dnn/layers/batch_normalization_layer.h"
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+/**
+ * result of evaluating one snapshot
+ **/
+struct snapshot_evaluation {
+  size_t tag;          ///< value passed to submit, e.g. the epoch
+  result test_result;  ///< same as network::test on the snapshot
+  double seconds;      ///< wall time of the evaluation
+};
+
+/**
+ * validation on a separate thread, concurrently with training.
+ *
+ * submit() copies the current weights of the network into a snapshot and
+ * returns; the snapshot is evaluated in mini-batches on the evaluator's
+ * own thread, and the result is passed to the callback from that thread.
+ * Calling submit from the on_epoch_enumerate callback of fit/train costs
+ * only the weight copy instead of a full network::test:
+ *
+ * @code
+ * background_evaluator<sequential> eval(test_images, test_labels,
+ *   [](const snapshot_evaluation &e) {
+ *     std::cout << e.tag << ": " << e.test_result.accuracy() << std::endl;
+ *   });
+ * int epoch = 0;
+ * net.train<mse>(opt, images, labels, 32, 10, [] {},
+ *                [&] { eval.submit(net, epoch++); });
+ * eval.wait();
+ * @endcode
+ *
+ * Two snapshots are double-buffered: one is being evaluated while the
+ * other receives the next submit, so weights are copied into existing
+ * buffers after the first two submits. If a snapshot is submitted before
+ * the previous one has been picked up, the previous one is replaced and
+ * counted in dropped(); the latest snapshot is always evaluated.
+ *
+ * The evaluation runs on a single thread with layer-level parallelism
+ * off, so it occupies one core and training keeps the others.
+ **/
+template <typename NetType>
+class background_evaluator {
+ public:
+  typedef std::function<void(const snapshot_evaluation &)> callback;
+
+  /**
+   * @param in         [in] validation inputs
+   * @param labels     [in] label-id of each input
+   * @param on_result  [in] called on the evaluator thread for each snapshot
+   * @param batch_size [in] number of samples per forward pass
+   **/
+  background_evaluator(const std::vector<vec_t> &in,
+                       const std::vector<label_t> &labels,
+                       callback on_result,
+                       size_t batch_size = 64)
+    : labels_(labels),
+      on_result_(on_result),
+      back_tag_(0),
+      pending_(false),
+      busy_(false),
+      stop_(false),
+      dropped_(0) {
+    if (in.size() != labels.size()) {
+      throw nn_error("number of inputs and labels must be the same");
+    }
+    batch_size = std::max(batch_size, size_t(1));
+    for (size_t i = 0; i < in.size(); i += batch_size) {
+      const size_t n = std::min(batch_size, in.size() - i);
+      batches_.emplace_back();
+      for (size_t j = 0; j < n; j++) batches_.back().push_back({in[i + j]});
+    }
+    worker_ = std::thread([this] { run(); });
+  }
+
+  /**
+   * stops after the evaluation in progress; a snapshot that has not
+   * started is discarded (call wait() first to have it evaluated)
+   **/
+  ~background_evaluator() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+
+  background_evaluator(const background_evaluator &) = delete;
+  background_evaluator &operator=(const background_evaluator &) = delete;
+
+  /**
+   * takes a snapshot of net's weights and queues it for evaluation.
+   * net must not be modified concurrently, which holds inside the
+   * callbacks of fit/train.
+   * @param tag passed back in snapshot_evaluation::tag
+   **/
+  void submit(const network<NetType> &net, size_t tag) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (error_) std::rethrow_exception(error_);
+    if (pending_) dropped_++;
+
+    if (back_) {
+      copy_state(net, *back_);
+    } else {
+      back_ = clone(net);
+    }
+    back_tag_ = tag;
+    pending_  = true;
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  /**
+   * blocks until every snapshot submitted so far has been evaluated (or
+   * dropped), and rethrows an exception raised during evaluation
+   **/
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !pending_ && !busy_; });
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  /**
+   * number of snapshots replaced by a newer one before being evaluated
+   **/
+  size_t dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+  }
+
+ private:
+  typedef std::unique_ptr<network<NetType>> network_ptr;
+
+  static network_ptr clone(const network<NetType> &net) {
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive oa(ss);
+      net.to_archive(oa, content_type::weights_and_model);
+    }
+    cereal::BinaryInputArchive ia(ss);
+    network_ptr dst(new network<NetType>());
+    dst->from_archive(ia, content_type::weights_and_model);
+    dst->set_netphase(net_phase::test);
+    for (size_t i = 0; i < dst->layer_size(); i++) {
+      (*dst)[i]->set_parallelize(false);
+    }
+    return dst;
+  }
+
+  // the layers' parameters plus the statistics of batch normalization,
+  // which are not weights
+  static void copy_state(const network<NetType> &src, network<NetType> &dst) {
+    for (size_t i = 0; i < src.layer_size(); i++) {
+      auto from = src[i]->weights();
+      auto to   = dst[i]->weights();
+      for (size_t j = 0; j < from.size(); j++) *to[j] = *from[j];
+
+      if (auto bn = dynamic_cast<const batch_normalization_layer *>(src[i])) {
+        auto &dst_bn = dst.template at<batch_normalization_layer>(i);
+        dst_bn.set_mean(bn->mean());
+        dst_bn.set_variance(bn->variance());
+      }
+    }
+  }
+
+  result evaluate(network<NetType> &net) const {
+    result r;
+    size_t index = 0;
+    for (const auto &batch : batches_) {
+      const std::vector<tensor_t> out = net.predict(batch);
+      for (const auto &sample : out) {
+        const label_t predicted = static_cast<label_t>(max_index(sample[0]));
+        const label_t actual    = labels_[index++];
+
+        if (predicted == actual) r.num_success++;
+        r.num_total++;
+        r.confusion_matrix[predicted][actual]++;
+      }
+    }
+    return r;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      cv_.wait(lock, [this] { return pending_ || stop_; });
+      if (stop_) return;
+
+      std::swap(front_, back_);
+      const size_t tag = back_tag_;
+      pending_         = false;
+      busy_            = true;
+      lock.unlock();
+
+      try {
+        const auto start = std::chrono::steady_clock::now();
+        snapshot_evaluation e;
+        e.tag         = tag;
+        e.test_result = evaluate(*front_);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        e.seconds          = std::chrono::duration<double>(elapsed).count();
+        if (on_result_) on_result_(e);
+      } catch (...) {
+        lock.lock();
+        error_ = std::current_exception();
+        lock.unlock();
+      }
+
+      lock.lock();
+      busy_ = false;
+      cv_.notify_all();
+    }
+  }
+
+  std::vector<std::vector<tensor_t>> batches_;
+  std::vector<label_t> labels_;
+  callback on_result_;
+
+  network_ptr front_;  // being evaluated
+  network_ptr back_;   // receives the next submit
+  size_t back_tag_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool pending_;
+  bool busy_;
+  bool stop_;
+  size_t dropped_;
+  std::exception_ptr error_;
+  std::thread worker_;
+};
+
+}  // namespace tiny_dnn
@@ -0,0 +1,629 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <initializer_list>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/activations/elu_layer.h"
+#include "tiny_dnn/activations/leaky_relu_layer.h"
+#include "tiny_dnn/activations/relu_layer.h"
+#include "tiny_dnn/activations/sigmoid_layer.h"
+#include "tiny_dnn/activations/softmax_layer.h"
+#include "tiny_dnn/activations/softplus_layer.h"
+#include "tiny_dnn/activations/softsign_layer.h"
+#include "tiny_dnn/activations/tanh_layer.h"
+#include "tiny_dnn/activations/tanh_p1m2_layer.h"
+#include "tiny_dnn/layers/average_pooling_layer.h"
+#include "tiny_dnn/layers/convolutional_layer.h"
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/layers/max_pooling_layer.h"
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+/**
+ * exports a trained network as a dependency-free C source file.
+ *
+ *     c_code_generator gen(net, "lenet");
+ *     std::ofstream h("lenet.h"), c("lenet.c");
+ *     gen.generate_header(h);
+ *     gen.generate_source(c);
+ *
+ * The source defines lenet_predict(const float *in, float *out): the
+ * weights are const arrays, the intermediate outputs live in two static
+ * buffers sized for the largest of them, and the body is a fixed sequence
+ * of calls into a small kernel set (only the kernels the network uses are
+ * emitted). There is no allocation and nothing to initialize; the price of
+ * the static buffers is that the function is not reentrant. The code is
+ * C99 and only includes <math.h> and <float.h>.
+ *
+ * The kernels perform the same operations in the same order as the
+ * internal backend, so with the same libm and no floating-point
+ * contraction (-ffp-contract=off) the outputs are bit-identical to
+ * predict() of a network running on backend_t::internal (checked by the
+ * c_code_generator_equivalence test). Exact equality holds only with
+ * backend_t::internal: the avx engine, the default when built with
+ * CNN_USE_AVX, sums in a different order and its outputs differ from the
+ * generated code by about one ulp.
+ *
+ * With quantize_weights, the weights of convolutional and fully-connected
+ * layers are stored as int8 with one scale per layer, a quarter of the
+ * size, and the outputs are no longer exact.
+ *
+ * Supported layers: convolutional (with padding, strides and connection
+ * tables), fully-connected, max/average pooling and the elu, leaky-relu,
+ * relu, sigmoid, softmax, softplus, softsign, tanh and tanh-scaled
+ * activations.
+ **/
+class c_code_generator {
+ public:
+  /**
+   * @param net              [in] trained network
+   * @param prefix           [in] prefix of every generated symbol
+   * @param quantize_weights [in] store conv/fc weights as int8
+   **/
+  explicit c_code_generator(const network<sequential> &net,
+                            const std::string &prefix = "tinydnn",
+                            bool quantize_weights     = false)
+    : prefix_(prefix), quantize_(quantize_weights) {
+    if (net.layer_size() == 0) throw nn_error("network has no layer");
+    for (size_t i = 0; i < net.layer_size(); i++) add(*net[i]);
+
+    in_size_  = net[0]->in_shape()[0].size();
+    out_size_ = net[net.layer_size() - 1]->out_shape()[0].size();
+    plan();
+  }
+
+  /**
+   * declarations of the generated source
+   **/
+  void generate_header(std::ostream &os) const {
+    const std::string guard = macro("H");
+    os << "/* " << prefix_ << ": generated by tiny-dnn, do not edit */\n"
+       << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+       << "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+    generate_sizes(os);
+    os << "void " << prefix_ << "_predict(const " << real() << " *in, "
+       << real() << " *out);\n\n"
+       << "#ifdef __cplusplus\n}\n#endif\n\n#endif /* " << guard << " */\n";
+  }
+
+  /**
+   * the network: weights, kernels and the predict function
+   **/
+  void generate_source(std::ostream &os) const {
+    os << "/* " << prefix_ << ": generated by tiny-dnn, do not edit */\n"
+       << "#include <float.h>\n#include <math.h>\n\n";
+    generate_sizes(os);
+    generate_buffers(os);
+    for (size_t i = 0; i < steps_.size(); i++) generate_params(os, i);
+    generate_kernels(os);
+    generate_predict(os);
+  }
+
+ private:
+  struct step {
+    std::string type;     // layer_type() of the layer
+    std::string kernel;   // kernel called, without the prefix
+    std::string args;     // integer arguments of the kernel
+    size_t in_size;
+    size_t out_size;
+    bool in_place;        // elementwise, may run on its input buffer
+    vec_t weight;
+    vec_t bias;
+    std::vector<int> table;  // conv connection table, empty if full
+    float_t scale;           // ave-pool scale factor
+
+    // same padding: the input is first copied into the padding buffer
+    size_t padded_size;
+    std::string pad_args;
+  };
+
+  void add(const layer &l) {
+    step s;
+    s.type        = l.layer_type();
+    s.in_size     = l.in_shape()[0].size();
+    s.out_size    = l.out_shape()[0].size();
+    s.in_place    = false;
+    s.scale       = float_t(0);
+    s.padded_size = 0;
+
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      add_conv(s, *c);
+    } else if (auto f = dynamic_cast<const fully_connected_layer *>(&l)) {
+      s.kernel = "fc";
+      s.weight = *l.weights()[0];
+      if (f->params_.has_bias_) s.bias = *l.weights()[1];
+      s.args = list({f->params_.in_size_, f->params_.out_size_});
+    } else if (auto m = dynamic_cast<const max_pooling_layer *>(&l)) {
+      const maxpool_params &p = m->params_;
+      s.kernel = "maxpool";
+      s.args   = list({p.in.width_, p.in.height_, p.in.depth_, p.out.width_,
+                     p.out.height_, p.pool_size_x, p.pool_size_y, p.stride_x,
+                     p.stride_y});
+    } else if (auto a = dynamic_cast<const average_pooling_layer *>(&l)) {
+      s.kernel = "avepool";
+      s.weight.assign(l.weights()[0]->begin(),
+                      l.weights()[0]->begin() + a->in_.depth_);
+      s.bias  = *l.weights()[1];
+      s.scale = a->scale_factor_;
+      s.args  = list({a->in_.width_, a->in_.height_, a->in_.depth_,
+                     a->out_.width_, a->out_.height_, a->pool_size_x_,
+                     a->pool_size_y_, a->stride_x_, a->stride_y_});
+    } else {
+      add_activation(s, l);
+    }
+    steps_.push_back(s);
+  }
+
+  void add_conv(step &s, const convolutional_layer &c) {
+    const core::conv_params &p = c.params_;
+    s.kernel = "conv";
+    s.weight = *c.weights()[0];
+    if (p.has_bias) s.bias = *c.weights()[1];
+    if (!p.tbl.is_empty()) {
+      for (serial_size_t o = 0; o < p.out.depth_; o++) {
+        for (serial_size_t i = 0; i < p.in.depth_; i++) {
+          s.table.push_back(p.tbl.is_connected(o, i) ? 1 : 0);
+        }
+      }
+    }
+    s.args = list({p.in_padded.width_, p.in_padded.height_, p.in.depth_,
+                   p.out.width_, p.out.height_, p.out.depth_, p.weight.width_,
+                   p.weight.height_, p.w_stride, p.h_stride});
+
+    if (p.pad_type == padding::same) {
+      s.padded_size = p.in_padded.size();
+      s.pad_args    = list({p.in.width_, p.in.height_, p.in.depth_,
+                         p.in_padded.width_, p.in_padded.height_,
+                         p.weight.width_ / 2, p.weight.height_ / 2});
+    }
+  }
+
+  // activations become an elementwise kernel computing the expression of x
+  void add_activation(step &s, const layer &l) {
+    std::string e;
+    if (dynamic_cast<const relu_layer *>(&l)) {
+      e = "x > 0 ? x : 0";
+    } else if (auto r = dynamic_cast<const leaky_relu_layer *>(&l)) {
+      e = "x > 0 ? x : " + literal(r->epsilon_value()) + " * x";
+    } else if (dynamic_cast<const elu_layer *>(&l)) {
+      e = "x < 0 ? " + fn("exp") + "(x) - 1 : x";
+    } else if (dynamic_cast<const sigmoid_layer *>(&l)) {
+      e = "1 / (1 + " + fn("exp") + "(-x))";
+    } else if (dynamic_cast<const tanh_layer *>(&l)) {
+      e = fn("tanh") + "(x)";
+    } else if (dynamic_cast<const tanh_p1m2_layer *>(&l)) {
+      e = "1 / (1 + " + fn("exp") + "(-2 * x))";
+    } else if (dynamic_cast<const softsign_layer *>(&l)) {
+      e = "x / (1 + " + fn("fabs") + "(x))";
+    } else if (auto p = dynamic_cast<const softplus_layer *>(&l)) {
+      const std::string bx = literal(p->beta_value()) + " * x";
+      e = bx + " > " + literal(p->threshold_value()) + " ? x : " +
+          literal(1 / p->beta_value()) + " * " + fn("log1p") + "(" +
+          fn("exp") + "(" + bx + "))";
+    } else if (!dynamic_cast<const softmax_layer *>(&l)) {
+      throw nn_error("c_code_generator: unsupported layer " + s.type);
+    }
+
+    s.in_place = true;
+    s.args     = std::to_string(s.in_size);
+    if (e.empty()) {
+      s.kernel = "softmax";
+      return;
+    }
+
+    // one kernel per distinct expression
+    auto it = activations_.find(e);
+    if (it == activations_.end()) {
+      std::string name = s.type.substr(0, s.type.find("-activation"));
+      std::replace(name.begin(), name.end(), '-', '_');
+      if (activation_names_.count(name)) {
+        name += std::to_string(activations_.size());
+      }
+      activation_names_.insert(name);
+      it = activations_.insert(std::make_pair(e, name)).first;
+    }
+    s.kernel = it->second;
+  }
+
+  // sizes of the buffers, and the buffer each step reads and writes
+  void plan() {
+    buffer_size_ = 1;
+    pad_size_    = 0;
+
+    std::string src = "in";
+
+    for (size_t i = 0; i < steps_.size(); i++) {
+      step &s         = steps_[i];
+      const bool last = i + 1 == steps_.size();
+      pad_size_       = std::max(pad_size_, s.padded_size);
+      if (!last) buffer_size_ = std::max(buffer_size_, s.out_size);
+
+      std::string dst;
+      if (last) {
+        dst = "out";
+      } else if (s.in_place && src != "in") {
+        dst = src;
+      } else {
+        dst = prefix_ + (src == prefix_ + "_buf0" ? "_buf1" : "_buf0");
+      }
+      src_.push_back(src);
+      dst_.push_back(dst);
+      src = dst;
+    }
+  }
+
+  void generate_sizes(std::ostream &os) const {
+    os << "#define " << macro("IN_SIZE") << " " << in_size_ << "\n"
+       << "#define " << macro("OUT_SIZE") << " " << out_size_ << "\n\n";
+  }
+
+  void generate_buffers(std::ostream &os) const {
+    os << "/* intermediate outputs */\n"
+       << "static " << real() << " " << prefix_ << "_buf0[" << buffer_size_
+       << "];\n"
+       << "static " << real() << " " << prefix_ << "_buf1[" << buffer_size_
+       << "];\n";
+    if (pad_size_ > 0) {
+      os << "static " << real() << " " << prefix_ << "_pad[" << pad_size_
+         << "];\n";
+    }
+    os << "\n";
+  }
+
+  void generate_params(std::ostream &os, size_t i) const {
+    const step &s       = steps_[i];
+    const std::string n = std::to_string(i);
+    if (s.weight.empty()) return;
+
+    os << "/* " << n << ": " << s.type << " */\n";
+    if (quantized(s)) {
+      std::vector<int> q(s.weight.size());
+      const float_t scale = weight_scale(s);
+      for (size_t j = 0; j < q.size(); j++) {
+        q[j] = static_cast<int>(std::round(s.weight[j] / scale));
+      }
+      generate_array(os, "signed char", prefix_ + "_w" + n, q);
+    } else {
+      generate_array(os, real(), prefix_ + "_w" + n, s.weight);
+    }
+    if (!s.bias.empty()) {
+      generate_array(os, real(), prefix_ + "_b" + n, s.bias);
+    }
+    if (!s.table.empty()) {
+      generate_array(os, "unsigned char", prefix_ + "_t" + n, s.table);
+    }
+    os << "\n";
+  }
+
+  template <typename Container>
+  void generate_array(std::ostream &os,
+                      const std::string &type,
+                      const std::string &name,
+                      const Container &values) const {
+    os << "static const " << type << " " << name << "[" << values.size()
+       << "] = {";
+    for (size_t i = 0; i < values.size(); i++) {
+      os << (i % 4 == 0 ? "\n  " : " ") << literal(values[i]);
+      if (i + 1 < values.size()) os << ",";
+    }
+    os << "\n};\n";
+  }
+
+  void generate_kernels(std::ostream &os) const {
+    std::set<std::string> emitted;
+    for (const auto &s : steps_) {
+      const std::string k = quantized(s) ? s.kernel + "_q" : s.kernel;
+      if (s.padded_size > 0 && emitted.insert("pad").second) {
+        os << kernel_pad();
+      }
+      if (!emitted.insert(k).second) continue;
+
+      if (s.kernel == "conv") {
+        os << kernel_conv(quantized(s));
+      } else if (s.kernel == "fc") {
+        os << kernel_fc(quantized(s));
+      } else if (s.kernel == "maxpool") {
+        os << kernel_maxpool();
+      } else if (s.kernel == "avepool") {
+        os << kernel_avepool();
+      } else if (s.kernel == "softmax") {
+        os << kernel_softmax();
+      }
+    }
+    for (const auto &a : activations_) {
+      os << kernel_activation(a.second, a.first);
+    }
+  }
+
+  void generate_predict(std::ostream &os) const {
+    os << "void " << prefix_ << "_predict(const " << real() << " *in, "
+       << real() << " *out) {\n";
+    for (size_t i = 0; i < steps_.size(); i++) {
+      const step &s       = steps_[i];
+      const std::string n = std::to_string(i);
+      std::string src     = src_[i];
+
+      if (s.padded_size > 0) {
+        os << "  " << prefix_ << "_pad_input(" << src << ", " << prefix_
+           << "_pad, " << s.pad_args << ");\n";
+        src = prefix_ + "_pad";
+      }
+
+      os << "  " << prefix_ << "_" << s.kernel << (quantized(s) ? "_q" : "")
+         << "(" << src << ", " << dst_[i];
+      if (!s.weight.empty()) {
+        os << ", " << prefix_ << "_w" << n;
+        if (quantized(s)) os << ", " << literal(weight_scale(s));
+        os << ", " << (s.bias.empty() ? "0" : prefix_ + "_b" + n);
+      }
+      if (s.kernel == "conv") {
+        os << ", " << (s.table.empty() ? "0" : prefix_ + "_t" + n);
+      }
+      if (s.kernel == "avepool") os << ", " << literal(s.scale);
+      os << ", " << s.args << "); /* " << s.type << " */\n";
+    }
+    os << "}\n";
+  }
+
+  // kernels, following the internal backend operation for operation
+
+  std::string kernel_conv(bool q) const {
+    return expand(
+      "static void @_conv" + std::string(q ? "_q" : "") +
+      "(const $ *in, $ *out, " + weight_param(q) +
+      ",\n"
+      "    const $ *b, const unsigned char *tbl, int iw, int ih, int id,\n"
+      "    int ow, int oh, int od, int kw, int kh, int sx, int sy) {\n"
+      "  int o, c, x, y, wx, wy, i;\n"
+      "  for (i = 0; i < ow * oh * od; i++) out[i] = 0;\n"
+      "  for (o = 0; o < od; o++) {\n"
+      "    $ *pa = out + o * ow * oh;\n"
+      "    for (c = 0; c < id; c++) {\n"
+      "      const " + weight_type(q) + " *pw = w + (id * o + c) * kw * kh;\n"
+      "      const $ *pin = in + c * iw * ih;\n"
+      "      $ *pout = pa;\n"
+      "      if (tbl && !tbl[o * id + c]) continue;\n"
+      "      for (y = 0; y < oh; y++) {\n"
+      "        const $ *pin_line = pin;\n"
+      "        for (x = 0; x < ow; x++) {\n"
+      "          const $ *pe = pin_line;\n"
+      "          const " + weight_type(q) + " *pwe = pw;\n"
+      "          $ sum = 0;\n"
+      "          for (wy = 0; wy < kh; wy++) {\n"
+      "            for (wx = 0; wx < kw; wx++) {\n"
+      "              sum += " + weight_read(q, "pwe[wx]") + " * pe[wx];\n"
+      "            }\n"
+      "            pwe += kw;\n"
+      "            pe += iw;\n"
+      "          }\n"
+      "          pout[x] += sum;\n"
+      "          pin_line += sx;\n"
+      "        }\n"
+      "        pout += ow;\n"
+      "        pin += iw * sy;\n"
+      "      }\n"
+      "    }\n"
+      "    if (b) {\n"
+      "      for (i = 0; i < ow * oh; i++) pa[i] += b[o];\n"
+      "    }\n"
+      "  }\n"
+      "}\n\n");
+  }
+
+  std::string kernel_fc(bool q) const {
+    return expand(
+      "static void @_fc" + std::string(q ? "_q" : "") +
+      "(const $ *in, $ *out, " + weight_param(q) +
+      ",\n"
+      "    const $ *b, int n_in, int n_out) {\n"
+      "  int i, c;\n"
+      "  for (i = 0; i < n_out; i++) {\n"
+      "    out[i] = 0;\n"
+      "    for (c = 0; c < n_in; c++) {\n"
+      "      out[i] += " + weight_read(q, "w[c * n_out + i]") + " * in[c];\n"
+      "    }\n"
+      "    if (b) out[i] += b[i];\n"
+      "  }\n"
+      "}\n\n");
+  }
+
+  std::string kernel_maxpool() const {
+    return expand(
+      "static void @_maxpool(const $ *in, $ *out, int iw, int ih, int d,\n"
+      "    int ow, int oh, int px, int py, int sx, int sy) {\n"
+      "  int c, x, y, dx, dy;\n"
+      "  for (c = 0; c < d; c++) {\n"
+      "    for (y = 0; y < oh; y++) {\n"
+      "      for (x = 0; x < ow; x++) {\n"
+      "        const int x0 = x * sx, y0 = y * sy;\n"
+      "        const int dxmax = px < iw - x0 ? px : iw - x0;\n"
+      "        const int dymax = py < ih - y0 ? py : ih - y0;\n"
+      "        $ m = " + lowest() + ";\n"
+      "        for (dy = 0; dy < dymax; dy++) {\n"
+      "          for (dx = 0; dx < dxmax; dx++) {\n"
+      "            const $ v = in[(c * ih + y0 + dy) * iw + x0 + dx];\n"
+      "            if (v > m) m = v;\n"
+      "          }\n"
+      "        }\n"
+      "        out[(c * oh + y) * ow + x] = m;\n"
+      "      }\n"
+      "    }\n"
+      "  }\n"
+      "}\n\n");
+  }
+
+  std::string kernel_avepool() const {
+    return expand(
+      "static void @_avepool(const $ *in, $ *out, const $ *w, const $ *b,\n"
+      "    $ scale, int iw, int ih, int d, int ow, int oh, int px, int py,\n"
+      "    int sx, int sy) {\n"
+      "  int c, x, y, dx, dy;\n"
+      "  for (c = 0; c < d; c++) {\n"
+      "    const $ weight = w[c] * scale;\n"
+      "    for (y = 0; y < oh; y++) {\n"
+      "      for (x = 0; x < ow; x++) {\n"
+      "        const int x0 = x * sx, y0 = y * sy;\n"
+      "        $ v = 0;\n"
+      "        if (x0 + px <= iw && y0 + py <= ih) {\n"
+      "          for (dy = 0; dy < py; dy++) {\n"
+      "            for (dx = 0; dx < px; dx++) {\n"
+      "              v += in[(c * ih + y0 + dy) * iw + x0 + dx];\n"
+      "            }\n"
+      "          }\n"
+      "        }\n"
+      "        v *= weight;\n"
+      "        v += b[c];\n"
+      "        out[(c * oh + y) * ow + x] = v;\n"
+      "      }\n"
+      "    }\n"
+      "  }\n"
+      "}\n\n");
+  }
+
+  std::string kernel_pad() const {
+    return expand(
+      "static void @_pad_input(const $ *in, $ *out, int iw, int ih, int d,\n"
+      "    int pw, int ph, int ox, int oy) {\n"
+      "  int i, c, x, y;\n"
+      "  for (i = 0; i < pw * ph * d; i++) out[i] = 0;\n"
+      "  for (c = 0; c < d; c++) {\n"
+      "    for (y = 0; y < ih; y++) {\n"
+      "      for (x = 0; x < iw; x++) {\n"
+      "        out[(c * ph + y + oy) * pw + x + ox] =\n"
+      "          in[(c * ih + y) * iw + x];\n"
+      "      }\n"
+      "    }\n"
+      "  }\n"
+      "}\n\n");
+  }
+
+  std::string kernel_softmax() const {
+    return expand(
+      "static void @_softmax(const $ *in, $ *out, int n) {\n"
+      "  int i;\n"
+      "  $ alpha = in[0], denominator = 0;\n"
+      "  for (i = 1; i < n; i++) {\n"
+      "    if (in[i] > alpha) alpha = in[i];\n"
+      "  }\n"
+      "  for (i = 0; i < n; i++) {\n"
+      "    out[i] = " + fn("exp") + "(in[i] - alpha);\n"
+      "    denominator += out[i];\n"
+      "  }\n"
+      "  for (i = 0; i < n; i++) out[i] /= denominator;\n"
+      "}\n\n");
+  }
+
+  std::string kernel_activation(const std::string &name,
+                                const std::string &e) const {
+    return expand("static void @_" + name +
+                  "(const $ *in, $ *out, int n) {\n"
+                  "  int i;\n"
+                  "  for (i = 0; i < n; i++) {\n"
+                  "    const $ x = in[i];\n"
+                  "    out[i] = " + e + ";\n"
+                  "  }\n"
+                  "}\n\n");
+  }
+
+  // helpers
+
+  bool quantized(const step &s) const {
+    return quantize_ && (s.kernel == "conv" || s.kernel == "fc");
+  }
+
+  static float_t weight_scale(const step &s) {
+    float_t m = float_t(0);
+    for (auto w : s.weight) m = std::max(m, std::abs(w));
+    return m > float_t(0) ? m / 127 : float_t(1);
+  }
+
+  std::string weight_type(bool q) const { return q ? "signed char" : "$"; }
+
+  std::string weight_param(bool q) const {
+    return q ? "const signed char *w, $ ws" : "const $ *w";
+  }
+
+  std::string weight_read(bool q, const std::string &w) const {
+    return q ? "(($)" + w + " * ws)" : w;
+  }
+
+  // replaces @ by the prefix and $ by the floating-point type
+  std::string expand(const std::string &code) const {
+    std::string out;
+    for (char c : code) {
+      if (c == '@') {
+        out += prefix_;
+      } else if (c == '$') {
+        out += real();
+      } else {
+        out += c;
+      }
+    }
+    return out;
+  }
+
+  static bool is_float() { return sizeof(float_t) == sizeof(float); }
+
+  static std::string real() { return is_float() ? "float" : "double"; }
+
+  static std::string lowest() { return is_float() ? "-FLT_MAX" : "-DBL_MAX"; }
+
+  // math function of the floating-point type
+  static std::string fn(const std::string &name) {
+    return is_float() ? name + "f" : name;
+  }
+
+  // enough digits to read back exactly v
+  static std::string literal(float_t v) {
+    std::ostringstream ss;
+    ss << std::showpoint
+       << std::setprecision(std::numeric_limits<float_t>::max_digits10) << v;
+    return ss.str() + (is_float() ? "f" : "");
+  }
+
+  static std::string literal(int v) { return std::to_string(v); }
+
+  static std::string list(std::initializer_list<serial_size_t> values) {
+    std::string s;
+    for (auto v : values) s += (s.empty() ? "" : ", ") + std::to_string(v);
+    return s;
+  }
+
+  std::string macro(const std::string &name) const {
+    std::string m = prefix_ + "_" + name;
+    std::transform(m.begin(), m.end(), m.begin(), ::toupper);
+    return m;
+  }
+
+  std::string prefix_;
+  bool quantize_;
+  size_t in_size_;
+  size_t out_size_;
+  size_t buffer_size_;
+  size_t pad_size_;
+  std::vector<step> steps_;
+  std::vector<std::string> src_;
+  std::vector<std::string> dst_;
+  std::map<std::string, std::string> activations_;  // expression -> name
+  std::set<std::string> activation_names_;
+};
+
+}  // namespace tiny_dnn
@@ -0,0 +1,389 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tiny_dnn/activations/activation_layer.h"
+#include "tiny_dnn/layers/average_pooling_layer.h"
+#include "tiny_dnn/layers/batch_normalization_layer.h"
+#include "tiny_dnn/layers/convolutional_layer.h"
+#include "tiny_dnn/layers/dropout_layer.h"
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/layers/max_pooling_layer.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/optimizers/optimizer.h"
+
+namespace tiny_dnn {
+
+/**
+ * deep copy of a layer (architecture and weights), unconnected
+ **/
+inline std::shared_ptr<layer> clone_layer(const layer &l) {
+  std::stringstream ss;
+  {
+    cereal::BinaryOutputArchive oa(ss);
+    layer::save_layer(oa, l);
+    oa(l);
+  }
+  cereal::BinaryInputArchive ia(ss);
+  auto dst = layer::load_layer(ia);
+  ia(*dst);
+  return dst;
+}
+
+enum class prune_criterion { l1_norm, l2_norm };
+
+/**
+ * first-order taylor importance of the weights, sum of (w * dE/dw)^2.
+ *
+ * it is used in place of an optimizer and never changes the weights:
+ *
+ *     taylor_importance t;
+ *     net.fit<mse>(t, calib_x, calib_y, 32, 1);
+ *     auto pruned = channel_pruner::prune(net, 0, 16, t);
+ **/
+struct taylor_importance : public stateful_optimizer<1> {
+  void update(const vec_t &dW, vec_t &W, bool parallelize) {
+    vec_t &s = get<0>(W);
+    for_i(parallelize, static_cast<int>(W.size()), [&](int i) {
+      const float_t t = W[i] * dW[i];
+      s[i] += t * t;
+    });
+  }
+
+  /**
+   * accumulated importance of each element of W, or nullptr if W was not
+   * seen during training
+   **/
+  const vec_t *of(const vec_t &W) const {
+    auto it = E_[0].find(&W);
+    return it == E_[0].end() ? nullptr : &it->second;
+  }
+};
+
+/**
+ * structured pruning of conv filters / fc neurons.
+ *
+ * removes output channels of a convolutional_layer or fully_connected_layer
+ * of a sequential network, and rewrites the layers which consume them
+ * (activations, dropout, batch-norm, pooling, and the next conv/fc layer)
+ * into smaller dense layers. the result is a plain network which runs on the
+ * existing kernels; fine-tune it with fit as usual.
+ **/
+class channel_pruner {
+ public:
+  /**
+   * magnitude of each output channel of a conv/fc layer
+   **/
+  static vec_t importance(
+    const layer &l, prune_criterion criterion = prune_criterion::l1_norm) {
+    const auto w = l.weights();
+    return accumulate(l, [&](size_t weight_index, size_t i) {
+      const float_t v = (*w[weight_index])[i];
+      return criterion == prune_criterion::l1_norm ? std::abs(v) : v * v;
+    });
+  }
+
+  /**
+   * taylor importance of each output channel of a conv/fc layer
+   **/
+  static vec_t importance(const layer &l, const taylor_importance &t) {
+    const auto w = l.weights();
+    std::vector<const vec_t *> s(w.size());
+    for (size_t i = 0; i < w.size(); i++) {
+      s[i] = t.of(*w[i]);
+      if (!s[i]) {
+        throw nn_error("no taylor importance was recorded for " +
+                       l.layer_type());
+      }
+    }
+    return accumulate(
+      l, [&](size_t weight_index, size_t i) { return (*s[weight_index])[i]; });
+  }
+
+  /**
+   * indices of the n most important channels, in ascending order
+   **/
+  static std::vector<serial_size_t> top_channels(const vec_t &importance,
+                                                 size_t n) {
+    std::vector<serial_size_t> idx(importance.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    n = std::min(n, idx.size());
+    std::stable_sort(idx.begin(), idx.end(),
+                     [&](serial_size_t a, serial_size_t b) {
+                       return importance[a] > importance[b];
+                     });
+    idx.resize(n);
+    std::sort(idx.begin(), idx.end());
+    return idx;
+  }
+
+  /**
+   * keep the `keep` most important output channels of net[index]
+   **/
+  static network<sequential> prune(
+    const network<sequential> &net,
+    size_t index,
+    size_t keep,
+    prune_criterion criterion = prune_criterion::l1_norm) {
+    return prune(net, index,
+                 top_channels(importance(*net[index], criterion), keep));
+  }
+
+  static network<sequential> prune(const network<sequential> &net,
+                                   size_t index,
+                                   size_t keep,
+                                   const taylor_importance &t) {
+    return prune(net, index, top_channels(importance(*net[index], t), keep));
+  }
+
+  /**
+   * keep the given output channels of net[index]
+   **/
+  static network<sequential> prune(const network<sequential> &net,
+                                   size_t index,
+                                   const std::vector<serial_size_t> &keep) {
+    if (index >= net.layer_size()) throw nn_error("layer index out of range");
+    const size_t channels = out_channel_count(*net[index]);
+    if (keep.empty() || !std::is_sorted(keep.begin(), keep.end()) ||
+        std::adjacent_find(keep.begin(), keep.end()) != keep.end() ||
+        keep.back() >= channels) {
+      throw nn_error("invalid channel selection");
+    }
+
+    network<sequential> dst;
+    for (size_t i = 0; i < index; i++) dst << clone_layer(*net[i]);
+    dst << prune_output(*net[index], keep);
+
+    size_t i = index + 1;
+    for (bool consumed = false; !consumed; i++) {
+      if (i == net.layer_size()) {
+        throw nn_error("the output channels of the network cannot be pruned");
+      }
+      dst << prune_input(*net[i], keep, channels, consumed);
+    }
+    for (; i < net.layer_size(); i++) dst << clone_layer(*net[i]);
+    return dst;
+  }
+
+ private:
+  static size_t out_channel_count(const layer &l) {
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      return c->params_.out.depth_;
+    }
+    if (auto f = dynamic_cast<const fully_connected_layer *>(&l)) {
+      return f->params_.out_size_;
+    }
+    throw nn_error("only conv and fully-connected layers can be pruned: " +
+                   l.layer_type());
+  }
+
+  /**
+   * sum f(weight_index, element) over the weights of each output channel
+   **/
+  template <typename F>
+  static vec_t accumulate(const layer &l, F f) {
+    const auto w = l.weights();
+    vec_t s(out_channel_count(l), float_t(0));
+
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      const size_t block = c->params_.weight.size() / s.size();
+      for (size_t o = 0; o < s.size(); o++) {
+        for (size_t i = 0; i < block; i++) s[o] += f(0, o * block + i);
+        if (c->params_.has_bias) s[o] += f(1, o);
+      }
+    } else {
+      auto fc = dynamic_cast<const fully_connected_layer *>(&l);
+      for (size_t c = 0; c < fc->params_.in_size_; c++) {
+        for (size_t o = 0; o < s.size(); o++) s[o] += f(0, c * s.size() + o);
+      }
+      if (fc->params_.has_bias_) {
+        for (size_t o = 0; o < s.size(); o++) s[o] += f(1, o);
+      }
+    }
+    return s;
+  }
+
+  static void set_weights(layer &l, const std::vector<vec_t> &w) {
+    std::vector<float_t> all;
+    for (const auto &v : w) all.insert(all.end(), v.begin(), v.end());
+    int idx = 0;
+    l.load(all, idx);
+  }
+
+  static core::connection_table select(const core::connection_table &tbl,
+                                       serial_size_t in_depth,
+                                       serial_size_t out_depth,
+                                       const std::vector<serial_size_t> *in,
+                                       const std::vector<serial_size_t> *out) {
+    if (tbl.is_empty()) return tbl;
+    const serial_size_t rows = in ? in->size() : in_depth;
+    const serial_size_t cols = out ? out->size() : out_depth;
+    std::unique_ptr<bool[]> ar(new bool[rows * cols]);
+    for (serial_size_t r = 0; r < rows; r++) {
+      for (serial_size_t c = 0; c < cols; c++) {
+        ar[r * cols + c] =
+          tbl.is_connected(out ? (*out)[c] : c, in ? (*in)[r] : r);
+      }
+    }
+    return core::connection_table(ar.get(), rows, cols);
+  }
+
+  /**
+   * conv/fc layer with fewer outputs
+   **/
+  static std::shared_ptr<layer> prune_output(
+    const layer &l, const std::vector<serial_size_t> &keep) {
+    const auto w       = l.weights();
+    const size_t k     = keep.size();
+    const size_t old_k = out_channel_count(l);
+    std::vector<vec_t> nw(w.size());
+
+    std::shared_ptr<layer> dst;
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      const auto &p = c->params_;
+      dst           = std::make_shared<convolutional_layer>(
+        p.in.width_, p.in.height_, p.weight.width_, p.weight.height_,
+        p.in.depth_, static_cast<serial_size_t>(k),
+        select(p.tbl, p.in.depth_, p.out.depth_, nullptr, &keep), p.pad_type,
+        p.has_bias, p.w_stride, p.h_stride, l.engine());
+
+      const size_t block = p.weight.size() / old_k;
+      for (auto o : keep) {
+        nw[0].insert(nw[0].end(), w[0]->begin() + o * block,
+                     w[0]->begin() + (o + 1) * block);
+        if (p.has_bias) nw[1].push_back((*w[1])[o]);
+      }
+    } else {
+      const auto &p = dynamic_cast<const fully_connected_layer &>(l).params_;
+      dst           = std::make_shared<fully_connected_layer>(
+        p.in_size_, static_cast<serial_size_t>(k), p.has_bias_, l.engine());
+
+      for (size_t c = 0; c < p.in_size_; c++) {
+        for (auto o : keep) nw[0].push_back((*w[0])[c * old_k + o]);
+      }
+      if (p.has_bias_) {
+        for (auto o : keep) nw[1].push_back((*w[1])[o]);
+      }
+    }
+    set_weights(*dst, nw);
+    return dst;
+  }
+
+  /**
+   * rewrite a layer which receives the pruned channels. consumed is set
+   * when the layer is a conv/fc layer, i.e. its output is unaffected.
+   **/
+  static std::shared_ptr<layer> prune_input(
+    const layer &l,
+    const std::vector<serial_size_t> &keep,
+    size_t channels,
+    bool &consumed) {
+    const shape3d in = l.in_shape()[0];
+    const size_t k   = keep.size();
+    const auto w     = l.weights();
+    std::vector<vec_t> nw(w.size());
+    consumed = false;
+
+    if (in.size() % channels) {
+      throw nn_error("cannot map pruned channels onto " + l.layer_type());
+    }
+    const size_t area = in.size() / channels;
+
+    if (dynamic_cast<const activation_layer *>(&l)) {
+      const serial_size_t n = static_cast<serial_size_t>(k);
+      const serial_size_t a = static_cast<serial_size_t>(area);
+      auto dst              = clone_layer(l);
+      dst->set_in_shape(channels == in.depth_
+                          ? shape3d(in.width_, in.height_, n)
+                          : shape3d(n * a, 1, 1));
+      return dst;
+    }
+    if (auto d = dynamic_cast<const dropout_layer *>(&l)) {
+      return std::make_shared<dropout_layer>(
+        static_cast<serial_size_t>(k * area), d->dropout_rate_, d->phase_);
+    }
+    if (auto b = dynamic_cast<const batch_normalization_layer *>(&l)) {
+      auto dst = std::make_shared<batch_normalization_layer>(
+        b->in_spatial_size_, static_cast<serial_size_t>(k), b->eps_,
+        b->momentum_, b->phase_);
+      for (size_t j = 0; j < k; j++) {
+        dst->mean_[j]     = b->mean_[keep[j]];
+        dst->variance_[j] = b->variance_[keep[j]];
+      }
+      return dst;
+    }
+    if (auto m = dynamic_cast<const max_pooling_layer *>(&l)) {
+      const auto &p = m->params_;
+      return std::make_shared<max_pooling_layer>(
+        p.in.width_, p.in.height_, static_cast<serial_size_t>(k),
+        p.pool_size_x, p.pool_size_y, p.stride_x, p.stride_y, p.pad_type,
+        l.engine());
+    }
+    if (auto a = dynamic_cast<const average_pooling_layer *>(&l)) {
+      auto dst = std::make_shared<average_pooling_layer>(
+        a->in_.width_, a->in_.height_, static_cast<serial_size_t>(k),
+        a->pool_size_x_, a->pool_size_y_, a->stride_x_, a->stride_y_,
+        a->pad_type_);
+      for (size_t i = 0; i < w.size(); i++) {
+        for (auto c : keep) nw[i].push_back((*w[i])[c]);
+      }
+      set_weights(*dst, nw);
+      return dst;
+    }
+
+    consumed = true;
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      const auto &p = c->params_;
+      if (p.in.depth_ != channels) {
+        throw nn_error("cannot map pruned channels onto " + l.layer_type());
+      }
+      auto dst = std::make_shared<convolutional_layer>(
+        p.in.width_, p.in.height_, p.weight.width_, p.weight.height_,
+        static_cast<serial_size_t>(k), p.out.depth_,
+        select(p.tbl, p.in.depth_, p.out.depth_, &keep, nullptr), p.pad_type,
+        p.has_bias, p.w_stride, p.h_stride, l.engine());
+
+      const size_t kernel = p.weight.width_ * p.weight.height_;
+      for (size_t o = 0; o < p.out.depth_; o++) {
+        for (auto inc : keep) {
+          auto first = w[0]->begin() + (o * channels + inc) * kernel;
+          nw[0].insert(nw[0].end(), first, first + kernel);
+        }
+      }
+      if (p.has_bias) nw[1] = *w[1];
+      set_weights(*dst, nw);
+      return dst;
+    }
+    if (auto f = dynamic_cast<const fully_connected_layer *>(&l)) {
+      const auto &p = f->params_;
+      auto dst      = std::make_shared<fully_connected_layer>(
+        static_cast<serial_size_t>(k * area), p.out_size_, p.has_bias_,
+        l.engine());
+
+      for (auto c : keep) {
+        for (size_t s = 0; s < area; s++) {
+          auto first = w[0]->begin() + (c * area + s) * p.out_size_;
+          nw[0].insert(nw[0].end(), first, first + p.out_size_);
+        }
+      }
+      if (p.has_bias_) nw[1] = *w[1];
+      set_weights(*dst, nw);
+      return dst;
+    }
+    throw nn_error("channel pruning does not support " + l.layer_type());
+  }
+};
+
+}  // namespace tiny_dnn
@@ -30,7 +30,7 @@ class deserialization_helper {
   void register_loader(
     const std::string &name,
     std::function<std::shared_ptr<layer>(InputArchive &)> func) {
-    loaders_[name] = [=](void *ar) {
+    loaders_[name] = [=](void *ar, std::uint32_t) {
       return func(*reinterpret_cast<InputArchive *>(ar));
     };
   }
@@ -40,7 +40,13 @@ class deserialization_helper {
     type_names_[typeid(T)] = name;
   }
 
-  std::shared_ptr<layer> load(const std::string &layer_name, InputArchive &ar) {
+  /**
+   * @param version [in] version of the record, see
+   *                     serialization_buddy::layer_version
+   **/
+  std::shared_ptr<layer> load(const std::string &layer_name,
+                              InputArchive &ar,
+                              std::uint32_t version = 0) {
     check_if_enabled();
 
     if (loaders_.find(layer_name) == loaders_.end()) {
@@ -50,7 +56,7 @@ class deserialization_helper {
                      "appropriate loader.");
     }
 
-    return loaders_[layer_name](reinterpret_cast<void *>(&ar));
+    return loaders_[layer_name](reinterpret_cast<void *>(&ar), version);
   }
 
   const std::string &type_name(std::type_index index) const {
@@ -79,19 +85,25 @@ class deserialization_helper {
   }
 
   /** layer-type -> generator  */
-  std::map<std::string, std::function<std::shared_ptr<layer>(void *)>> loaders_;
+  std::map<std::string,
+           std::function<std::shared_ptr<layer>(void *, std::uint32_t)>>
+    loaders_;
 
   std::map<std::type_index, std::string> type_names_;
 
   template <typename T>
-  static std::shared_ptr<layer> load_layer_impl(InputArchive &ia);
+  static std::shared_ptr<layer> load_layer_impl(InputArchive &ia,
+                                                std::uint32_t version);
 
   template <typename T>
   friend void register_layers(T *h);
 
   template <typename T>
   void register_layer(const char *layer_name) {
-    register_loader(layer_name, load_layer_impl<T>);
+    loaders_[layer_name] = [](void *ar, std::uint32_t version) {
+      return load_layer_impl<T>(*reinterpret_cast<InputArchive *>(ar),
+                                version);
+    };
     register_type<T>(layer_name);
   }
 
@@ -102,7 +114,7 @@ class deserialization_helper {
 template <typename InputArchive>
 template <typename T>
 std::shared_ptr<layer> deserialization_helper<InputArchive>::load_layer_impl(
-  InputArchive &ia) {
+  InputArchive &ia, std::uint32_t version) {
   using ST = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
 
   std::unique_ptr<ST> bn(new ST());
@@ -116,6 +128,8 @@ std::shared_ptr<layer> deserialization_helper<InputArchive>::load_layer_impl(
   t.reset(reinterpret_cast<T *>(bn.get()));
   bn.release();
 
+  serialization_buddy::serialize_extension(ia, *static_cast<T *>(t.get()),
+                                           version);
   return t;
 }
 
@@ -146,7 +160,25 @@ std::shared_ptr<layer> layer::load_layer(InputArchive &ia) {
 
   std::string p;
   ia(cereal::make_nvp("type", p));
-  auto l = deserialization_helper<InputArchive>::get_instance().load(p, ia);
+
+  // "<type>@<version>", or the plain "<type>" of a record saved before
+  // versioning
+  std::uint32_t version = 0;
+  const size_t at       = p.rfind('@');
+  if (at != std::string::npos) {
+    version = static_cast<std::uint32_t>(std::stoul(p.substr(at + 1)));
+    p.erase(at);
+  }
+  if (version > serialization_buddy::layer_version()) {
+    throw nn_error("layer " + p + " was saved by a newer version (" +
+                   std::to_string(version) + ")");
+  }
+
+  bool weight_quantization = false;
+  serialization_buddy::serialize_common(ia, weight_quantization, version);
+  auto l =
+    deserialization_helper<InputArchive>::get_instance().load(p, ia, version);
+  l->quantize_weights_ = weight_quantization;
 
   finish_loading_layer(ia);
 
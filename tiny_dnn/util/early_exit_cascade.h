@@ -0,0 +1,175 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+/**
+ * confidence of a prediction: its largest output, i.e. the probability of
+ * the top class for a softmax output
+ **/
+inline float_t max_probability(const vec_t &out) {
+  return out.empty() ? float_t(0) : *std::max_element(out.begin(), out.end());
+}
+
+/**
+ * confidence of a prediction: difference between its two largest outputs
+ **/
+inline float_t top2_margin(const vec_t &out) {
+  if (out.size() < 2) return max_probability(out);
+  vec_t top(2);
+  std::partial_sort_copy(out.begin(), out.end(), top.begin(), top.end(),
+                         std::greater<float_t>());
+  return top[0] - top[1];
+}
+
+/**
+ * inference through a chain of exits, stopping at the first one that is
+ * confident enough.
+ *
+ * An exit is either a whole model fed with the cascade's input
+ * (add_model), e.g. a small model in front of a large one, or an exit head
+ * on a backbone split into segments (add_exit): each segment is fed with
+ * the output of the previous one, and its head turns the features into a
+ * prediction. The two kinds can be mixed; a model does not change the
+ * features passed to the next segment.
+ *
+ * Samples whose confidence reaches the threshold of an exit leave the
+ * batch there; only the others are evaluated by the next stage. The last
+ * exit answers for every sample left, whatever its confidence, so the
+ * worst case costs the whole chain.
+ *
+ * @code
+ * early_exit_cascade<sequential> c;
+ * c.add_model(small, 0.9).add_model(large, 0);
+ * std::vector<size_t> exits;
+ * auto out = c.predict(images, &exits);
+ * @endcode
+ **/
+template <typename NetType>
+class early_exit_cascade {
+ public:
+  typedef std::function<float_t(const vec_t &)> confidence_function;
+
+  explicit early_exit_cascade(confidence_function confidence = max_probability)
+    : confidence_(confidence) {}
+
+  /**
+   * @param model     [in] network fed with the input of the cascade
+   * @param threshold [in] minimum confidence to answer at this exit
+   **/
+  early_exit_cascade &add_model(network<NetType> &model, float_t threshold) {
+    stages_.push_back(stage{nullptr, &model, threshold});
+    exits_.push_back(0);
+    return *this;
+  }
+
+  /**
+   * @param segment   [in] next segment of the backbone, fed with the output
+   *                       of the previous segment (or the input)
+   * @param head      [in] exit head fed with the output of the segment
+   * @param threshold [in] minimum confidence to answer at this exit
+   **/
+  early_exit_cascade &add_exit(network<NetType> &segment,
+                               network<NetType> &head,
+                               float_t threshold) {
+    stages_.push_back(stage{&segment, &head, threshold});
+    exits_.push_back(0);
+    return *this;
+  }
+
+  size_t stage_count() const { return stages_.size(); }
+
+  /**
+   * predictions of a batch
+   * @param in   [in]  inputs
+   * @param exit [out] optional, index of the exit that answered each sample
+   **/
+  std::vector<vec_t> predict(const std::vector<vec_t> &in,
+                             std::vector<size_t> *exit = nullptr) {
+    if (stages_.empty()) throw nn_error("cascade has no exits");
+
+    std::vector<vec_t> out(in.size());
+    if (exit) exit->assign(in.size(), 0);
+
+    // samples still in the batch, and the backbone features of each
+    std::vector<size_t> active(in.size());
+    std::vector<tensor_t> features(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+      active[i]   = i;
+      features[i] = tensor_t{in[i]};
+    }
+
+    for (size_t s = 0; s < stages_.size() && !active.empty(); s++) {
+      const stage &st = stages_[s];
+      const bool last = s + 1 == stages_.size();
+
+      std::vector<tensor_t> pred;
+      if (st.segment) {
+        features = st.segment->predict(features);
+        pred     = st.head->predict(features);
+      } else {
+        std::vector<tensor_t> input;
+        for (auto i : active) input.push_back({in[i]});
+        pred = st.head->predict(input);
+      }
+
+      size_t kept = 0;
+      for (size_t j = 0; j < active.size(); j++) {
+        const vec_t &p = pred[j][0];
+        if (last || confidence_(p) >= st.threshold) {
+          out[active[j]] = p;
+          if (exit) (*exit)[active[j]] = s;
+          exits_[s]++;
+        } else {
+          if (kept != j) {
+            active[kept]   = active[j];
+            features[kept] = std::move(features[j]);
+          }
+          kept++;
+        }
+      }
+      active.resize(kept);
+      features.resize(kept);
+    }
+    return out;
+  }
+
+  vec_t predict(const vec_t &in, size_t *exit = nullptr) {
+    std::vector<size_t> e;
+    vec_t out = predict(std::vector<vec_t>{in}, &e)[0];
+    if (exit) *exit = e[0];
+    return out;
+  }
+
+  /**
+   * number of samples answered by each exit since the last reset
+   **/
+  const std::vector<size_t> &exit_counts() const { return exits_; }
+
+  void reset_counts() { std::fill(exits_.begin(), exits_.end(), 0); }
+
+ private:
+  struct stage {
+    network<NetType> *segment;  // nullptr: a model fed with the input
+    network<NetType> *head;
+    float_t threshold;
+  };
+
+  confidence_function confidence_;
+  std::vector<stage> stages_;
+  std::vector<size_t> exits_;
+};
+
+}  // namespace tiny_dnn
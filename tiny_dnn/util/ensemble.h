@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "tiny_dnn/core/framework/elementwise_expression.h"
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+enum class ensemble_method {
+  mean,  // weighted mean of the members' outputs
+  vote   // weighted share of the members whose top class is each class
+};
+
+/**
+ * several networks scoring the same inputs.
+ *
+ * The inputs are copied once into a batch that every member reads, and
+ * the members run concurrently, one per thread. The threads of the
+ * ensemble are split between members and the parallel loops inside them:
+ * with T threads and M members, min(T, M) members run at a time, each on
+ * up to T / min(T, M) threads, all drawn from the thread_budget of the
+ * calling thread's execution_context. Latency is then close to that of
+ * the slowest member rather than the sum of all.
+ *
+ * Members must be distinct networks; a network bound to its own
+ * execution_context keeps that context.
+ *
+ * @code
+ * ensemble<sequential> e(ensemble_method::mean);
+ * for (auto &m : models) e.add(m);
+ * std::vector<vec_t> scores = e.predict(requests);
+ * @endcode
+ **/
+template <typename NetType>
+class ensemble {
+ public:
+  /**
+   * @param method      [in] how outputs are combined
+   * @param max_threads [in] threads used by a prediction, the calling thread
+   *                         included (0: the cap of the calling thread's
+   *                         context, or one per hardware thread)
+   **/
+  explicit ensemble(ensemble_method method = ensemble_method::mean,
+                    size_t max_threads     = 0)
+    : method_(method), max_threads_(max_threads) {}
+
+  /**
+   * @param member [in] network to add, not copied
+   * @param weight [in] weight of its output (or vote)
+   **/
+  ensemble &add(network<NetType> &member, float_t weight = float_t(1)) {
+    for (const auto &m : members_) {
+      if (m.net == &member) {
+        throw nn_error("network is already a member of the ensemble");
+      }
+    }
+    if (weight < float_t(0)) throw nn_error("negative ensemble weight");
+    members_.push_back(member_t{&member, weight});
+    return *this;
+  }
+
+  size_t size() const { return members_.size(); }
+
+  /**
+   * combined outputs of a batch
+   **/
+  std::vector<vec_t> predict(const std::vector<vec_t> &in) {
+    if (members_.empty()) throw nn_error("ensemble has no members");
+    if (in.empty()) return {};
+
+    std::vector<tensor_t> batch(in.size());
+    for (size_t i = 0; i < in.size(); i++) batch[i] = tensor_t{in[i]};
+
+    std::vector<std::vector<tensor_t>> outs(members_.size());
+    run(batch, outs);
+    return combine(outs, in.size());
+  }
+
+  vec_t predict(const vec_t &in) {
+    return predict(std::vector<vec_t>{in})[0];
+  }
+
+  label_t predict_label(const vec_t &in) {
+    const vec_t out = predict(in);
+    return static_cast<label_t>(
+      std::max_element(out.begin(), out.end()) - out.begin());
+  }
+
+ private:
+  struct member_t {
+    network<NetType> *net;
+    float_t weight;
+  };
+
+  void run(const std::vector<tensor_t> &batch,
+           std::vector<std::vector<tensor_t>> &outs) {
+    execution_context *caller = execution_context::current();
+
+    thread_budget &budget = caller ? caller->budget() : thread_budget::global();
+    const int priority    = caller ? caller->priority() : 0;
+
+    const size_t threads =
+      max_threads_ != 0 ? max_threads_ : worker_lease::max_threads();
+    const size_t concurrent = std::min(threads, members_.size());
+
+    execution_context across(concurrent, priority, budget);
+    execution_context within(threads / concurrent, priority, budget);
+
+    execution_scope scope(&across);
+    for_i(true, members_.size(),
+          [&](size_t m) {
+            execution_scope member_scope(&within);
+            outs[m] = members_[m].net->predict(batch);
+          },
+          1);
+  }
+
+  std::vector<vec_t> combine(const std::vector<std::vector<tensor_t>> &outs,
+                             size_t samples) const {
+    float_t total = float_t(0);
+    for (const auto &m : members_) total += m.weight;
+    if (total <= float_t(0)) throw nn_error("ensemble weights sum to zero");
+
+    std::vector<vec_t> out(samples);
+    for (size_t i = 0; i < samples; i++) {
+      vec_t &o = out[i];
+      o.assign(outs[0][i][0].size(), float_t(0));
+
+      for (size_t m = 0; m < members_.size(); m++) {
+        const vec_t &p  = outs[m][i][0];
+        const float_t w = members_[m].weight / total;
+        if (method_ == ensemble_method::mean) {
+          expr::assign(o, expr::ref(o) + w * expr::ref(p));
+        } else {
+          if (p.size() != o.size()) {
+            throw nn_error("ensemble members have different output sizes");
+          }
+          o[std::max_element(p.begin(), p.end()) - p.begin()] += w;
+        }
+      }
+    }
+    return out;
+  }
+
+  ensemble_method method_;
+  size_t max_threads_;
+  std::vector<member_t> members_;
+};
+
+}  // namespace tiny_dnn
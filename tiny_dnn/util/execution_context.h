@@ -0,0 +1,256 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nn_error.h"
+
+namespace tiny_dnn {
+
+class execution_context;
+
+/**
+ * the worker threads that parallel_for may start on top of its calling
+ * thread, shared by every execution_context of a process.
+ *
+ * A context borrows workers for one parallel_for and gives them back when
+ * it returns. Workers are held back for contexts of higher priority that
+ * are busy, i.e. in a parallel loop or out of one for less than `hold`: a
+ * context may only borrow what is left after each of them could still get
+ * up to its cap, so a latency-sensitive model finds its threads available
+ * between the loops of a forward pass however busy the others are. Idle
+ * contexts hold nothing back.
+ **/
+class thread_budget {
+ public:
+  /**
+   * @param workers [in] threads parallel loops may start
+   * @param hold    [in] how long a context stays busy after its last loop
+   **/
+  explicit thread_budget(
+    size_t workers,
+    std::chrono::steady_clock::duration hold = std::chrono::milliseconds(100))
+    : free_(workers), lent_(0), hold_(hold) {}
+
+  // hardware threads less the one calling parallel_for
+  static thread_budget &global() {
+    static thread_budget budget(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+    return budget;
+  }
+
+  /**
+   * takes up to `want` workers for ctx (nullptr: the default context);
+   * ctx is busy until each borrow is matched by a give_back
+   * @return number of workers granted, possibly 0
+   **/
+  size_t borrow(const execution_context *ctx, size_t want);
+
+  void give_back(const execution_context *ctx, size_t n);
+
+  size_t available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_;
+  }
+
+  // workers granted since construction, returned or not
+  size_t lent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lent_;
+  }
+
+ private:
+  friend class execution_context;
+
+  struct entry {
+    const execution_context *ctx;
+    size_t in_use;
+    size_t loops;  // borrow calls not given back yet
+    std::chrono::steady_clock::time_point last_end;
+  };
+
+  entry *find(const execution_context *ctx) {
+    for (auto &e : contexts_) {
+      if (e.ctx == ctx) return &e;
+    }
+    return nullptr;
+  }
+
+  void add(const execution_context *ctx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    contexts_.push_back(
+      entry{ctx, 0, 0, std::chrono::steady_clock::time_point::min()});
+  }
+
+  void remove(const execution_context *ctx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    contexts_.erase(std::remove_if(contexts_.begin(), contexts_.end(),
+                                   [ctx](const entry &e) {
+                                     return e.ctx == ctx;
+                                   }),
+                    contexts_.end());
+  }
+
+  mutable std::mutex mutex_;
+  size_t free_;
+  size_t lent_;
+  std::chrono::steady_clock::duration hold_;
+  std::vector<entry> contexts_;
+};
+
+/**
+ * limits and priority of the parallel_for/for_i calls made on behalf of
+ * one network.
+ *
+ * A network bound to a context with network::set_execution_context runs
+ * its parallel loops on at most max_threads threads (the calling thread
+ * included). Contexts of higher priority get workers first, see
+ * thread_budget. Networks without a context behave as a context of
+ * priority 0 with no cap.
+ *
+ * The cap applies to the default std::thread backend and to OpenMP; the
+ * priority only to the default backend, which is the only one whose
+ * threads tiny-dnn starts itself.
+ **/
+class execution_context {
+ public:
+  /**
+   * @param max_threads [in] threads per parallel loop, the calling thread
+   *                         included (0: one per hardware thread)
+   * @param priority    [in] contexts with a larger value get workers first
+   * @param budget      [in] the workers this context draws from
+   **/
+  explicit execution_context(size_t max_threads = 0,
+                             int priority          = 0,
+                             thread_budget &budget = thread_budget::global())
+    : max_threads_(max_threads), priority_(priority), budget_(budget) {
+    budget_.add(this);
+  }
+
+  ~execution_context() { budget_.remove(this); }
+
+  execution_context(const execution_context &) = delete;
+  execution_context &operator=(const execution_context &) = delete;
+
+  size_t max_threads() const {
+    if (max_threads_ != 0) return max_threads_;
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  int priority() const { return priority_; }
+
+  thread_budget &budget() const { return budget_; }
+
+  // the context bound to the calling thread, nullptr if none
+  static execution_context *current() { return current_ref(); }
+
+ private:
+  friend class execution_scope;
+
+  static execution_context *&current_ref() {
+    static thread_local execution_context *ctx = nullptr;
+    return ctx;
+  }
+
+  size_t max_threads_;
+  int priority_;
+  thread_budget &budget_;
+};
+
+/**
+ * binds a context to the calling thread for the lifetime of the scope
+ **/
+class execution_scope {
+ public:
+  explicit execution_scope(execution_context *ctx)
+    : prev_(execution_context::current_ref()) {
+    if (ctx) execution_context::current_ref() = ctx;
+  }
+
+  ~execution_scope() { execution_context::current_ref() = prev_; }
+
+  execution_scope(const execution_scope &) = delete;
+  execution_scope &operator=(const execution_scope &) = delete;
+
+ private:
+  execution_context *prev_;
+};
+
+inline size_t thread_budget::borrow(const execution_context *ctx,
+                                    size_t want) {
+  const int priority = ctx ? ctx->priority() : 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // workers that busy contexts of higher priority could still ask for
+  const auto now  = std::chrono::steady_clock::now();
+  size_t reserved = 0;
+  for (const auto &e : contexts_) {
+    if (e.ctx == ctx || e.ctx->priority() <= priority) continue;
+    if (e.loops == 0 && now >= e.last_end + hold_) continue;
+    const size_t cap = e.ctx->max_threads() - 1;
+    if (cap > e.in_use) reserved += cap - e.in_use;
+  }
+
+  const size_t n = free_ > reserved ? std::min(want, free_ - reserved) : 0;
+  free_ -= n;
+  lent_ += n;
+  if (entry *e = find(ctx)) {
+    e->in_use += n;
+    e->loops++;
+  }
+  return n;
+}
+
+inline void thread_budget::give_back(const execution_context *ctx, size_t n) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_ += n;
+  if (entry *e = find(ctx)) {
+    e->in_use -= n;
+    if (e->loops > 0 && --e->loops == 0) {
+      e->last_end = std::chrono::steady_clock::now();
+    }
+  }
+}
+
+/**
+ * workers borrowed for one parallel loop of the calling thread's context
+ **/
+class worker_lease {
+ public:
+  explicit worker_lease(size_t want)
+    : ctx_(execution_context::current()),
+      budget_(ctx_ ? ctx_->budget() : thread_budget::global()),
+      n_(budget_.borrow(ctx_, std::min(want, max_threads() - 1))) {}
+
+  ~worker_lease() { budget_.give_back(ctx_, n_); }
+
+  worker_lease(const worker_lease &) = delete;
+  worker_lease &operator=(const worker_lease &) = delete;
+
+  // threads of the calling thread's context, the calling thread included
+  static size_t max_threads() {
+    if (execution_context *ctx = execution_context::current()) {
+      return ctx->max_threads();
+    }
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  size_t size() const { return n_; }
+
+ private:
+  execution_context *ctx_;
+  thread_budget &budget_;
+  size_t n_;
+};
+
+}  // namespace tiny_dnn
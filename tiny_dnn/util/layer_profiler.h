@@ -0,0 +1,238 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tiny_dnn/layers/layer.h"
+#include "tiny_dnn/util/perf_counters.h"
+
+namespace tiny_dnn {
+
+enum class profile_phase : int { forward = 0, backward = 1 };
+
+inline const char *to_string(profile_phase phase) {
+  return phase == profile_phase::forward ? "forward" : "backward";
+}
+
+/**
+ * accumulated statistics of one layer
+ **/
+struct layer_profile {
+  layer_profile() : index(0), engine(core::backend_t::internal) {
+    for (int i = 0; i < 2; i++) {
+      calls[i]   = 0;
+      seconds[i] = 0;
+      flops[i]   = 0;
+    }
+  }
+
+  /**
+   * achieved GFLOP/s (0 if the flop count of the layer is unknown)
+   **/
+  double gflops(profile_phase p) const {
+    const int i = static_cast<int>(p);
+    return seconds[i] > 0 ? flops[i] / seconds[i] * 1e-9 : 0.0;
+  }
+
+  /**
+   * instructions per cycle (0 if counters are unavailable)
+   **/
+  double ipc(profile_phase p) const {
+    const auto &c = counters[static_cast<int>(p)];
+    return c[hw_counter::cycles] ? static_cast<double>(
+                                     c[hw_counter::instructions]) /
+                                     c[hw_counter::cycles]
+                                 : 0.0;
+  }
+
+  std::string layer_type;
+  size_t index;  ///< order of first execution in the network
+  core::backend_t engine;
+  size_t calls[2];
+  double seconds[2];
+  uint64_t flops[2];
+  hw_counter_values counters[2];
+};
+
+/**
+ * per-layer forward/backward profiler
+ *
+ * Measures wall-clock time of every layer::forward / layer::backward call
+ * and, if available, hardware performance counters (see perf_counters).
+ * Attach it to a network and run it as usual:
+ *
+ *     layer_profiler prof;
+ *     net.set_profiler(&prof);
+ *     net.fit<mse>(opt, x, y, 32, 1);
+ *     prof.print(std::cout);
+ *
+ * GFLOP/s are derived from the static cost model of each layer
+ * (layer::forward_flops / layer::backward_flops). Use set_flop_counter to
+ * count operations differently.
+ **/
+class layer_profiler {
+ public:
+  /**
+   * returns the number of floating point operations executed by one call
+   **/
+  typedef std::function<uint64_t(
+    const layer &l, profile_phase phase, size_t sample_count)>
+    flop_counter;
+
+  /**
+   * @param use_hw_counters set false to skip perf_event_open entirely
+   **/
+  explicit layer_profiler(bool use_hw_counters = true)
+    : flop_counter_(cost_model_flops), in_flight_(nullptr) {
+    if (use_hw_counters) hw_.reset(new perf_counters());
+  }
+
+  bool hw_counters_available() const { return hw_ && hw_->available(); }
+
+  void set_flop_counter(flop_counter f) { flop_counter_ = f; }
+
+  void begin(const layer &l, profile_phase phase) {
+    CNN_UNREFERENCED_PARAMETER(phase);
+    in_flight_ = &l;
+    if (hw_) begin_counters_ = hw_->read();
+    begin_time_ = std::chrono::steady_clock::now();
+  }
+
+  void end(const layer &l, profile_phase phase) {
+    const auto now = std::chrono::steady_clock::now();
+    hw_counter_values counters;
+    if (hw_) counters = hw_->read() - begin_counters_;
+    if (in_flight_ != &l) return;  // unbalanced begin/end
+    in_flight_ = nullptr;
+
+    layer_profile &p = profile_of(l);
+    const int i      = static_cast<int>(phase);
+    p.calls[i]++;
+    p.seconds[i] += std::chrono::duration<double>(now - begin_time_).count();
+    p.counters[i] += counters;
+    if (flop_counter_) {
+      p.flops[i] += flop_counter_(l, phase, sample_count(l));
+    }
+  }
+
+  /**
+   * profiles in order of first execution
+   **/
+  const std::vector<layer_profile> &profiles() const { return profiles_; }
+
+  void reset() {
+    profiles_.clear();
+    index_.clear();
+    in_flight_ = nullptr;
+  }
+
+  template <typename Char, typename CharTraits>
+  void print(std::basic_ostream<Char, CharTraits> &os) const {
+    const bool hw = hw_counters_available();
+    os << std::left << std::setw(4) << "#" << std::setw(20) << "layer"
+       << std::setw(10) << "engine" << std::setw(10) << "phase"
+       << std::right << std::setw(8) << "calls" << std::setw(12) << "ms"
+       << std::setw(10) << "GFLOP/s";
+    if (hw) {
+      os << std::setw(8) << "IPC" << std::setw(14) << "L1D-miss"
+         << std::setw(14) << "LLC-miss" << std::setw(14) << "br-miss";
+    }
+    os << std::endl;
+
+    for (const auto &p : profiles_) {
+      for (int i = 0; i < 2; i++) {
+        if (p.calls[i] == 0) continue;
+        const profile_phase ph = static_cast<profile_phase>(i);
+        std::ostringstream engine;
+        engine << p.engine;
+        os << std::left << std::setw(4) << p.index << std::setw(20)
+           << p.layer_type << std::setw(10) << engine.str() << std::setw(10)
+           << to_string(ph) << std::right << std::setw(8) << p.calls[i]
+           << std::setw(12) << std::fixed << std::setprecision(3)
+           << p.seconds[i] * 1e3 << std::setw(10) << std::setprecision(2)
+           << p.gflops(ph);
+        if (hw) {
+          const auto &c = p.counters[i];
+          os << std::setw(8) << p.ipc(ph) << std::setw(14)
+             << c[hw_counter::l1d_read_misses] << std::setw(14)
+             << c[hw_counter::llc_misses] << std::setw(14)
+             << c[hw_counter::branch_misses];
+        }
+        os << std::endl;
+      }
+    }
+    if (!hw) os << "(hardware counters unavailable)" << std::endl;
+  }
+
+  /**
+   * RAII helper to profile a scope
+   **/
+  class scope {
+   public:
+    scope(layer_profiler *prof, const layer &l, profile_phase phase)
+      : prof_(prof), l_(l), phase_(phase) {
+      if (prof_) prof_->begin(l_, phase_);
+    }
+    ~scope() {
+      if (prof_) prof_->end(l_, phase_);
+    }
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+
+   private:
+    layer_profiler *prof_;
+    const layer &l_;
+    profile_phase phase_;
+  };
+
+ private:
+  layer_profile &profile_of(const layer &l) {
+    auto it = index_.find(&l);
+    if (it != index_.end()) return profiles_[it->second];
+
+    index_[&l] = profiles_.size();
+    profiles_.emplace_back();
+    layer_profile &p = profiles_.back();
+    p.layer_type     = l.layer_type();
+    p.index          = profiles_.size() - 1;
+    p.engine         = l.engine();
+    return p;
+  }
+
+  static uint64_t cost_model_flops(const layer &l,
+                                   profile_phase phase,
+                                   size_t sample_count) {
+    return sample_count * (phase == profile_phase::forward
+                             ? l.forward_flops()
+                             : l.backward_flops());
+  }
+
+  static size_t sample_count(const layer &l) {
+    auto out = l.outputs();
+    return out.empty() || !out[0] ? 0 : out[0]->get_data()->size();
+  }
+
+  std::unique_ptr<perf_counters> hw_;
+  flop_counter flop_counter_;
+  std::vector<layer_profile> profiles_;
+  std::unordered_map<const layer *, size_t> index_;
+  const layer *in_flight_;
+  std::chrono::steady_clock::time_point begin_time_;
+  hw_counter_values begin_counters_;
+};
+
+}  // namespace tiny_dnn
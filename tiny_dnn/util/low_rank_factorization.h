@@ -0,0 +1,538 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/channel_pruning.h"
+#include "tiny_dnn/util/random.h"
+
+namespace tiny_dnn {
+
+/**
+ * options of the low-rank factorization
+ **/
+struct low_rank_params {
+  low_rank_params()
+    : rank(0),
+      energy(0.9),
+      power_iterations(4),
+      oversampling(8),
+      block_size(16),
+      fine_tune_epochs(0),
+      fine_tune_batch_size(16) {}
+
+  /**
+   * target rank; 0 selects the smallest rank which keeps `energy`
+   **/
+  size_t rank;
+
+  /**
+   * fraction of the squared singular values (frobenius energy) to keep
+   **/
+  double energy;
+
+  int power_iterations;
+  size_t oversampling;
+
+  /**
+   * basis vectors added per step while searching the rank for `energy`
+   **/
+  size_t block_size;
+
+  /**
+   * epochs of training after each factorized layer (0: no fine-tuning).
+   * only used by the overload that takes training data.
+   **/
+  int fine_tune_epochs;
+  size_t fine_tune_batch_size;
+};
+
+/**
+ * per-layer result of the factorization
+ **/
+struct low_rank_report {
+  size_t index;  ///< index of the original layer
+  serial_size_t in_size;
+  serial_size_t out_size;
+  size_t rank;
+  double retained_energy;  ///< kept fraction of the frobenius energy
+  double accuracy_before;  ///< test accuracy in %, -1 if not measured
+  double accuracy_after;   ///< after factorization (and fine-tuning)
+  uint64_t params_before;
+  uint64_t params_after;
+  uint64_t flops_before;  ///< forward flops per sample
+  uint64_t flops_after;
+
+  bool has_accuracy() const { return accuracy_before >= 0; }
+
+  ///< accuracy lost by this layer, in percentage points
+  double accuracy_drop() const { return accuracy_before - accuracy_after; }
+
+  double speedup() const {
+    return flops_after ? static_cast<double>(flops_before) / flops_after : 0;
+  }
+};
+
+template <typename Char, typename CharTraits>
+std::basic_ostream<Char, CharTraits> &operator<<(
+  std::basic_ostream<Char, CharTraits> &os,
+  const std::vector<low_rank_report> &reports) {
+  os << std::left << std::setw(6) << "#" << std::right << std::setw(14)
+     << "shape" << std::setw(8) << "rank" << std::setw(10) << "energy"
+     << std::setw(10) << "acc" << std::setw(10) << "acc-drop" << std::setw(12)
+     << "params" << std::setw(10) << "speedup" << std::endl;
+  for (const auto &r : reports) {
+    std::ostringstream shape, acc, drop;
+    shape << r.in_size << "x" << r.out_size;
+    acc << std::fixed << std::setprecision(2);
+    drop << std::fixed << std::setprecision(2);
+    if (r.has_accuracy()) {
+      acc << r.accuracy_after;
+      drop << r.accuracy_drop();
+    } else {
+      acc << "-";
+      drop << "-";
+    }
+    os << std::left << std::setw(6) << r.index << std::right << std::setw(14)
+       << shape.str() << std::setw(8) << r.rank << std::setw(10) << std::fixed
+       << std::setprecision(4) << r.retained_energy << std::setw(10)
+       << acc.str() << std::setw(10) << drop.str() << std::setw(12)
+       << r.params_after << std::setw(10) << std::setprecision(2)
+       << r.speedup() << std::endl;
+  }
+  return os;
+}
+
+namespace detail {
+
+/**
+ * truncated SVD A ~= U diag(s) V^T of a dense row-major m x n matrix.
+ *
+ * An orthonormal basis Q of the dominant column space is built block by
+ * block with subspace iteration on the part of A that Q does not capture
+ * yet (blocked randQB; Halko, Martinsson and Tropp, 2011, Martinsson and
+ * Voronin, 2016), and the SVD is read off the small l x n matrix Q^T A.
+ * Every step therefore costs in proportion to the basis size l, and the
+ * energy search stops one block past the rank it needs.
+ * U is m x k, V is n x k, both column-major.
+ **/
+class truncated_svd {
+ public:
+  truncated_svd(const float_t *a, size_t m, size_t n)
+    : a_(a), m_(m), n_(n), l_(0) {}
+
+  ///< rank-k factors from a single basis block of k + oversampling
+  void compute(size_t k, size_t oversampling, int power_iterations) {
+    reset();
+    grow(std::min(k + oversampling, std::min(m_, n_)), power_iterations);
+    decompose(k);
+  }
+
+  /**
+   * grow the basis by `block` until it holds `energy` of the frobenius
+   * energy of A, then decompose it.
+   * @return the smallest rank whose singular values keep `energy`
+   **/
+  size_t compute_energy(double energy, size_t block, int power_iterations) {
+    const size_t max_l = std::min(m_, n_);
+    double total = 0;
+    for (size_t i = 0; i < m_ * n_; i++) {
+      total += static_cast<double>(a_[i]) * a_[i];
+    }
+
+    reset();
+    double kept = 0;
+    do {
+      kept += grow(std::min(std::max<size_t>(block, 1), max_l - l_),
+                   power_iterations);
+    } while (l_ < max_l && kept < energy * total);
+    decompose(l_);
+
+    size_t rank = 0;
+    for (kept = 0; rank < s_.size() && kept < energy * total; rank++) {
+      kept += s_[rank] * s_[rank];
+    }
+    return rank;
+  }
+
+  const std::vector<double> &s() const { return s_; }
+  double u(size_t row, size_t k) const { return u_[k * m_ + row]; }
+  double v(size_t row, size_t k) const { return v_[k * n_ + row]; }
+
+ private:
+  void reset() {
+    l_ = 0;
+    q_.clear();
+    bt_.clear();
+  }
+
+  // append b columns to Q (and to B^T = A^T Q), returns their energy
+  double grow(size_t b, int power_iterations) {
+    std::vector<double> omega(n_ * b);
+    for (auto &v : omega) v = gaussian_rand(0.0, 1.0);
+
+    q_.resize(m_ * (l_ + b));
+    double *y = &q_[m_ * l_];
+    multiply(&omega[0], b, y);
+    orthonormalize(&q_[0], m_, l_, l_ + b);
+    for (int i = 0; i < power_iterations; i++) {
+      multiply_transposed(y, b, &omega[0]);
+      orthonormalize(&omega[0], n_, 0, b);
+      multiply(&omega[0], b, y);
+      orthonormalize(&q_[0], m_, l_, l_ + b);
+    }
+
+    bt_.resize(n_ * (l_ + b));
+    double *bt = &bt_[n_ * l_];
+    multiply_transposed(y, b, bt);
+    l_ += b;
+
+    double energy = 0;
+    for (size_t i = 0; i < n_ * b; i++) energy += bt[i] * bt[i];
+    return energy;
+  }
+
+  // the eigen decomposition of B B^T gives the singular triplets
+  void decompose(size_t k) {
+    std::vector<double> c(l_ * l_, 0.0);
+    for (size_t i = 0; i < l_; i++) {
+      for (size_t j = i; j < l_; j++) {
+        double s = 0;
+        for (size_t r = 0; r < n_; r++) s += bt_[i * n_ + r] * bt_[j * n_ + r];
+        c[i * l_ + j] = c[j * l_ + i] = s;
+      }
+    }
+    std::vector<double> eigvec, eigval;
+    jacobi_eigen(c, l_, eigvec, eigval);
+
+    std::vector<size_t> order(l_);
+    for (size_t i = 0; i < l_; i++) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&](size_t x, size_t y) { return eigval[x] > eigval[y]; });
+
+    k = std::min(k, l_);
+    s_.assign(k, 0.0);
+    u_.assign(m_ * k, 0.0);
+    v_.assign(n_ * k, 0.0);
+    for (size_t j = 0; j < k; j++) {
+      const size_t e = order[j];
+      s_[j]          = std::sqrt(std::max(eigval[e], 0.0));
+      for (size_t i = 0; i < l_; i++) {
+        const double w = eigvec[i * l_ + e];
+        for (size_t r = 0; r < m_; r++) u_[j * m_ + r] += q_[i * m_ + r] * w;
+        if (s_[j] > 0) {
+          for (size_t r = 0; r < n_; r++)
+            v_[j * n_ + r] += bt_[i * n_ + r] * w / s_[j];
+        }
+      }
+    }
+  }
+
+  // y(m x l) = A * x(n x l), column-major x and y
+  void multiply(const double *x, size_t l, double *y) const {
+    for_i(m_, [&](size_t r) {
+      const float_t *row = a_ + r * n_;
+      for (size_t j = 0; j < l; j++) {
+        const double *xj = &x[j * n_];
+        double s         = 0;
+        for (size_t c = 0; c < n_; c++) s += row[c] * xj[c];
+        y[j * m_ + r] = s;
+      }
+    });
+  }
+
+  // y(n x l) = A^T * x(m x l), column-major x and y
+  void multiply_transposed(const double *x, size_t l, double *y) const {
+    auto column = [&](size_t j) {
+      double *yj       = &y[j * n_];
+      const double *xj = &x[j * m_];
+      std::fill(yj, yj + n_, 0.0);
+      for (size_t r = 0; r < m_; r++) {
+        const float_t *row = a_ + r * n_;
+        const double xr    = xj[r];
+        for (size_t c = 0; c < n_; c++) yj[c] += row[c] * xr;
+      }
+    };
+    for_i(true, l, column, 1);
+  }
+
+  // modified gram-schmidt of the columns [first, last) of x (rows x last)
+  // against all columns before them
+  static void orthonormalize(double *x,
+                             size_t rows,
+                             size_t first,
+                             size_t last) {
+    for (size_t j = first; j < last; j++) {
+      double *xj = &x[j * rows];
+      for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < j; i++) {
+          const double *xi = &x[i * rows];
+          double d         = 0;
+          for (size_t r = 0; r < rows; r++) d += xi[r] * xj[r];
+          for (size_t r = 0; r < rows; r++) xj[r] -= d * xi[r];
+        }
+      }
+      double norm = 0;
+      for (size_t r = 0; r < rows; r++) norm += xj[r] * xj[r];
+      norm = std::sqrt(norm);
+      const double rcp = norm > 1e-12 ? 1 / norm : 0;
+      for (size_t r = 0; r < rows; r++) xj[r] *= rcp;
+    }
+  }
+
+  // cyclic jacobi eigen decomposition of a symmetric n x n matrix
+  static void jacobi_eigen(std::vector<double> a,
+                           size_t n,
+                           std::vector<double> &vec,
+                           std::vector<double> &val) {
+    vec.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; i++) vec[i * n + i] = 1.0;
+
+    for (int sweep = 0; sweep < 64; sweep++) {
+      double off = 0, diag = 0;
+      for (size_t p = 0; p < n; p++) {
+        diag += a[p * n + p] * a[p * n + p];
+        for (size_t q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+      }
+      if (off <= 1e-24 * diag) break;
+
+      for (size_t p = 0; p < n; p++) {
+        for (size_t q = p + 1; q < n; q++) {
+          const double apq = a[p * n + q];
+          if (std::abs(apq) < 1e-300) continue;
+          const double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+          const double t     = (theta >= 0 ? 1.0 : -1.0) /
+                           (std::abs(theta) + std::sqrt(theta * theta + 1));
+          const double c = 1 / std::sqrt(t * t + 1), s = t * c;
+
+          for (size_t k = 0; k < n; k++) {
+            const double akp = a[k * n + p], akq = a[k * n + q];
+            a[k * n + p] = c * akp - s * akq;
+            a[k * n + q] = s * akp + c * akq;
+          }
+          for (size_t k = 0; k < n; k++) {
+            const double apk = a[p * n + k], aqk = a[q * n + k];
+            a[p * n + k] = c * apk - s * aqk;
+            a[q * n + k] = s * apk + c * aqk;
+          }
+          for (size_t k = 0; k < n; k++) {
+            const double vkp = vec[k * n + p], vkq = vec[k * n + q];
+            vec[k * n + p] = c * vkp - s * vkq;
+            vec[k * n + q] = s * vkp + c * vkq;
+          }
+        }
+      }
+    }
+    val.resize(n);
+    for (size_t i = 0; i < n; i++) val[i] = a[i * n + i];
+  }
+
+  const float_t *a_;
+  size_t m_, n_;
+  size_t l_;                    ///< basis size
+  std::vector<double> q_, bt_;  ///< Q (m x l) and B^T (n x l)
+  std::vector<double> s_, u_, v_;
+};
+
+}  // namespace detail
+
+/**
+ * replace net[index], a fully_connected_layer, with two thin
+ * fully-connected layers (in -> rank, rank -> out) obtained by truncated
+ * SVD of its weights. the bias moves to the second layer.
+ * fine-tune the returned network with fit to recover accuracy.
+ **/
+inline network<sequential> factorize_fully_connected(
+  const network<sequential> &net,
+  size_t index,
+  const low_rank_params &params = low_rank_params(),
+  low_rank_report *report       = nullptr) {
+  if (index >= net.layer_size()) throw nn_error("layer index out of range");
+  const layer &l = *net[index];
+  if (!dynamic_cast<const fully_connected_layer *>(&l)) {
+    throw nn_error("not a fully-connected layer: " + l.layer_type());
+  }
+
+  const auto w          = l.weights();
+  const size_t m        = l.in_data_size();
+  const size_t n        = l.out_data_size();
+  const bool has_bias   = w.size() > 1;
+  const size_t max_rank = std::min(m, n);
+
+  double total = 0;
+  for (auto v : *w[0]) total += static_cast<double>(v) * v;
+
+  detail::truncated_svd svd(&(*w[0])[0], m, n);
+  size_t rank = params.rank ? std::min(params.rank, max_rank) : 0;
+
+  if (rank) {
+    svd.compute(rank, params.oversampling, params.power_iterations);
+  } else {
+    rank = svd.compute_energy(params.energy, params.block_size,
+                              params.power_iterations);
+  }
+  rank = std::max<size_t>(rank, 1);
+
+  auto first = std::make_shared<fully_connected_layer>(
+    static_cast<serial_size_t>(m), static_cast<serial_size_t>(rank), false,
+    l.engine());
+  auto second = std::make_shared<fully_connected_layer>(
+    static_cast<serial_size_t>(rank), static_cast<serial_size_t>(n), has_bias,
+    l.engine());
+
+  // W (m x n) ~= (U sqrt(S)) (sqrt(S) V^T)
+  std::vector<float_t> w1(m * rank), w2;
+  for (size_t r = 0; r < m; r++) {
+    for (size_t j = 0; j < rank; j++) {
+      w1[r * rank + j] =
+        static_cast<float_t>(svd.u(r, j) * std::sqrt(svd.s()[j]));
+    }
+  }
+  w2.resize(rank * n);
+  for (size_t j = 0; j < rank; j++) {
+    for (size_t c = 0; c < n; c++) {
+      w2[j * n + c] = static_cast<float_t>(std::sqrt(svd.s()[j]) * svd.v(c, j));
+    }
+  }
+  if (has_bias) w2.insert(w2.end(), w[1]->begin(), w[1]->end());
+
+  int idx = 0;
+  first->load(w1, idx);
+  idx = 0;
+  second->load(w2, idx);
+
+  if (report) {
+    double kept = 0;
+    for (size_t j = 0; j < rank; j++) kept += svd.s()[j] * svd.s()[j];
+    report->index           = index;
+    report->in_size         = static_cast<serial_size_t>(m);
+    report->out_size        = static_cast<serial_size_t>(n);
+    report->rank            = rank;
+    report->retained_energy = total > 0 ? std::min(1.0, kept / total) : 1.0;
+    report->accuracy_before = -1;
+    report->accuracy_after  = -1;
+    report->params_before   = l.param_count();
+    report->params_after    = first->param_count() + second->param_count();
+    report->flops_before    = l.forward_flops();
+    report->flops_after     = first->forward_flops() + second->forward_flops();
+  }
+
+  network<sequential> dst;
+  for (size_t i = 0; i < net.layer_size(); i++) {
+    if (i == index) {
+      dst << first << second;
+    } else {
+      dst << clone_layer(*net[i]);
+    }
+  }
+  return dst;
+}
+
+namespace detail {
+
+inline network<sequential> clone_network(const network<sequential> &net) {
+  network<sequential> dst;
+  for (size_t i = 0; i < net.layer_size(); i++) dst << clone_layer(*net[i]);
+  return dst;
+}
+
+/**
+ * factorize the fully-connected layers of a deep copy of net one after
+ * the other. on_accept(before, after, report) runs for every layer whose
+ * factorization is kept, and may train `after`.
+ **/
+template <typename OnAccept>
+network<sequential> factorize_each(const network<sequential> &net,
+                                   const low_rank_params &params,
+                                   std::vector<low_rank_report> *reports,
+                                   OnAccept on_accept) {
+  network<sequential> dst = clone_network(net);
+  for (size_t i = 0, original = 0; i < dst.layer_size(); i++, original++) {
+    if (!dynamic_cast<const fully_connected_layer *>(dst[i])) continue;
+
+    low_rank_report r;
+    network<sequential> candidate =
+      factorize_fully_connected(dst, i, params, &r);
+    r.index = original;
+    if (r.params_after < r.params_before) {
+      on_accept(dst, candidate, r);
+      dst = candidate;
+      i++;  // skip the second half of the factorized pair
+    }
+    if (reports) reports->push_back(r);
+  }
+  return dst;
+}
+
+}  // namespace detail
+
+/**
+ * factorize every fully_connected_layer for which the chosen rank
+ * actually reduces the parameter count. one report per layer examined.
+ * the returned network shares no layers with net.
+ **/
+inline network<sequential> factorize_fully_connected(
+  const network<sequential> &net,
+  const low_rank_params &params,
+  std::vector<low_rank_report> *reports = nullptr) {
+  return detail::factorize_each(
+    net, params, reports,
+    [](network<sequential> &, network<sequential> &, low_rank_report &) {});
+}
+
+/**
+ * as above, and report the accuracy on (test_x, test_y) before and after
+ * each factorized layer. with params.fine_tune_epochs > 0 the network is
+ * trained on (train_x, train_y) right after each layer is split, so the
+ * next layer is factorized on top of the recovered network and
+ * accuracy_after is measured after fine-tuning.
+ *
+ *     low_rank_params p;
+ *     p.fine_tune_epochs = 2;
+ *     std::vector<low_rank_report> reports;
+ *     adagrad opt;
+ *     auto small = factorize_fully_connected<cross_entropy_multiclass>(
+ *       net, p, opt, train_x, train_y, test_x, test_y, &reports);
+ *     std::cout << reports;
+ **/
+template <typename Loss, typename Optimizer>
+network<sequential> factorize_fully_connected(
+  const network<sequential> &net,
+  const low_rank_params &params,
+  Optimizer &optimizer,
+  const std::vector<vec_t> &train_x,
+  const std::vector<label_t> &train_y,
+  const std::vector<vec_t> &test_x,
+  const std::vector<label_t> &test_y,
+  std::vector<low_rank_report> *reports = nullptr) {
+  auto accuracy = [&](network<sequential> &n) {
+    return static_cast<double>(n.test(test_x, test_y).accuracy());
+  };
+  return detail::factorize_each(
+    net, params, reports, [&](network<sequential> &before,
+                              network<sequential> &after, low_rank_report &r) {
+      r.accuracy_before = accuracy(before);
+      if (params.fine_tune_epochs > 0) {
+        after.train<Loss>(optimizer, train_x, train_y,
+                          params.fine_tune_batch_size,
+                          params.fine_tune_epochs);
+      }
+      r.accuracy_after = accuracy(after);
+    });
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,499 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/nn_error.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * options of save_compressed
+ **/
+struct compression_params {
+  compression_params() : bits(6), min_size(64), kmeans_iterations(12) {}
+
+  /**
+   * bits per weight index (1-8), i.e. a codebook of 2^bits shared values
+   * per weight vector. 0 keeps the weights lossless.
+   **/
+  int bits;
+
+  /**
+   * weight vectors smaller than this (biases, typically) are kept lossless
+   **/
+  size_t min_size;
+
+  /**
+   * lloyd iterations of the k-means clustering
+   **/
+  int kmeans_iterations;
+};
+
+namespace compression {
+
+typedef std::vector<uint8_t> bytes_t;
+
+/**
+ * transpose an array of n elements of elem_size bytes so that the i-th
+ * byte of every element is stored contiguously. exponent and high mantissa
+ * bytes of float weights are highly redundant, which the LZ codec exploits.
+ **/
+inline bytes_t byte_shuffle(const void *src, size_t n, size_t elem_size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(src);
+  bytes_t dst(n * elem_size);
+  for (size_t b = 0; b < elem_size; b++) {
+    uint8_t *d = &dst[b * n];
+    for (size_t i = 0; i < n; i++) d[i] = p[i * elem_size + b];
+  }
+  return dst;
+}
+
+inline void byte_unshuffle(const uint8_t *src,
+                           size_t n,
+                           size_t elem_size,
+                           void *dst) {
+  uint8_t *d = reinterpret_cast<uint8_t *>(dst);
+  for (size_t b = 0; b < elem_size; b++) {
+    const uint8_t *s = &src[b * n];
+    for (size_t i = 0; i < n; i++) d[i * elem_size + b] = s[i];
+  }
+}
+
+namespace detail {
+
+static const size_t lz_min_match  = 4;
+static const size_t lz_max_offset = 65535;
+static const int lz_hash_bits     = 14;
+
+inline uint32_t lz_read32(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t lz_hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - lz_hash_bits);
+}
+
+inline void lz_put_length(bytes_t &dst, size_t len) {
+  for (; len >= 255; len -= 255) dst.push_back(255);
+  dst.push_back(static_cast<uint8_t>(len));
+}
+
+inline void lz_put_sequence(bytes_t &dst,
+                            const uint8_t *literals,
+                            size_t n_literals,
+                            size_t match_len,
+                            size_t offset) {
+  const size_t ml = match_len ? match_len - lz_min_match : 0;
+  dst.push_back(static_cast<uint8_t>((std::min<size_t>(n_literals, 15) << 4) |
+                                     std::min<size_t>(ml, 15)));
+  if (n_literals >= 15) lz_put_length(dst, n_literals - 15);
+  dst.insert(dst.end(), literals, literals + n_literals);
+  if (match_len == 0) return;  // last sequence carries literals only
+  dst.push_back(static_cast<uint8_t>(offset & 0xff));
+  dst.push_back(static_cast<uint8_t>(offset >> 8));
+  if (ml >= 15) lz_put_length(dst, ml - 15);
+}
+
+inline size_t lz_get_length(const uint8_t *&p, const uint8_t *end) {
+  size_t len = 0;
+  uint8_t b;
+  do {
+    if (p >= end) throw nn_error("corrupted compressed stream");
+    b = *p++;
+    len += b;
+  } while (b == 255);
+  return len;
+}
+
+}  // namespace detail
+
+/**
+ * byte-oriented LZ77 compression (LZ4-like sequence format, 64KB window)
+ **/
+inline bytes_t lz_compress(const uint8_t *src, size_t n) {
+  using namespace detail;
+  bytes_t dst;
+  dst.reserve(n / 2 + 16);
+  std::vector<size_t> table(size_t(1) << lz_hash_bits,
+                            std::numeric_limits<size_t>::max());
+
+  size_t anchor = 0, i = 0;
+  while (n >= lz_min_match && i + lz_min_match <= n) {
+    const uint32_t v = lz_read32(src + i);
+    const uint32_t h = lz_hash(v);
+    const size_t cand = table[h];
+    table[h]          = i;
+
+    if (cand != std::numeric_limits<size_t>::max() &&
+        i - cand <= lz_max_offset && lz_read32(src + cand) == v) {
+      size_t len = lz_min_match;
+      while (i + len < n && src[cand + len] == src[i + len]) len++;
+      lz_put_sequence(dst, src + anchor, i - anchor, len, i - cand);
+      i += len;
+      anchor = i;
+    } else {
+      i++;
+    }
+  }
+  lz_put_sequence(dst, src + anchor, n - anchor, 0, 0);
+  return dst;
+}
+
+/**
+ * @param n number of decompressed bytes (stored by the caller)
+ **/
+inline bytes_t lz_decompress(const uint8_t *src, size_t src_size, size_t n) {
+  using namespace detail;
+  bytes_t dst;
+  dst.reserve(n);
+  const uint8_t *p = src, *end = src + src_size;
+
+  while (p < end) {
+    const uint8_t token = *p++;
+    size_t n_literals   = token >> 4;
+    if (n_literals == 15) n_literals += lz_get_length(p, end);
+    if (static_cast<size_t>(end - p) < n_literals ||
+        dst.size() + n_literals > n)
+      throw nn_error("corrupted compressed stream");
+    dst.insert(dst.end(), p, p + n_literals);
+    p += n_literals;
+    if (p == end) break;
+
+    if (end - p < 2) throw nn_error("corrupted compressed stream");
+    const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+    p += 2;
+    size_t len = (token & 0x0f);
+    if (len == 15) len += lz_get_length(p, end);
+    len += lz_min_match;
+    if (offset == 0 || offset > dst.size() || dst.size() + len > n)
+      throw nn_error("corrupted compressed stream");
+
+    // byte-wise copy: source and destination may overlap
+    size_t from = dst.size() - offset;
+    for (size_t k = 0; k < len; k++) dst.push_back(dst[from + k]);
+  }
+  if (dst.size() != n) throw nn_error("corrupted compressed stream");
+  return dst;
+}
+
+/**
+ * weights represented as indices into a small table of shared values
+ **/
+struct weight_codebook {
+  weight_codebook() : bits(0) {}
+
+  vec_t decode() const {
+    vec_t w(indices.size());
+    for (size_t i = 0; i < w.size(); i++) w[i] = codebook[indices[i]];
+    return w;
+  }
+
+  int bits;
+  std::vector<float_t> codebook;  ///< sorted ascending
+  std::vector<uint8_t> indices;
+};
+
+/**
+ * 1-D k-means clustering of w into 2^bits shared values.
+ * centroids start at the quantiles of w, so dense regions of the weight
+ * distribution get more levels than with uniform quantization.
+ **/
+inline weight_codebook cluster_weights(const vec_t &w,
+                                       int bits,
+                                       int iterations = 12) {
+  if (bits < 1 || bits > 8) throw nn_error("codebook bits must be in [1, 8]");
+
+  weight_codebook cb;
+  cb.bits = bits;
+  cb.indices.resize(w.size());
+  if (w.empty()) return cb;
+
+  std::vector<float_t> sorted(w.begin(), w.end());
+  std::sort(sorted.begin(), sorted.end());
+  const size_t k = std::min(size_t(1) << bits, sorted.size());
+  cb.codebook.resize(k);
+  for (size_t c = 0; c < k; c++) {
+    cb.codebook[c] = sorted[(2 * c + 1) * sorted.size() / (2 * k)];
+  }
+
+  std::vector<float_t> bounds(k > 0 ? k - 1 : 0);
+  std::vector<double> sum(k);
+  std::vector<size_t> count(k);
+
+  auto assign = [&](float_t v) {
+    return static_cast<uint8_t>(
+      std::upper_bound(bounds.begin(), bounds.end(), v) - bounds.begin());
+  };
+
+  for (int it = 0; it < iterations; it++) {
+    for (size_t c = 0; c + 1 < k; c++) {
+      bounds[c] = (cb.codebook[c] + cb.codebook[c + 1]) / float_t(2);
+    }
+    std::fill(sum.begin(), sum.end(), 0.0);
+    std::fill(count.begin(), count.end(), size_t(0));
+
+    // sorted input: each cluster is a contiguous range
+    for (auto v : sorted) {
+      const uint8_t c = assign(v);
+      sum[c] += v;
+      count[c]++;
+    }
+    bool moved = false;
+    for (size_t c = 0; c < k; c++) {
+      if (count[c] == 0) continue;
+      const float_t m = static_cast<float_t>(sum[c] / count[c]);
+      moved           = moved || m != cb.codebook[c];
+      cb.codebook[c]  = m;
+    }
+    std::sort(cb.codebook.begin(), cb.codebook.end());
+    if (!moved) break;
+  }
+
+  for (size_t c = 0; c + 1 < k; c++) {
+    bounds[c] = (cb.codebook[c] + cb.codebook[c + 1]) / float_t(2);
+  }
+  for (size_t i = 0; i < w.size(); i++) cb.indices[i] = assign(w[i]);
+  return cb;
+}
+
+/**
+ * pack n indices of the given bit width (LSB first)
+ **/
+inline bytes_t pack_bits(const std::vector<uint8_t> &idx, int bits) {
+  bytes_t dst((idx.size() * bits + 7) / 8);
+  size_t pos = 0;
+  for (auto v : idx) {
+    for (int b = 0; b < bits; b++, pos++) {
+      if (v & (1 << b)) dst[pos / 8] |= static_cast<uint8_t>(1 << (pos % 8));
+    }
+  }
+  return dst;
+}
+
+inline std::vector<uint8_t> unpack_bits(const uint8_t *src,
+                                        size_t n,
+                                        int bits) {
+  std::vector<uint8_t> idx(n);
+  size_t pos = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t v = 0;
+    for (int b = 0; b < bits; b++, pos++) {
+      if (src[pos / 8] & (1 << (pos % 8))) v |= static_cast<uint8_t>(1 << b);
+    }
+    idx[i] = v;
+  }
+  return idx;
+}
+
+namespace detail {
+
+template <typename T>
+void put(bytes_t &dst, T v) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+  dst.insert(dst.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t *&p, const uint8_t *end) {
+  if (static_cast<size_t>(end - p) < sizeof(T))
+    throw nn_error("corrupted compressed model");
+  T v;
+  std::memcpy(&v, p, sizeof(T));
+  p += sizeof(T);
+  return v;
+}
+
+inline void encode_weight(bytes_t &dst,
+                          const vec_t &w,
+                          const compression_params &params) {
+  const bool lossy = params.bits > 0 && w.size() >= params.min_size;
+  put<uint8_t>(dst, static_cast<uint8_t>(lossy ? params.bits : 0));
+  put<uint64_t>(dst, w.size());
+
+  if (!lossy) {
+    bytes_t s = byte_shuffle(w.data(), w.size(), sizeof(float_t));
+    dst.insert(dst.end(), s.begin(), s.end());
+    return;
+  }
+  weight_codebook cb =
+    cluster_weights(w, params.bits, params.kmeans_iterations);
+  put<uint16_t>(dst, static_cast<uint16_t>(cb.codebook.size()));
+  for (auto c : cb.codebook) put<float_t>(dst, c);
+  bytes_t packed = pack_bits(cb.indices, cb.bits);
+  dst.insert(dst.end(), packed.begin(), packed.end());
+}
+
+/**
+ * @param clustered [out] if not null, receives the codebook and indices of
+ *                        a clustered vector (bits == 0 if it is lossless)
+ **/
+inline vec_t decode_weight(const uint8_t *&p,
+                           const uint8_t *end,
+                           weight_codebook *clustered = nullptr) {
+  const int bits  = get<uint8_t>(p, end);
+  const size_t n  = static_cast<size_t>(get<uint64_t>(p, end));
+  const size_t sz = bits ? (n * bits + 7) / 8 : n * sizeof(float_t);
+
+  if (bits == 0) {
+    if (static_cast<size_t>(end - p) < sz)
+      throw nn_error("corrupted compressed model");
+    vec_t w(n);
+    byte_unshuffle(p, n, sizeof(float_t), w.data());
+    p += sz;
+    return w;
+  }
+
+  weight_codebook cb;
+  cb.bits = bits;
+  cb.codebook.resize(get<uint16_t>(p, end));
+  if (cb.codebook.size() > (size_t(1) << bits))
+    throw nn_error("corrupted compressed model");
+  for (auto &c : cb.codebook) c = get<float_t>(p, end);
+  if (static_cast<size_t>(end - p) < sz)
+    throw nn_error("corrupted compressed model");
+  cb.indices = unpack_bits(p, n, bits);
+  p += sz;
+  for (auto i : cb.indices) {
+    if (i >= cb.codebook.size()) throw nn_error("corrupted compressed model");
+  }
+  vec_t w = cb.decode();
+  if (clustered) *clustered = std::move(cb);
+  return w;
+}
+
+static const char model_magic[8] = {'T', 'D', 'N', 'N', 'C', 'M', 0, 1};
+
+}  // namespace detail
+}  // namespace compression
+
+/**
+ * write the network in the compact format: architecture (cereal binary)
+ * followed by per-vector k-means clustered weights, LZ compressed.
+ * lossless weights are byte-shuffled before compression.
+ **/
+template <typename NetType>
+void save_compressed(const network<NetType> &net,
+                     std::ostream &os,
+                     const compression_params &params = compression_params()) {
+  namespace cd = compression::detail;
+
+  std::ostringstream model;
+  {
+    cereal::BinaryOutputArchive bo(model);
+    net.to_archive(bo, content_type::model);
+  }
+  const std::string m = model.str();
+
+  compression::bytes_t payload;
+  for (const auto *l : net) {
+    for (const vec_t *w : l->weights()) cd::encode_weight(payload, *w, params);
+  }
+  const compression::bytes_t z =
+    compression::lz_compress(payload.data(), payload.size());
+
+  compression::bytes_t header;
+  header.insert(header.end(), cd::model_magic, cd::model_magic + 8);
+  cd::put<uint8_t>(header, sizeof(float_t));
+  cd::put<uint64_t>(header, m.size());
+  cd::put<uint64_t>(header, payload.size());
+  cd::put<uint64_t>(header, z.size());
+
+  os.write(reinterpret_cast<const char *>(header.data()), header.size());
+  os.write(m.data(), m.size());
+  os.write(reinterpret_cast<const char *>(z.data()), z.size());
+  if (!os) throw nn_error("failed to write compressed model");
+}
+
+template <typename NetType>
+void save_compressed(const network<NetType> &net,
+                     const std::string &filename,
+                     const compression_params &params = compression_params()) {
+  std::ofstream ofs(filename.c_str(), std::ios::binary | std::ios::out);
+  if (ofs.fail() || ofs.bad()) throw nn_error("failed to open:" + filename);
+  save_compressed(net, ofs, params);
+}
+
+/**
+ * read a network written by save_compressed. fully-connected layers with
+ * clustered weights keep the indices and run on the codebook kernel in the
+ * test phase (see fully_connected_layer::set_codebook_weights); all other
+ * clustered weights are expanded back to float.
+ **/
+template <typename NetType>
+void load_compressed(network<NetType> &net, std::istream &is) {
+  namespace cd = compression::detail;
+
+  std::string buf((std::istreambuf_iterator<char>(is)),
+                  std::istreambuf_iterator<char>());
+  const uint8_t *p   = reinterpret_cast<const uint8_t *>(buf.data());
+  const uint8_t *end = p + buf.size();
+
+  if (buf.size() < 8 || std::memcmp(p, cd::model_magic, 8) != 0)
+    throw nn_error("not a compressed tiny-dnn model");
+  p += 8;
+  if (cd::get<uint8_t>(p, end) != sizeof(float_t))
+    throw nn_error("compressed model was saved with another float_t");
+  const size_t model_size   = cd::get<uint64_t>(p, end);
+  const size_t payload_size = cd::get<uint64_t>(p, end);
+  const size_t z_size       = cd::get<uint64_t>(p, end);
+  if (static_cast<size_t>(end - p) < model_size + z_size)
+    throw nn_error("corrupted compressed model");
+
+  {
+    std::istringstream model(
+      std::string(reinterpret_cast<const char *>(p), model_size));
+    cereal::BinaryInputArchive bi(model);
+    net.from_archive(bi, content_type::model);
+  }
+  p += model_size;
+
+  const compression::bytes_t payload =
+    compression::lz_decompress(p, z_size, payload_size);
+  const uint8_t *q = payload.data(), *qend = q + payload.size();
+
+  for (auto *l : net) {
+    std::vector<float_t> all;
+    compression::weight_codebook cb;
+    for (const vec_t *w : static_cast<const layer *>(l)->weights()) {
+      vec_t d = cd::decode_weight(q, qend, all.empty() ? &cb : nullptr);
+      if (d.size() != w->size())
+        throw nn_error("weight size mismatch in compressed model");
+      all.insert(all.end(), d.begin(), d.end());
+    }
+    int idx = 0;
+    l->load(all, idx);
+
+    auto *fc = dynamic_cast<fully_connected_layer *>(l);
+    if (fc && cb.bits > 0) fc->set_codebook_weights(cb.codebook, cb.indices);
+  }
+  if (q != qend) throw nn_error("corrupted compressed model");
+}
+
+template <typename NetType>
+void load_compressed(network<NetType> &net, const std::string &filename) {
+  std::ifstream ifs(filename.c_str(), std::ios::binary | std::ios::in);
+  if (ifs.fail() || ifs.bad()) throw nn_error("failed to open:" + filename);
+  load_compressed(net, ifs);
+}
+
+}  // namespace tiny_dnn
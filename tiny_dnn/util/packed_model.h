@@ -0,0 +1,431 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) || defined(WIN32)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tiny_dnn/layers/convolutional_layer.h"
+#include "tiny_dnn/layers/deconvolutional_layer.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/nn_error.h"
+#include "tiny_dnn/util/parallel_for.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+/**
+ * reads and writes the pre-packed model format: the architecture (cereal
+ * binary) followed by a table of weight blobs, each stored as raw float_t
+ * at a 64-byte aligned file offset. loading is a bulk copy per blob, done
+ * in parallel, straight out of a read-only mapping of the file.
+ *
+ * filters of grouped convolutions are stored compact: only the (out, in)
+ * channel pairs of the connection table are written, and the unconnected
+ * ones are zero-filled on load.
+ **/
+class packed_model_io {
+ public:
+  static const size_t alignment = 64;
+
+  enum packing : uint32_t {
+    dense   = 0,
+    grouped = 1  ///< connected filters of a convolution only
+  };
+
+  ///< one row of the blob table, 32 bytes on disk
+  struct blob_entry {
+    uint64_t offset;      ///< from the start of the file
+    uint64_t size;        ///< stored elements
+    uint64_t dense_size;  ///< elements of the layer's weight vector
+    uint32_t packing;
+    uint32_t taps;  ///< filter size of grouped blobs
+  };
+
+  template <typename NetType>
+  static void save(const network<NetType> &net, std::ostream &os) {
+    std::ostringstream model;
+    {
+      cereal::BinaryOutputArchive bo(model);
+      net.to_archive(bo, content_type::model);
+    }
+    const std::string m = model.str();
+
+    std::vector<const layer *> owners;
+    std::vector<const vec_t *> blobs;
+    for (const auto *l : net) {
+      for (const vec_t *w : l->weights()) {
+        owners.push_back(l);
+        blobs.push_back(w);
+      }
+    }
+
+    uint64_t pos = header_size + m.size() + blobs.size() * entry_size;
+    std::vector<blob_entry> table(blobs.size());
+    for (size_t i = 0; i < blobs.size(); i++) {
+      blob_entry &e = table[i];
+      const core::connection_table *tbl = connections(*owners[i], blobs[i]);
+
+      e.dense_size = blobs[i]->size();
+      e.packing    = tbl ? grouped : dense;
+      e.taps       = tbl ? filter_taps(*owners[i]) : 0;
+      e.size       = tbl ? tbl->connections(0, 0) * e.taps : e.dense_size;
+      e.offset     = align(pos);
+      pos          = e.offset + e.size * sizeof(float_t);
+    }
+
+    std::vector<uint8_t> header;
+    header.insert(header.end(), magic(), magic() + 8);
+    put<uint32_t>(header, sizeof(float_t));
+    put<uint32_t>(header, alignment);
+    put<uint64_t>(header, m.size());
+    put<uint64_t>(header, blobs.size());
+    os.write(reinterpret_cast<const char *>(header.data()), header.size());
+    os.write(m.data(), m.size());
+
+    std::vector<uint8_t> rows;
+    for (const auto &e : table) {
+      put<uint64_t>(rows, e.offset);
+      put<uint64_t>(rows, e.size);
+      put<uint64_t>(rows, e.dense_size);
+      put<uint32_t>(rows, e.packing);
+      put<uint32_t>(rows, e.taps);
+    }
+    os.write(reinterpret_cast<const char *>(rows.data()), rows.size());
+
+    pos = header_size + m.size() + rows.size();
+    for (size_t i = 0; i < blobs.size(); i++) {
+      const blob_entry &e = table[i];
+      const std::vector<char> pad(static_cast<size_t>(e.offset - pos), 0);
+      os.write(pad.data(), pad.size());
+
+      if (e.packing == dense) {
+        write_floats(os, blobs[i]->data(), blobs[i]->size());
+      } else {
+        const vec_t c = compact(*owners[i], *blobs[i], e);
+        write_floats(os, c.data(), c.size());
+      }
+      pos = e.offset + e.size * sizeof(float_t);
+    }
+    if (!os) throw nn_error("failed to write packed model");
+  }
+
+  /**
+   * rebuild the network from a packed model held in memory, e.g. a mapped
+   * file or a blob linked into the binary
+   **/
+  template <typename NetType>
+  static void load(network<NetType> &net, const uint8_t *data, size_t size) {
+    const uint8_t *p = data, *end = data + size;
+
+    if (size < header_size || std::memcmp(p, magic(), 8) != 0)
+      throw nn_error("not a packed tiny-dnn model");
+    p += 8;
+    if (get<uint32_t>(p, end) != sizeof(float_t))
+      throw nn_error("packed model was saved with another float_t");
+    get<uint32_t>(p, end);
+    const size_t model_size = static_cast<size_t>(get<uint64_t>(p, end));
+    const size_t num_blobs  = static_cast<size_t>(get<uint64_t>(p, end));
+    if (static_cast<size_t>(end - p) < model_size)
+      throw nn_error("corrupted packed model");
+
+    {
+      std::istringstream model(
+        std::string(reinterpret_cast<const char *>(p), model_size));
+      cereal::BinaryInputArchive bi(model);
+      net.from_archive(bi, content_type::model);
+    }
+    p += model_size;
+
+    std::vector<layer *> owners;
+    std::vector<vec_t *> blobs;
+    for (auto *l : net) {
+      for (vec_t *w : l->weights()) {
+        owners.push_back(l);
+        blobs.push_back(w);
+      }
+    }
+    if (blobs.size() != num_blobs)
+      throw nn_error("weight count mismatch in packed model");
+
+    std::vector<blob_entry> table(num_blobs);
+    for (size_t i = 0; i < num_blobs; i++) {
+      blob_entry &e = table[i];
+      e.offset      = get<uint64_t>(p, end);
+      e.size        = get<uint64_t>(p, end);
+      e.dense_size  = get<uint64_t>(p, end);
+      e.packing     = get<uint32_t>(p, end);
+      e.taps        = get<uint32_t>(p, end);
+      check(e, *owners[i], *blobs[i], size);
+    }
+
+    for_i(true, num_blobs,
+          [&](size_t i) {
+            const blob_entry &e = table[i];
+            const uint8_t *src  = data + e.offset;
+            if (e.packing == dense) {
+              std::memcpy(blobs[i]->data(), src, e.size * sizeof(float_t));
+            } else {
+              expand(*owners[i], src, e, *blobs[i]);
+            }
+          },
+          1);
+
+    for (auto *l : owners) l->initialized_ = true;
+  }
+
+ private:
+  static const size_t header_size = 32;
+  static const size_t entry_size  = 32;
+
+  static const char *magic() { return "TDNNPK\0\1"; }
+
+  static uint64_t align(uint64_t pos) {
+    return (pos + alignment - 1) / alignment * alignment;
+  }
+
+  template <typename T>
+  static void put(std::vector<uint8_t> &dst, T v) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    dst.insert(dst.end(), p, p + sizeof(T));
+  }
+
+  template <typename T>
+  static T get(const uint8_t *&p, const uint8_t *end) {
+    if (static_cast<size_t>(end - p) < sizeof(T))
+      throw nn_error("corrupted packed model");
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+  }
+
+  static void write_floats(std::ostream &os, const float_t *p, size_t n) {
+    os.write(reinterpret_cast<const char *>(p), n * sizeof(float_t));
+  }
+
+  template <typename Params>
+  static const core::connection_table *grouped_table(const Params &params) {
+    return params.tbl.is_empty() ? nullptr : &params.tbl;
+  }
+
+  /**
+   * connection table of the filters in w, or nullptr if w is stored dense
+   **/
+  static const core::connection_table *connections(const layer &l,
+                                                   const vec_t *w) {
+    if (w != l.weights()[0]) return nullptr;
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l))
+      return grouped_table(c->params_);
+    if (auto d = dynamic_cast<const deconvolutional_layer *>(&l))
+      return grouped_table(d->params_);
+    return nullptr;
+  }
+
+  static serial_size_t filter_taps(const layer &l) {
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l))
+      return c->params_.weight.area();
+    return dynamic_cast<const deconvolutional_layer &>(l).params_.weight.area();
+  }
+
+  static serial_size_t in_depth(const layer &l) {
+    return l.in_shape()[0].depth_;
+  }
+
+  static serial_size_t out_depth(const layer &l) {
+    return l.out_shape()[0].depth_;
+  }
+
+  // the filters of output channel o follow those of channels 0..o-1, so the
+  // first filter of each output channel is known before copying
+  static std::vector<size_t> filter_offsets(const layer &l,
+                                            const core::connection_table &tbl,
+                                            size_t taps) {
+    std::vector<size_t> offsets(out_depth(l) + 1, 0);
+    for (serial_size_t o = 0; o < out_depth(l); o++) {
+      size_t n = 0;
+      for (serial_size_t i = 0; i < in_depth(l); i++) {
+        if (tbl.is_connected(o, i)) n++;
+      }
+      offsets[o + 1] = offsets[o] + n * taps;
+    }
+    return offsets;
+  }
+
+  static vec_t compact(const layer &l, const vec_t &w, const blob_entry &e) {
+    const core::connection_table &tbl = *connections(l, &w);
+    const serial_size_t id            = in_depth(l);
+    const std::vector<size_t> offsets = filter_offsets(l, tbl, e.taps);
+
+    vec_t c(static_cast<size_t>(e.size));
+    for_i(l.parallelize(), out_depth(l), [&](size_t o) {
+      float_t *dst = &c[offsets[o]];
+      for (serial_size_t i = 0; i < id; i++) {
+        if (!tbl.is_connected(o, i)) continue;
+        const float_t *src = &w[(o * id + i) * e.taps];
+        dst                = std::copy(src, src + e.taps, dst);
+      }
+    });
+    return c;
+  }
+
+  static void expand(const layer &l,
+                     const uint8_t *src,
+                     const blob_entry &e,
+                     vec_t &w) {
+    const core::connection_table &tbl = *connections(l, &w);
+    const serial_size_t id            = in_depth(l);
+    const std::vector<size_t> offsets = filter_offsets(l, tbl, e.taps);
+    const size_t bytes                = e.taps * sizeof(float_t);
+
+    for (serial_size_t o = 0; o < out_depth(l); o++) {
+      const uint8_t *s = src + offsets[o] * sizeof(float_t);
+      for (serial_size_t i = 0; i < id; i++) {
+        float_t *dst = &w[(o * id + i) * e.taps];
+        if (tbl.is_connected(o, i)) {
+          std::memcpy(dst, s, bytes);
+          s += bytes;
+        } else {
+          std::fill_n(dst, e.taps, float_t(0));
+        }
+      }
+    }
+  }
+
+  static void check(const blob_entry &e,
+                    const layer &l,
+                    const vec_t &w,
+                    size_t file_size) {
+    if (e.dense_size != w.size() || e.offset % alignment != 0 ||
+        e.offset > file_size ||
+        e.size > (file_size - e.offset) / sizeof(float_t))
+      throw nn_error("corrupted packed model");
+
+    const core::connection_table *tbl = connections(l, &w);
+    if (e.packing == dense) {
+      if (tbl || e.size != w.size()) throw nn_error("corrupted packed model");
+    } else if (e.packing == grouped) {
+      if (!tbl || e.taps != filter_taps(l) ||
+          e.size != uint64_t(tbl->connections(0, 0)) * e.taps)
+        throw nn_error("corrupted packed model");
+    } else {
+      throw nn_error("unknown weight packing in packed model");
+    }
+  }
+};
+
+/**
+ * read-only view of a whole file. mapped on POSIX systems, so pages are
+ * shared between processes serving the same model and only touched once
+ * while loading; read into memory elsewhere.
+ **/
+class mapped_file {
+ public:
+  explicit mapped_file(const std::string &filename)
+    : data_(nullptr), size_(0) {
+#if defined(_MSC_VER) || defined(WIN32)
+    std::ifstream ifs(filename.c_str(), std::ios::binary | std::ios::in);
+    if (ifs.fail() || ifs.bad()) throw nn_error("failed to open:" + filename);
+    buf_.assign(std::istreambuf_iterator<char>(ifs),
+                std::istreambuf_iterator<char>());
+    data_ = reinterpret_cast<const uint8_t *>(buf_.data());
+    size_ = buf_.size();
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) throw nn_error("failed to open:" + filename);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw nn_error("failed to stat:" + filename);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+      void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        close(fd);
+        throw nn_error("failed to map:" + filename);
+      }
+      data_ = static_cast<const uint8_t *>(p);
+    }
+    close(fd);
+#endif
+  }
+
+  ~mapped_file() {
+#if !defined(_MSC_VER) && !defined(WIN32)
+    if (data_) munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+#if defined(_MSC_VER) || defined(WIN32)
+  std::string buf_;
+#endif
+};
+
+/**
+ * write the network in the pre-packed format. meant to be done once per
+ * imported model (see examples/caffe_converter), so that serving processes
+ * only pay for load_packed.
+ **/
+template <typename NetType>
+void save_packed(const network<NetType> &net, std::ostream &os) {
+  packed_model_io::save(net, os);
+}
+
+template <typename NetType>
+void save_packed(const network<NetType> &net, const std::string &filename) {
+  std::ofstream ofs(filename.c_str(), std::ios::binary | std::ios::out);
+  if (ofs.fail() || ofs.bad()) throw nn_error("failed to open:" + filename);
+  save_packed(net, ofs);
+}
+
+/**
+ * rebuild a network written by save_packed
+ **/
+template <typename NetType>
+void load_packed(network<NetType> &net, const uint8_t *data, size_t size) {
+  packed_model_io::load(net, data, size);
+}
+
+template <typename NetType>
+void load_packed(network<NetType> &net, std::istream &is) {
+  const std::string buf((std::istreambuf_iterator<char>(is)),
+                        std::istreambuf_iterator<char>());
+  load_packed(net, reinterpret_cast<const uint8_t *>(buf.data()), buf.size());
+}
+
+template <typename NetType>
+void load_packed(network<NetType> &net, const std::string &filename) {
+  mapped_file f(filename);
+  load_packed(net, f.data(), f.size());
+}
+
+}  // namespace tiny_dnn
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "aligned_allocator.h"
+#include "execution_context.h"
 #include "nn_error.h"
 #include "tiny_dnn/config.h"
 
@@ -87,7 +88,8 @@ void parallel_for(size_t begin,
                   const Func &f,
                   size_t /*grainsize*/) {
   assert(end >= begin);
-#pragma omp parallel for
+  const int nthreads = static_cast<int>(worker_lease::max_threads());
+#pragma omp parallel for num_threads(nthreads)
   for (size_t i = begin; i < end; ++i) f(blocked_range(i, i + 1));
 }
 
@@ -135,28 +137,33 @@ void parallel_for(size_t begin,
                   const Func &f,
                   size_t /*grainsize*/) {
   assert(end >= begin);
-  size_t nthreads  = std::thread::hardware_concurrency();
+  // the calling thread runs the first block, borrowed workers the others,
+  // bound to the calling thread's context
+  execution_context *ctx = execution_context::current();
+  worker_lease workers(end - begin > 0 ? end - begin - 1 : 0);
+  size_t nthreads  = workers.size() + 1;
   size_t blockSize = (end - begin) / nthreads;
   if (blockSize * nthreads < end - begin) blockSize++;
 
   std::vector<std::future<void> > futures;
 
-  size_t blockBegin            = begin;
+  size_t blockBegin            = begin + blockSize;
   size_t blockEnd              = blockBegin + blockSize;
   if (blockEnd > end) blockEnd = end;
 
-  for (size_t i = 0; i < nthreads; i++) {
+  for (size_t i = 1; i < nthreads && blockBegin < end; i++) {
     futures.push_back(
-      std::move(std::async(std::launch::async, [blockBegin, blockEnd, &f] {
+      std::move(std::async(std::launch::async, [blockBegin, blockEnd, ctx, &f] {
+        execution_scope scope(ctx);
         f(blocked_range(blockBegin, blockEnd));
       })));
 
     blockBegin += blockSize;
     blockEnd = blockBegin + blockSize;
-    if (blockBegin >= end) break;
     if (blockEnd > end) blockEnd = end;
   }
 
+  f(blocked_range(begin, std::min(begin + blockSize, end)));
   for (auto &future : futures) future.wait();
 }
 
@@ -0,0 +1,177 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__) && !defined(CNN_NO_PERF_EVENTS)
+#define CNN_HAS_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tiny_dnn {
+
+/**
+ * hardware events sampled by perf_counters
+ **/
+enum class hw_counter : int {
+  cycles = 0,
+  instructions,
+  l1d_read_misses,
+  llc_misses,
+  branch_misses
+};
+
+static const int hw_counter_count = 5;
+
+inline const char *to_string(hw_counter c) {
+  switch (c) {
+    case hw_counter::cycles: return "cycles";
+    case hw_counter::instructions: return "instructions";
+    case hw_counter::l1d_read_misses: return "l1d_read_misses";
+    case hw_counter::llc_misses: return "llc_misses";
+    case hw_counter::branch_misses: return "branch_misses";
+    default: return "unknown";
+  }
+}
+
+/**
+ * snapshot (or difference of two snapshots) of the hardware counters.
+ * counters which could not be opened stay zero and have valid[i] == false.
+ **/
+struct hw_counter_values {
+  hw_counter_values() {
+    std::memset(value, 0, sizeof(value));
+    std::memset(valid, 0, sizeof(valid));
+  }
+
+  uint64_t operator[](hw_counter c) const { return value[static_cast<int>(c)]; }
+
+  hw_counter_values &operator+=(const hw_counter_values &rhs) {
+    for (int i = 0; i < hw_counter_count; i++) {
+      value[i] += rhs.value[i];
+      valid[i] = valid[i] || rhs.valid[i];
+    }
+    return *this;
+  }
+
+  uint64_t value[hw_counter_count];
+  bool valid[hw_counter_count];
+};
+
+inline hw_counter_values operator-(const hw_counter_values &end,
+                                   const hw_counter_values &begin) {
+  hw_counter_values d;
+  for (int i = 0; i < hw_counter_count; i++) {
+    d.valid[i] = end.valid[i] && begin.valid[i];
+    d.value[i] = d.valid[i] && end.value[i] >= begin.value[i]
+                   ? end.value[i] - begin.value[i]
+                   : 0;
+  }
+  return d;
+}
+
+/**
+ * thin wrapper of linux perf_event_open(2)
+ *
+ * Counters are user-space only and follow the calling thread and every
+ * thread it spawns after construction (e.g. the std::async workers of
+ * parallel_for). Threads of a pool created earlier (TBB, OpenMP) are not
+ * counted.
+ *
+ * Opening a counter fails when the kernel or the container does not expose
+ * the PMU (EACCES, ENOENT, ENOSYS...). This is not an error: the counter is
+ * just reported as unavailable. On non-linux platforms, or if
+ * CNN_NO_PERF_EVENTS is defined, no counter is available.
+ **/
+class perf_counters {
+ public:
+  perf_counters() {
+    for (int i = 0; i < hw_counter_count; i++) fd_[i] = -1;
+#ifdef CNN_HAS_PERF_EVENTS
+    open(hw_counter::cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    open(hw_counter::instructions, PERF_TYPE_HARDWARE,
+         PERF_COUNT_HW_INSTRUCTIONS);
+    open(hw_counter::l1d_read_misses, PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    open(hw_counter::llc_misses, PERF_TYPE_HARDWARE,
+         PERF_COUNT_HW_CACHE_MISSES);
+    open(hw_counter::branch_misses, PERF_TYPE_HARDWARE,
+         PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+  }
+
+  ~perf_counters() {
+#ifdef CNN_HAS_PERF_EVENTS
+    for (int i = 0; i < hw_counter_count; i++) {
+      if (fd_[i] >= 0) close(fd_[i]);
+    }
+#endif
+  }
+
+  perf_counters(const perf_counters &) = delete;
+  perf_counters &operator=(const perf_counters &) = delete;
+
+  /**
+   * true if at least one counter could be opened
+   **/
+  bool available() const {
+    for (int i = 0; i < hw_counter_count; i++) {
+      if (fd_[i] >= 0) return true;
+    }
+    return false;
+  }
+
+  bool available(hw_counter c) const { return fd_[static_cast<int>(c)] >= 0; }
+
+  /**
+   * current (monotonically increasing) counter values
+   **/
+  hw_counter_values read() const {
+    hw_counter_values v;
+#ifdef CNN_HAS_PERF_EVENTS
+    for (int i = 0; i < hw_counter_count; i++) {
+      if (fd_[i] < 0) continue;
+      uint64_t count = 0;
+      if (::read(fd_[i], &count, sizeof(count)) == sizeof(count)) {
+        v.value[i] = count;
+        v.valid[i] = true;
+      }
+    }
+#endif
+    return v;
+  }
+
+ private:
+#ifdef CNN_HAS_PERF_EVENTS
+  void open(hw_counter c, uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 0;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    // pid = 0, cpu = -1: this thread (and its children) on any cpu
+    const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    fd_[static_cast<int>(c)] = fd < 0 ? -1 : static_cast<int>(fd);
+  }
+#endif
+
+  int fd_[hw_counter_count];
+};
+
+}  // namespace tiny_dnn
@@ -35,6 +35,43 @@ struct scalar_generic {
   static register_type add(const register_type &v1, const register_type &v2) {
     return v1 + v2;
   }
+  static register_type sub(const register_type &v1, const register_type &v2) {
+    return v1 - v2;
+  }
+  static register_type div(const register_type &v1, const register_type &v2) {
+    return v1 / v2;
+  }
+  static register_type maximum(const register_type &v1,
+                               const register_type &v2) {
+    return v1 < v2 ? v2 : v1;
+  }
+  static register_type minimum(const register_type &v1,
+                               const register_type &v2) {
+    return v2 < v1 ? v2 : v1;
+  }
+  // comparisons return a mask: all bits set where true in the SIMD traits,
+  // 1 here. mask_and and blend take such a mask
+  static register_type greater(const register_type &v1,
+                               const register_type &v2) {
+    return register_type(v1 > v2);
+  }
+  static register_type less(const register_type &v1, const register_type &v2) {
+    return register_type(v1 < v2);
+  }
+  static register_type not_zero(const register_type &v) {
+    return register_type(v != register_type(0));
+  }
+  // v where mask is set, 0 elsewhere
+  static register_type mask_and(const register_type &mask,
+                                const register_type &v) {
+    return mask != register_type(0) ? v : register_type(0);
+  }
+  // v1 where mask is set, v2 elsewhere
+  static register_type blend(const register_type &mask,
+                             const register_type &v1,
+                             const register_type &v2) {
+    return mask != register_type(0) ? v1 : v2;
+  }
   static register_type madd(const register_type &v1,
                             const register_type &v2,
                             const register_type &v3) {
@@ -69,6 +106,39 @@ struct float_sse {
   static register_type add(const register_type &v1, const register_type &v2) {
     return _mm_add_ps(v1, v2);
   }
+  static register_type sub(const register_type &v1, const register_type &v2) {
+    return _mm_sub_ps(v1, v2);
+  }
+  static register_type div(const register_type &v1, const register_type &v2) {
+    return _mm_div_ps(v1, v2);
+  }
+  static register_type maximum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_max_ps(v1, v2);
+  }
+  static register_type minimum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_min_ps(v1, v2);
+  }
+  static register_type greater(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_cmpgt_ps(v1, v2);
+  }
+  static register_type less(const register_type &v1, const register_type &v2) {
+    return _mm_cmplt_ps(v1, v2);
+  }
+  static register_type not_zero(const register_type &v) {
+    return _mm_cmpneq_ps(v, zero());
+  }
+  static register_type mask_and(const register_type &mask,
+                                const register_type &v) {
+    return _mm_and_ps(mask, v);
+  }
+  static register_type blend(const register_type &mask,
+                             const register_type &v1,
+                             const register_type &v2) {
+    return _mm_or_ps(_mm_and_ps(mask, v1), _mm_andnot_ps(mask, v2));
+  }
   static register_type madd(const register_type &v1,
                             const register_type &v2,
                             const register_type &v3) {
@@ -121,6 +191,39 @@ struct double_sse {
   static register_type add(const register_type &v1, const register_type &v2) {
     return _mm_add_pd(v1, v2);
   }
+  static register_type sub(const register_type &v1, const register_type &v2) {
+    return _mm_sub_pd(v1, v2);
+  }
+  static register_type div(const register_type &v1, const register_type &v2) {
+    return _mm_div_pd(v1, v2);
+  }
+  static register_type maximum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_max_pd(v1, v2);
+  }
+  static register_type minimum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_min_pd(v1, v2);
+  }
+  static register_type greater(const register_type &v1,
+                               const register_type &v2) {
+    return _mm_cmpgt_pd(v1, v2);
+  }
+  static register_type less(const register_type &v1, const register_type &v2) {
+    return _mm_cmplt_pd(v1, v2);
+  }
+  static register_type not_zero(const register_type &v) {
+    return _mm_cmpneq_pd(v, zero());
+  }
+  static register_type mask_and(const register_type &mask,
+                                const register_type &v) {
+    return _mm_and_pd(mask, v);
+  }
+  static register_type blend(const register_type &mask,
+                             const register_type &v1,
+                             const register_type &v2) {
+    return _mm_or_pd(_mm_and_pd(mask, v1), _mm_andnot_pd(mask, v2));
+  }
   static register_type madd(const register_type &v1,
                             const register_type &v2,
                             const register_type &v3) {
@@ -178,6 +281,39 @@ struct float_avx {
   static register_type add(const register_type &v1, const register_type &v2) {
     return _mm256_add_ps(v1, v2);
   }
+  static register_type sub(const register_type &v1, const register_type &v2) {
+    return _mm256_sub_ps(v1, v2);
+  }
+  static register_type div(const register_type &v1, const register_type &v2) {
+    return _mm256_div_ps(v1, v2);
+  }
+  static register_type maximum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_max_ps(v1, v2);
+  }
+  static register_type minimum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_min_ps(v1, v2);
+  }
+  static register_type greater(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_cmp_ps(v1, v2, _CMP_GT_OQ);
+  }
+  static register_type less(const register_type &v1, const register_type &v2) {
+    return _mm256_cmp_ps(v1, v2, _CMP_LT_OQ);
+  }
+  static register_type not_zero(const register_type &v) {
+    return _mm256_cmp_ps(v, zero(), _CMP_NEQ_UQ);
+  }
+  static register_type mask_and(const register_type &mask,
+                                const register_type &v) {
+    return _mm256_and_ps(mask, v);
+  }
+  static register_type blend(const register_type &mask,
+                             const register_type &v1,
+                             const register_type &v2) {
+    return _mm256_blendv_ps(v2, v1, mask);
+  }
 #ifdef CNN_USE_AVX2
   static register_type madd(const register_type &v1,
                             const register_type &v2,
@@ -236,6 +372,39 @@ struct double_avx {
   static register_type add(const register_type &v1, const register_type &v2) {
     return _mm256_add_pd(v1, v2);
   }
+  static register_type sub(const register_type &v1, const register_type &v2) {
+    return _mm256_sub_pd(v1, v2);
+  }
+  static register_type div(const register_type &v1, const register_type &v2) {
+    return _mm256_div_pd(v1, v2);
+  }
+  static register_type maximum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_max_pd(v1, v2);
+  }
+  static register_type minimum(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_min_pd(v1, v2);
+  }
+  static register_type greater(const register_type &v1,
+                               const register_type &v2) {
+    return _mm256_cmp_pd(v1, v2, _CMP_GT_OQ);
+  }
+  static register_type less(const register_type &v1, const register_type &v2) {
+    return _mm256_cmp_pd(v1, v2, _CMP_LT_OQ);
+  }
+  static register_type not_zero(const register_type &v) {
+    return _mm256_cmp_pd(v, zero(), _CMP_NEQ_UQ);
+  }
+  static register_type mask_and(const register_type &mask,
+                                const register_type &v) {
+    return _mm256_and_pd(mask, v);
+  }
+  static register_type blend(const register_type &mask,
+                             const register_type &v1,
+                             const register_type &v2) {
+    return _mm256_blendv_pd(v2, v1, mask);
+  }
 #ifdef CNN_USE_AVX2
   static register_type madd(const register_type &v1,
                             const register_type &v2,
@@ -500,6 +669,39 @@ inline void reduce(const typename T::value_type *src,
   }
 }
 
+template <typename T, typename src_aligned>
+inline typename T::value_type sum(const typename T::value_type *src,
+                                  std::size_t size) {
+  typename T::register_type r0 = T::zero();
+  typename T::register_type r1 = T::zero();
+  typename T::register_type r2 = T::zero();
+  typename T::register_type r3 = T::zero();
+  auto sz                      = T::unroll_size;
+  auto sz4                     = T::unroll_size * 4;
+  auto n4                      = size / sz4;
+  auto n1                      = (size % sz4) / sz;
+  auto remain                  = size % sz;
+  for (size_t i = 0; i < n4; ++i) {
+    r0 = T::add(T::template load<src_aligned>(&src[i * sz4 + sz * 0]), r0);
+    r1 = T::add(T::template load<src_aligned>(&src[i * sz4 + sz * 1]), r1);
+    r2 = T::add(T::template load<src_aligned>(&src[i * sz4 + sz * 2]), r2);
+    r3 = T::add(T::template load<src_aligned>(&src[i * sz4 + sz * 3]), r3);
+  }
+  size_t idx = n4 * sz4;
+  for (size_t i = 0; i < n1; ++i) {
+    r0 = T::add(T::template load<src_aligned>(&src[idx + i * sz]), r0);
+  }
+  r0                           = T::add(r0, r1);
+  r2                           = T::add(r2, r3);
+  r0                           = T::add(r0, r2);
+  typename T::value_type total = T::resemble(r0);
+  idx += n1 * sz;
+  for (size_t i = 0; i < remain; ++i) {
+    total += src[idx + i];
+  }
+  return total;
+}
+
 template <typename T>
 void fill(T *dst, size_t size, T value) {
   std::fill(dst, dst + size, value);
@@ -527,6 +729,11 @@ void fill(T *dst, size_t size, T value) {
 
 }  // namespace detail
 
+// number of elements held by one register of the selected instruction set
+inline constexpr std::size_t simd_width() {
+  return VECTORIZE_TYPE::unroll_size;
+}
+
 // dst[i] += c
 template <typename T>
 void add(T c, std::size_t size, T *dst) {
@@ -617,6 +824,16 @@ T dot(const T *s1, const T *s2, std::size_t size) {
   }
 }
 
+// sum(src[i])
+template <typename T>
+T sum(const T *src, std::size_t size) {
+  if (VECTORIZE_TYPE::is_aligned((VECTORIZE_TYPE::value_type *)src)) {
+    return detail::sum<VECTORIZE_TYPE, std::true_type>(src, size);
+  } else {
+    return detail::sum<VECTORIZE_TYPE, std::false_type>(src, size);
+  }
+}
+
 /// dst[i] += src[i]
 template <typename T>
 void reduce(const T *src, std::size_t size, T *dst) {
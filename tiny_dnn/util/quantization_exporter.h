@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "tiny_dnn/layers/convolutional_layer.h"
+#include "tiny_dnn/layers/fake_quantization_layer.h"
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/layers/quantized_convolutional_layer.h"
+#include "tiny_dnn/layers/quantized_fully_connected_layer.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/channel_pruning.h"
+
+namespace tiny_dnn {
+
+/**
+ * converts a network trained with fake_quantization_layer and weight
+ * quantization into one running the uint8 quantized_* kernels.
+ *
+ *     net << fake_quantization_layer(shape3d(32, 32, 3))
+ *         << convolutional_layer(32, 32, 5, 3, 6) << ...;
+ *     net[1]->set_weight_quantization(true);
+ *     net.fit<mse>(opt, x, y, 32, 10);
+ *     network<sequential> q = quantization_exporter::convert(net);
+ *
+ * Fake-quantization layers are dropped; the range each one learned becomes
+ * the fixed input range of the layer that follows it. Convolutions without
+ * a connection table become quantized_convolutional_layer. Fully-connected
+ * layers are converted only when the gemmlowp backend is available
+ * (CNN_USE_GEMMLOWP) and are kept in float otherwise. Every other layer is
+ * copied unchanged.
+ **/
+class quantization_exporter {
+ public:
+  static network<sequential> convert(const network<sequential> &net) {
+    network<sequential> dst;
+    const fake_quantization_layer *range = nullptr;
+
+    for (size_t i = 0; i < net.layer_size(); i++) {
+      const layer &l = *net[i];
+      if (auto f = dynamic_cast<const fake_quantization_layer *>(&l)) {
+        range = f;
+        continue;
+      }
+
+      std::shared_ptr<layer> q = quantize(l);
+      if (q && range && range->range_initialized()) {
+        set_input_range(q.get(), range->range_min(), range->range_max());
+      }
+      dst << (q ? q : clone_layer(l));
+      range = nullptr;
+    }
+    return dst;
+  }
+
+ private:
+  static std::shared_ptr<layer> quantize(const layer &l) {
+    std::shared_ptr<layer> q;
+
+    if (auto c = dynamic_cast<const convolutional_layer *>(&l)) {
+      const core::conv_params &p = c->params_;
+      if (!p.tbl.is_empty()) return nullptr;
+      q = std::make_shared<quantized_convolutional_layer>(
+        p.in.width_, p.in.height_, p.weight.width_, p.weight.height_,
+        p.in.depth_, p.out.depth_, p.pad_type, p.has_bias, p.w_stride,
+        p.h_stride);
+    }
+#ifdef CNN_USE_GEMMLOWP
+    if (auto f = dynamic_cast<const fully_connected_layer *>(&l)) {
+      const core::fully_params &p = f->params_;
+      q = std::make_shared<quantized_fully_connected_layer>(
+        p.in_size_, p.out_size_, p.has_bias_);
+    }
+#endif
+    if (!q) return nullptr;
+
+    std::vector<float_t> w;
+    for (auto v : l.weights()) w.insert(w.end(), v->begin(), v->end());
+    int idx = 0;
+    q->load(w, idx);
+    return q;
+  }
+
+  static void set_input_range(layer *q, float_t min_v, float_t max_v) {
+    if (auto c = dynamic_cast<quantized_convolutional_layer *>(q)) {
+      c->set_input_range(min_v, max_v);
+    } else if (auto f = dynamic_cast<quantized_fully_connected_layer *>(q)) {
+      f->set_input_range(min_v, max_v);
+    }
+  }
+};
+
+}  // namespace tiny_dnn
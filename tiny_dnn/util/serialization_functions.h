@@ -85,6 +85,47 @@ struct LoadAndConstruct<tiny_dnn::batch_normalization_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::binary_convolutional_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::binary_convolutional_layer> &construct) {
+    tiny_dnn::serial_size_t w_width, w_height, out_ch, w_stride, h_stride;
+    bool has_bias;
+    tiny_dnn::shape3d in;
+    tiny_dnn::padding pad_type;
+
+    ar(cereal::make_nvp("in_size", in),
+       cereal::make_nvp("window_width", w_width),
+       cereal::make_nvp("window_height", w_height),
+       cereal::make_nvp("out_channels", out_ch),
+       cereal::make_nvp("pad_type", pad_type),
+       cereal::make_nvp("has_bias", has_bias),
+       cereal::make_nvp("w_stride", w_stride),
+       cereal::make_nvp("h_stride", h_stride));
+
+    construct(in.width_, in.height_, w_width, w_height, in.depth_, out_ch,
+              pad_type, has_bias, w_stride, h_stride);
+  }
+};
+
+template <>
+struct LoadAndConstruct<tiny_dnn::binary_fully_connected_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::binary_fully_connected_layer> &construct) {
+    tiny_dnn::serial_size_t in_dim, out_dim;
+    bool has_bias;
+
+    ar(cereal::make_nvp("in_size", in_dim),
+       cereal::make_nvp("out_size", out_dim),
+       cereal::make_nvp("has_bias", has_bias));
+    construct(in_dim, out_dim, has_bias);
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::concat_layer> {
   template <class Archive>
@@ -166,6 +207,24 @@ struct LoadAndConstruct<tiny_dnn::dropout_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::fake_quantization_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::fake_quantization_layer> &construct) {
+    tiny_dnn::shape3d in_shape;
+    tiny_dnn::fake_quantization_mode mode;
+    tiny_dnn::float_t momentum;
+    tiny_dnn::net_phase phase;
+
+    ar(cereal::make_nvp("in_shape", in_shape), cereal::make_nvp("mode", mode),
+       cereal::make_nvp("momentum", momentum),
+       cereal::make_nvp("phase", phase));
+    construct(in_shape, mode, momentum, phase);
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::fully_connected_layer> {
   template <class Archive>
@@ -182,6 +241,23 @@ struct LoadAndConstruct<tiny_dnn::fully_connected_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::global_average_pooling_fc_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::global_average_pooling_fc_layer> &construct) {
+    tiny_dnn::shape3d in_shape;
+    tiny_dnn::serial_size_t out_size;
+    bool has_bias;
+
+    ar(cereal::make_nvp("in_shape", in_shape),
+       cereal::make_nvp("out_size", out_size),
+       cereal::make_nvp("has_bias", has_bias));
+    construct(in_shape, out_size, has_bias);
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::global_average_pooling_layer> {
   template <class Archive>
@@ -195,6 +271,39 @@ struct LoadAndConstruct<tiny_dnn::global_average_pooling_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::gru_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar, cereal::construct<tiny_dnn::gru_layer> &construct) {
+    tiny_dnn::serial_size_t in_size, hidden_size, seq_len, bptt_steps;
+    bool return_sequences;
+
+    ar(cereal::make_nvp("in_size", in_size),
+       cereal::make_nvp("hidden_size", hidden_size),
+       cereal::make_nvp("seq_len", seq_len),
+       cereal::make_nvp("return_sequences", return_sequences),
+       cereal::make_nvp("bptt_steps", bptt_steps));
+    construct(in_size, hidden_size, seq_len, return_sequences, bptt_steps);
+  }
+};
+
+template <>
+struct LoadAndConstruct<tiny_dnn::hierarchical_softmax_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::hierarchical_softmax_layer> &construct) {
+    tiny_dnn::serial_size_t in_size, n_classes;
+    std::vector<tiny_dnn::serial_size_t> cluster_ends;
+
+    ar(cereal::make_nvp("in_size", in_size),
+       cereal::make_nvp("n_classes", n_classes),
+       cereal::make_nvp("cluster_ends", cluster_ends));
+    construct(in_size, n_classes, cluster_ends);
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::input_layer> {
   template <class Archive>
@@ -239,6 +348,23 @@ struct LoadAndConstruct<tiny_dnn::lrn_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::lstm_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar, cereal::construct<tiny_dnn::lstm_layer> &construct) {
+    tiny_dnn::serial_size_t in_size, hidden_size, seq_len, bptt_steps;
+    bool return_sequences;
+
+    ar(cereal::make_nvp("in_size", in_size),
+       cereal::make_nvp("hidden_size", hidden_size),
+       cereal::make_nvp("seq_len", seq_len),
+       cereal::make_nvp("return_sequences", return_sequences),
+       cereal::make_nvp("bptt_steps", bptt_steps));
+    construct(in_size, hidden_size, seq_len, return_sequences, bptt_steps);
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::max_pooling_layer> {
   template <class Archive>
@@ -359,6 +485,30 @@ struct LoadAndConstruct<tiny_dnn::quantized_fully_connected_layer> {
   }
 };
 
+template <>
+struct LoadAndConstruct<tiny_dnn::sampled_softmax_layer> {
+  template <class Archive>
+  static void load_and_construct(
+    Archive &ar,
+    cereal::construct<tiny_dnn::sampled_softmax_layer> &construct) {
+    tiny_dnn::serial_size_t in_size, n_classes, n_candidates;
+    tiny_dnn::candidate_sampler sampler;
+    tiny_dnn::vec_t proposal;
+
+    ar(cereal::make_nvp("in_size", in_size),
+       cereal::make_nvp("n_classes", n_classes),
+       cereal::make_nvp("n_candidates", n_candidates),
+       cereal::make_nvp("sampler", sampler),
+       cereal::make_nvp("proposal", proposal));
+    if (sampler == tiny_dnn::candidate_sampler::custom) {
+      construct(in_size, n_classes, n_candidates);
+      construct->set_proposal(proposal);
+    } else {
+      construct(in_size, n_classes, n_candidates, sampler);
+    }
+  }
+};
+
 template <>
 struct LoadAndConstruct<tiny_dnn::slice_layer> {
   template <class Archive>
@@ -493,8 +643,132 @@ struct LoadAndConstruct<tiny_dnn::softsign_layer> {
 namespace tiny_dnn {
 
 struct serialization_buddy {
+  /**
+   * version of the layer records written by save_layer, stored in the
+   * record as "<type>@<version>". Records saved before versioning carry
+   * the plain "<type>" and load as version 0.
+   *
+   * 1: layer::weight_quantization, input range of the quantized layers
+   * 2: weight storage of the fully-connected and convolutional layers
+   * 3: packed weights of the binary layers
+   **/
+  static std::uint32_t layer_version() { return 3; }
+
+  ///< fields every layer record gained after version 0, after its type
+  template <class Archive>
+  static void serialize_common(Archive &ar,
+                               bool &weight_quantization,
+                               std::uint32_t version) {
+    if (version >= 1) {
+      ar(cereal::make_nvp("weight_quantization", weight_quantization));
+    }
+  }
+
+  ///< fields a layer record gained after version 0, at its end
+  template <class Archive>
+  static void serialize_extension(Archive &, layer &, std::uint32_t) {}
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  quantized_convolutional_layer &layer,
+                                  std::uint32_t version) {
+    serialize_input_range(ar, layer.params_, version);
+  }
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  quantized_fully_connected_layer &layer,
+                                  std::uint32_t version) {
+    serialize_input_range(ar, layer.params_, version);
+  }
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  fully_connected_layer &layer,
+                                  std::uint32_t version) {
+    if (version < 2) return;
+    serialize_storage(ar, layer);
+    if (layer.storage_ == weight_storage::codebook) {
+      ar(cereal::make_nvp("codebook_weights", layer.codebook_W_));
+    }
+  }
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  convolutional_layer &layer,
+                                  std::uint32_t version) {
+    if (version >= 2) serialize_storage(ar, layer);
+  }
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  binary_convolutional_layer &layer,
+                                  std::uint32_t version) {
+    if (version >= 3) serialize_packed(ar, layer);
+  }
+
+  template <class Archive>
+  static void serialize_extension(Archive &ar,
+                                  binary_fully_connected_layer &layer,
+                                  std::uint32_t version) {
+    if (version >= 3) serialize_packed(ar, layer);
+  }
+
+  ///< signs and scales of binary layers without real-valued weights
+  template <class Archive, class Layer>
+  static void serialize_packed(Archive &ar, Layer &layer) {
+    ar(cereal::make_nvp("packed_only", layer.packed_only_));
+    if (layer.packed_only_) {
+      ar(cereal::make_nvp("packed_weights", layer.packed_W_),
+         cereal::make_nvp("alpha", layer.alpha_));
+      layer.packed_dirty_ = false;
+    }
+  }
+
+  /**
+   * inference-time weight storage. Layers that released their dense
+   * weights store the sparse copy instead, the others rebuild it from
+   * the dense weights on first use.
+   **/
+  template <class Archive, class Layer>
+  static void serialize_storage(Archive &ar, Layer &layer) {
+    ar(cereal::make_nvp("weight_storage", layer.storage_),
+       cereal::make_nvp("sparse_threshold", layer.sparse_threshold_),
+       cereal::make_nvp("dense_released", layer.dense_released_));
+    if (layer.dense_released_) {
+      ar(cereal::make_nvp("sparse_weights", layer.sparse_W_));
+      layer.sparse_dirty_ = false;
+    }
+  }
+
+  template <class Archive>
+  static void serialize_input_range(Archive &ar,
+                                    core::Params &params,
+                                    std::uint32_t version) {
+    if (version >= 1) {
+      ar(cereal::make_nvp("input_min", params.input_min),
+         cereal::make_nvp("input_max", params.input_max));
+    }
+  }
+
 #ifndef CNN_NO_SERIALIZATION
 
+  template <class Archive>
+  static inline void serialize(Archive &ar, block_sparse_matrix &m) {
+    ar(cereal::make_nvp("rows", m.rows_), cereal::make_nvp("cols", m.cols_),
+       cereal::make_nvp("block_size", m.block_),
+       cereal::make_nvp("row_ptr", m.row_ptr_),
+       cereal::make_nvp("col_idx", m.col_idx_),
+       cereal::make_nvp("values", m.values_));
+  }
+
+  template <class Archive>
+  static inline void serialize(Archive &ar, codebook_matrix &m) {
+    ar(cereal::make_nvp("rows", m.rows_), cereal::make_nvp("cols", m.cols_),
+       cereal::make_nvp("codebook", m.codebook_),
+       cereal::make_nvp("indices", m.packed_));
+  }
+
   template <class Archive>
   static inline void serialize(Archive &ar, tiny_dnn::layer &layer) {
     auto all_weights = layer.weights();
@@ -546,6 +820,33 @@ struct serialization_buddy {
        cereal::make_nvp("variance", layer.variance_));
   }
 
+  template <class Archive>
+  static inline void serialize(Archive &ar,
+                               tiny_dnn::binary_convolutional_layer &layer) {
+    layer.serialize_prolog(ar);
+    auto &params_ = layer.params_;
+    ar(cereal::make_nvp("in_size", params_.in),
+       cereal::make_nvp("window_width", params_.weight.width_),
+       cereal::make_nvp("window_height", params_.weight.height_),
+       cereal::make_nvp("out_channels", params_.out.depth_),
+       cereal::make_nvp("pad_type", params_.pad_type),
+       cereal::make_nvp("has_bias", params_.has_bias),
+       cereal::make_nvp("w_stride", params_.w_stride),
+       cereal::make_nvp("h_stride", params_.h_stride));
+    serialize_extension(ar, layer, layer_version());
+  }
+
+  template <class Archive>
+  static inline void serialize(
+    Archive &ar, tiny_dnn::binary_fully_connected_layer &layer) {
+    layer.serialize_prolog(ar);
+    auto &params_ = layer.params_;
+    ar(cereal::make_nvp("in_size", params_.in_size_),
+       cereal::make_nvp("out_size", params_.out_size_),
+       cereal::make_nvp("has_bias", params_.has_bias_));
+    serialize_extension(ar, layer, layer_version());
+  }
+
   template <class Archive>
   static inline void serialize(Archive &ar, tiny_dnn::concat_layer &layer) {
     layer.serialize_prolog(ar);
@@ -566,6 +867,7 @@ struct serialization_buddy {
        cereal::make_nvp("has_bias", params_.has_bias),
        cereal::make_nvp("w_stride", params_.w_stride),
        cereal::make_nvp("h_stride", params_.h_stride));
+    serialize_extension(ar, layer, layer_version());
   }
 
   template <class Archive>
@@ -592,6 +894,16 @@ struct serialization_buddy {
        cereal::make_nvp("phase", layer.phase_));
   }
 
+  template <class Archive>
+  static inline void serialize(Archive &ar,
+                               tiny_dnn::fake_quantization_layer &layer) {
+    layer.serialize_prolog(ar);
+    ar(cereal::make_nvp("in_shape", layer.in_shape_),
+       cereal::make_nvp("mode", layer.mode_),
+       cereal::make_nvp("momentum", layer.momentum_),
+       cereal::make_nvp("phase", layer.phase_));
+  }
+
   template <class Archive>
   static inline void serialize(Archive &ar,
                                tiny_dnn::fully_connected_layer &layer) {
@@ -600,6 +912,16 @@ struct serialization_buddy {
     ar(cereal::make_nvp("in_size", params_.in_size_),
        cereal::make_nvp("out_size", params_.out_size_),
        cereal::make_nvp("has_bias", params_.has_bias_));
+    serialize_extension(ar, layer, layer_version());
+  }
+
+  template <class Archive>
+  static inline void serialize(
+    Archive &ar, tiny_dnn::global_average_pooling_fc_layer &layer) {
+    layer.serialize_prolog(ar);
+    ar(cereal::make_nvp("in_shape", layer.in_),
+       cereal::make_nvp("out_size", layer.out_size_),
+       cereal::make_nvp("has_bias", layer.has_bias_));
   }
 
   template <class Archive>
@@ -610,6 +932,25 @@ struct serialization_buddy {
     ar(cereal::make_nvp("in_shape", params_.in));
   }
 
+  template <class Archive>
+  static inline void serialize(Archive &ar, tiny_dnn::gru_layer &layer) {
+    layer.serialize_prolog(ar);
+    ar(cereal::make_nvp("in_size", layer.in_size_),
+       cereal::make_nvp("hidden_size", layer.hidden_size_),
+       cereal::make_nvp("seq_len", layer.seq_len_),
+       cereal::make_nvp("return_sequences", layer.return_sequences_),
+       cereal::make_nvp("bptt_steps", layer.bptt_steps_));
+  }
+
+  template <class Archive>
+  static inline void serialize(Archive &ar,
+                               tiny_dnn::hierarchical_softmax_layer &layer) {
+    layer.serialize_prolog(ar);
+    ar(cereal::make_nvp("in_size", layer.in_size_),
+       cereal::make_nvp("n_classes", layer.n_classes_),
+       cereal::make_nvp("cluster_ends", layer.cluster_ends_));
+  }
+
   template <class Archive>
   static inline void serialize(Archive &ar, tiny_dnn::input_layer &layer) {
     layer.serialize_prolog(ar);
@@ -634,6 +975,16 @@ struct serialization_buddy {
        cereal::make_nvp("region", layer.region_));
   }
 
+  template <class Archive>
+  static inline void serialize(Archive &ar, tiny_dnn::lstm_layer &layer) {
+    layer.serialize_prolog(ar);
+    ar(cereal::make_nvp("in_size", layer.in_size_),
+       cereal::make_nvp("hidden_size", layer.hidden_size_),
+       cereal::make_nvp("seq_len", layer.seq_len_),
+       cereal::make_nvp("return_sequences", layer.return_sequences_),
+       cereal::make_nvp("bptt_steps", layer.bptt_steps_));
+  }
+
   template <class Archive>
   static inline void serialize(Archive &ar,
                                tiny_dnn::max_pooling_layer &layer) {
@@ -678,6 +1029,7 @@ struct serialization_buddy {
        cereal::make_nvp("has_bias", params_.has_bias),
        cereal::make_nvp("w_stride", params_.w_stride),
        cereal::make_nvp("h_stride", params_.h_stride));
+    serialize_extension(ar, layer, layer_version());
   }
 
   template <class Archive>
@@ -704,6 +1056,25 @@ struct serialization_buddy {
     ar(cereal::make_nvp("in_size", params_.in_size_),
        cereal::make_nvp("out_size", params_.out_size_),
        cereal::make_nvp("has_bias", params_.has_bias_));
+    serialize_extension(ar, layer, layer_version());
+  }
+
+  template <class Archive>
+  static inline void serialize(Archive &ar,
+                               tiny_dnn::sampled_softmax_layer &layer) {
+    layer.serialize_prolog(ar);
+    // the custom proposal is stored as per-class probabilities
+    tiny_dnn::vec_t proposal;
+    if (layer.sampler_ == tiny_dnn::candidate_sampler::custom) {
+      for (tiny_dnn::label_t c = 0; c < layer.n_classes_; c++) {
+        proposal.push_back(layer.proposal(c));
+      }
+    }
+    ar(cereal::make_nvp("in_size", layer.in_size_),
+       cereal::make_nvp("n_classes", layer.n_classes_),
+       cereal::make_nvp("n_candidates", layer.n_candidates_),
+       cereal::make_nvp("sampler", layer.sampler_),
+       cereal::make_nvp("proposal", proposal));
   }
 
   template <class Archive>
@@ -779,6 +1150,16 @@ serialize(Archive &ar, T &layer) {
   serialization_buddy::serialize(ar, layer);
 }
 
+template <class Archive>
+void serialize(Archive &ar, tiny_dnn::block_sparse_matrix &m) {
+  serialization_buddy::serialize(ar, m);
+}
+
+template <class Archive>
+void serialize(Archive &ar, tiny_dnn::codebook_matrix &m) {
+  serialization_buddy::serialize(ar, m);
+}
+
 template <class Archive, typename T>
 void serialize(Archive &ar, tiny_dnn::index3d<T> &idx) {
   ar(cereal::make_nvp("width", idx.width_),
@@ -117,9 +117,12 @@ void layer::save_layer(OutputArchive &oa, const layer &l) {
 
 template <class Archive>
 void layer::serialize_prolog(Archive &ar) {
+  const std::uint32_t version = serialization_buddy::layer_version();
   ar(cereal::make_nvp(
     "type",
-    serialization_helper<Archive>::get_instance().type_name(typeid(*this))));
+    serialization_helper<Archive>::get_instance().type_name(typeid(*this)) +
+      "@" + std::to_string(version)));
+  serialization_buddy::serialize_common(ar, quantize_weights_, version);
 }
 
 }  // namespace tiny_dnn
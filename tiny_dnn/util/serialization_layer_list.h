@@ -17,16 +17,26 @@ void register_layers(T* h) {
   h->template register_layer<average_pooling_layer>("avepool");
   h->template register_layer<average_unpooling_layer>("aveunpool");
   h->template register_layer<batch_normalization_layer>("batchnorm");
+  h->template register_layer<binary_convolutional_layer>("b_conv");
+  h->template register_layer<binary_fully_connected_layer>(
+    "b_fully_connected");
   h->template register_layer<concat_layer>("concat");
   h->template register_layer<convolutional_layer>("conv");
   h->template register_layer<deconvolutional_layer>("deconv");
   h->template register_layer<dropout_layer>("dropout");
+  h->template register_layer<fake_quantization_layer>("fake_quantization");
   h->template register_layer<fully_connected_layer>("fully_connected");
+  h->template register_layer<global_average_pooling_fc_layer>(
+    "global_average_pooling_fc");
   h->template register_layer<global_average_pooling_layer>(
     "global_average_pooling");
+  h->template register_layer<gru_layer>("gru");
+  h->template register_layer<hierarchical_softmax_layer>(
+    "hierarchical_softmax");
   h->template register_layer<input_layer>("input");
   h->template register_layer<linear_layer>("linear");
   h->template register_layer<lrn_layer>("lrn");
+  h->template register_layer<lstm_layer>("lstm");
   h->template register_layer<max_pooling_layer>("maxpool");
   h->template register_layer<max_unpooling_layer>("maxunpool");
   h->template register_layer<power_layer>("power");
@@ -34,6 +44,7 @@ void register_layers(T* h) {
   h->template register_layer<quantized_deconvolutional_layer>("q_deconv");
   h->template register_layer<quantized_fully_connected_layer>(
     "q_fully_connected");
+  h->template register_layer<sampled_softmax_layer>("sampled_softmax");
   h->template register_layer<slice_layer>("slice");
 
   h->template register_layer<sigmoid_layer>("sigmoid");
@@ -0,0 +1,501 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tiny_dnn {
+
+/**
+ * phases of a single training step, in execution order
+ **/
+enum class train_phase : int {
+  data_copy = 0,  ///< gather the mini-batch into contiguous buffers
+  forward,        ///< forward propagation
+  loss,           ///< gradient of the loss function
+  backward,       ///< backward propagation
+  update          ///< optimizer step
+};
+
+static const int train_phase_count = 5;
+
+inline const char *to_string(train_phase phase) {
+  switch (phase) {
+    case train_phase::data_copy: return "data_copy";
+    case train_phase::forward: return "forward";
+    case train_phase::loss: return "loss";
+    case train_phase::backward: return "backward";
+    case train_phase::update: return "update";
+    default: return "unknown";
+  }
+}
+
+/**
+ * histogram over the most recent N observations, plus lifetime totals
+ *
+ * bucket bounds are inclusive upper bounds (prometheus "le" semantics);
+ * an implicit +Inf bucket catches everything above the last bound. The
+ * total_* values never decrease, as a prometheus histogram requires.
+ **/
+class rolling_histogram {
+ public:
+  static std::vector<double> default_latency_bounds() {
+    return {1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2,
+            5e-2, 0.1,    0.25,   0.5,  1.0,    2.5,    5.0,  10.0};
+  }
+
+  explicit rolling_histogram(
+    size_t window                     = 256,
+    const std::vector<double> &bounds = default_latency_bounds())
+    : bounds_(bounds),
+      buckets_(bounds.size() + 1, 0),
+      total_buckets_(bounds.size() + 1, 0),
+      ring_(std::max(window, size_t(1))),
+      head_(0),
+      size_(0),
+      sum_(0),
+      total_count_(0),
+      total_sum_(0) {
+    std::sort(bounds_.begin(), bounds_.end());
+  }
+
+  void observe(double v) {
+    if (size_ == ring_.size()) {
+      // evict the oldest observation
+      const double old = ring_[head_];
+      buckets_[bucket_of(old)]--;
+      sum_ -= old;
+    } else {
+      size_++;
+    }
+    ring_[head_] = v;
+    head_        = (head_ + 1) % ring_.size();
+    buckets_[bucket_of(v)]++;
+    sum_ += v;
+
+    total_buckets_[bucket_of(v)]++;
+    total_count_++;
+    total_sum_ += v;
+  }
+
+  ///< forgets the window; the lifetime totals are kept
+  void clear() {
+    std::fill(buckets_.begin(), buckets_.end(), 0);
+    head_ = size_ = 0;
+    sum_          = 0;
+  }
+
+  size_t count() const { return size_; }
+
+  double sum() const { return size_ ? sum_ : 0.0; }
+
+  double mean() const { return size_ ? sum_ / size_ : 0.0; }
+
+  /**
+   * q-quantile (0 <= q <= 1) of the observations in the window
+   **/
+  double quantile(double q) const {
+    if (size_ == 0) return 0.0;
+    // until the ring wraps around only the first size_ slots are valid
+    std::vector<double> v(ring_.begin(), ring_.begin() + size_);
+    const size_t k = std::min(size_ - 1, static_cast<size_t>(q * size_));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+  }
+
+  const std::vector<double> &bounds() const { return bounds_; }
+
+  /**
+   * cumulative count for each bound, followed by the +Inf bucket
+   **/
+  std::vector<size_t> cumulative_counts() const {
+    std::vector<size_t> c(buckets_.size());
+    size_t acc = 0;
+    for (size_t i = 0; i < buckets_.size(); i++) c[i] = (acc += buckets_[i]);
+    return c;
+  }
+
+  size_t total_count() const { return total_count_; }
+
+  double total_sum() const { return total_sum_; }
+
+  /**
+   * cumulative_counts() over every observation since construction
+   **/
+  std::vector<size_t> total_cumulative_counts() const {
+    std::vector<size_t> c(total_buckets_.size());
+    size_t acc = 0;
+    for (size_t i = 0; i < total_buckets_.size(); i++)
+      c[i] = (acc += total_buckets_[i]);
+    return c;
+  }
+
+ private:
+  size_t bucket_of(double v) const {
+    return std::lower_bound(bounds_.begin(), bounds_.end(), v) -
+           bounds_.begin();
+  }
+
+  std::vector<double> bounds_;
+  std::vector<size_t> buckets_;
+  std::vector<size_t> total_buckets_;
+  std::vector<double> ring_;
+  size_t head_;
+  size_t size_;
+  double sum_;
+  size_t total_count_;
+  double total_sum_;
+};
+
+/**
+ * one scraped value, in the shape of a prometheus sample
+ **/
+struct metric_sample {
+  std::string name;  ///< metric family name, without prefix
+  std::string type;  ///< "counter", "gauge" or "histogram"
+  std::vector<std::pair<std::string, std::string>> labels;
+  double value;
+};
+
+/**
+ * training throughput telemetry
+ *
+ * network::fit records wall-clock time of each training phase, the size of
+ * each mini-batch and the process cpu time consumed. Consumers pull the
+ * aggregated numbers at any time (also from another thread) via the getters,
+ * collect() or write_prometheus().
+ *
+ *     network<sequential> net;
+ *     ...
+ *     net.fit<mse>(opt, x, y, 32, 10,
+ *                  [](const training_telemetry &t) {
+ *                    std::cout << t.samples_per_second() << std::endl;
+ *                  },
+ *                  [](const training_telemetry &t) {
+ *                    t.write_prometheus(std::cout);
+ *                  });
+ *
+ * Rolling values (rates, quantiles, utilization) cover the last `window`
+ * mini-batches; counters and the exported histograms are cumulative over
+ * the lifetime of the object. The latency of the window is exported as
+ * gauges with a "quantile" label, named <histogram>_window.
+ **/
+class training_telemetry {
+ public:
+  typedef std::chrono::steady_clock clock;
+
+  explicit training_telemetry(size_t window = 256)
+    : batch_seconds_(window),
+      utilization_(window, {0.125, 0.25, 0.5, 0.75, 0.9, 1.0}),
+      batch_samples_(std::max(window, size_t(1)), 0),
+      batch_head_(0),
+      window_samples_(0),
+      samples_total_(0),
+      batches_total_(0),
+      epochs_total_(0),
+      hardware_threads_(std::max(1u, std::thread::hardware_concurrency())),
+      batch_cpu_begin_(0) {
+    for (int i = 0; i < train_phase_count; i++)
+      phase_seconds_.emplace_back(window);
+  }
+
+  training_telemetry(const training_telemetry &rhs) { *this = rhs; }
+
+  training_telemetry &operator=(const training_telemetry &rhs) {
+    if (this == &rhs) return *this;
+    std::lock(mtx_, rhs.mtx_);
+    std::lock_guard<std::mutex> l1(mtx_, std::adopt_lock);
+    std::lock_guard<std::mutex> l2(rhs.mtx_, std::adopt_lock);
+    batch_seconds_    = rhs.batch_seconds_;
+    phase_seconds_    = rhs.phase_seconds_;
+    utilization_      = rhs.utilization_;
+    batch_samples_    = rhs.batch_samples_;
+    batch_head_       = rhs.batch_head_;
+    window_samples_   = rhs.window_samples_;
+    samples_total_    = rhs.samples_total_;
+    batches_total_    = rhs.batches_total_;
+    epochs_total_     = rhs.epochs_total_;
+    hardware_threads_ = rhs.hardware_threads_;
+    batch_begin_      = rhs.batch_begin_;
+    batch_cpu_begin_  = rhs.batch_cpu_begin_;
+    return *this;
+  }
+
+  /////////////////////////////////////////////////////////////////////////
+  // producer side (called by network)
+
+  void begin_batch() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    batch_begin_     = clock::now();
+    batch_cpu_begin_ = std::clock();
+  }
+
+  void record_phase(train_phase phase, double seconds) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    phase_seconds_[static_cast<int>(phase)].observe(seconds);
+  }
+
+  void end_batch(size_t samples) {
+    const auto now     = clock::now();
+    const auto cpu_now = std::clock();
+    std::lock_guard<std::mutex> lock(mtx_);
+    const double wall =
+      std::chrono::duration<double>(now - batch_begin_).count();
+    const double cpu =
+      static_cast<double>(cpu_now - batch_cpu_begin_) / CLOCKS_PER_SEC;
+
+    batch_seconds_.observe(wall);
+    if (wall > 0) {
+      utilization_.observe(
+        std::min(1.0, std::max(0.0, cpu / (wall * hardware_threads_))));
+    }
+
+    window_samples_ -= batch_samples_[batch_head_];
+    batch_samples_[batch_head_] = samples;
+    window_samples_ += samples;
+    batch_head_ = (batch_head_ + 1) % batch_samples_.size();
+
+    samples_total_ += samples;
+    batches_total_++;
+  }
+
+  void end_epoch() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    epochs_total_++;
+  }
+
+  /**
+   * forget rolling statistics (counters are kept)
+   **/
+  void reset_window() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    batch_seconds_.clear();
+    utilization_.clear();
+    for (auto &h : phase_seconds_) h.clear();
+    std::fill(batch_samples_.begin(), batch_samples_.end(), 0);
+    window_samples_ = 0;
+  }
+
+  /////////////////////////////////////////////////////////////////////////
+  // consumer side
+
+  size_t samples_total() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return samples_total_;
+  }
+
+  size_t batches_total() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return batches_total_;
+  }
+
+  size_t epochs_total() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return epochs_total_;
+  }
+
+  /**
+   * training throughput over the rolling window
+   **/
+  double samples_per_second() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const double t = batch_seconds_.sum();
+    return t > 0 ? window_samples_ / t : 0.0;
+  }
+
+  /**
+   * mean wall-clock seconds per mini-batch over the rolling window
+   **/
+  double mean_batch_seconds() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return batch_seconds_.mean();
+  }
+
+  /**
+   * mean wall-clock seconds spent in the given phase over the rolling window
+   **/
+  double mean_phase_seconds(train_phase phase) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return phase_seconds_[static_cast<int>(phase)].mean();
+  }
+
+  /**
+   * q-quantile of the mini-batch latency over the rolling window
+   **/
+  double batch_latency_quantile(double q) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return batch_seconds_.quantile(q);
+  }
+
+  /**
+   * fraction of the hardware threads kept busy (process cpu time / wall time
+   * / hardware_concurrency), averaged over the rolling window
+   **/
+  double thread_utilization() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return utilization_.mean();
+  }
+
+  rolling_histogram batch_histogram() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return batch_seconds_;
+  }
+
+  rolling_histogram phase_histogram(train_phase phase) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return phase_seconds_[static_cast<int>(phase)];
+  }
+
+  /**
+   * snapshot of all metrics, suitable for an external exporter
+   **/
+  std::vector<metric_sample> collect() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<metric_sample> out;
+    const double t = batch_seconds_.sum();
+
+    out.push_back({"samples_total", "counter", {}, double(samples_total_)});
+    out.push_back({"batches_total", "counter", {}, double(batches_total_)});
+    out.push_back({"epochs_total", "counter", {}, double(epochs_total_)});
+    out.push_back({"samples_per_second", "gauge", {},
+                   t > 0 ? window_samples_ / t : 0.0});
+    out.push_back(
+      {"thread_utilization", "gauge", {}, utilization_.mean()});
+    out.push_back(
+      {"hardware_threads", "gauge", {}, double(hardware_threads_)});
+
+    append_histogram(out, "batch_seconds", batch_seconds_, {});
+    for (int i = 0; i < train_phase_count; i++) {
+      append_histogram(out, "phase_seconds", phase_seconds_[i],
+                       {{"phase", to_string(static_cast<train_phase>(i))}});
+    }
+
+    append_window(out, "batch_seconds", batch_seconds_, {});
+    for (int i = 0; i < train_phase_count; i++) {
+      append_window(out, "phase_seconds", phase_seconds_[i],
+                    {{"phase", to_string(static_cast<train_phase>(i))}});
+    }
+    return out;
+  }
+
+  /**
+   * write all metrics in prometheus text exposition format
+   **/
+  void write_prometheus(std::ostream &os,
+                        const std::string &prefix = "tiny_dnn_train_") const {
+    const auto samples = collect();
+    std::string last_family;
+
+    for (const auto &s : samples) {
+      std::string family = s.name;
+      if (s.type == "histogram") {
+        family = family.substr(0, family.rfind('_'));
+      }
+      if (family != last_family) {
+        os << "# TYPE " << prefix << family << " " << s.type << "\n";
+        last_family = family;
+      }
+      os << prefix << s.name;
+      if (!s.labels.empty()) {
+        os << "{";
+        for (size_t i = 0; i < s.labels.size(); i++) {
+          if (i) os << ",";
+          os << s.labels[i].first << "=\"" << s.labels[i].second << "\"";
+        }
+        os << "}";
+      }
+      os << " " << s.value << "\n";
+    }
+  }
+
+ private:
+  static void append_histogram(
+    std::vector<metric_sample> &out,
+    const std::string &name,
+    const rolling_histogram &h,
+    const std::vector<std::pair<std::string, std::string>> &labels) {
+    const auto counts = h.total_cumulative_counts();
+    for (size_t i = 0; i < counts.size(); i++) {
+      auto l = labels;
+      l.emplace_back("le", i < h.bounds().size()
+                             ? format_label(h.bounds()[i])
+                             : std::string("+Inf"));
+      out.push_back({name + "_bucket", "histogram", l, double(counts[i])});
+    }
+    out.push_back({name + "_sum", "histogram", labels, h.total_sum()});
+    out.push_back(
+      {name + "_count", "histogram", labels, double(h.total_count())});
+  }
+
+  // quantiles of the rolling window of h
+  static void append_window(
+    std::vector<metric_sample> &out,
+    const std::string &name,
+    const rolling_histogram &h,
+    const std::vector<std::pair<std::string, std::string>> &labels) {
+    for (double q : {0.5, 0.9, 0.99}) {
+      auto l = labels;
+      l.emplace_back("quantile", format_label(q));
+      out.push_back({name + "_window", "gauge", l, h.quantile(q)});
+    }
+  }
+
+  static std::string format_label(double v) {
+    std::ostringstream os;
+    os << v;
+    return os.str();
+  }
+
+  mutable std::mutex mtx_;
+  rolling_histogram batch_seconds_;
+  std::vector<rolling_histogram> phase_seconds_;
+  rolling_histogram utilization_;
+  std::vector<size_t> batch_samples_;
+  size_t batch_head_;
+  size_t window_samples_;
+  size_t samples_total_;
+  size_t batches_total_;
+  size_t epochs_total_;
+  unsigned int hardware_threads_;
+  clock::time_point batch_begin_;
+  std::clock_t batch_cpu_begin_;
+};
+
+/**
+ * records the lifetime of the scope as one phase of the current mini-batch
+ **/
+class train_phase_scope {
+ public:
+  train_phase_scope(training_telemetry &t, train_phase phase)
+    : t_(t), phase_(phase), begin_(training_telemetry::clock::now()) {}
+
+  ~train_phase_scope() {
+    t_.record_phase(phase_, std::chrono::duration<double>(
+                              training_telemetry::clock::now() - begin_)
+                              .count());
+  }
+
+  train_phase_scope(const train_phase_scope &) = delete;
+  train_phase_scope &operator=(const train_phase_scope &) = delete;
+
+ private:
+  training_telemetry &t_;
+  train_phase phase_;
+  training_telemetry::clock::time_point begin_;
+};
+
+}  // namespace tiny_dnn
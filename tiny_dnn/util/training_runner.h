@@ -0,0 +1,340 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+/**
+ * hands out a fixed number of cores to clients in proportion to their
+ * shares.
+ *
+ * A client holds a core between acquire() and release(), and reports the
+ * seconds it used. When a core is free it goes to the waiting client with
+ * the least used time per share, ties going to the client added first.
+ **/
+class fair_share_scheduler {
+ public:
+  explicit fair_share_scheduler(
+    size_t cores = std::thread::hardware_concurrency())
+    : free_(std::max(cores, size_t(1))) {}
+
+  /**
+   * @param share relative amount of cpu time the client is entitled to
+   * @return id of the client
+   **/
+  size_t add_client(double share = 1.0) {
+    if (share <= 0) throw nn_error("share must be positive");
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_.push_back(client{share, 0, 0, false});
+    return clients_.size() - 1;
+  }
+
+  // blocks until a core is granted to the client
+  void acquire(size_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait_for_core(lock, id);
+  }
+
+  // returns the core, charging the client for the seconds it held it
+  void release(size_t id, double seconds) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      charge(id, seconds);
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * release followed by acquire, where the client competes for the core
+   * it has just returned; between separate calls, another client could
+   * take the core without regard to the shares
+   **/
+  void yield(size_t id, double seconds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    charge(id, seconds);
+    cv_.notify_all();
+    wait_for_core(lock, id);
+  }
+
+  // cpu seconds charged to the client so far
+  double used(size_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_[id].used;
+  }
+
+  // number of clients waiting for a core
+  size_t waiting() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(
+      std::count_if(clients_.begin(), clients_.end(),
+                    [](const client &c) { return c.waiting; }));
+  }
+
+ private:
+  struct client {
+    double share;
+    double used;
+    double vtime;  // used / share
+    bool waiting;
+  };
+
+  void charge(size_t id, double seconds) {
+    clients_[id].used += seconds;
+    clients_[id].vtime += seconds / clients_[id].share;
+    free_++;
+  }
+
+  void wait_for_core(std::unique_lock<std::mutex> &lock, size_t id) {
+    clients_[id].waiting = true;
+    cv_.wait(lock, [&] { return free_ > 0 && next() == id; });
+    clients_[id].waiting = false;
+    free_--;
+    // the next client in line may have checked before this one won
+    if (free_ > 0) cv_.notify_all();
+  }
+
+  size_t next() const {
+    size_t best = clients_.size();
+    for (size_t i = 0; i < clients_.size(); i++) {
+      if (!clients_[i].waiting) continue;
+      if (best == clients_.size() || clients_[i].vtime < clients_[best].vtime)
+        best = i;
+    }
+    return best;
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<client> clients_;
+  size_t free_;
+};
+
+/**
+ * read-only training data, shared by all models of a training_runner
+ **/
+class shared_dataset {
+ public:
+  // classification
+  shared_dataset(const std::vector<vec_t> &inputs,
+                 const std::vector<label_t> &labels)
+    : labels_(labels) {
+    if (inputs.size() != labels.size()) {
+      throw nn_error("number of inputs and labels must be the same");
+    }
+    for (const auto &in : inputs) inputs_.push_back({in});
+  }
+
+  // regression
+  shared_dataset(const std::vector<vec_t> &inputs,
+                 const std::vector<vec_t> &targets) {
+    if (inputs.size() != targets.size()) {
+      throw nn_error("number of inputs and targets must be the same");
+    }
+    for (const auto &in : inputs) inputs_.push_back({in});
+    for (const auto &t : targets) targets_.push_back({t});
+  }
+
+  size_t size() const { return inputs_.size(); }
+
+  bool has_labels() const { return !labels_.empty(); }
+
+ private:
+  friend class training_runner;
+
+  std::vector<tensor_t> inputs_;
+  std::vector<label_t> labels_;
+  std::vector<tensor_t> targets_;
+};
+
+/**
+ * trains several networks concurrently in one process.
+ *
+ * Every model trains on its own thread, single-threaded, and between
+ * mini-batches asks a fair_share_scheduler for one of the runner's cores,
+ * so no more models than cores run at once and each gets cpu time in
+ * proportion to its share. The models read the same shared_dataset
+ * without copying it.
+ *
+ * @code
+ * shared_dataset data(images, labels);
+ * training_runner runner;  // one core per hardware thread
+ * for (size_t i = 0; i < nets.size(); i++) {
+ *   runner.add<cross_entropy>(nets[i], opts[i], data, 32, 10);
+ * }
+ * runner.run();
+ * @endcode
+ **/
+class training_runner {
+ public:
+  explicit training_runner(size_t cores = std::thread::hardware_concurrency())
+    : scheduler_(cores) {}
+
+  /**
+   * queues a model for training; net, optimizer and data must outlive
+   * run().
+   *
+   * @param net                the network, trained without resetting it
+   * @param optimizer          optimizing algorithm of this network
+   * @param data               training data
+   * @param batch_size         number of samples per parameter update
+   * @param epoch              number of training epochs
+   * @param on_batch_enumerate callback for each mini-batch enumerate
+   *                           (optionally taking const training_telemetry&)
+   * @param on_epoch_enumerate callback for each epoch
+   *                           (optionally taking const training_telemetry&)
+   * @param share              relative amount of cpu time of this model
+   * @return id of the model, to query used()
+   **/
+  template <typename Error,
+            typename NetType,
+            typename Optimizer,
+            typename OnBatchEnumerate,
+            typename OnEpochEnumerate>
+  size_t add(network<NetType> &net,
+             Optimizer &optimizer,
+             const shared_dataset &data,
+             size_t batch_size,
+             int epoch,
+             OnBatchEnumerate on_batch_enumerate,
+             OnEpochEnumerate on_epoch_enumerate,
+             double share = 1.0) {
+    if (batch_size == 0 || data.size() < batch_size) {
+      throw nn_error("batch size must be between 1 and the dataset size");
+    }
+    const serial_size_t dim_out = net.out_data_size();
+    for (size_t i = 0; i < data.labels_.size(); i++) {
+      net.check_t(i, data.labels_[i], dim_out);
+    }
+    for (size_t i = 0; i < data.targets_.size(); i++) {
+      net.check_t(i, data.targets_[i][0], dim_out);
+    }
+
+    // weights are initialized here, as the random generator is shared
+    net.net_.setup(false);
+
+    const size_t id = scheduler_.add_client(share);
+    jobs_.push_back([=, &net, &optimizer, &data]() mutable {
+      core_lease core(&scheduler_, id);
+      auto on_batch = [&](const training_telemetry &t) {
+        detail::invoke_train_callback(on_batch_enumerate, t, 0);
+        core.yield();
+      };
+      auto on_epoch = [&](const training_telemetry &t) {
+        detail::invoke_train_callback(on_epoch_enumerate, t, 0);
+      };
+
+      core.acquire();
+      if (data.has_labels()) {
+        net.template train_epochs<Error>(optimizer, data.inputs_, data.labels_,
+                                         batch_size, epoch, on_batch,
+                                         on_epoch, false, 1,
+                                         std::vector<tensor_t>());
+      } else {
+        net.template train_epochs<Error>(optimizer, data.inputs_,
+                                         data.targets_, batch_size, epoch,
+                                         on_batch, on_epoch, false, 1,
+                                         std::vector<tensor_t>());
+      }
+    });
+    return id;
+  }
+
+  template <typename Error, typename NetType, typename Optimizer>
+  size_t add(network<NetType> &net,
+             Optimizer &optimizer,
+             const shared_dataset &data,
+             size_t batch_size,
+             int epoch,
+             double share = 1.0) {
+    return add<Error>(net, optimizer, data, batch_size, epoch, nop, nop,
+                      share);
+  }
+
+  /**
+   * trains all queued models and returns when they are done. If training
+   * a model throws, the other models still finish and the first
+   * exception is rethrown.
+   **/
+  void run() {
+    std::vector<std::exception_ptr> errors(jobs_.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < jobs_.size(); i++) {
+      threads.emplace_back([&, i] {
+        try {
+          jobs_[i]();
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto &t : threads) t.join();
+    jobs_.clear();
+
+    for (auto &e : errors) {
+      if (e) std::rethrow_exception(e);
+    }
+  }
+
+  // cpu seconds the model has trained for
+  double used(size_t id) const { return scheduler_.used(id); }
+
+ private:
+  // a core of the scheduler, held by one model
+  class core_lease {
+   public:
+    core_lease(fair_share_scheduler *scheduler, size_t id)
+      : scheduler_(scheduler), id_(id), held_(false) {}
+
+    ~core_lease() {
+      if (held_) release();
+    }
+
+    void acquire() {
+      scheduler_->acquire(id_);
+      held_  = true;
+      start_ = std::chrono::steady_clock::now();
+    }
+
+    void yield() {
+      scheduler_->yield(id_, elapsed());
+      start_ = std::chrono::steady_clock::now();
+    }
+
+    void release() {
+      held_ = false;
+      scheduler_->release(id_, elapsed());
+    }
+
+   private:
+    double elapsed() const {
+      const auto d = std::chrono::steady_clock::now() - start_;
+      return std::chrono::duration<double>(d).count();
+    }
+
+    fair_share_scheduler *scheduler_;
+    size_t id_;
+    bool held_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  fair_share_scheduler scheduler_;
+  std::vector<std::function<void()>> jobs_;
+};
+
+}  // namespace tiny_dnn